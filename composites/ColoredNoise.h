@@ -1,13 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <vector>
 
 #include "AudioMath.h"
 #include "FFT.h"
-#include "FFTCrossFader.h"
 #include "FFTData.h"
 #include "IComposite.h"
-#include "ManagedPool.h"
 #include "ThreadClient.h"
 #include "ThreadServer.h"
 #include "ThreadSharedState.h"
@@ -19,7 +20,7 @@ struct Module;
 }
 }  // namespace rack
 using Module = ::rack::engine::Module;
-class NoiseMessage;
+class NoiseBankMessage;
 
 template <class TBase>
 class ColoredNoiseDescription : public IComposite {
@@ -28,22 +29,29 @@ public:
     int getNumParams() override;
 };
 
-const int crossfadeSamples = 4 * 1024;
-
 /**
  * Implementation of the "Colors" noises generator
  *
  * Original CPI = 11.7
  * service thread less often and iput less often -> 5.6
+ *
+ * Now it plays from a bank of noise buffers, one for each whole dB/octave
+ * of slope. The server makes them once, the first time they are needed. They all
+ * have the same phases, so mixing two neighbors gives the slopes in between,
+ * and turning the knob never goes back to the server.
+ * Each channel has its own bank, with its own random phases. Playing one buffer
+ * at different offsets would be the same noise delayed, and would comb filter
+ * when the channels are mixed. To keep the memory down the extra channels
+ * get shorter buffers, and the banks of channels that go away are freed.
  */
 template <class TBase>
 class ColoredNoise : public TBase {
 public:
-    ColoredNoise(Module* module) : TBase(module), crossFader(crossfadeSamples) {
+    ColoredNoise(Module* module) : TBase(module) {
         commonConstruct();
     }
 
-    ColoredNoise() : TBase(), crossFader(crossfadeSamples) {
+    ColoredNoise() : TBase() {
         commonConstruct();
     }
 
@@ -69,6 +77,7 @@ public:
     enum ParamIds {
         SLOPE_PARAM,
         SLOPE_TRIM,
+        CHANNELS_PARAM,
         NUM_PARAMS
     };
 
@@ -91,37 +100,60 @@ public:
     */
     void step() override;
 
+    /**
+     * The slope of the first channel, in dB per octave.
+     */
     float getSlope() const;
 
-    int _msgCount() const;  // just for debugging
+    /**
+     * How many channels have their noise bank. Just for debugging.
+     */
+    int _msgCount() const;
 
     typedef float T;  // use floats for all signals
 private:
     AudioMath::ScaleFun<T> cv_scaler;
-    bool isRequestPending = false;
     int cycleCount = 1;
 
+    std::unique_ptr<ThreadClient> thread;
+
+    static const int maxChannels = 16;
+    int numChannels = 1;
+    int playOffset = 0;
+
     /**
-     * crossFader generates the audio, but we must
-     * feed it with NoiseMessage data from the ThreadServer
+     * The first channel gets 1.5 seconds of noise (at 44.1k), about 4.5 MB.
+     * The others get a quarter of that.
      */
-    FFTCrossFader crossFader;
+    static const int firstBankSize = 64 * 1024;
+    static const int otherBankSize = 16 * 1024;
 
-    // just for debugging
-    int messageCount = 0;
-
-    std::unique_ptr<ThreadClient> thread;
+    /**
+     * One bank for each channel. The messages are made up front, the server
+     * allocates and fills in the buffers, and frees them again when the
+     * channel goes away, so the audio thread never does either.
+     * Banks are filled in channel order as channels are added, and freed
+     * from the top down, so the first numBanks channels always have theirs.
+     * The server can only take one message at a time, so pendingBank is the
+     * one it has, or -1.
+     */
+    std::unique_ptr<NoiseBankMessage> banks[maxChannels];
+    int numBanks = 0;
+    int pendingBank = -1;
 
     /**
-     * Messages moved between thread, messagePool, and crossFader
-     * as new noise slopes are requested in response to CV/knob changes.
+     * Each channel plays lowerBuffer + upperGain * (upperBuffer - lowerBuffer).
      */
-    ManagedPool<NoiseMessage, 2> messagePool;
+    float slopes[maxChannels] = {0};
+    const float* lowerBuffer[maxChannels] = {nullptr};
+    const float* upperBuffer[maxChannels] = {nullptr};
+    float upperGain[maxChannels] = {0};
 
     void serviceFFTServer();
     void serviceAudio();
     void serviceInputs();
     void commonConstruct();
+    void setSlope(int channel, float slope);
 };
 
 class NoiseMessage : public ThreadMessage {
@@ -144,6 +176,49 @@ public:
     std::unique_ptr<FFTDataReal> dataBuffer;
 };
 
+/**
+ * A noise buffer for each slope from minSlope to maxSlope dB per octave,
+ * in steps of one. All made from the same random phases.
+ * At 64K bins the buffers are about 4.5 MB in all, so the server allocates them.
+ */
+class NoiseBankMessage : public ThreadMessage {
+public:
+    static const int minSlope = -8;
+    static const int maxSlope = 8;
+    static const int numSlopes = maxSlope - minSlope + 1;
+
+    NoiseBankMessage(int numBins = 64 * 1024) : ThreadMessage(Type::NOISE_BANK), numBins(numBins) {
+        assert((numBins & (numBins - 1)) == 0);
+    }
+
+    int size() const {
+        return numBins;
+    }
+
+    const float* getBuffer(int slopeIndex) const {
+        assert(slopeIndex >= 0 && slopeIndex < numSlopes);
+        return buffers[slopeIndex]->data();
+    }
+
+    /**
+     * The slope is ignored, the rest applies to the whole bank.
+     */
+    ColoredNoiseSpec noiseSpec;
+
+    /**
+     * If set the server frees the buffers, instead of making them.
+     */
+    bool freeBuffers = false;
+
+    /**
+     * Server is going to make these, and fill them up with time-domain data.
+     */
+    std::unique_ptr<FFTDataReal> buffers[numSlopes];
+
+private:
+    const int numBins;
+};
+
 class NoiseServer : public ThreadServer {
 public:
     NoiseServer(std::shared_ptr<ThreadSharedState> state) : ThreadServer(state) {
@@ -155,6 +230,10 @@ protected:
      * We have plenty of time to do some heavy lifting here.
      */
     virtual void handleMessage(ThreadMessage* msg) override {
+        if (msg->type == ThreadMessage::Type::NOISE_BANK) {
+            handleBank(static_cast<NoiseBankMessage*>(msg));
+            return;
+        }
         if (msg->type != ThreadMessage::Type::NOISE) {
             assert(false);
             return;
@@ -177,125 +256,144 @@ private:
 
     // may do nothing, may create the first buffer,
     // may delete the old buffer and make a new one.
+    void reallocSpectrum(int size) {
+        if (noiseSpectrum && ((int)noiseSpectrum->size() == size)) {
+            return;
+        }
+
+        noiseSpectrum.reset(new FFTDataCpx(size));
+    }
+
     void reallocSpectrum(const NoiseMessage* msg) {
-        if (noiseSpectrum && ((int)noiseSpectrum->size() == msg->dataBuffer->size())) {
+        reallocSpectrum(msg->dataBuffer->size());
+    }
+
+    void handleBank(NoiseBankMessage* bankMessage) {
+        if (bankMessage->freeBuffers) {
+            for (auto& buffer : bankMessage->buffers) {
+                buffer.reset();
+            }
+            sendMessageToClient(bankMessage);
             return;
         }
 
-        noiseSpectrum.reset(new FFTDataCpx(msg->dataBuffer->size()));
+        const int size = bankMessage->size();
+        reallocSpectrum(size);
+
+        // new phases for every bank, so no two channels are the same noise
+        std::vector<float> phases(size);
+        for (int i = 0; i < size; ++i) {
+            phases[i] = float(2 * AudioMath::Pi * double(std::rand()) / double(RAND_MAX));
+        }
+
+        for (int i = 0; i < NoiseBankMessage::numSlopes; ++i) {
+            bankMessage->buffers[i].reset(new FFTDataReal(size));
+            ColoredNoiseSpec spec = bankMessage->noiseSpec;
+            spec.slope = float(NoiseBankMessage::minSlope + i);
+            FFT::makeNoiseSpectrum(noiseSpectrum.get(), spec, phases);
+            FFT::inverse(bankMessage->buffers[i].get(), *noiseSpectrum.get());
+            FFT::normalize(bankMessage->buffers[i].get(), 5);  // use 5v amplitude.
+        }
+        sendMessageToClient(bankMessage);
     }
 };
 
 template <class TBase>
 float ColoredNoise<TBase>::getSlope() const {
-    const NoiseMessage* curMsg = crossFader.playingMessage();
-    return curMsg ? curMsg->noiseSpec.slope : 0;
+    return numBanks ? slopes[0] : 0;
 }
 
 template <class TBase>
 void ColoredNoise<TBase>::commonConstruct() {
-    crossFader.enableMakeupGain(true);
     std::shared_ptr<ThreadSharedState> threadState = std::make_shared<ThreadSharedState>();
     std::unique_ptr<ThreadServer> server(new NoiseServer(threadState));
 
     std::unique_ptr<ThreadClient> client(new ThreadClient(threadState, std::move(server)));
     this->thread = std::move(client);
+
+    for (int i = 0; i < maxChannels; ++i) {
+        banks[i].reset(new NoiseBankMessage(i == 0 ? int(firstBankSize) : int(otherBankSize)));
+        banks[i]->noiseSpec.highFreqCorner = 6000;
+    }
 }
 
 template <class TBase>
 int ColoredNoise<TBase>::_msgCount() const {
-    return messageCount;
+    return numBanks;
 }
 
 template <class TBase>
 void ColoredNoise<TBase>::serviceFFTServer() {
-    // see if we need to request first frame of sample data
-    // first request will be white noise. Is that ok?
-    if (!isRequestPending && crossFader.empty()) {
-        assert(!messagePool.empty());
-        NoiseMessage* msg = messagePool.pop();
-
-        bool sent = thread->sendMessage(msg);
-        if (sent) {
-            isRequestPending = true;
-        } else {
-            messagePool.push(msg);
+    if (pendingBank < 0) {
+        if (numBanks < numChannels) {
+            banks[numBanks]->freeBuffers = false;
+            if (thread->sendMessage(banks[numBanks].get())) {
+                pendingBank = numBanks;
+            }
+        } else if (numBanks > numChannels) {
+            // stop playing it now, the server will free it
+            NoiseBankMessage* bank = banks[numBanks - 1].get();
+            bank->freeBuffers = true;
+            if (thread->sendMessage(bank)) {
+                pendingBank = --numBanks;
+            }
         }
     }
 
-    // see if any messages came back for us
     ThreadMessage* newMsg = thread->getMessage();
     if (newMsg) {
-        ++messageCount;
-        assert(newMsg->type == ThreadMessage::Type::NOISE);
-        NoiseMessage* noise = static_cast<NoiseMessage*>(newMsg);
-
-        isRequestPending = false;
-
-        // put it in the cross fader for playback
-        // give the last one back
-        NoiseMessage* oldMsg = crossFader.acceptData(noise);
-        if (oldMsg) {
-            messagePool.push(oldMsg);
+        assert(pendingBank >= 0 && newMsg == banks[pendingBank].get());
+        if (!banks[pendingBank]->freeBuffers) {
+            assert(pendingBank == numBanks);
+            ++numBanks;
         }
+        pendingBank = -1;
     }
 }
 
 template <class TBase>
 void ColoredNoise<TBase>::serviceAudio() {
-    float output = 0;
-    NoiseMessage* oldMessage = crossFader.step(&output);
-    if (oldMessage) {
-        // One frame may be done fading - we can take it back.
-        messagePool.push(oldMessage);
+    auto& output = TBase::outputs[AUDIO_OUTPUT];
+    const int playing = std::min(numChannels, numBanks);
+    for (int i = 0; i < playing; ++i) {
+        // the sizes are all powers of two, so this wraps the shorter ones
+        const int index = playOffset & (banks[i]->size() - 1);
+        const float lower = lowerBuffer[i][index];
+        output.setVoltage(lower + upperGain[i] * (upperBuffer[i][index] - lower), i);
     }
 
-    TBase::outputs[AUDIO_OUTPUT].setVoltage(output, 0);
+    // silent until the bank comes back
+    for (int i = playing; i < numChannels; ++i) {
+        output.setVoltage(0, i);
+    }
+    playOffset = (playOffset + 1) & (firstBankSize - 1);
 }
 
 template <class TBase>
-void ColoredNoise<TBase>::serviceInputs() {
-    if (isRequestPending) {
-        return;  // can't do anything until server is free.
-    }
-    if (crossFader.empty()) {
-        return;  // if we don't have data, we will be asking anyway
-    }
-    if (messagePool.empty()) {
-        return;  // all our buffers are in use
-    }
-
-    T combinedSlope = cv_scaler(
-        TBase::inputs[SLOPE_CV].getVoltage(0),
-        TBase::params[SLOPE_PARAM].value,
-        TBase::params[SLOPE_TRIM].value);
-
-    // get slope input to one decimal place
-    int i = int(combinedSlope * 10);
-    combinedSlope = i / 10.f;
-    ColoredNoiseSpec sp;
-    sp.slope = combinedSlope;
-    sp.highFreqCorner = 6000;
-    const NoiseMessage* playingData = crossFader.playingMessage();
-    if (!playingData || !(sp != playingData->noiseSpec)) {
-        // If we aren't playing yet, or no change in slope,
-        // the don't do anything
-        return;
-    }
+void ColoredNoise<TBase>::setSlope(int channel, float slope) {
+    slopes[channel] = slope;
+
+    // which two buffers, and how much of each
+    const float position = std::max(0.f, std::min(float(NoiseBankMessage::numSlopes - 1),
+                                                  slope - NoiseBankMessage::minSlope));
+    const int lowerIndex = std::min(int(position), NoiseBankMessage::numSlopes - 2);
+    lowerBuffer[channel] = banks[channel]->getBuffer(lowerIndex);
+    upperBuffer[channel] = banks[channel]->getBuffer(lowerIndex + 1);
+    upperGain[channel] = position - lowerIndex;
+}
 
-    assert(!messagePool.empty());
-    NoiseMessage* msg = messagePool.pop();
-    assert(msg);
-    if (!msg) {
-        return;
-    }
-    msg->noiseSpec = sp;
-    // TODO: put this logic in one place
-    bool sent = thread->sendMessage(msg);
-    if (sent) {
-        isRequestPending = true;
-    } else {
-        messagePool.push(msg);
+template <class TBase>
+void ColoredNoise<TBase>::serviceInputs() {
+    auto& slopeInput = TBase::inputs[SLOPE_CV];
+    numChannels = std::max(int(std::round(TBase::params[CHANNELS_PARAM].value)), int(slopeInput.channels));
+    numChannels = std::max(1, std::min(int(maxChannels), numChannels));
+    TBase::outputs[AUDIO_OUTPUT].setChannels(numChannels);
+
+    const T knob = TBase::params[SLOPE_PARAM].value;
+    const T trim = TBase::params[SLOPE_TRIM].value;
+    const int playing = std::min(numChannels, numBanks);
+    for (int i = 0; i < playing; ++i) {
+        setSlope(i, cv_scaler(slopeInput.getPolyVoltage(i), knob, trim));
     }
 }
 
@@ -329,6 +427,9 @@ inline IComposite::Config ColoredNoiseDescription<TBase>::getParam(int i) {
         case ColoredNoise<TBase>::SLOPE_TRIM:
             ret = {-1.0, 1.0, 1.0, "Freq slope CV trim"};
             break;
+        case ColoredNoise<TBase>::CHANNELS_PARAM:
+            ret = {1, 16, 1, "Polyphony"};
+            break;
         default:
             assert(false);
     }
@@ -161,6 +161,18 @@ private:
     void setupLimiter();
     void stepn();
     void pollAttackRelease();
+    void setupProcFunc();
+
+    /**
+     * All the compressors have the same settings, so we pick one of these
+     * when they change, and it runs all the banks with nothing called through a pointer.
+     */
+    template <Cmprsr::CurveType CURVE, bool REDUCE_DISTORTION>
+    void processBanks();
+    template <Cmprsr::CurveType CURVE>
+    void setupProcFunc();
+    using processFunction = void (Compressor<TBase>::*)();
+    processFunction procFun = nullptr;
 
     int numChannelsL_m = 0;
     int numBanksL_m = 0;
@@ -204,6 +216,7 @@ inline const std::vector<std::string>& Compressor<TBase>::ratiosLong() {
 template <class TBase>
 inline void Compressor<TBase>::init() {
     setupLimiter();
+    setupProcFunc();
     divn.setup(32, [this]() {
         this->stepn();
     });
@@ -300,6 +313,7 @@ inline void Compressor<TBase>::stepn() {
         }
     }
 
+    setupProcFunc();
     bypassed = !bool(std::round(Compressor<TBase>::params[NOTBYPASS_PARAM].value));
     // printf("notbypass value = %f, bypassed = %d\n", Compressor<TBase>::params[NOTBYPASS_PARAM].value, bypassed); fflush(stdout);
 }
@@ -347,10 +361,43 @@ inline void Compressor<TBase>::process(const typename TBase::ProcessArgs& args)
         return;
     }
 
+    assert(procFun);
+    (this->*procFun)();
+}
+
+template <class TBase>
+inline void Compressor<TBase>::setupProcFunc() {
+    switch (compressorsL[0].getCurveType()) {
+        case Cmprsr::CurveType::Limit:
+            setupProcFunc<Cmprsr::CurveType::Limit>();
+            break;
+        case Cmprsr::CurveType::HardKnee:
+            setupProcFunc<Cmprsr::CurveType::HardKnee>();
+            break;
+        case Cmprsr::CurveType::Table:
+            setupProcFunc<Cmprsr::CurveType::Table>();
+            break;
+    }
+}
+
+template <class TBase>
+template <Cmprsr::CurveType CURVE>
+inline void Compressor<TBase>::setupProcFunc() {
+    procFun = compressorsL[0].getReduceDistortion() ? &Compressor<TBase>::processBanks<CURVE, true> : &Compressor<TBase>::processBanks<CURVE, false>;
+}
+
+template <class TBase>
+template <Cmprsr::CurveType CURVE, bool REDUCE_DISTORTION>
+inline void Compressor<TBase>::processBanks() {
+    SqInput& inPortL = TBase::inputs[LAUDIO_INPUT];
+    SqOutput& outPortL = TBase::outputs[LAUDIO_OUTPUT];
+    SqInput& inPortR = TBase::inputs[RAUDIO_INPUT];
+    SqOutput& outPortR = TBase::outputs[RAUDIO_OUTPUT];
+
     for (int bank = 0; bank < numBanksL_m; ++bank) {
         const int baseChannel = bank * 4;
         const float_4 input = inPortL.getPolyVoltageSimd<float_4>(baseChannel);
-        const float_4 wetOutput = compressorsL[bank].step(input) * makeupGain_m;
+        const float_4 wetOutput = compressorsL[bank].template stepKernel<CURVE, REDUCE_DISTORTION>(input) * makeupGain_m;
         const float_4 mixedOutput = wetOutput * wetLevel + input * dryLevel;
 
         outPortL.setVoltageSimd(mixedOutput, baseChannel);
@@ -358,7 +405,7 @@ inline void Compressor<TBase>::process(const typename TBase::ProcessArgs& args)
     for (int bank = 0; bank < numBanksR_m; ++bank) {
         const int baseChannel = bank * 4;
         const float_4 input = inPortR.getPolyVoltageSimd<float_4>(baseChannel);
-        const float_4 wetOutput = compressorsR[bank].step(input) * makeupGain_m;
+        const float_4 wetOutput = compressorsR[bank].template stepKernel<CURVE, REDUCE_DISTORTION>(input) * makeupGain_m;
         const float_4 mixedOutput = wetOutput * wetLevel + input * dryLevel;
 
         outPortR.setVoltageSimd(mixedOutput, baseChannel);
@@ -58,6 +58,8 @@ public:
         NOTBYPASS_PARAM,
         WETDRY_PARAM,
         CHANNEL_PARAM,
+        DETECTOR_PARAM,
+        LOOKAHEAD_PARAM,
         NUM_PARAMS
     };
 
@@ -95,6 +97,12 @@ public:
     float getGainReductionDb() const;
     static const std::vector<std::string>& ratios();
     static const std::vector<std::string>& ratiosLong();
+
+    /**
+     * The choices for DETECTOR_PARAM. The first is the original peak follower,
+     * the others delay the audio by LOOKAHEAD_PARAM ms, and look ahead that far.
+     */
+    static const std::vector<std::string>& detectors();
     static std::function<double(double)> getSlowAttackFunction() {
         return AudioMath::makeFunc_Exp(0, 1, .05, 30);
     }
@@ -116,9 +124,24 @@ private:
     unsigned int currentChannel = 0;        // which of the 16 channels we are editing ATM.
 
     Cmprsr compressors[4];
+
+    /**
+     * All the compressors have the same settings, so we pick one of these
+     * when they change, and it runs all the banks with nothing called through a pointer.
+     */
+    template <Cmprsr::CurveType CURVE, bool REDUCE_DISTORTION>
+    void processBanks();
+    template <Cmprsr::CurveType CURVE, bool RMS>
+    void processBanksLookahead();
+    template <Cmprsr::CurveType CURVE>
+    void setupProcFunc();
+    void setupProcFunc();
+    using processFunction = void (Compressor2<TBase>::*)();
+    processFunction procFun = nullptr;
     void setupLimiter();
     void stepn();
     void pollAttackRelease();
+    void pollLookahead();
 
     int numChannels_m = 0;
     int numBanks_m = 0;
@@ -144,6 +167,9 @@ private:
     float lastThreshold = -1;
     float lastRatio = -1;
     int lastNumChannels = -1;
+    float lastRawDetector = -1;
+    float lastRawLookahead = -1;
+    int detector_m = 0;
     bool bypassed = false;
 };
 
@@ -157,9 +183,16 @@ inline const std::vector<std::string>& Compressor2<TBase>::ratiosLong() {
     return Cmprsr::ratiosLong();
 }
 
+template <class TBase>
+inline const std::vector<std::string>& Compressor2<TBase>::detectors() {
+    static const std::vector<std::string> theDetectors = {"Peak", "Look peak", "Look RMS"};
+    return theDetectors;
+}
+
 template <class TBase>
 inline void Compressor2<TBase>::init() {
     setupLimiter();
+    setupProcFunc();
     divn.setup(32, [this]() {
         this->stepn();
     });
@@ -232,6 +265,7 @@ inline void Compressor2<TBase>::stepn() {
     numBanks_m = (numChannels_m / 4) + ((numChannels_m % 4) ? 1 : 0);
 
     pollAttackRelease();
+    pollLookahead();
 
     const float rawWetDry = Compressor2<TBase>::params[WETDRY_PARAM].value;
     if (rawWetDry != lastRawMix) {
@@ -274,6 +308,7 @@ inline void Compressor2<TBase>::stepn() {
         }
     }
 
+    setupProcFunc();
     bypassed = !bool(std::round(Compressor2<TBase>::params[NOTBYPASS_PARAM].value));
     // printf("notbypass value = %f, bypassed = %d\n", Compressor2<TBase>::params[NOTBYPASS_PARAM].value, bypassed); fflush(stdout);
 }
@@ -298,6 +333,25 @@ inline void Compressor2<TBase>::pollAttackRelease() {
     }
 }
 
+template <class TBase>
+inline void Compressor2<TBase>::pollLookahead() {
+    const float rawDetector = Compressor2<TBase>::params[DETECTOR_PARAM].value;
+    const float rawLookahead = Compressor2<TBase>::params[LOOKAHEAD_PARAM].value;
+    if (rawDetector != lastRawDetector || rawLookahead != lastRawLookahead) {
+        lastRawDetector = rawDetector;
+        lastRawLookahead = rawLookahead;
+
+        detector_m = int(std::round(rawDetector));
+        if (detector_m != 0) {
+            const int samples = int(rawLookahead * .001f / TBase::engineGetSampleTime());
+            const bool rms = detector_m == 2;
+            for (int i = 0; i < 4; ++i) {
+                compressors[i].setLookahead(samples, rms);
+            }
+        }
+    }
+}
+
 template <class TBase>
 inline void Compressor2<TBase>::process(const typename TBase::ProcessArgs& args) {
     divn.step();
@@ -323,24 +377,66 @@ inline void Compressor2<TBase>::process(const typename TBase::ProcessArgs& args)
         return;
     }
 
+    assert(procFun);
+    (this->*procFun)();
+}
+
+template <class TBase>
+inline void Compressor2<TBase>::setupProcFunc() {
+    switch (compressors[0].getCurveType()) {
+        case Cmprsr::CurveType::Limit:
+            setupProcFunc<Cmprsr::CurveType::Limit>();
+            break;
+        case Cmprsr::CurveType::HardKnee:
+            setupProcFunc<Cmprsr::CurveType::HardKnee>();
+            break;
+        case Cmprsr::CurveType::Table:
+            setupProcFunc<Cmprsr::CurveType::Table>();
+            break;
+    }
+}
+
+template <class TBase>
+template <Cmprsr::CurveType CURVE>
+inline void Compressor2<TBase>::setupProcFunc() {
+    if (detector_m != 0) {
+        procFun = compressors[0].getLookaheadRMS() ? &Compressor2<TBase>::processBanksLookahead<CURVE, true> : &Compressor2<TBase>::processBanksLookahead<CURVE, false>;
+        return;
+    }
+    procFun = compressors[0].getReduceDistortion() ? &Compressor2<TBase>::processBanks<CURVE, true> : &Compressor2<TBase>::processBanks<CURVE, false>;
+}
+
+template <class TBase>
+template <Cmprsr::CurveType CURVE, bool REDUCE_DISTORTION>
+inline void Compressor2<TBase>::processBanks() {
+    SqInput& inPort = TBase::inputs[LAUDIO_INPUT];
+    SqOutput& outPort = TBase::outputs[LAUDIO_OUTPUT];
+
     for (int bank = 0; bank < numBanks_m; ++bank) {
         const int baseChannel = bank * 4;
         const float_4 input = inPort.getPolyVoltageSimd<float_4>(baseChannel);
-        const float_4 wetOutput = compressors[bank].step(input) * makeupGain_m;
+        const float_4 wetOutput = compressors[bank].template stepKernel<CURVE, REDUCE_DISTORTION>(input) * makeupGain_m;
         const float_4 mixedOutput = wetOutput * wetLevel + input * dryLevel;
 
         outPort.setVoltageSimd(mixedOutput, baseChannel);
     }
-#if 0
-    for (int bank = 0; bank < numBanksR_m; ++bank) {
+}
+
+template <class TBase>
+template <Cmprsr::CurveType CURVE, bool RMS>
+inline void Compressor2<TBase>::processBanksLookahead() {
+    SqInput& inPort = TBase::inputs[LAUDIO_INPUT];
+    SqOutput& outPort = TBase::outputs[LAUDIO_OUTPUT];
+
+    for (int bank = 0; bank < numBanks_m; ++bank) {
         const int baseChannel = bank * 4;
-        const float_4 input = inPortR.getPolyVoltageSimd<float_4>(baseChannel);
-        const float_4 wetOutput = compressorsR[bank].step(input) * makeupGain_m;
-        const float_4 mixedOutput = wetOutput * wetLevel + input * dryLevel;
+        const float_4 input = inPort.getPolyVoltageSimd<float_4>(baseChannel);
+        const float_4 wetOutput = compressors[bank].template stepLookahead<CURVE, RMS>(input) * makeupGain_m;
 
-        outPortR.setVoltageSimd(mixedOutput, baseChannel);
+        // the dry signal has to be delayed as much as the wet
+        const float_4 mixedOutput = wetOutput * wetLevel + compressors[bank].getDelayedInput() * dryLevel;
+        outPort.setVoltageSimd(mixedOutput, baseChannel);
     }
-#endif
 }
 
 // TODO: do we still need this old init function? combine with other?
@@ -355,6 +451,7 @@ inline void Compressor2<TBase>::setupLimiter() {
 template <class TBase>
 inline void Compressor2<TBase>::onSampleRateChange() {
     setupLimiter();
+    lastRawLookahead = -1;  // the lookahead is in samples
 }
 
 template <class TBase>
@@ -391,6 +488,12 @@ inline IComposite::Config Compressor2Description<TBase>::getParam(int i) {
         case Compressor2<TBase>::CHANNEL_PARAM:
             ret = {1, 16, 1, "edit channel"};
             break;
+        case Compressor2<TBase>::DETECTOR_PARAM:
+            ret = {0, 2, 0, "Detector"};
+            break;
+        case Compressor2<TBase>::LOOKAHEAD_PARAM:
+            ret = {1, 5, 2, "Lookahead time"};
+            break;
         default:
             assert(false);
     }
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "IComposite.h"
+#include "PartitionedConvolver.h"
+#include "ThreadClient.h"
+#include "ThreadServer.h"
+#include "ThreadSharedState.h"
+#include "assert.h"
+
+namespace rack {
+namespace engine {
+struct Module;
+}
+}  // namespace rack
+using Module = ::rack::engine::Module;
+
+template <class TBase>
+class ConvolverDescription : public IComposite {
+public:
+    Config getParam(int i) override;
+    int getNumParams() override;
+};
+
+/**
+ * Asks the server to build the convolvers for an impulse.
+ */
+class ConvolverLoadMessage : public ThreadMessage {
+public:
+    ConvolverLoadMessage() : ThreadMessage(Type::CONVOLVER_LOAD) {
+    }
+    ~ConvolverLoadMessage() {
+        delete impulse;
+    }
+
+    /**
+     * A new impulse from the UI, or null to rebuild the last one
+     * at a new block size. The server takes it.
+     */
+    std::vector<float>* impulse = nullptr;
+    int blockSize = PartitionedConvolver::minBlockSize;
+
+    /**
+     * Used in both directions.
+     * plugin->server: the old head, to be deleted by the server.
+     * server->plugin: the new head, or null if the impulse is empty.
+     */
+    std::unique_ptr<PartitionedConvolver> head;
+    bool hasTail = false;
+};
+
+/**
+ * One block of input for the tail, and the output of the one before it.
+ */
+class ConvolverTailMessage : public ThreadMessage {
+public:
+    ConvolverTailMessage(int size) : ThreadMessage(Type::CONVOLVER_TAIL),
+                                     input(size),
+                                     output(size) {
+    }
+
+    std::vector<float> input;
+    std::vector<float> output;
+
+    /**
+     * The blocks of input the audio thread had to drop since the last message.
+     */
+    int skippedBlocks = 0;
+};
+
+class ConvolverServer : public ThreadServer {
+public:
+    ConvolverServer(std::shared_ptr<ThreadSharedState> state) : ThreadServer(state) {
+    }
+
+    static const int tailBlockRatio = 16;
+
+    static int getTailBlockSize(int blockSize) {
+        return blockSize * tailBlockRatio;
+    }
+
+    /**
+     * Where the tail starts in the impulse.
+     */
+    static int getHeadSize(int blockSize) {
+        return 2 * getTailBlockSize(blockSize) - blockSize;
+    }
+
+    /**
+     * This is called on the server thread, not the audio thread.
+     */
+    void handleMessage(ThreadMessage* msg) override {
+        switch (msg->type) {
+            case ThreadMessage::Type::CONVOLVER_LOAD:
+                handleLoad(static_cast<ConvolverLoadMessage*>(msg));
+                break;
+            case ThreadMessage::Type::CONVOLVER_TAIL:
+                handleTail(static_cast<ConvolverTailMessage*>(msg));
+                break;
+            default:
+                assert(false);
+        }
+    }
+
+private:
+    std::vector<float> impulse;
+    std::unique_ptr<PartitionedConvolver> tail;
+
+    void handleLoad(ConvolverLoadMessage* msg) {
+        msg->head.reset();
+        tail.reset();
+        if (msg->impulse) {
+            impulse = std::move(*msg->impulse);
+            delete msg->impulse;
+            msg->impulse = nullptr;
+        }
+
+        const int size = int(impulse.size());
+        const int headSize = getHeadSize(msg->blockSize);
+        if (size > 0) {
+            msg->head.reset(new PartitionedConvolver(msg->blockSize, impulse.data(), std::min(size, headSize)));
+        }
+        if (size > headSize) {
+            tail.reset(new PartitionedConvolver(getTailBlockSize(msg->blockSize),
+                                                impulse.data() + headSize, size - headSize));
+        }
+        msg->hasTail = bool(tail);
+        sendMessageToClient(msg);
+    }
+
+    void handleTail(ConvolverTailMessage* msg) {
+        if (tail) {
+            tail->skip(msg->skippedBlocks);
+            tail->process(msg->input.data(), msg->output.data());
+        } else {
+            std::fill(msg->output.begin(), msg->output.end(), 0.f);
+        }
+        sendMessageToClient(msg);
+    }
+};
+
+/**
+ * Convolution with an impulse response (a cabinet or a room), at low latency.
+ *
+ * The impulse is split in two. The head, the first 2 * tailBlockSize - blockSize
+ * samples, is a PartitionedConvolver with the small block size, on the audio thread.
+ * The rest is a PartitionedConvolver with blocks tailBlockRatio times as big,
+ * on the server thread. Every tail block the audio thread sends the server the input
+ * it just finished, and gets back the output for the one before, which it plays
+ * over the next tail block. So the tail comes out 2 * tailBlockSize late, which is
+ * where it starts in the impulse, plus the head's latency.
+ * The whole output is the convolution, delayed by blockSize samples.
+ * The dry signal goes through the same delay, so the mix doesn't comb filter.
+ *
+ * If the server falls behind the tail is silent for a block, rather than
+ * the audio thread waiting. The server is told how many blocks it missed,
+ * so the tail stays in time.
+ *
+ * Loading an impulse, or changing the block size, rebuilds everything on the server.
+ * The wet signal is silent until the new one comes back.
+ */
+template <class TBase>
+class Convolver : public TBase {
+public:
+    Convolver(Module* module) : TBase(module) {
+        commonConstruct();
+    }
+
+    Convolver() : TBase() {
+        commonConstruct();
+    }
+
+    virtual ~Convolver() {
+        thread.reset();  // kill the threads before deleting other things
+        delete impulseRequest.exchange(nullptr);
+    }
+
+    /** Implement IComposite
+     */
+    static std::shared_ptr<IComposite> getDescription() {
+        return std::make_shared<ConvolverDescription<TBase>>();
+    }
+
+    void init() {
+    }
+
+    static const int maxBlockSize = 1024;
+
+    enum ParamIds {
+        BLOCK_SIZE_PARAM,
+        MIX_PARAM,
+        NUM_PARAMS
+    };
+
+    enum InputIds {
+        AUDIO_INPUT,
+        NUM_INPUTS
+    };
+
+    enum OutputIds {
+        AUDIO_OUTPUT,
+        NUM_OUTPUTS
+    };
+
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    /**
+    * Main processing entry point. Called every sample
+    */
+    void step() override;
+
+    /**
+     * May be called from any thread. The impulse is played at
+     * whatever sample rate we run at.
+     */
+    void setImpulse_UI(const std::vector<float>& impulse) {
+        delete impulseRequest.exchange(new std::vector<float>(impulse));
+    }
+
+    bool isImpulseLoaded() const {
+        return bool(head);
+    }
+
+    /**
+     * This is also the latency.
+     */
+    int getBlockSize() const {
+        return blockSize;
+    }
+
+    static int blockSizeFromParam(float value) {
+        const int index = std::max(0, std::min(5, int(std::round(value))));
+        return PartitionedConvolver::minBlockSize << index;
+    }
+
+    // just for debugging
+    int _underruns() const {
+        return underruns;
+    }
+
+    /**
+     * Just for tests: wait for the server instead of dropping tail blocks,
+     * so the output doesn't depend on how fast the server thread is.
+     */
+    void _setWaitForTail(bool wait) {
+        waitForTail = wait;
+    }
+
+private:
+    std::unique_ptr<ThreadClient> thread;
+    std::unique_ptr<ConvolverLoadMessage> loadMessage;
+    std::unique_ptr<ConvolverTailMessage> tailMessage;
+
+    // Only one message may be out at a time.
+    ThreadMessage* inFlight = nullptr;
+
+    // sent in on UI thread
+    std::atomic<std::vector<float>*> impulseRequest = {nullptr};
+    bool hasImpulse = false;
+
+    std::unique_ptr<PartitionedConvolver> head;
+    int blockSize = PartitionedConvolver::minBlockSize;
+
+    bool hasTail = false;
+    int tailBlockSize = 0;
+    std::vector<float> tailInput;
+    std::vector<float> tailOutput;
+    int tailIndex = 0;
+
+    // The dry signal, delayed blockSize samples to line up with the wet.
+    std::vector<float> dryDelay;
+    int dryIndex = 0;
+
+    // The output in tailMessage belongs to a block we already gave up on.
+    bool tailStale = true;
+    int skippedBlocks = 0;
+
+    int pollCounter = 0;
+    int underruns = 0;
+    bool waitForTail = false;
+
+    void commonConstruct();
+    void serviceServer();
+    void pollServer();
+    void endTailBlock();
+};
+
+template <class TBase>
+inline void Convolver<TBase>::commonConstruct() {
+    std::shared_ptr<ThreadSharedState> threadState = std::make_shared<ThreadSharedState>();
+    std::unique_ptr<ThreadServer> server(new ConvolverServer(threadState));
+
+    std::unique_ptr<ThreadClient> client(new ThreadClient(threadState, std::move(server)));
+    this->thread = std::move(client);
+
+    const int maxTailBlockSize = ConvolverServer::getTailBlockSize(maxBlockSize);
+    loadMessage.reset(new ConvolverLoadMessage());
+    tailMessage.reset(new ConvolverTailMessage(maxTailBlockSize));
+    tailInput.resize(maxTailBlockSize);
+    tailOutput.resize(maxTailBlockSize);
+    dryDelay.resize(maxBlockSize);
+}
+
+template <class TBase>
+inline void Convolver<TBase>::pollServer() {
+    if (!inFlight) {
+        return;
+    }
+    ThreadMessage* msg = thread->getMessage();
+    if (!msg) {
+        return;
+    }
+    assert(msg == inFlight);
+    inFlight = nullptr;
+
+    if (msg == loadMessage.get()) {
+        head = std::move(loadMessage->head);
+        hasTail = loadMessage->hasTail;
+        tailBlockSize = ConvolverServer::getTailBlockSize(blockSize);
+        tailIndex = 0;
+        std::fill(tailOutput.begin(), tailOutput.end(), 0.f);
+        tailStale = true;
+        skippedBlocks = 0;
+    }
+}
+
+template <class TBase>
+inline void Convolver<TBase>::serviceServer() {
+    pollServer();
+    if (inFlight) {
+        return;
+    }
+
+    // A request that couldn't be sent last time is still in the message.
+    if (!loadMessage->impulse) {
+        loadMessage->impulse = impulseRequest.exchange(nullptr);
+    }
+    const int newBlockSize = blockSizeFromParam(TBase::params[BLOCK_SIZE_PARAM].value);
+    const bool rebuild = hasImpulse && (newBlockSize != blockSize);
+    if (!loadMessage->impulse && !rebuild) {
+        return;
+    }
+
+    // The server deletes the old head, so we don't on the audio thread.
+    if (head) {
+        loadMessage->head = std::move(head);
+    }
+    hasTail = false;
+    loadMessage->blockSize = newBlockSize;
+    if (thread->sendMessage(loadMessage.get())) {
+        inFlight = loadMessage.get();
+        hasImpulse = true;
+        blockSize = newBlockSize;
+    }
+}
+
+template <class TBase>
+inline void Convolver<TBase>::endTailBlock() {
+    pollServer();
+    while (waitForTail && inFlight) {
+        std::this_thread::yield();
+        pollServer();
+    }
+
+    if (inFlight) {
+        // The server is late. Drop this block, and what it's working on now.
+        ++underruns;
+        ++skippedBlocks;
+        tailStale = true;
+        std::fill(tailOutput.begin(), tailOutput.begin() + tailBlockSize, 0.f);
+        return;
+    }
+
+    if (tailStale) {
+        std::fill(tailOutput.begin(), tailOutput.begin() + tailBlockSize, 0.f);
+    } else {
+        std::copy(tailMessage->output.begin(), tailMessage->output.begin() + tailBlockSize, tailOutput.begin());
+    }
+
+    std::copy(tailInput.begin(), tailInput.begin() + tailBlockSize, tailMessage->input.begin());
+    tailMessage->skippedBlocks = skippedBlocks;
+    if (thread->sendMessage(tailMessage.get())) {
+        inFlight = tailMessage.get();
+        skippedBlocks = 0;
+        tailStale = false;
+    } else {
+        ++underruns;
+        ++skippedBlocks;
+        tailStale = true;
+    }
+}
+
+template <class TBase>
+inline void Convolver<TBase>::step() {
+    if (++pollCounter >= PartitionedConvolver::minBlockSize) {
+        pollCounter = 0;
+        serviceServer();
+    }
+
+    const float input = TBase::inputs[AUDIO_INPUT].getVoltage(0);
+
+    // The block size may have just gone down.
+    if (dryIndex >= blockSize) {
+        dryIndex = 0;
+    }
+    const float dry = dryDelay[dryIndex];
+    dryDelay[dryIndex] = input;
+    if (++dryIndex == blockSize) {
+        dryIndex = 0;
+    }
+
+    float wet = 0;
+    if (head) {
+        wet = head->step(input);
+        if (hasTail) {
+            tailInput[tailIndex] = input;
+            wet += tailOutput[tailIndex];
+            if (++tailIndex == tailBlockSize) {
+                tailIndex = 0;
+                endTailBlock();
+            }
+        }
+    }
+
+    const float mix = TBase::params[MIX_PARAM].value;
+    TBase::outputs[AUDIO_OUTPUT].setVoltage(dry + mix * (wet - dry), 0);
+}
+
+template <class TBase>
+int ConvolverDescription<TBase>::getNumParams() {
+    return Convolver<TBase>::NUM_PARAMS;
+}
+
+template <class TBase>
+inline IComposite::Config ConvolverDescription<TBase>::getParam(int i) {
+    Config ret(0, 1, 0, "");
+    switch (i) {
+        case Convolver<TBase>::BLOCK_SIZE_PARAM:
+            ret = {0, 5, 2, "Block size"};
+            break;
+        case Convolver<TBase>::MIX_PARAM:
+            ret = {0, 1, 1, "Dry/wet mix"};
+            break;
+        default:
+            assert(false);
+    }
+    return ret;
+}
@@ -3,11 +3,22 @@
 #include "Divider.h"
 #include "IComposite.h"
 #ifndef _MSC_VER
-#include "MinBLEPVCO.h"
+#include "MinBLEPVCO_4.h"
 #endif
 #include "ObjectCache.h"
+#include "PolyApprox_4.h"
 #include "SqMath.h"
 
+#ifndef _CLAMP
+#define _CLAMP
+namespace std {
+inline float clamp(float v, float lo, float hi) {
+    assert(lo < hi);
+    return std::min(hi, std::max(v, lo));
+}
+}  // namespace std
+#endif
+
 namespace rack {
 namespace engine {
 struct Module;
@@ -25,6 +36,7 @@ public:
 /**
  * perf test 1.0 44.5
  * 44.7 with normalization
+ * three VCOs in one MinBLEPVCO_4, three saws: 85 ns -> 59 ns, 93 -> 79 with CV moving
  */
 template <class TBase>
 class EV3 : public TBase {
@@ -131,17 +143,17 @@ private:
     void stepn(int);
     void init();
     void processPWInputs();
-    void processPWInput(int osc);
     float getInput(int osc, InputIds in0, InputIds in1, InputIds in2);
 
-    MinBLEPVCO vcos[3];
-    float _freq[3];
-    float _out[3];
-    float _outGain[3];
+    /**
+     * The three VCOs are lanes 0..2. Lane 3 is unused.
+     */
+    MinBLEPVCO_4 vcos;
+    float_4 _outGain = 0;
+    float_4 lastPitch = -1000;
+    float lastSampleTime = 0;
     float _pitchOffset[3];
     float volumeScale = 1;
-    std::function<float(float)> expLookup =
-        ObjectCache<float>::getExp2Ex();
     std::shared_ptr<LookupTableParams<float>> audioTaper =
         ObjectCache<float>::getAudioTaper();
 
@@ -151,38 +163,30 @@ private:
 template <class TBase>
 inline void EV3<TBase>::init() {
     for (int i = 0; i < 3; ++i) {
-        vcos[i].setWaveform(MinBLEPVCO::Waveform::Saw);
-        _outGain[i] = 0;
+        vcos.setWaveform(i, MinBLEPVCO_4::Waveform::Saw);
         _pitchOffset[i] = 0;
     }
+    vcos.setWaveform(3, MinBLEPVCO_4::Waveform::END);
 
     div.setup(4, [this] {
         this->stepn(div.getDiv());
     });
-
-    vcos[0].setSyncCallback([this](float f) {
-        if (TBase::params[SYNC2_PARAM].value > .5) {
-            vcos[1].onMasterSync(f);
-        }
-
-        if (TBase::params[SYNC3_PARAM].value > .5) {
-            vcos[2].onMasterSync(f);
-        }
-    });
 }
 
 template <class TBase>
 inline void EV3<TBase>::setSync() {
-    vcos[0].setSyncEnabled(false);
-    vcos[1].setSyncEnabled(TBase::params[SYNC2_PARAM].value > .5);
-    vcos[2].setSyncEnabled(TBase::params[SYNC3_PARAM].value > .5);
+    // VCO 1 is the master, in lane 0
+    float_4 sync = 0;
+    sync[1] = TBase::params[SYNC2_PARAM].value;
+    sync[2] = TBase::params[SYNC3_PARAM].value;
+    vcos.setSyncEnabled(sync > float_4(.5f));
 }
 
 template <class TBase>
 inline void EV3<TBase>::processWaveforms() {
-    vcos[0].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE1_PARAM].value);
-    vcos[1].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE2_PARAM].value);
-    vcos[2].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE3_PARAM].value);
+    vcos.setWaveform(0, (MinBLEPVCO_4::Waveform)(int)TBase::params[WAVE1_PARAM].value);
+    vcos.setWaveform(1, (MinBLEPVCO_4::Waveform)(int)TBase::params[WAVE2_PARAM].value);
+    vcos.setWaveform(2, (MinBLEPVCO_4::Waveform)(int)TBase::params[WAVE3_PARAM].value);
 }
 
 template <class TBase>
@@ -203,24 +207,20 @@ float EV3<TBase>::getInput(int osc, InputIds in1, InputIds in2, InputIds in3) {
 }
 
 template <class TBase>
-void EV3<TBase>::processPWInput(int osc) {
-    const float pwmInput = getInput(osc, PWM1_INPUT, PWM2_INPUT, PWM3_INPUT) / 5.f;
-
-    const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
-    const float pwmTrim = TBase::params[PWM1_PARAM + delta].value;
-    const float pwInit = TBase::params[PW1_PARAM + delta].value;
+inline void EV3<TBase>::processPWInputs() {
+    float_4 pw = .5f;
+    for (int osc = 0; osc < 3; ++osc) {
+        const float pwmInput = getInput(osc, PWM1_INPUT, PWM2_INPUT, PWM3_INPUT) / 5.f;
 
-    float pw = pwInit + pwmInput * pwmTrim;
-    const float minPw = 0.05f;
-    pw = sq::rescale(std::clamp(pw, -1.0f, 1.0f), -1.0f, 1.0f, minPw, 1.0f - minPw);
-    vcos[osc].setPulseWidth(pw);
-}
+        const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
+        const float pwmTrim = TBase::params[PWM1_PARAM + delta].value;
+        const float pwInit = TBase::params[PW1_PARAM + delta].value;
 
-template <class TBase>
-inline void EV3<TBase>::processPWInputs() {
-    processPWInput(0);
-    processPWInput(1);
-    processPWInput(2);
+        float x = pwInit + pwmInput * pwmTrim;
+        const float minPw = 0.05f;
+        pw[osc] = sq::rescale(std::clamp(x, -1.0f, 1.0f), -1.0f, 1.0f, minPw, 1.0f - minPw);
+    }
+    vcos.setPulseWidth(pw);
 }
 
 template <class TBase>
@@ -250,17 +250,15 @@ inline void EV3<TBase>::step() {
     processPitchInputs();
     stepVCOs();
 
+    const float_4 rawWaveform = vcos.getOutput();
+    const float_4 scaledWaveform = rawWaveform * _outGain;
     float mix = 0;
     float totalGain = 0;
 
     for (int i = 0; i < 3; ++i) {
-        const float gain = _outGain[i];
-        const float rawWaveform = vcos[i].getOutput();
-        const float scaledWaveform = rawWaveform * gain;
-        totalGain += gain;
-        mix += scaledWaveform;
-        _out[i] = scaledWaveform;
-        TBase::outputs[VCO1_OUTPUT + i].value = rawWaveform;
+        totalGain += _outGain[i];
+        mix += scaledWaveform[i];
+        TBase::outputs[VCO1_OUTPUT + i].value = rawWaveform[i];
     }
     if (totalGain <= 1) {
         volumeScale = 1;
@@ -273,14 +271,13 @@ inline void EV3<TBase>::step() {
 
 template <class TBase>
 inline void EV3<TBase>::stepVCOs() {
-    for (int i = 0; i < 3; ++i) {
-        vcos[i].step();
-    }
+    vcos.step();
 }
 
 template <class TBase>
 inline void EV3<TBase>::processPitchInputs() {
     float lastFM = 0;
+    float pitches[3];
     for (int osc = 0; osc < 3; ++osc) {
         assert(osc >= 0 && osc <= 2);
         const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
@@ -302,11 +299,19 @@ inline void EV3<TBase>::processPitchInputs() {
 
         const float q = float(log2(261.626));  // move up to pitch range of EvenVCO
         pitch += q;
-        const float freq = expLookup(pitch);
-        _freq[osc] = freq;
-        vcos[osc].setNormalizedFreq(TBase::engineGetSampleTime() * freq,
-                                    TBase::engineGetSampleTime());
+        pitches[osc] = pitch;
+    }
+
+    // the pitch usually doesn't change, so skip the exp when it doesn't
+    const float_4 pitch4(pitches[0], pitches[1], pitches[2], 0);
+    const float sampleTime = TBase::engineGetSampleTime();
+    if (!rack::simd::movemask(pitch4 != lastPitch) && (sampleTime == lastSampleTime)) {
+        return;
     }
+    lastPitch = pitch4;
+    lastSampleTime = sampleTime;
+    const float_4 freq = PolyApprox_4::exp2<PolyApprox_4::Precision::High>(pitch4);
+    vcos.setNormalizedFreq(sampleTime * freq, sampleTime);
 }
 
 template <class TBase>
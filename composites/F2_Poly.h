@@ -10,6 +10,7 @@
 #include "Divider.h"
 #include "IComposite.h"
 #include "Limiter.h"
+#include "PolyApprox_4.h"
 #include "SqLog.h"
 #include "SqMath.h"
 #include "SqPort.h"
@@ -107,6 +108,8 @@ public:
  *  5X      12k         20k     10db
  *  10      14k         20k     12db
  * 
+ * Each bank now picks its own oversample rate (1X, 2X or 4X) from its Fc and Q,
+ * so low cutoff patches don't pay for the 4X.
  */
 template <class TBase>
 class F2_Poly : public TBase {
@@ -177,6 +180,12 @@ public:
 
     const StateVariableFilterParams2<T>& _params1() const;
     const StateVariableFilterParams2<T>& _params2() const;
+    int _oversample(int bank) const;
+
+    /**
+     * When off, always runs at 4X, like the original version.
+     */
+    void _setAdaptiveOversample(bool);
 
 private:
     StateVariableFilterParams2<T> params1[4];
@@ -184,8 +193,13 @@ private:
     StateVariableFilterState2<T> state1[4];
     StateVariableFilterState2<T> state2[4];
     Limiter limiter;
-    StateVariableFilter2<T>::processFunction filterFunc = nullptr;
-    const int oversample = 4;
+    StateVariableFilter2<T>::Mode mode_m = StateVariableFilter2<T>::Mode::LowPass;
+
+    /**
+     * each bank has its own oversample rate.
+     */
+    int oversample_m[4] = {4, 4, 4, 4};
+    bool adaptiveOversample = true;
 
     float_4 outputGain_n = 0;
     bool limiterEnabled_m = 0;
@@ -216,14 +230,27 @@ private:
 
     static float_4 fastQFunc(float_4 qV, int numStages);
     static std::pair<float_4, float_4> fastFcFunc2(float_4 freqVolts, float_4 rVolts, float oversample, float sampleTime);
+    int chooseOversample(int bank, float_4 maxFc) const;
+    void setOversample(int bank, int oversample);
 
+    using Mode = typename StateVariableFilter2<T>::Mode;
     using processFunction = void (F2_Poly<TBase>::*)(const typename TBase::ProcessArgs& args);
     processFunction procFun;
 
-    void processOneBankSeries(const typename TBase::ProcessArgs& args);
-    void processOneBank12_lim(const typename TBase::ProcessArgs& args);
-    void processOneBank12_nolim(const typename TBase::ProcessArgs& args);
-    void processGeneric(const typename TBase::ProcessArgs& args);
+    /**
+     * There is one of these for every combination of topology, mode and limiter,
+     * so the filters all inline. setupProcFunc picks one when the settings change.
+     */
+    template <Topology TOPOLOGY, Mode M, bool LIMITER>
+    void processBanks(const typename TBase::ProcessArgs& args);
+
+    template <Topology TOPOLOGY, Mode M, int OVERSAMPLE>
+    T runFilters(T input, int bank);
+
+    template <Topology TOPOLOGY, Mode M>
+    processFunction getProcFunc() const;
+    template <Topology TOPOLOGY>
+    processFunction getProcFunc() const;
 
     AudioMath_4::ScaleFun scaleFc = AudioMath_4::makeScalerWithBipolarAudioTrim(0, 10, 0, 10);
 #ifdef _ACDETECT
@@ -254,8 +281,8 @@ inline void F2_Poly<TBase>::stepm() {
     numBanks_m = (numChannels_m / 4) + ((numChannels_m % 4) ? 1 : 0);
 
     setupModes();
-    setupProcFunc();
     limiterEnabled_m = bool(std::round(F2_Poly<TBase>::params[LIMITER_PARAM].value));
+    setupProcFunc();
 
 #if !defined(_ACDETECT)
     const bool hres = bool(.5f < std::round(F2_Poly<TBase>::params[CV_UPDATE_FREQ].value));
@@ -283,20 +310,68 @@ inline const StateVariableFilterParams2<float_4>& F2_Poly<TBase>::_params2() con
     return params2[0];
 }
 
+template <class TBase>
+inline int F2_Poly<TBase>::_oversample(int bank) const {
+    return oversample_m[bank];
+}
+
+template <class TBase>
+inline void F2_Poly<TBase>::_setAdaptiveOversample(bool b) {
+    adaptiveOversample = b;
+
+    // force all the fc to be re-calculated
+    for (int bank = 0; bank < 4; ++bank) {
+        lastFcVC[bank] = float_4(-1000);
+    }
+}
+
+template <class TBase>
+inline int F2_Poly<TBase>::chooseOversample(int bank, float_4 maxFc) const {
+    if (!adaptiveOversample) {
+        return 4;
+    }
+
+    // The errors of the SVF (compared with running at a very high rate) grow with
+    // fcGain * qGain, which mostly shows up as passband gain error at low Q, and with fcGain ** 2,
+    // which is a tuning error that matters at high Q.
+    // Keeping fcGain * max(qGain, .24) under .03 holds both to about .2 db or a cent
+    // of the 4X response.
+    const float_4 fcGain = maxFc * float_4(float(2 * AudioMath::Pi));
+    const float_4 ratio = fcGain * SimdBlocks::max(params1[bank]._qGain(), float_4(.24f)) / float_4(.03f);
+    const float worst = std::max(std::max(ratio[0], ratio[1]), std::max(ratio[2], ratio[3]));
+
+    int oversample = (worst <= 1) ? 1 : ((worst <= 2) ? 2 : 4);
+
+    // Don't drop to a lower rate until we are well under the limit,
+    // so an Fc sitting right on the line doesn't keep toggling.
+    while (oversample < oversample_m[bank] && worst > .8f * oversample) {
+        oversample *= 2;
+    }
+    return oversample;
+}
+
+template <class TBase>
+inline void F2_Poly<TBase>::setOversample(int bank, int oversample) {
+    // The filter state is the same at any sample rate (z1 is the bandpass, z2 the lowpass),
+    // so we keep it. Switching is then as smooth as a small change in Fc.
+    assert(oversample == 1 || oversample == 2 || oversample == 4);
+    oversample_m[bank] = oversample;
+}
+
 template <class TBase>
 inline float_4 F2_Poly<TBase>::fastQFunc(float_4 qV, int numStages) {
     assert(numStages >= 1 && numStages <= 2);
 
     const float expMult = (numStages == 1) ? 1 / 1.5f : 1 / 2.5f;
-    float_4 q = rack::dsp::approxExp2_taylor5(qV * expMult) - .5;
+    float_4 q = PolyApprox_4::exp2(qV * expMult) - .5;
     return q;
 }
 
 template <class TBase>
 inline std::pair<float_4, float_4> F2_Poly<TBase>::fastFcFunc2(float_4 freqVolts, float_4 r, float oversample, float sampleTime) {
-    assert(oversample == 4);
+    assert(oversample == 1 || oversample == 2 || oversample == 4);
     assert(sampleTime < .0001);
-    float_4 freq = rack::dsp::FREQ_C4 * rack::dsp::approxExp2_taylor5(freqVolts + 30 - 4) / 1073741824;
+    float_4 freq = rack::dsp::FREQ_C4 * PolyApprox_4::exp2(freqVolts - 4);
 
     freq /= oversample;
     freq *= sampleTime;
@@ -327,8 +402,8 @@ inline void F2_Poly<TBase>::setupFreq() {
         qVolts += qPort.getPolyVoltageSimd<float_4>(baseChannel);
         qVolts = rack::simd::clamp(qVolts, 0, 10);
 
-        int changeMask = rack::simd::movemask(qVolts != lastQv[bank]);
-        if (changeMask) {
+        const bool qChanged = rack::simd::movemask(qVolts != lastQv[bank]);
+        if (qChanged) {
             lastQv[bank] = qVolts;
             float_4 q = fastQFunc(qVolts, numStages);
             params1[bank].setQ(q);
@@ -357,7 +432,8 @@ inline void F2_Poly<TBase>::setupFreq() {
         float_4 fcCV = fcPort.getPolyVoltageSimd<float_4>(baseChannel);
         const bool fcCVChanged = rack::simd::movemask(fcCV != lastFcVC[bank]);
 
-        if (fcCVChanged || rChanged || fcKnobChanged || fcTrimChanged) {
+        // Q changes can change the oversample rate, so they need a new fc, too
+        if (fcCVChanged || rChanged || fcKnobChanged || fcTrimChanged || qChanged) {
             // SQINFO("changed: %d, %d, %d, %d", fcCVChanged, rChanged, fcKnobChanged, fcTrimChanged);
             lastFcVC[bank] = fcCV;
 
@@ -367,10 +443,15 @@ inline void F2_Poly<TBase>::setupFreq() {
                 lastFcTrim);
             // SQINFO("cv=%f, knob=%f, trim=%f combined = %f", fcCV[0], lastFcKnob, lastFcTrim, combinedFcVoltage[0]);
 
-            auto fr = fastFcFunc2(combinedFcVoltage, processedRValue, float(oversample), sampleTime);
+            // second is always the higher of the two, since r >= 1
+            const auto fr = fastFcFunc2(combinedFcVoltage, processedRValue, 1, sampleTime);
+            const int oversample = chooseOversample(bank, fr.second);
+            if (oversample != oversample_m[bank]) {
+                setOversample(bank, oversample);
+            }
 
-            params1[bank].setFreq(fr.first);
-            params2[bank].setFreq(fr.second);
+            params1[bank].setFreq(fr.first / float(oversample));
+            params2[bank].setFreq(fr.second / float(oversample));
         }
     }
 }
@@ -378,8 +459,7 @@ inline void F2_Poly<TBase>::setupFreq() {
 template <class TBase>
 inline void F2_Poly<TBase>::setupModes() {
     const int modeParam = int(std::round(F2_Poly<TBase>::params[MODE_PARAM].value));
-    auto mode = StateVariableFilter2<T>::Mode(modeParam);
-    filterFunc = StateVariableFilter2<T>::getProcPointer(mode, oversample);
+    mode_m = StateVariableFilter2<T>::Mode(modeParam);
 
     const int topologyInt = int(std::round(F2_Poly<TBase>::params[TOPOLOGY_PARAM].value));
     topology_m = Topology(topologyInt);
@@ -387,20 +467,47 @@ inline void F2_Poly<TBase>::setupModes() {
 
 template <class TBase>
 inline void F2_Poly<TBase>::setupProcFunc() {
-    procFun = &F2_Poly<TBase>::processGeneric;
-    if (numBanks_m == 1) {
-        if (topology_m == Topology::SERIES) {
-            procFun = &F2_Poly<TBase>::processOneBankSeries;
-        } else if (topology_m == Topology::SINGLE) {
-            if (limiterEnabled_m) {
-                procFun = &F2_Poly<TBase>::processOneBank12_lim;
-            } else {
-                procFun = &F2_Poly<TBase>::processOneBank12_nolim;
-            }
-        }
+    switch (topology_m) {
+        case Topology::SINGLE:
+            procFun = getProcFunc<Topology::SINGLE>();
+            break;
+        case Topology::SERIES:
+            procFun = getProcFunc<Topology::SERIES>();
+            break;
+        case Topology::PARALLEL:
+            procFun = getProcFunc<Topology::PARALLEL>();
+            break;
+        case Topology::PARALLEL_INV:
+            procFun = getProcFunc<Topology::PARALLEL_INV>();
+            break;
+        default:
+            assert(false);
     }
 }
 
+template <class TBase>
+template <typename F2_Poly<TBase>::Topology TOPOLOGY>
+inline typename F2_Poly<TBase>::processFunction F2_Poly<TBase>::getProcFunc() const {
+    switch (mode_m) {
+        case Mode::LowPass:
+            return getProcFunc<TOPOLOGY, Mode::LowPass>();
+        case Mode::BandPass:
+            return getProcFunc<TOPOLOGY, Mode::BandPass>();
+        case Mode::HighPass:
+            return getProcFunc<TOPOLOGY, Mode::HighPass>();
+        case Mode::Notch:
+            return getProcFunc<TOPOLOGY, Mode::Notch>();
+    }
+    assert(false);
+    return nullptr;
+}
+
+template <class TBase>
+template <typename F2_Poly<TBase>::Topology TOPOLOGY, typename F2_Poly<TBase>::Mode M>
+inline typename F2_Poly<TBase>::processFunction F2_Poly<TBase>::getProcFunc() const {
+    return limiterEnabled_m ? &F2_Poly<TBase>::processBanks<TOPOLOGY, M, true> : &F2_Poly<TBase>::processBanks<TOPOLOGY, M, false>;
+}
+
 #ifdef _ACDETECT
 template <class TBase>
 inline void F2_Poly<TBase>::checkForACCV() {
@@ -447,95 +554,63 @@ inline void F2_Poly<TBase>::process(const typename TBase::ProcessArgs& args) {
 
     // always do the CV calc, even though it might be divided.
     stepn();
-    assert(oversample == 4);
     assert(procFun);
     (this->*procFun)(args);
 }
 
 template <class TBase>
-inline void F2_Poly<TBase>::processOneBankSeries(const typename TBase::ProcessArgs& args) {
-    SqInput& inPort = TBase::inputs[AUDIO_INPUT];
-    const float_4 input = inPort.getPolyVoltageSimd<float_4>(0);
-
-    const T temp = (*filterFunc)(input, state1[0], params1[0]);
-    T output = (*filterFunc)(temp, state2[0], params2[0]);
-
-    if (limiterEnabled_m) {
-        output = limiter.step(output);
-    } else {
-        output *= outputGain_n;
+template <typename F2_Poly<TBase>::Topology TOPOLOGY, typename F2_Poly<TBase>::Mode M, int OVERSAMPLE>
+inline typename F2_Poly<TBase>::T F2_Poly<TBase>::runFilters(T input, int bank) {
+    using Filter = StateVariableFilter2<T>;
+    switch (TOPOLOGY) {
+        case Topology::SERIES: {
+            const T temp = Filter::template run<M, OVERSAMPLE>(input, state1[bank], params1[bank]);
+            return Filter::template run<M, OVERSAMPLE>(temp, state2[bank], params2[bank]);
+        }
+        case Topology::PARALLEL:
+            return Filter::template run<M, OVERSAMPLE>(input, state1[bank], params1[bank]) +
+                   Filter::template run<M, OVERSAMPLE>(input, state2[bank], params2[bank]);
+        case Topology::PARALLEL_INV:
+            return Filter::template run<M, OVERSAMPLE>(input, state1[bank], params1[bank]) -
+                   Filter::template run<M, OVERSAMPLE>(input, state2[bank], params2[bank]);
+        case Topology::SINGLE:
+            return Filter::template run<M, OVERSAMPLE>(input, state1[bank], params1[bank]);
+        default:
+            assert(false);
     }
-
-    SqOutput& outPort = TBase::outputs[AUDIO_OUTPUT];
-    output = rack::simd::clamp(output, -10.f, 10.f);
-    outPort.setVoltageSimd(output, 0);
+    return input;
 }
 
 template <class TBase>
-inline void F2_Poly<TBase>::processOneBank12_lim(const typename TBase::ProcessArgs& args) {
+template <typename F2_Poly<TBase>::Topology TOPOLOGY, typename F2_Poly<TBase>::Mode M, bool LIMITER>
+inline void F2_Poly<TBase>::processBanks(const typename TBase::ProcessArgs& args) {
     SqInput& inPort = TBase::inputs[AUDIO_INPUT];
-    const float_4 input = inPort.getPolyVoltageSimd<float_4>(0);
-
-    T output = (*filterFunc)(input, state1[0], params1[0]);
-    output = limiter.step(output);
-
     SqOutput& outPort = TBase::outputs[AUDIO_OUTPUT];
-    output = rack::simd::clamp(output, -10.f, 10.f);
-    outPort.setVoltageSimd(output, 0);
-}
-
-template <class TBase>
-inline void F2_Poly<TBase>::processOneBank12_nolim(const typename TBase::ProcessArgs& args) {
-    SqInput& inPort = TBase::inputs[AUDIO_INPUT];
-    const float_4 input = inPort.getPolyVoltageSimd<float_4>(0);
-
-    T output = (*filterFunc)(input, state1[0], params1[0]);
-    output *= outputGain_n;
-
-    SqOutput& outPort = TBase::outputs[AUDIO_OUTPUT];
-    output = rack::simd::clamp(output, -10.f, 10.f);
-    outPort.setVoltageSimd(output, 0);
-}
-
-template <class TBase>
-inline void F2_Poly<TBase>::processGeneric(const typename TBase::ProcessArgs& args) {
-    SqInput& inPort = TBase::inputs[AUDIO_INPUT];
     for (int bank = 0; bank < numBanks_m; bank++) {
         const int baseChannel = 4 * bank;
         const float_4 input = inPort.getPolyVoltageSimd<float_4>(baseChannel);
+
+        // The oversample rate can be different for each bank, and changes with Fc,
+        // so it's a switch rather than more template arguments.
         T output;
-        switch (topology_m) {
-            case Topology::SERIES: {
-                const T temp = (*filterFunc)(input, state1[bank], params1[bank]);
-                output = (*filterFunc)(temp, state2[bank], params2[bank]);
-            } break;
-            case Topology::PARALLEL: {
-                // parallel add
-                output = (*filterFunc)(input, state1[bank], params1[bank]);
-                output += (*filterFunc)(input, state2[bank], params2[bank]);
-            } break;
-            case Topology::PARALLEL_INV: {
-                // parallel sub
-                output = (*filterFunc)(input, state1[bank], params1[bank]);
-                output -= (*filterFunc)(input, state2[bank], params2[bank]);
-            } break;
-            case Topology::SINGLE: {
-                // one filter 4X
-                output = (*filterFunc)(input, state1[bank], params1[bank]);
-            } break;
+        switch (oversample_m[bank]) {
+            case 1:
+                output = runFilters<TOPOLOGY, M, 1>(input, bank);
+                break;
+            case 2:
+                output = runFilters<TOPOLOGY, M, 2>(input, bank);
+                break;
             default:
-                assert(false);
+                output = runFilters<TOPOLOGY, M, 4>(input, bank);
         }
 
-        if (limiterEnabled_m) {
+        if (LIMITER) {
             output = limiter.step(output);
         } else {
             output *= outputGain_n;
         }
 
-        SqOutput& outPort = TBase::outputs[AUDIO_OUTPUT];
         output = rack::simd::clamp(output, -10.f, 10.f);
-
         outPort.setVoltageSimd(output, baseChannel);
     }
 }
@@ -39,7 +39,7 @@ public:
 template <class TBase>
 class Filt : public TBase {
 public:
-    using T = double;
+    using T = float_4;
     Filt(Module* module) : TBase(module) {
     }
     Filt() : TBase() {
@@ -141,7 +141,7 @@ public:
         int numFiltersActive = 0;
         int leftOutputChannels = 0;
         int rightOutputChannels = 0;
-        LadderFilterBank<T>::Modes mode = LadderFilterBank<T>::Modes::normal;
+        LadderFilterBank::Modes mode = LadderFilterBank::Modes::normal;
         SqInput* inputForChannel0 = nullptr;
         SqInput* inputForChannel1 = nullptr;
     };
@@ -152,7 +152,7 @@ public:
 
 private:
     void stepn(int);
-    LadderFilterBank<T> filters;
+    LadderFilterBank filters;
     Divider div;
     PeakDetector peak;
 
@@ -182,7 +182,7 @@ inline void Filt<TBase>::setupProcessingVars() {
     const bool ro = TBase::outputs[R_AUDIO_OUTPUT].isConnected();
 
     // Decode the modes. "weird" modes only possible with one filter
-    processingVars.mode = LadderFilterBank<T>::Modes::normal;
+    processingVars.mode = LadderFilterBank::Modes::normal;
     processingVars.leftOutputChannels = processingVars.numFiltersActive;
     processingVars.rightOutputChannels = 1;
     processingVars.inputForChannel0 = nullptr;
@@ -190,14 +190,14 @@ inline void Filt<TBase>::setupProcessingVars() {
 
     if (processingVars.numFiltersActive == 1) {
         if (li && ri && lo && ro) {
-            processingVars.mode = LadderFilterBank<T>::Modes::stereo;
+            processingVars.mode = LadderFilterBank::Modes::stereo;
             processingVars.inputForChannel1 = &TBase::inputs[R_AUDIO_INPUT];
             processingVars.numFiltersActive = 2;
         } else if (li && !ri && lo && ro) {
             // do we need lo here? if only right was connected we would still do this, yes?
-            processingVars.mode = LadderFilterBank<T>::Modes::leftOnly;
+            processingVars.mode = LadderFilterBank::Modes::leftOnly;
         } else if (!li && ri && lo && ro) {
-            processingVars.mode = LadderFilterBank<T>::Modes::rightOnly;
+            processingVars.mode = LadderFilterBank::Modes::rightOnly;
             processingVars.inputForChannel0 = &TBase::inputs[R_AUDIO_INPUT];
         }
     }
@@ -233,7 +233,7 @@ inline void Filt<TBase>::stepn(int divFactor) {
     // update the slope LEDs from the first filter stage
     for (int i = 0; i < 4; ++i) {
         // float s = imp._f.getLEDValue(i);
-        float s = filters.get(0).getLEDValue(i);
+        float s = filters.getLEDValue(0, i);
         s *= 2.5;
         s = s * s;
         TBase::lights[i + Filt<TBase>::SLOPE0_LIGHT].value = s;
@@ -248,7 +248,7 @@ template <class TBase>
 inline void Filt<TBase>::step() {
     div.step();
 
-    if (LadderFilterBank<T>::Modes::stereo == processingVars.mode) assert(processingVars.numFiltersActive == 2);
+    if (LadderFilterBank::Modes::stereo == processingVars.mode) assert(processingVars.numFiltersActive == 2);
 
     filters.step(processingVars.numFiltersActive, processingVars.mode,
                  TBase::inputs[L_AUDIO_INPUT], TBase::outputs[L_AUDIO_OUTPUT],
@@ -263,18 +263,18 @@ inline void Filt<TBase>::step() {
     }
 
     switch (processingVars.mode) {
-        case LadderFilterBank<T>::Modes::normal:
+        case LadderFilterBank::Modes::normal:
             TBase::outputs[R_AUDIO_OUTPUT].setVoltage(0, 0);
             break;
-        case LadderFilterBank<T>::Modes::stereo:
+        case LadderFilterBank::Modes::stereo:
             // copy the r output from poly port to  mono R out
             {
                 const float r = TBase::outputs[L_AUDIO_OUTPUT].getVoltage(1);
                 TBase::outputs[R_AUDIO_OUTPUT].setVoltage(r, 0);
             }
             break;
-        case LadderFilterBank<T>::Modes::rightOnly:
-        case LadderFilterBank<T>::Modes::leftOnly: {
+        case LadderFilterBank::Modes::rightOnly:
+        case LadderFilterBank::Modes::leftOnly: {
             const float r = TBase::outputs[L_AUDIO_OUTPUT].getVoltage(0);
             TBase::outputs[R_AUDIO_OUTPUT].setVoltage(r, 0);
         } break;
@@ -5,8 +5,12 @@
 #include "BiquadState.h"
 #include "HilbertFilterDesigner.h"
 #include "IComposite.h"
-#include "LookupTable.h"
-#include "SinOscillator.h"
+#include "PolyApprox_4.h"
+#include "QuadratureOscillator_4.h"
+#include "SqPort.h"
+
+#include <algorithm>
+#include <memory>
 
 namespace rack {
 namespace engine {
@@ -25,6 +29,10 @@ public:
 /**
  * Complete Frequency Shifter composite
  *
+ * Polyphonic, up to 16 channels. Four channels at a time go through the
+ * Hilbert filters and the quadrature oscillator as one float_4.
+ * A monophonic CV controls all the channels.
+ *
  * If TBase is WidgetComposite, this class is used as the implementation part of the Booty Shifter module.
  * If TBase is TestComposite, this class may stand alone for unit tests.
  */
@@ -48,15 +56,19 @@ public:
 
     void setSampleRate(float rate) {
         reciprocalSampleRate = 1 / rate;
-        HilbertFilterDesigner<T>::design(rate, hilbertFilterParamsSin, hilbertFilterParamsCos);
+
+        // design in float, then use the same taps for all four lanes
+        BiquadParams<float, 3> paramsSin;
+        BiquadParams<float, 3> paramsCos;
+        HilbertFilterDesigner<float>::design(rate, paramsSin, paramsCos);
+        for (int i = 0; i < 3 * 5; ++i) {
+            hilbertFilterParamsSin.setAtIndex(float_4(paramsSin.getAtIndex(i)), i);
+            hilbertFilterParamsCos.setAtIndex(float_4(paramsCos.getAtIndex(i)), i);
+        }
     }
 
     // must be called after setSampleRate
     void init() {
-        SinOscillator<T, true>::setFrequency(oscParams, T(.01));
-        exponential2 = ObjectCache<T>::getExp2();  // Get a shared copy of the 2**x lookup.
-                                                   // This will enable exp mode to track at
-                                                   // 1V/ octave.
     }
 
     // Define all the enums here. This will let the tests and the widget access them.
@@ -89,59 +101,65 @@ public:
     typedef float T;  // use floats for all signals
     T freqRange = 5;  // the freq range switch
 private:
-    SinOscillatorParams<T> oscParams;
-    SinOscillatorState<T> oscState;
-    BiquadParams<T, 3> hilbertFilterParamsSin;
-    BiquadParams<T, 3> hilbertFilterParamsCos;
-    BiquadState<T, 3> hilbertFilterStateSin;
-    BiquadState<T, 3> hilbertFilterStateCos;
+    QuadratureOscillator_4 oscillators[4];
+    BiquadParams<float_4, 3> hilbertFilterParamsSin;
+    BiquadParams<float_4, 3> hilbertFilterParamsCos;
+    BiquadState<float_4, 3> hilbertFilterStateSin[4];
+    BiquadState<float_4, 3> hilbertFilterStateCos[4];
 
-    std::shared_ptr<LookupTableParams<T>> exponential2;
+    float reciprocalSampleRate = 1.f / 44100.f;
 
-    float reciprocalSampleRate;
+    float_4 getFreqHz(int baseChannel);
 };
 
 template <class TBase>
-inline void FrequencyShifter<TBase>::step() {
-    assert(exponential2->isValid());
-
+inline float_4 FrequencyShifter<TBase>::getFreqHz(int baseChannel) {
     // Add the knob and the CV value.
-    T freqHz;
-    T cvTotal = TBase::params[PITCH_PARAM].value + TBase::inputs[CV_INPUT].getVoltage(0);
-    if (cvTotal > 5) {
-        cvTotal = 5;
-    }
-    if (cvTotal < -5) {
-        cvTotal = -5;
-    }
+    SqInput& cvPort = TBase::inputs[CV_INPUT];
+    const float_4 cv = (cvPort.channels > 1) ? cvPort.getVoltageSimd<float_4>(baseChannel) : float_4(cvPort.getVoltage(0));
+    float_4 cvTotal = float_4(TBase::params[PITCH_PARAM].value) + cv;
+    cvTotal = SimdBlocks::min(cvTotal, float_4(5));
+    cvTotal = SimdBlocks::max(cvTotal, float_4(-5));
+
     if (freqRange > .2) {
-        cvTotal *= freqRange;
-        cvTotal *= T(1. / 5.);
-        freqHz = cvTotal;
+        return cvTotal * float_4(freqRange * T(1. / 5.));
     } else {
-        cvTotal += 7;  // shift up to GE 2 (min value for out 1v/oct lookup)
-        freqHz = LookupTable<T>::lookup(*exponential2, cvTotal);
-        freqHz /= 2;  // down to 2..2k range that we want.
+        // 1V/octave, 2..2k range
+        return PolyApprox_4::exp2(cvTotal + float_4(6));
     }
+}
 
-    SinOscillator<float, true>::setFrequency(oscParams, freqHz * reciprocalSampleRate);
-
-    // Generate the quadrature sin oscillators.
-    T x, y;
-    SinOscillator<T, true>::runQuadrature(x, y, oscState, oscParams);
-
-    // Filter the input through the quadrature filter
-    const T input = TBase::inputs[AUDIO_INPUT].getVoltage(0);
-    const T hilbertSin = BiquadFilter<T>::run(input, hilbertFilterStateSin, hilbertFilterParamsSin);
-    const T hilbertCos = BiquadFilter<T>::run(input, hilbertFilterStateCos, hilbertFilterParamsCos);
-
-    // Cross modulate the two sections.
-    x *= hilbertSin;
-    y *= hilbertCos;
-
-    // And combine for final SSB output.
-    TBase::outputs[SIN_OUTPUT].setVoltage(x + y, 0);
-    TBase::outputs[COS_OUTPUT].setVoltage(x - y, 0);
+template <class TBase>
+inline void FrequencyShifter<TBase>::step() {
+    SqInput& inPort = TBase::inputs[AUDIO_INPUT];
+
+    // with nothing patched we still run one channel, like the mono version did
+    const int numChannels = std::max(1, int(inPort.channels));
+    const int numBanks = (numChannels + 3) / 4;
+    TBase::outputs[SIN_OUTPUT].setChannels(numChannels);
+    TBase::outputs[COS_OUTPUT].setChannels(numChannels);
+
+    for (int bank = 0; bank < numBanks; ++bank) {
+        const int baseChannel = bank * 4;
+        oscillators[bank].setFrequency(getFreqHz(baseChannel) * float_4(reciprocalSampleRate));
+
+        // Generate the quadrature sin oscillators.
+        float_4 x, y;
+        oscillators[bank].run(x, y);
+
+        // Filter the input through the quadrature filter
+        const float_4 input = inPort.getVoltageSimd<float_4>(baseChannel);
+        const float_4 hilbertSin = BiquadFilter<float_4>::run(input, hilbertFilterStateSin[bank], hilbertFilterParamsSin);
+        const float_4 hilbertCos = BiquadFilter<float_4>::run(input, hilbertFilterStateCos[bank], hilbertFilterParamsCos);
+
+        // Cross modulate the two sections.
+        x *= hilbertSin;
+        y *= hilbertCos;
+
+        // And combine for final SSB output.
+        TBase::outputs[SIN_OUTPUT].setVoltageSimd(x + y, baseChannel);
+        TBase::outputs[COS_OUTPUT].setVoltageSimd(x - y, baseChannel);
+    }
 }
 
 template <class TBase>
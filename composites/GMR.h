@@ -77,6 +77,9 @@ inline void GMR<TBase>::step() {
     inputClockProcessing.go(inClock);
     if (inputClockProcessing.trigger()) {
         outClock = gtg->clock();
+    } else {
+        // keep the next few bars generated, so clocks don't have to
+        gtg->fillLookahead();
     }
     outputProcessing.go(outClock);
     TBase::outputs[TRIGGER_OUTPUT].setVoltage(outputProcessing.get(), 0);
@@ -4,7 +4,12 @@
 #include "SqPort.h"
 #include "SqStream.h"
 
-template <typename T>
+/**
+ * Up to 16 channels of LadderFilter, four channels per LadderFilter<float_4>.
+ *
+ * A single channel uses a scalar LadderFilter<double> instead, like Filt
+ * did before, since running three idle lanes made mono slower than that.
+ */
 class LadderFilterBank {
 public:
     enum class Modes {
@@ -16,9 +21,9 @@ public:
     void stepn(float sampleTime, int numChannels,
                SqInput& fc1Input, SqInput& fc2Input, SqInput& qInput, SqInput& driveInput, SqInput& edgeInput, SqInput& slopeInput,
                float fcParam, float fc1TrimParam, float fc2TrimParam,
-               T volume,
+               float volume,
                float qParam, float qTrimParam, float makeupGainParam,
-               typename LadderFilter<T>::Types type, typename LadderFilter<T>::Voicing voicing,
+               LadderFilterBase::Types type, LadderFilterBase::Voicing voicing,
                float driveParam, float driveTrim,
                float edgeParam, float edgeTrim,
                float slopeParam, float slopeTrim,
@@ -39,16 +44,24 @@ public:
         s.add("[");
         s.add(channel);
         s.add("] ");
-        filters[channel]._dump(s.str());
+        if (isMono) {
+            monoFilter._dump(s.str());
+        } else {
+            filters[channel / 4]._dump(channel % 4, s.str());
+        }
     }
-    const LadderFilter<T>& get(int channel) {
-        return filters[channel];
+
+    float getLEDValue(int channel, int tapNumber) const {
+        return isMono ? monoFilter.getLEDValue(tapNumber) : filters[channel / 4].getLEDValue(channel % 4, tapNumber);
     }
 
 private:
-    LadderFilter<T> filters[16];
+    static const int maxBanks = 4;
+    LadderFilter<float_4> filters[maxBanks];
+    LadderFilter<double> monoFilter;
+    bool isMono = true;
 
-    std::shared_ptr<LookupTableParams<T>> expLookup = ObjectCache<T>::getExp2();  // Do we need more precision?
+    std::shared_ptr<LookupTableParams<float>> expLookup = ObjectCache<float>::getExp2();  // Do we need more precision?
     AudioMath::ScaleFun<float> scaleGain = AudioMath::makeLinearScaler<float>(0, 1);
     std::shared_ptr<LookupTableParams<float>> audioTaper = {ObjectCache<float>::getAudioTaper()};
 
@@ -58,58 +71,69 @@ private:
     AudioMath::ScaleFun<float> scaleEdge = AudioMath::makeScalerWithBipolarAudioTrim(0, 1);
 };
 
-template <typename T>
-inline void LadderFilterBank<T>::stepn(float sampleTime, int numChannels,
-                                       SqInput& fc1Input, SqInput& fc2Input, SqInput& qInput, SqInput& driveInput, SqInput& edgeInput, SqInput& slopeInput,
-                                       float fcParam, float fc1TrimParam, float fc2TrimParam,
-                                       T volume,
-                                       float qParam, float qTrimParam, float makeupGainParam,
-                                       typename LadderFilter<T>::Types type, typename LadderFilter<T>::Voicing voicing,
-                                       float driveParam, float driveTrimParam,
-                                       float edgeParam, float edgeTrim,
-                                       float slopeParam, float slopeTrim,
-                                       float spreadParam) {
-    for (int channel = 0; channel < numChannels; ++channel) {
-        LadderFilter<T>& filt = filters[channel];
-
+inline void LadderFilterBank::stepn(float sampleTime, int numChannels,
+                                   SqInput& fc1Input, SqInput& fc2Input, SqInput& qInput, SqInput& driveInput, SqInput& edgeInput, SqInput& slopeInput,
+                                   float fcParam, float fc1TrimParam, float fc2TrimParam,
+                                   float volume,
+                                   float qParam, float qTrimParam, float makeupGainParam,
+                                   LadderFilterBase::Types type, LadderFilterBase::Voicing voicing,
+                                   float driveParam, float driveTrimParam,
+                                   float edgeParam, float edgeTrim,
+                                   float slopeParam, float slopeTrim,
+                                   float spreadParam) {
+    isMono = (numChannels == 1);
+    if (isMono) {
+        monoFilter.setType(type);
+        monoFilter.setVoicing(voicing);
+        monoFilter.setVolume(volume);
+    }
+    const int numBanks = isMono ? 0 : (numChannels + 3) / 4;
+    for (int bank = 0; bank < numBanks; ++bank) {
+        LadderFilter<float_4>& filt = filters[bank];
         filt.setType(type);
         filt.setVoicing(voicing);
         filt.setVolume(volume);
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        LadderFilter<float_4>& filt = filters[channel / 4];
+        const int lane = channel % 4;
+        float fcClipped = 0;
+        float res = 0;
+        float makeupGain = 0;
+        float gain = 0;
+        float edge = 0;
+        float slope = 0;
 
         // filter Fc calc
         {
-            T fcClipped = 0;
-            T freqCV1 = scaleFc(
+            float freqCV1 = scaleFc(
                 fc1Input.getPolyVoltage(channel),
                 fcParam,
                 fc1TrimParam);
-            T freqCV2 = scaleFc(
+            float freqCV2 = scaleFc(
                 fc2Input.getPolyVoltage(channel),
                 0,
                 fc2TrimParam);  // note: test second inputs
-            T freqCV = freqCV1 + freqCV2 + 6;
-            const T fc = LookupTable<T>::lookup(*expLookup, freqCV, true) * 10;
-            const T normFc = fc * sampleTime;
+            float freqCV = freqCV1 + freqCV2 + 6;
+            const float fc = LookupTable<float>::lookup(*expLookup, freqCV, true) * 10;
+            const float normFc = fc * sampleTime;
 
-            fcClipped = std::min(normFc, T(.48));
-            fcClipped = std::max(fcClipped, T(.0000001));
-            filt.setNormalizedFc(fcClipped);
+            fcClipped = std::min(normFc, .48f);
+            fcClipped = std::max(fcClipped, .0000001f);
         }
         {
-            T res = scaleQ(
+            res = scaleQ(
                 qInput.getPolyVoltage(0),
                 qParam,
                 qTrimParam);
-            const T qMiddle = 2.8;
-            res = (res < 2) ? (res * qMiddle / 2) : .5 * (res - 2) * (4 - qMiddle) + qMiddle;
+            const float qMiddle = 2.8f;
+            res = (res < 2) ? (res * qMiddle / 2) : .5f * (res - 2) * (4 - qMiddle) + qMiddle;
 
             if (res < 0 || res > 4) fprintf(stderr, "res out of bounds %f\n", res);
 
-            const T bAmt = makeupGainParam;
-            const T makeupGain = 1 + bAmt * (res);
-
-            filt.setFeedback(res);
-            filt.setBassMakeupGain(makeupGain);
+            const float bAmt = makeupGainParam;
+            makeupGain = 1 + bAmt * (res);
         }
         {
             float gainInput = scaleGain(
@@ -117,48 +141,68 @@ inline void LadderFilterBank<T>::stepn(float sampleTime, int numChannels,
                 driveParam,
                 driveTrimParam);
 
-            T gain = T(.15) + 4 * LookupTable<float>::lookup(*audioTaper, gainInput, false);
-            filt.setGain(gain);
+            gain = .15f + 4 * LookupTable<float>::lookup(*audioTaper, gainInput, false);
         }
         {
-            const float edge = scaleEdge(
+            edge = scaleEdge(
                 edgeInput.getPolyVoltage(channel),
                 edgeParam,
                 edgeTrim);
-            filt.setEdge(edge);
         }
         {
-            T slope = scaleSlope(
+            slope = scaleSlope(
                 slopeInput.getPolyVoltage(channel),
                 slopeParam,
                 slopeTrim);
-            filt.setSlope(slope);
         }
-        filt.setFreqSpread(spreadParam);
+
+        if (isMono) {
+            monoFilter.setNormalizedFc(fcClipped);
+            monoFilter.setFeedback(res);
+            monoFilter.setBassMakeupGain(makeupGain);
+            monoFilter.setGain(gain);
+            monoFilter.setEdge(edge);
+            monoFilter.setSlope(slope);
+            monoFilter.setFreqSpread(spreadParam);
+        } else {
+            filt.setNormalizedFc(lane, fcClipped);
+            filt.setFeedback(lane, res);
+            filt.setBassMakeupGain(lane, makeupGain);
+            filt.setGain(lane, gain);
+            filt.setEdge(lane, edge);
+            filt.setSlope(lane, slope);
+            filt.setFreqSpread(lane, spreadParam);
+        }
     }
 }
 
-template <typename T>
-inline void LadderFilterBank<T>::step(int numChannels, Modes mode,
-                                      SqInput& audioInput, SqOutput& audioOutput,
-                                      SqInput* inputForChannel0, SqInput* inputForChannel1,
-                                      PeakDetector& peak) {
-    for (int channel = 0; channel < numChannels; ++channel) {
-        LadderFilter<T>& filt = filters[channel];
+inline void LadderFilterBank::step(int numChannels, Modes mode,
+                                  SqInput& audioInput, SqOutput& audioOutput,
+                                  SqInput* inputForChannel0, SqInput* inputForChannel1,
+                                  PeakDetector& peak) {
+    if (numChannels == 1 && isMono) {
+        const float input = (mode == Modes::rightOnly) ? inputForChannel0->getVoltage(0) : audioInput.getVoltage(0);
+        monoFilter.run(input);
+        const float output = monoFilter.getOutput();
+        audioOutput.setVoltage(output, 0);
+        peak.step(output);
+        return;
+    }
+
+    for (int channel = 0; channel < numChannels; channel += 4) {
+        LadderFilter<float_4>& filt = filters[channel / 4];
 
-        float input = audioInput.getVoltage(channel);
+        float_4 input = audioInput.getVoltageSimd<float_4>(channel);
         switch (mode) {
             case Modes::stereo:
-                if (channel == 1) {
-                    assert(inputForChannel1);
-                    // for legacy stereo mode, dsp1 gets input from right input
-                    input = inputForChannel1->getVoltage(0);
-                }
+                assert(inputForChannel1);
                 assert(numChannels == 2);
+                // for legacy stereo mode, dsp1 gets input from right input
+                input[1] = inputForChannel1->getVoltage(0);
                 break;
             case Modes::rightOnly:
-                assert(channel == 0);
-                input = inputForChannel0->getVoltage(0);
+                assert(numChannels == 1);
+                input[0] = inputForChannel0->getVoltage(0);
                 break;
             case Modes::normal:
             case Modes::leftOnly:
@@ -168,8 +212,12 @@ inline void LadderFilterBank<T>::step(int numChannels, Modes mode,
         }
 
         filt.run(input);
-        const float output = (float)filt.getOutput();
-        audioOutput.setVoltage(output, channel);
-        peak.step(output);
+        const float_4 output = filt.getOutput();
+        audioOutput.setVoltageSimd(output, channel);
+
+        const int bankChannels = std::min(4, numChannels - channel);
+        for (int i = 0; i < bankChannels; ++i) {
+            peak.step(output[i]);
+        }
     }
-}
\ No newline at end of file
+}
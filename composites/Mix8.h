@@ -7,8 +7,10 @@
 
 #include "Divider.h"
 #include "IComposite.h"
+#include "MixHelper.h"
 #include "MultiLag.h"
 #include "ObjectCache.h"
+#include "PolyApprox_4.h"
 #include "SqMath.h"
 
 namespace rack {
@@ -32,6 +34,7 @@ public:
  * add /4 process for cv : 19
  * add the master mute and expand: 19.6
  * with final features: 25
+ * float_4 channel strips (MixStrips_4), and pan only when it moves: about half
  *
  * Notes on how the AS mixer works.
  * VOL =  CH1_PARAM, 0.0f, 1.0f, 0.8f)
@@ -221,12 +224,7 @@ public:
 
     const static int numChannels = 8;
 
-    float buf_inputs[numChannels] = {0};
     float buf_channelGains[numChannels] = {0};
-    float buf_channelOuts[numChannels] = {0};
-    float buf_leftPanGains[numChannels] = {0};
-    float buf_rightPanGains[numChannels] = {0};
-    float buf_channelSendGains[numChannels] = {0};
 
     /** 
      * allocate extra bank for the master mute
@@ -238,12 +236,15 @@ public:
 private:
     Divider divider;
 
+    // The gains for step, two banks of four channels.
+    // Mix8 only has one send, so SEND_B is not used.
+    using Strips = MixStrips_4<numChannels>;
+    Strips strips;
+
     /**
      * 8 input channels and one master
      */
     MultiLPF<12> antiPop;
-    std::shared_ptr<LookupTableParams<float>> panL = ObjectCache<float>::getMixerPanL();
-    std::shared_ptr<LookupTableParams<float>> panR = ObjectCache<float>::getMixerPanR();
 };
 
 #ifndef _CLAMP
@@ -292,19 +293,15 @@ inline void Mix8<TBase>::stepn(int div) {
     buf_masterGain = TBase::params[MASTER_VOLUME_PARAM].value;
     buf_auxReturnGain = TBase::params[RETURN_GAIN_PARAM].value;
 
-    // send gains
-    for (int i = 0; i < numChannels; ++i) {
-        const float slider = TBase::params[i + SEND0_PARAM].value;
-        buf_channelSendGains[i] = slider;
-    }
-
-    // fill buf_leftPanGains and buf_rightPanGains
+    // pans for all channels
+    float pans[numChannels];
     for (int i = 0; i < numChannels; ++i) {
         const float balance = TBase::params[i + PAN0_PARAM].value;
         const float cv = TBase::inputs[i + PAN0_INPUT].getVoltage(0);
-        const float panValue = std::clamp(balance + cv / 5, -1, 1);
-        buf_leftPanGains[i] = LookupTable<float>::lookup(*panL, panValue);
-        buf_rightPanGains[i] = LookupTable<float>::lookup(*panR, panValue);
+        pans[i] = std::clamp(balance + cv / 5, -1, 1);
+    }
+    for (int bank = 0; bank < Strips::numBanks; ++bank) {
+        strips.setPan(bank, float_4::load(pans + bank * 4));
     }
 
     buf_masterGain = TBase::params[MASTER_VOLUME_PARAM].value;
@@ -331,6 +328,27 @@ inline void Mix8<TBase>::stepn(int div) {
     }
     buf_muteInputs[8] = 1.0f - TBase::params[MASTER_MUTE_PARAM].value;
     antiPop.step(buf_muteInputs);
+
+    float sends[numChannels];
+    for (int i = 0; i < numChannels; ++i) {
+        sends[i] = TBase::params[i + SEND0_PARAM].value;
+    }
+
+    for (int bank = 0; bank < Strips::numBanks; ++bank) {
+        const int first = bank * 4;
+        const float_4 mute = antiPop.get4(first);
+        const float_4 channelGain = float_4::load(buf_channelGains + first) * mute;
+        const float_4 send = float_4::load(sends + first);
+
+        // The sends follow the channel and the pan
+        const float_4 left = channelGain * strips.panLeft[bank];
+        const float_4 right = channelGain * strips.panRight[bank];
+        strips.gains[Strips::CHANNEL][bank] = channelGain;
+        strips.gains[Strips::LEFT][bank] = left;
+        strips.gains[Strips::RIGHT][bank] = right;
+        strips.gains[Strips::SEND_A_LEFT][bank] = left * send;
+        strips.gains[Strips::SEND_A_RIGHT][bank] = right * send;
+    }
 }
 
 template <class TBase>
@@ -348,28 +366,23 @@ template <class TBase>
 inline void Mix8<TBase>::step() {
     divider.step();
 
-    // fill buf_inputs
-    for (int i = 0; i < numChannels; ++i) {
-        buf_inputs[i] = TBase::inputs[i + AUDIO0_INPUT].getVoltage(0);
-    }
-
-    // compute buf_channelOuts
-    for (int i = 0; i < numChannels; ++i) {
-        const float muteValue = antiPop.get(i);
-        buf_channelOuts[i] = buf_inputs[i] * buf_channelGains[i] * muteValue;
+    float_4 inputs[Strips::numBanks];
+    for (int bank = 0; bank < Strips::numBanks; ++bank) {
+        const int first = bank * 4 + AUDIO0_INPUT;
+        inputs[bank] = float_4(
+            TBase::inputs[first].getVoltage(0),
+            TBase::inputs[first + 1].getVoltage(0),
+            TBase::inputs[first + 2].getVoltage(0),
+            TBase::inputs[first + 3].getVoltage(0));
     }
 
-    // compute and output master outputs
-    float left = 0, right = 0;
-    float lSend = 0, rSend = 0;
-    for (int i = 0; i < numChannels; ++i) {
-        left += buf_channelOuts[i] * buf_leftPanGains[i];
-        right += buf_channelOuts[i] * buf_rightPanGains[i];
-
-        lSend += buf_channelOuts[i] * buf_leftPanGains[i] * buf_channelSendGains[i];
-        rSend += buf_channelOuts[i] * buf_rightPanGains[i] * buf_channelSendGains[i];
-    }
+    // compute the channel outputs, and the master and send busses
+    float_4 channelOuts[Strips::numBanks];
+    float busses[8];
+    strips.mix(inputs, channelOuts, busses);
 
+    float left = busses[Strips::LEFT];
+    float right = busses[Strips::RIGHT];
     left += TBase::inputs[LEFT_RETURN_INPUT].getVoltage(0) * buf_auxReturnGain;
     right += TBase::inputs[RIGHT_RETURN_INPUT].getVoltage(0) * buf_auxReturnGain;
 
@@ -379,12 +392,12 @@ inline void Mix8<TBase>::step() {
     TBase::outputs[LEFT_OUTPUT].setVoltage(left * masterGain + TBase::inputs[LEFT_EXPAND_INPUT].getVoltage(0), 0);
     TBase::outputs[RIGHT_OUTPUT].setVoltage(right * masterGain + TBase::inputs[RIGHT_EXPAND_INPUT].getVoltage(0), 0);
 
-    TBase::outputs[LEFT_SEND_OUTPUT].setVoltage(lSend, 0);
-    TBase::outputs[RIGHT_SEND_OUTPUT].setVoltage(rSend, 0);
+    TBase::outputs[LEFT_SEND_OUTPUT].setVoltage(busses[Strips::SEND_A_LEFT], 0);
+    TBase::outputs[RIGHT_SEND_OUTPUT].setVoltage(busses[Strips::SEND_A_RIGHT], 0);
 
     // output channel outputs
     for (int i = 0; i < numChannels; ++i) {
-        TBase::outputs[i + CHANNEL0_OUTPUT].setVoltage(buf_channelOuts[i], 0);
+        TBase::outputs[i + CHANNEL0_OUTPUT].setVoltage(channelOuts[i / 4][i % 4], 0);
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GateTrigger.h"
+#include "PolyApprox_4.h"
 
 #define _CHAUDIOTAPER  // not needed any more?
 
@@ -123,3 +124,104 @@ inline void MixHelper<TMixComposite>::procOneMute(
     mixer->params[muteStateParam].value = muted ? 1.f : 0.f;
     mixer->lights[light].value = muted ? 10.f : 0.f;
 }
+
+/**
+ * The channel strips of a mixer, four channels to a float_4.
+ *
+ * stepn works out each channel's gain * mute * pan * send once, and puts
+ * them in gains. Then every sample mix() is a multiply-add per gain per bank
+ * of four channels, and a transpose at the end to add up the lanes.
+ */
+template <int numChannels>
+class MixStrips_4 {
+public:
+    static const int numBanks = (numChannels + 3) / 4;
+    static const int numBusses = 6;
+
+    /**
+     * The first six are in the same order as the expansion busses.
+     * CHANNEL is the gain to the channel output.
+     */
+    enum Gains {
+        LEFT,
+        RIGHT,
+        SEND_A_LEFT,
+        SEND_A_RIGHT,
+        SEND_B_LEFT,
+        SEND_B_RIGHT,
+        CHANNEL,
+        NUM_GAINS
+    };
+
+    MixStrips_4();
+
+    /**
+     * equal power pan for a bank. The sines are only re-calculated when the pan moves.
+     * the results go in panLeft and panRight.
+     */
+    void setPan(int bank, float_4 pan);
+
+    /**
+     * inputs and channelOutputs have one float_4 for each bank.
+     * busses gets the sums of the first six gains. It must have room for eight.
+     */
+    void mix(const float_4* inputs, float_4* channelOutputs, float* busses) const;
+
+    float_4 gains[NUM_GAINS][numBanks];
+    float_4 panLeft[numBanks];
+    float_4 panRight[numBanks];
+
+private:
+    float_4 lastPan[numBanks];
+
+    static float_4 sumLanes(float_4 a, float_4 b, float_4 c, float_4 d);
+};
+
+template <int numChannels>
+inline MixStrips_4<numChannels>::MixStrips_4() {
+    for (int bank = 0; bank < numBanks; ++bank) {
+        for (int gain = 0; gain < NUM_GAINS; ++gain) {
+            gains[gain][bank] = 0;
+        }
+        panLeft[bank] = 0;
+        panRight[bank] = 0;
+        lastPan[bank] = 2;  // pans are -1..1, so the first one will be new
+    }
+}
+
+template <int numChannels>
+inline void MixStrips_4<numChannels>::setPan(int bank, float_4 pan) {
+    if (!rack::simd::movemask(pan != lastPan[bank])) {
+        return;
+    }
+    lastPan[bank] = pan;
+    PolyApprox_4::panGains(pan, panLeft[bank], panRight[bank]);
+}
+
+template <int numChannels>
+inline void MixStrips_4<numChannels>::mix(const float_4* inputs, float_4* channelOutputs, float* busses) const {
+    float_4 sums[NUM_GAINS - 1];
+    for (int gain = 0; gain < CHANNEL; ++gain) {
+        sums[gain] = inputs[0] * gains[gain][0];
+    }
+    channelOutputs[0] = inputs[0] * gains[CHANNEL][0];
+
+    for (int bank = 1; bank < numBanks; ++bank) {
+        for (int gain = 0; gain < CHANNEL; ++gain) {
+            sums[gain] += inputs[bank] * gains[gain][bank];
+        }
+        channelOutputs[bank] = inputs[bank] * gains[CHANNEL][bank];
+    }
+
+    sumLanes(sums[LEFT], sums[RIGHT], sums[SEND_A_LEFT], sums[SEND_A_RIGHT]).store(busses);
+    sumLanes(sums[SEND_B_LEFT], sums[SEND_B_RIGHT], float_4::zero(), float_4::zero()).store(busses + 4);
+}
+
+/**
+ * returns the sum of the lanes of a in lane 0, of b in lane 1, and so on.
+ */
+template <int numChannels>
+inline float_4 MixStrips_4<numChannels>::sumLanes(float_4 a, float_4 b, float_4 c, float_4 d) {
+    _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+    return (a + b) + (c + d);
+}
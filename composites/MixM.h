@@ -11,6 +11,7 @@
 #include "MixHelper.h"
 #include "MultiLag.h"
 #include "ObjectCache.h"
+#include "PolyApprox_4.h"
 #include "SqMath.h"
 #include "mixpolyhelper.h"
 
@@ -198,14 +199,6 @@ public:
 
     void stepn(int steps);
 
-    // These are all calculated in stepn from the
-    // contents of filteredCV
-
-    float buf_channelSendGainsALeft[numChannels] = {0};
-    float buf_channelSendGainsARight[numChannels] = {0};
-    float buf_channelSendGainsBLeft[numChannels] = {0};
-    float buf_channelSendGainsBRight[numChannels] = {0};
-
     float buf_auxReturnGainA = 0;
     float buf_auxReturnGainB = 0;
 
@@ -228,13 +221,17 @@ private:
     static const int cvOffsetMaster = 16;
     MultiLPF<20> filteredCV;
 
-    std::shared_ptr<LookupTableParams<float>> panL = ObjectCache<float>::getMixerPanL();
-    std::shared_ptr<LookupTableParams<float>> panR = ObjectCache<float>::getMixerPanR();
 
     const float* expansionInputs = nullptr;
 
     MixHelper<MixM<TBase>> helper;
     MixPolyHelper<MixM<TBase>> polyHelper;
+
+    // The gains for step. These are all calculated in stepn from the
+    // contents of filteredCV
+    using Strips = MixStrips_4<numChannels>;
+    Strips strips;
+
     std::shared_ptr<LookupTableParams<float>> taperLookupParam = ObjectCache<float>::getAudioTaper18();
 };
 
@@ -301,9 +298,14 @@ inline void MixM<TBase>::stepn(int div) {
         }
     }
 
+    // Round up the knobs and CV one channel at a time,
+    // then do the math four channels at a time.
+    float volumes[numChannels];
+    float mutes[numChannels];
+    float pans[numChannels];
+    float sendsA[numChannels];
+    float sendsB[numChannels];
     for (int i = 0; i < numChannels; ++i) {
-        float channelGain = 0;
-
         // First let's round up the channel volume
         {
             const float rawSlider = TBase::params[i + GAIN0_PARAM].value;
@@ -314,7 +316,7 @@ inline void MixM<TBase>::stepn(int div) {
                 rawCV / 10.0f,
                 0.0f,
                 1.0f);
-            channelGain = slider * cv;
+            volumes[i] = slider * cv;
         }
 
         // now round up the mutes
@@ -329,48 +331,16 @@ inline void MixM<TBase>::stepn(int div) {
             // be applicable if no solo
             rawMuteValue = TBase::params[i + MUTE0_STATE_PARAM].value > .5 ? 0.f : 1.f;
         }
-        channelGain *= rawMuteValue;
-
-        // now the raw channel gains are all computed
-        unbufferedCV[cvOffsetGain + i] = channelGain;
-        unbufferedCV[cvOffsetMute + i] = rawMuteValue;
+        mutes[i] = rawMuteValue;
 
-        // now do the pan calculation
         {
             const float balance = TBase::params[i + PAN0_PARAM].value;
             const float cv = TBase::inputs[i + PAN0_INPUT].getVoltage(0);
-            const float panValue = std::clamp(balance + cv / 5, -1, 1);
-            unbufferedCV[cvOffsetPanLeft + i] = LookupTable<float>::lookup(*panL, panValue) * channelGain;
-            unbufferedCV[cvOffsetPanRight + i] = LookupTable<float>::lookup(*panR, panValue) * channelGain;
+            pans[i] = std::clamp(balance + cv / 5, -1, 1);
         }
 
-        // precalc all the send gains
-        {
-            const float muteValue = filteredCV.get(cvOffsetMute + i);
-            const float sliderA = TBase::params[i + SEND0_PARAM].value;
-            const float sliderB = TBase::params[i + SENDb0_PARAM].value;
-
-            // TODO: we can do some main volume work ahead of time, just like the sends here
-            if (!AisPreFader) {
-                // post faster, gain sees mutes, faders,  pan, and send level
-                buf_channelSendGainsALeft[i] = filteredCV.get(i + cvOffsetPanLeft) * sliderA;
-                buf_channelSendGainsARight[i] = filteredCV.get(i + cvOffsetPanRight) * sliderA;
-            } else {
-                // pre-fader fader, gain sees mutes and send only
-                buf_channelSendGainsALeft[i] = muteValue * sliderA * (1.f / sqrt(2.f));
-                buf_channelSendGainsARight[i] = muteValue * sliderA * (1.f / sqrt(2.f));
-            }
-
-            if (!BisPreFader) {
-                // post faster, gain sees mutes, faders,  pan, and send level
-                buf_channelSendGainsBLeft[i] = filteredCV.get(i + cvOffsetPanLeft) * sliderB;
-                buf_channelSendGainsBRight[i] = filteredCV.get(i + cvOffsetPanRight) * sliderB;
-            } else {
-                // pref fader, gain sees mutes and send only
-                buf_channelSendGainsBLeft[i] = muteValue * sliderB * (1.f / sqrt(2.f));
-                buf_channelSendGainsBRight[i] = muteValue * sliderB * (1.f / sqrt(2.f));
-            }
-        }
+        sendsA[i] = TBase::params[i + SEND0_PARAM].value;
+        sendsB[i] = TBase::params[i + SENDb0_PARAM].value;
 
         // refresh the solo lights
         {
@@ -378,42 +348,70 @@ inline void MixM<TBase>::stepn(int div) {
             TBase::lights[i + SOLO0_LIGHT].value = (soloValue > .5f) ? 10.f : 0.f;
         }
     }
+
+    for (int bank = 0; bank < Strips::numBanks; ++bank) {
+        const int first = bank * 4;
+        float_4 mute = float_4::load(mutes + first);
+        float_4 channelGain = float_4::load(volumes + first) * mute;
+        strips.setPan(bank, float_4::load(pans + first));
+
+        channelGain.store(unbufferedCV + cvOffsetGain + first);
+        mute.store(unbufferedCV + cvOffsetMute + first);
+        (strips.panLeft[bank] * channelGain).store(unbufferedCV + cvOffsetPanLeft + first);
+        (strips.panRight[bank] * channelGain).store(unbufferedCV + cvOffsetPanRight + first);
+
+        // The sends use the smoothed gains from last time.
+        // post fader, gain sees mutes, faders,  pan, and send level
+        // pre-fader fader, gain sees mutes and send only
+        const float_4 preFaderGain = float_4(filteredCV.get4(cvOffsetMute + first)) * float_4(1.f / std::sqrt(2.f));
+        const float_4 leftGain = filteredCV.get4(cvOffsetPanLeft + first);
+        const float_4 rightGain = filteredCV.get4(cvOffsetPanRight + first);
+        const float_4 sendA = float_4::load(sendsA + first);
+        const float_4 sendB = float_4::load(sendsB + first);
+        strips.gains[Strips::SEND_A_LEFT][bank] = (AisPreFader ? preFaderGain : leftGain) * sendA;
+        strips.gains[Strips::SEND_A_RIGHT][bank] = (AisPreFader ? preFaderGain : rightGain) * sendA;
+        strips.gains[Strips::SEND_B_LEFT][bank] = (BisPreFader ? preFaderGain : leftGain) * sendB;
+        strips.gains[Strips::SEND_B_RIGHT][bank] = (BisPreFader ? preFaderGain : rightGain) * sendB;
+    }
+
     filteredCV.step(unbufferedCV);
+
+    for (int bank = 0; bank < Strips::numBanks; ++bank) {
+        const int first = bank * 4;
+        strips.gains[Strips::CHANNEL][bank] = filteredCV.get4(cvOffsetGain + first);
+        strips.gains[Strips::LEFT][bank] = filteredCV.get4(cvOffsetPanLeft + first);
+        strips.gains[Strips::RIGHT][bank] = filteredCV.get4(cvOffsetPanRight + first);
+    }
 }
 
 template <class TBase>
 inline void MixM<TBase>::step() {
     divider.step();
 
-    float left = 0, right = 0;  // these variables will be summed up over all channels
-    float lSend = 0, rSend = 0;
-    float lSendb = 0, rSendb = 0;
+    const float_4 input(
+        polyHelper.getNormalizedInputSum(this, 0),
+        polyHelper.getNormalizedInputSum(this, 1),
+        polyHelper.getNormalizedInputSum(this, 2),
+        polyHelper.getNormalizedInputSum(this, 3));
+
+    // sum all the channels into the busses
+    float_4 channelOutput;
+    float busses[8];
+    strips.mix(&input, &channelOutput, busses);
 
     if (expansionInputs) {
-        left = expansionInputs[0];
-        right = expansionInputs[1];
-        lSend = expansionInputs[2];
-        rSend = expansionInputs[3];
-        lSendb = expansionInputs[4];
-        rSendb = expansionInputs[5];
+        for (int i = 0; i < Strips::numBusses; ++i) {
+            busses[i] += expansionInputs[i];
+        }
     }
 
     for (int i = 0; i < numChannels; ++i) {
-        const float channelInput = polyHelper.getNormalizedInputSum(this, i);
-
-        // sum the channel output to the masters
-        left += channelInput * filteredCV.get(i + cvOffsetPanLeft);
-        right += channelInput * filteredCV.get(i + cvOffsetPanRight);
-
-        // TODO: aux sends
-        lSend += channelInput * buf_channelSendGainsALeft[i];
-        lSendb += channelInput * buf_channelSendGainsBLeft[i];
-        rSend += channelInput * buf_channelSendGainsARight[i];
-        rSendb += channelInput * buf_channelSendGainsBRight[i];
-
-        TBase::outputs[i + CHANNEL0_OUTPUT].setVoltage(channelInput * filteredCV.get(i + cvOffsetGain), 0);
+        TBase::outputs[i + CHANNEL0_OUTPUT].setVoltage(channelOutput[i], 0);
     }
 
+    float left = busses[Strips::LEFT];
+    float right = busses[Strips::RIGHT];
+
     // add the returns into the master mix
     left += TBase::inputs[LEFT_RETURN_INPUT].getVoltage(0) * buf_auxReturnGainA;
     right += TBase::inputs[RIGHT_RETURN_INPUT].getVoltage(0) * buf_auxReturnGainA;
@@ -426,11 +424,11 @@ inline void MixM<TBase>::step() {
     TBase::outputs[LEFT_OUTPUT].setVoltage(left * masterGain, 0);
     TBase::outputs[RIGHT_OUTPUT].setVoltage(right * masterGain, 0);
 
-    TBase::outputs[LEFT_SEND_OUTPUT].setVoltage(lSend, 0);
-    TBase::outputs[RIGHT_SEND_OUTPUT].setVoltage(rSend, 0);
+    TBase::outputs[LEFT_SEND_OUTPUT].setVoltage(busses[Strips::SEND_A_LEFT], 0);
+    TBase::outputs[RIGHT_SEND_OUTPUT].setVoltage(busses[Strips::SEND_A_RIGHT], 0);
 
-    TBase::outputs[LEFT_SENDb_OUTPUT].setVoltage(lSendb, 0);
-    TBase::outputs[RIGHT_SENDb_OUTPUT].setVoltage(rSendb, 0);
+    TBase::outputs[LEFT_SENDb_OUTPUT].setVoltage(busses[Strips::SEND_B_LEFT], 0);
+    TBase::outputs[RIGHT_SENDb_OUTPUT].setVoltage(busses[Strips::SEND_B_RIGHT], 0);
 }
 
 template <class TBase>
@@ -144,13 +144,6 @@ public:
 
     void stepn(int steps);
 
-    // These are all calculated in stepn from the
-    // contents of filteredCV
-
-    // TODO: this should be numGroups
-    float buf_channelSendGainA[numChannels] = {0};
-    float buf_channelSendGainB[numChannels] = {0};
-
     // TODO: reduce this number to what we actually need
 
     /**
@@ -194,6 +187,11 @@ private:
     // TODO:cut down mix helper size.
     MixHelper<MixStereo<TBase>> helper;
 
+    // The gains for step, one lane per channel. These are all calculated in stepn
+    // from the contents of filteredCV
+    using Strips = MixStrips_4<numChannels>;
+    Strips strips;
+
     std::shared_ptr<LookupTableParams<float>> taperLookupParam = ObjectCache<float>::getAudioTaper18();
 };
 
@@ -220,6 +218,11 @@ inline void MixStereo<TBase>::stepn(int div) {
         }
     }
 
+    // per channel
+    float sendsA[numChannels];
+    float sendsB[numChannels];
+    float mutes[numChannels];
+
     for (int group = 0; group < numGroups; ++group) {
         float groupGain = 0;
 
@@ -277,36 +280,13 @@ inline void MixStereo<TBase>::stepn(int div) {
             unbufferedCV[cvOffsetGainBalance + group * 2 + 1] = rightPan * groupGain;
         }
 
-        // Calculate all the send gains
+        // save the send levels for both channels of the group
         {
             assert(group + SEND0_PARAM < NUM_PARAMS);
             assert(group + SENDb0_PARAM < NUM_PARAMS);
-
-            const float muteValue = filteredCV.get(cvOffsetMute + group);
-            const float sliderA = TBase::params[group + SEND0_PARAM].value;
-            const float sliderB = TBase::params[group + SENDb0_PARAM].value;
-
-            const float panAttenuation = .5f;  // 6db pan law
-
-            // TODO: we can do some main volume work ahead of time, just like the sends here
-            if (!AisPreFader) {
-                // post faster, gain sees mutes, faders,  pan, and send level
-                buf_channelSendGainA[group * 2] = filteredCV.get(group * 2 + cvOffsetGainBalance) * sliderA;
-                buf_channelSendGainA[group * 2 + 1] = filteredCV.get(group * 2 + 1 + cvOffsetGainBalance) * sliderA;
-            } else {
-                // pre-fader fader, gain sees mutes and send only
-                buf_channelSendGainA[group * 2] = muteValue * sliderA * panAttenuation;
-                buf_channelSendGainA[group * 2 + 1] = muteValue * sliderA * panAttenuation;
-            }
-
-            if (!BisPreFader) {
-                // post faster, gain sees mutes, faders,  pan, and send level
-                buf_channelSendGainB[group * 2] = filteredCV.get(group * 2 + cvOffsetGainBalance) * sliderB;
-                buf_channelSendGainB[group * 2 + 1] = filteredCV.get(group * 2 + 1 + cvOffsetGainBalance) * sliderB;
-            } else {
-                buf_channelSendGainB[group * 2] = muteValue * sliderB * panAttenuation;
-                buf_channelSendGainB[group * 2 + 1] = muteValue * sliderB * panAttenuation;
-            }
+            sendsA[group * 2] = sendsA[group * 2 + 1] = TBase::params[group + SEND0_PARAM].value;
+            sendsB[group * 2] = sendsB[group * 2 + 1] = TBase::params[group + SENDb0_PARAM].value;
+            mutes[group * 2] = mutes[group * 2 + 1] = filteredCV.get(cvOffsetMute + group);
         }
 
         // look for normaled mono channels
@@ -326,7 +306,40 @@ inline void MixStereo<TBase>::stepn(int div) {
             TBase::lights[group + SOLO0_LIGHT].value = (soloValue > .5f) ? 10.f : 0.f;
         }
     }
+
+    // Calculate all the send gains. They use the smoothed gains from last time.
+    // Even lanes are the left channels, odd lanes the right.
+    static_assert(Strips::numBanks == 1, "stereo mixer is one bank");
+    const float_4 leftLanes(1, 0, 1, 0);
+    const float_4 rightLanes(0, 1, 0, 1);
+    {
+        const float panAttenuation = .5f;  // 6db pan law
+
+        // post fader, gain sees mutes, faders,  pan, and send level
+        // pre-fader fader, gain sees mutes and send only
+        const float_4 postFaderGain = filteredCV.get4(cvOffsetGainBalance);
+        const float_4 preFaderGain = float_4::load(mutes) * float_4(panAttenuation);
+        const float_4 sendA = (AisPreFader ? preFaderGain : postFaderGain) * float_4::load(sendsA);
+        const float_4 sendB = (BisPreFader ? preFaderGain : postFaderGain) * float_4::load(sendsB);
+        strips.gains[Strips::SEND_A_LEFT][0] = sendA * leftLanes;
+        strips.gains[Strips::SEND_A_RIGHT][0] = sendA * rightLanes;
+        strips.gains[Strips::SEND_B_LEFT][0] = sendB * leftLanes;
+        strips.gains[Strips::SEND_B_RIGHT][0] = sendB * rightLanes;
+    }
+
     filteredCV.step(unbufferedCV);
+
+    const float_4 gainBalance = filteredCV.get4(cvOffsetGainBalance);
+    strips.gains[Strips::LEFT][0] = gainBalance * leftLanes;
+    strips.gains[Strips::RIGHT][0] = gainBalance * rightLanes;
+#ifdef _NN
+    // mod for artem - pan all the time
+    strips.gains[Strips::CHANNEL][0] = gainBalance;
+#else
+    const float gain0 = filteredCV.get(cvOffsetGain);
+    const float gain1 = filteredCV.get(cvOffsetGain + 1);
+    strips.gains[Strips::CHANNEL][0] = float_4(gain0, gain0, gain1, gain1);
+#endif
 }
 
 template <class TBase>
@@ -359,66 +372,38 @@ template <class TBase>
 inline void MixStereo<TBase>::step() {
     divider.step();
 
-    float left = 0, right = 0;  // these variables will be summed up over all channels
-    float lSendA = 0, rSendA = 0;
-    float lSendB = 0, rSendB = 0;
-
-    if (expansionInputs) {
-        left = expansionInputs[0];
-        right = expansionInputs[1];
-        lSendA = expansionInputs[2];
-        rSendA = expansionInputs[3];
-        lSendB = expansionInputs[4];
-        rSendB = expansionInputs[5];
-    }
-
-    for (int channel = 0; channel < numChannels; ++channel) {
-        const int group = channel / 2;
-        const bool isLeft = !(channel & 1);
-
-        int inputChannel = channel;
+    const float in0 = TBase::inputs[AUDIO0_INPUT].getVoltage(0);
+    const float in1 = TBase::inputs[AUDIO1_INPUT].getVoltage(0);
+    const float in2 = TBase::inputs[AUDIO2_INPUT].getVoltage(0);
+    const float in3 = TBase::inputs[AUDIO3_INPUT].getVoltage(0);
 #ifdef _NN
-        if (!isLeft && groupIsMono[group]) {
-            inputChannel--;
-        }
+    // mono groups send the left input to both sides
+    const float_4 input(in0, groupIsMono[0] ? in0 : in1, in2, groupIsMono[1] ? in2 : in3);
+#else
+    const float_4 input(in0, in1, in2, in3);
 #endif
-        assert(channel + AUDIO0_INPUT < NUM_INPUTS);
-        const float channelInput = TBase::inputs[inputChannel + AUDIO0_INPUT].getVoltage(0);
 
-        if (isLeft) {
-            left += channelInput * filteredCV.get(channel + cvOffsetGainBalance);
-            lSendA += channelInput * buf_channelSendGainA[channel];
-            lSendB += channelInput * buf_channelSendGainB[channel];
-        } else {
-            right += channelInput * filteredCV.get(channel + cvOffsetGainBalance);
-            rSendA += channelInput * buf_channelSendGainA[channel];
-            rSendB += channelInput * buf_channelSendGainB[channel];
-        }
+    // sum all the channels into the busses
+    float_4 channelOutput;
+    float busses[8];
+    strips.mix(&input, &channelOutput, busses);
 
-        // now calculate and output the channel outs
-        // TODO: clean this up
-        assert(channel + CHANNEL0_OUTPUT < NUM_OUTPUTS);
-#ifdef _NN
-        float channelOutput = 0;
-        if (groupIsMono[group] || true) {  // mod for artem - pan all the time
-            channelOutput = channelInput * filteredCV.get(channel + cvOffsetGainBalance);
-        } else {
-            channelOutput = channelInput * filteredCV.get(group + cvOffsetGain);
+    if (expansionInputs) {
+        for (int i = 0; i < Strips::numBusses; ++i) {
+            busses[i] += expansionInputs[i];
         }
-        TBase::outputs[channel + CHANNEL0_OUTPUT].setVoltage(channelOutput, 0);
-#else
-        TBase::outputs[channel + CHANNEL0_OUTPUT].value = channelInput * filteredCV.get(group + cvOffsetGain);
-#endif
     }
 
     // output the buses to the expansion port
     if (expansionOutputs) {
-        expansionOutputs[0] = left;
-        expansionOutputs[1] = right;
-        expansionOutputs[2] = lSendA;
-        expansionOutputs[3] = rSendA;
-        expansionOutputs[4] = lSendB;
-        expansionOutputs[5] = rSendB;
+        for (int i = 0; i < Strips::numBusses; ++i) {
+            expansionOutputs[i] = busses[i];
+        }
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        assert(channel + CHANNEL0_OUTPUT < NUM_OUTPUTS);
+        TBase::outputs[channel + CHANNEL0_OUTPUT].setVoltage(channelOutput[channel], 0);
     }
 }
 
@@ -142,7 +142,8 @@ private:
     bool wasRunning = false;
     std::shared_ptr<MidiPlayer2> player;
     /**
-     * called by the divider every 'n' step calls
+     * called by the divider every 'n' step calls,
+     * or sooner if a clock edge comes in. n is the number of samples since the last call.
      */
     void stepn(int n);
 
@@ -196,7 +197,7 @@ void Seq<TBase>::init(MidiSongPtr song) {
     audition = std::make_shared<MidiAudition>(host);
 
     div.setup(4, [this] {
-        this->stepn(div.getDiv());
+        this->stepn(div.getElapsed());
     });
     onSampleRateChange();
 }
@@ -216,7 +217,16 @@ void Seq<TBase>::setSong(MidiSongPtr newSong) {
 
 template <class TBase>
 void Seq<TBase>::step() {
-    div.step();
+    // Most of the work is only done every few samples, but when the clock comes in
+    // we do it right away, so the gates and CV change on the sample of the clock edge.
+    const bool edge = clock.isEdgePending(
+        TBase::inputs[CLOCK_INPUT].getVoltage(0),
+        TBase::inputs[RESET_INPUT].getVoltage(0));
+    if (edge) {
+        div.stepAndFire();
+    } else {
+        div.step();
+    }
 }
 
 template <class TBase>
@@ -95,6 +95,10 @@ public:
         CV_FUNCTION2_PARAM,
         CV_FUNCTION3_PARAM,
         CV_SELECT_OCTAVE_PARAM,
+        VOICE_MODE0_PARAM,  // MidiVoiceAssigner::Mode for each track. Last, so old patches still load.
+        VOICE_MODE1_PARAM,
+        VOICE_MODE2_PARAM,
+        VOICE_MODE3_PARAM,
         NUM_PARAMS
     };
 
@@ -154,6 +158,7 @@ public:
     static std::vector<std::string> getClockRates();
     static std::vector<std::string> getPolyLabels();
     static std::vector<std::string> getCVFunctionLabels();
+    static std::vector<std::string> getVoiceModeLabels();
 
     /**
      * return 0 if not playing
@@ -184,7 +189,8 @@ private:
     void resetClock();
     void serviceSelCV();
     /**
-     * called by the divider every 'n' step calls
+     * called by the divider every 'n' step calls,
+     * or sooner if a clock edge comes in. n is the number of samples since the last call.
      */
     void stepn(int n);
 
@@ -239,7 +245,7 @@ void Seq4<TBase>::init(MidiSong4Ptr song) {
     // audition = std::make_shared<MidiAudition>(host);
 
     div.setup(4, [this] {
-        this->stepn(div.getDiv());
+        this->stepn(div.getElapsed());
     });
     onSampleRateChange();
     player->setPorts(TBase::inputs.data() + MOD0_INPUT, TBase::params.data() + TRIGGER_IMMEDIATE_PARAM);
@@ -324,6 +330,9 @@ void Seq4<TBase>::stepn(int n) {
         const float cvMode = TBase::params[CV_FUNCTION_PARAM + i].value;
         MidiTrackPlayer::CVInputMode mode = MidiTrackPlayer::CVInputMode(std::round(cvMode));
         getTrackPlayer(i)->setCVInputMode(mode);
+
+        const int voiceMode = int(std::round(TBase::params[VOICE_MODE0_PARAM + i].value));
+        player->setVoiceAssignMode(i, MidiVoiceAssigner::Mode(voiceMode));
     }
 
     if (!running && wasRunning) {
@@ -362,7 +371,16 @@ void Seq4<TBase>::serviceRunStop() {
 
 template <class TBase>
 inline void Seq4<TBase>::step() {
-    div.step();
+    // Most of the work is only done every few samples, but when the clock comes in
+    // we do it right away, so the gates and CV change on the sample of the clock edge.
+    const bool edge = clock.isEdgePending(
+        TBase::inputs[CLOCK_INPUT].getVoltage(0),
+        TBase::inputs[RESET_INPUT].getVoltage(0));
+    if (edge) {
+        div.stepAndFire();
+    } else {
+        div.step();
+    }
 }
 
 template <class TBase>
@@ -444,6 +462,17 @@ inline std::vector<std::string> Seq4<TBase>::getCVFunctionLabels() {
         "Prev",
         "Set"};
 }
+
+// in the order of MidiVoiceAssigner::Mode
+template <class TBase>
+inline std::vector<std::string> Seq4<TBase>::getVoiceModeLabels() {
+    return {
+        "Re-use voice of same pitch",
+        "Rotate",
+        "Steal oldest note",
+        "Low note priority",
+        "High note priority"};
+}
 template <class TBase>
 int Seq4Description<TBase>::getNumParams() {
     return Seq4<TBase>::NUM_PARAMS;
@@ -539,6 +568,18 @@ inline IComposite::Config Seq4Description<TBase>::getParam(int i) {
         case Seq4<TBase>::CV_SELECT_OCTAVE_PARAM:
             ret = {0, 10, 2, "Select CV octave"};
             break;
+        case Seq4<TBase>::VOICE_MODE0_PARAM:
+            ret = {0, 4, 0, "Voice assignment 1"};
+            break;
+        case Seq4<TBase>::VOICE_MODE1_PARAM:
+            ret = {0, 4, 0, "Voice assignment 2"};
+            break;
+        case Seq4<TBase>::VOICE_MODE2_PARAM:
+            ret = {0, 4, 0, "Voice assignment 3"};
+            break;
+        case Seq4<TBase>::VOICE_MODE3_PARAM:
+            ret = {0, 4, 0, "Voice assignment 4"};
+            break;
         default:
             assert(false);
     }
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "ADAA.h"
 #include "AsymWaveShaper.h"
-#include "ButterworthFilterDesigner.h"
 #include "IComposite.h"
-#include "IIRDecimator.h"
-#include "IIRUpsampler.h"
 #include "LookupTable.h"
+#include "LookupTable_4.h"
 #include "ObjectCache.h"
+#include "PolyphaseDecimator.h"
+#include "PolyphaseUpsampler.h"
+#include "SimdBlocks.h"
+#include "StateVariable4PHP_4.h"
 
 namespace rack {
 namespace engine {
@@ -22,6 +25,181 @@ public:
     int getNumParams() override;
 };
 
+/**
+ * The shapes that have closed form anti-derivatives, for ADAA.
+ * Each f must match the corresponding case in Shaper::processBuffer.
+ * F is the anti-derivative of f, and F2 is the anti-derivative of F.
+ */
+class ShaperADAAShapes {
+public:
+    class FullWave {
+    public:
+        static const int id = 0;
+        static double f(double x) {
+            const double y = a * std::abs(x);
+            return (y < limit) ? y : limit;
+        }
+        static double F(double x) {
+            return (x < 0) ? -evenF(-x) : evenF(x);
+        }
+        static double F2(double x) {
+            return evenF2(std::abs(x));
+        }
+
+    private:
+        static constexpr double a = 1.94;
+        static constexpr double limit = 10;
+        // anti-derivative for x >= 0
+        static double evenF(double x) {
+            const double knee = limit / a;
+            return (x < knee) ? a * x * x / 2 : a * knee * knee / 2 + limit * (x - knee);
+        }
+        // and its anti-derivative, which is even
+        static double evenF2(double x) {
+            const double knee = limit / a;
+            if (x < knee) {
+                return a * x * x * x / 6;
+            }
+            const double d = x - knee;
+            return a * knee * knee * knee / 6 + a * knee * knee * d / 2 + limit * d * d / 2;
+        }
+    };
+
+    class HalfWave {
+    public:
+        static const int id = 1;
+        static double f(double x) {
+            const double y = a * std::max(0.0, x);
+            return (y < limit) ? y : limit;
+        }
+        static double F(double x) {
+            const double knee = limit / a;
+            if (x <= 0) {
+                return 0;
+            }
+            return (x < knee) ? a * x * x / 2 : a * knee * knee / 2 + limit * (x - knee);
+        }
+        static double F2(double x) {
+            const double knee = limit / a;
+            if (x <= 0) {
+                return 0;
+            }
+            if (x < knee) {
+                return a * x * x * x / 6;
+            }
+            const double d = x - knee;
+            return a * knee * knee * knee / 6 + a * knee * knee * d / 2 + limit * d * d / 2;
+        }
+
+    private:
+        static constexpr double a = 1.4 * 1.26;
+        static constexpr double limit = 10;
+    };
+
+    class Clip {
+    public:
+        static const int id = 2;
+        static double f(double x) {
+            return a * std::max(-1.0, std::min(1.0, x));
+        }
+        static double F(double x) {
+            const double ax = std::abs(x);
+            return a * ((ax < 1) ? x * x / 2 : ax - .5);
+        }
+        static double F2(double x) {
+            const double ax = std::abs(x);
+            const double oddF2 = (ax < 1) ? ax * ax * ax / 6 : 1.0 / 6 + (ax * ax - 1) / 2 - (ax - 1) / 2;
+            return a * ((x < 0) ? -oddF2 : oddF2);
+        }
+
+    private:
+        static constexpr double a = 3 * 1.2;
+    };
+
+    class EmitterCoupled {
+    public:
+        static const int id = 3;
+        static double f(double x) {
+            return a * std::tanh(x * k);
+        }
+        /**
+         * a * log(cosh(kx)) / k, arranged so that cosh can't overflow.
+         */
+        static double F(double x) {
+            const double u = std::abs(x * k);
+            return (a / k) * (u + std::log1p(std::exp(-2 * u)) - std::log(2.0));
+        }
+
+        /**
+         * The integral of log(cosh(u)) needs the dilogarithm Li2.
+         * For u >= 0 it is
+         *      u^2/2 - u log(2) + (Li2(-exp(-2u)) + pi^2/12) / 2
+         * and it is odd.
+         */
+        static double F2(double x) {
+            const double u = std::abs(x * k);
+            const double ret = (a / (k * k)) * (u * u / 2 - u * std::log(2.0) + (negativeLi2(u) + pi2 / 12) / 2);
+            return (x < 0) ? -ret : ret;
+        }
+
+    private:
+        static constexpr double a = 5.4;
+        static constexpr double k = .25;
+        static constexpr double pi2 = 3.14159265358979323846 * 3.14159265358979323846;
+
+        /**
+         * Li2(-exp(-2u)) for u >= 0.
+         * The Landen identity turns it into Li2(w) with w in (0, .5].
+         * The Bernoulli series in v = -log(1 - w) converges very fast there, since v <= log(2).
+         */
+        static double negativeLi2(double u) {
+            const double v = std::log1p(std::exp(-2 * u));
+            const double v2 = v * v;
+            // B(n) / (n + 1)! for n = 2, 4, .. 12
+            const double series = 1.0 / 36 +
+                                  v2 * (-1.0 / 3600 +
+                                        v2 * (1.0 / 211680 +
+                                              v2 * (-1.0 / 10886400 +
+                                                    v2 * (1.0 / 526901760 +
+                                                          v2 * (-691.0 / (2730.0 * 6227020800.0))))));
+            const double li2w = v - v2 / 4 + v * v2 * series;
+            return -li2w - v2 / 2;
+        }
+    };
+
+    class Fold {
+    public:
+        static const int id = 4;
+        static double f(double x) {
+            return a * AudioMath::fold(float(x));
+        }
+        /**
+         * fold is a triangle wave with period 4, so its anti-derivative is
+         * a periodic string of parabolas.
+         */
+        static double F(double x) {
+            // r is in [-1, 3)
+            const double r = x - 4 * std::floor((x + 1) / 4);
+            const double ret = (r <= 1) ? r * r / 2 : .5 + 2 * (r - 1) - (r * r - 1) / 2;
+            return a * ret;
+        }
+        /**
+         * F is always positive, and goes up by 2 every period.
+         * So F2 is a ramp, plus a periodic string of cubics.
+         */
+        static double F2(double x) {
+            const double n = std::floor((x + 1) / 4);
+            const double r = x - 4 * n;
+            const double s = r - 2;
+            const double ret = (r <= 1) ? (r * r * r + 1) / 6 : 1.0 / 3 + (r - 1) - (s * s * s + 1) / 6;
+            return a * (2 * n + ret);
+        }
+
+    private:
+        static constexpr double a = 5.6;
+    };
+};
+
 /**
 Version 1, cpu usage:
     full wave: 95
@@ -80,6 +258,7 @@ public:
         PARAM_OFFSET_TRIM,
         PARAM_OVERSAMPLE,
         PARAM_ACDC,
+        PARAM_ADAA,
         NUM_PARAMS
     };
 
@@ -112,9 +291,14 @@ public:
      */
     void step() override;
 
-    float _gain = 0;
-    float _offset = 0;
-    float _gainInput = 0;
+    static const int maxChannels = 16;
+    static const int maxBanks = maxChannels / 4;
+
+    /**
+     * Gain and offset for each channel, four channels per bank.
+     */
+    float_4 _gain[maxBanks];
+    float_4 _offset[maxBanks];
 
 private:
     std::shared_ptr<LookupTableParams<float>> audioTaper = {ObjectCache<float>::getAudioTaper()};
@@ -124,27 +308,42 @@ private:
 
     const static int maxOversample = 16;
     int curOversample = 16;
+
+    /**
+     * 0 for off, or 1 or 2 for first or second order ADAA.
+     * The shapes that support it run ADAA on top of
+     * whatever oversampling is selected.
+     */
+    int adaaOrder = 0;
     void init();
 
     std::shared_ptr<LookupTableParams<float>> tanhLookup;
     AsymWaveShaper asymShaper;
     int cycleCount = 0;
     Shapes shape = Shapes::Clip;
-    int asymCurveindex = 0;
+
+    /**
+     * Per channel settings that only some shapes use.
+     */
+    int asymCurveIndex[maxChannels];
+    float_4 crushGain[maxBanks];
 
     class DSPImp {
     public:
         /**
-         * 4 pole butterworth HP (DC blocker)
+         * 4 pole butterworth HP (DC blocker), one per bank.
+         * A float biquad does not have the precision for such a low cutoff,
+         * but the state variable form does.
          */
-        using Thpf = double;
-        BiquadParams<Thpf, 2> dcBlockParams;
-        BiquadState<Thpf, 2> dcBlockState;
+        StateVariable4PHP_4 dcBlock[maxBanks];
 
-        IIRUpsampler up;
-        IIRDecimator<float> dec;
+        PolyphaseUpsampler<float_4> up[maxBanks];
+        PolyphaseDecimator<float_4> dec[maxBanks];
+        ADAAState adaa[maxChannels];
 
         bool isActive = false;
+        int numChannels = 0;
+        int numBanks = 0;
     };
 
     // stereo
@@ -152,7 +351,17 @@ private:
 
     void processCV();
     void setOversample();
-    void processBuffer(float*) const;
+    void processBuffer(float_4*, int bank) const;
+    void processBufferADAA(float_4*, ADAAState*, int numLanes) const;
+    void copyOutput(int from, int to);
+    static bool canUseADAA(Shapes);
+
+    /**
+     * ADAA is scalar, so runs one lane at a time.
+     * Unused lanes come out as zero.
+     */
+    template <class TShape>
+    static void runADAA(float_4* buffer, int numSamples, ADAAState* state, int numLanes, int order);
 };
 
 template <class TBase>
@@ -192,6 +401,14 @@ const char* Shaper<TBase>::getString(Shapes shape) {
 
 template <class TBase>
 void Shaper<TBase>::init() {
+    for (int i = 0; i < maxBanks; ++i) {
+        _gain[i] = 0;
+        _offset[i] = 0;
+        crushGain[i] = 1;
+    }
+    for (int i = 0; i < maxChannels; ++i) {
+        asymCurveIndex[i] = 0;
+    }
     onSampleRateChange();
     setOversample();
     tanhLookup = ObjectCache<float>::getTanh5();
@@ -202,8 +419,10 @@ void Shaper<TBase>::setOversample() {
     //   float fc = .25 / float(oversample);
     for (int i = 0; i < 2; ++i) {
         DSPImp& imp = dsp[i];
-        imp.up.setup(curOversample);
-        imp.dec.setup(curOversample);
+        for (int bank = 0; bank < maxBanks; ++bank) {
+            imp.up[bank].setup(curOversample);
+            imp.dec[bank].setup(curOversample);
+        }
     }
 }
 
@@ -213,22 +432,41 @@ void Shaper<TBase>::onSampleRateChange() {
     float fcNormalized = cutoffHz * this->engineGetSampleTime();
     assert((fcNormalized > 0) && (fcNormalized < .1));
     for (int i = 0; i < 2; ++i) {
-        DSPImp& imp = dsp[i];
-        ButterworthFilterDesigner<double>::designFourPoleHighpass(imp.dcBlockParams, fcNormalized);
+        for (int bank = 0; bank < maxBanks; ++bank) {
+            for (int lane = 0; lane < 4; ++lane) {
+                dsp[i].dcBlock[bank].setCutoff(lane, fcNormalized);
+            }
+        }
+    }
+}
+
+template <class TBase>
+bool Shaper<TBase>::canUseADAA(Shapes shape) {
+    switch (shape) {
+        case Shapes::FullWave:
+        case Shapes::HalfWave:
+        case Shapes::Clip:
+        case Shapes::EmitterCoupled:
+        case Shapes::Fold:
+            return true;
+        default:
+            return false;
     }
 }
 
 template <class TBase>
 void Shaper<TBase>::processCV() {
+    const int iShape = (int)std::round(TBase::params[PARAM_SHAPE].value);
+    shape = Shapes(iShape);
+    adaaOrder = canUseADAA(shape) ? std::max(0, std::min(2, int(std::round(TBase::params[PARAM_ADAA].value)))) : 0;
+
     int oversampleCode = (int)std::round(TBase::params[PARAM_OVERSAMPLE].value);
     switch (oversampleCode) {
         case 0:
             curOversample = 16;
-            setOversample();
             break;
         case 1:
             curOversample = 4;
-            setOversample();
             break;
         case 2:
             curOversample = 1;
@@ -237,31 +475,51 @@ void Shaper<TBase>::processCV() {
             assert(false);
     }
 
-    // 0..1
-    _gainInput = scaleGain(
-        TBase::inputs[INPUT_GAIN].getVoltage(0),
-        TBase::params[PARAM_GAIN].value,
-        TBase::params[PARAM_GAIN_TRIM].value);
+    if (curOversample != 1) {
+        setOversample();
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        DSPImp& imp = dsp[i];
+        auto& inPort = TBase::inputs[INPUT_AUDIO0 + i];
+        auto& outPort = TBase::outputs[OUTPUT_AUDIO0 + i];
+        imp.isActive = inPort.isConnected() && outPort.isConnected();
+        imp.numChannels = imp.isActive ? inPort.getChannels() : 0;
+        imp.numBanks = (imp.numChannels / 4) + ((imp.numChannels % 4) ? 1 : 0);
+        if (imp.isActive) {
+            outPort.setChannels(imp.numChannels);
+        }
+    }
+
+    const int numChannels = std::max(dsp[0].numChannels, dsp[1].numChannels);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const int bank = channel / 4;
+        const int lane = channel % 4;
 
-    _gain = 5 * LookupTable<float>::lookup(*audioTaper, _gainInput, false);
+        // 0..1
+        const float gainInput = scaleGain(
+            TBase::inputs[INPUT_GAIN].getPolyVoltage(channel),
+            TBase::params[PARAM_GAIN].value,
+            TBase::params[PARAM_GAIN_TRIM].value);
 
-    // -5 .. 5
-    const float offsetInput = scaleOffset(
-        TBase::inputs[INPUT_OFFSET].getVoltage(0),
-        TBase::params[PARAM_OFFSET].value,
-        TBase::params[PARAM_OFFSET_TRIM].value);
+        _gain[bank][lane] = 5 * LookupTable<float>::lookup(*audioTaper, gainInput, false);
 
-    _offset = offsetInput;
+        // -5 .. 5
+        const float offsetInput = scaleOffset(
+            TBase::inputs[INPUT_OFFSET].getPolyVoltage(channel),
+            TBase::params[PARAM_OFFSET].value,
+            TBase::params[PARAM_OFFSET_TRIM].value);
 
-    const int iShape = (int)std::round(TBase::params[PARAM_SHAPE].value);
-    shape = Shapes(iShape);
+        _offset[bank][lane] = offsetInput;
 
-    const float sym = .1f * (5 - _offset);
-    asymCurveindex = (int)round(sym * 15.1);  // This math belongs in the shaper
+        const float sym = .1f * (5 - offsetInput);
+        asymCurveIndex[channel] = (int)round(sym * 15.1);  // This math belongs in the shaper
 
-    for (int i = 0; i < 2; ++i) {
-        dsp[i].isActive = TBase::inputs[INPUT_AUDIO0 + i].isConnected() &&
-                          TBase::outputs[OUTPUT_AUDIO0 + i].isConnected();
+        float invGain = 1 + (1 - gainInput) * 100;  //0..10
+        invGain *= .01f;
+        invGain = std::max(invGain, .09f);
+        assert(invGain >= .09);
+        crushGain[bank][lane] = invGain;
     }
 }
 
@@ -275,35 +533,44 @@ void Shaper<TBase>::step() {
     for (int i = 0; i < 2; ++i) {
         DSPImp& imp = dsp[i];
         if (imp.isActive) {
-            float buffer[maxOversample];
-            float input = TBase::inputs[INPUT_AUDIO0 + i].getVoltage(0);
-
-            // TODO: maybe add offset after gain?
-            if (shape != Shapes::AsymSpline) {
-                input += _offset;
-            }
-            if (shape != Shapes::Crush) {
-                input *= _gain;
-            }
+            auto& inPort = TBase::inputs[INPUT_AUDIO0 + i];
+            auto& outPort = TBase::outputs[OUTPUT_AUDIO0 + i];
+            for (int bank = 0; bank < imp.numBanks; ++bank) {
+                const int baseChannel = bank * 4;
+                float_4 buffer[maxOversample];
+                float_4 input = inPort.template getVoltageSimd<float_4>(baseChannel);
+
+                // TODO: maybe add offset after gain?
+                if (shape != Shapes::AsymSpline) {
+                    input += _offset[bank];
+                }
+                if (shape != Shapes::Crush) {
+                    input *= _gain[bank];
+                }
 
-            if (curOversample != 1) {
-                imp.up.process(buffer, input);
-            } else {
-                buffer[0] = input;
-            }
+                if (curOversample != 1) {
+                    imp.up[bank].process(buffer, input);
+                } else {
+                    buffer[0] = input;
+                }
 
-            processBuffer(buffer);
-            float output;
-            if (curOversample != 1) {
-                output = imp.dec.process(buffer);
-            } else {
-                output = buffer[0];
-            }
+                if (adaaOrder) {
+                    processBufferADAA(buffer, imp.adaa + baseChannel, std::min(4, imp.numChannels - baseChannel));
+                } else {
+                    processBuffer(buffer, bank);
+                }
+                float_4 output;
+                if (curOversample != 1) {
+                    output = imp.dec[bank].process(buffer);
+                } else {
+                    output = buffer[0];
+                }
 
-            if (TBase::params[PARAM_ACDC].value < .5) {
-                output = float(BiquadFilter<double>::run(output, imp.dcBlockState, imp.dcBlockParams));
+                if (TBase::params[PARAM_ACDC].value < .5) {
+                    output = imp.dcBlock[bank].run(output);
+                }
+                outPort.setVoltageSimd(output, baseChannel);
             }
-            TBase::outputs[OUTPUT_AUDIO0 + i].setVoltage(output, 0);
         }
     }
 
@@ -314,94 +581,105 @@ void Shaper<TBase>::step() {
         TBase::outputs[OUTPUT_AUDIO1].setVoltage(0, 0);
     } else if (dsp[0].isActive && !dsp[1].isActive) {
         // left connected, right not r = l
-        TBase::outputs[OUTPUT_AUDIO1].setVoltage(TBase::outputs[OUTPUT_AUDIO0].getVoltage(0), 0);
+        copyOutput(OUTPUT_AUDIO0, OUTPUT_AUDIO1);
     } else if (!dsp[0].isActive && dsp[1].isActive) {
-        TBase::outputs[OUTPUT_AUDIO0].setVoltage(TBase::outputs[OUTPUT_AUDIO1].getVoltage(0), 0);
+        copyOutput(OUTPUT_AUDIO1, OUTPUT_AUDIO0);
+    }
+}
+
+template <class TBase>
+void Shaper<TBase>::copyOutput(int from, int to) {
+    auto& fromPort = TBase::outputs[from];
+    auto& toPort = TBase::outputs[to];
+    const int numChannels = fromPort.getChannels();
+    toPort.setChannels(numChannels);
+    for (int baseChannel = 0; baseChannel < numChannels; baseChannel += 4) {
+        toPort.setVoltageSimd(fromPort.template getVoltageSimd<float_4>(baseChannel), baseChannel);
     }
 }
 
 template <class TBase>
-void Shaper<TBase>::processBuffer(float* buffer) const {
+void Shaper<TBase>::processBuffer(float_4* buffer, int bank) const {
     switch (shape) {
         case Shapes::FullWave:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = std::abs(x);
+                float_4 x = buffer[i];
+                x = rack::simd::abs(x);
                 x *= 1.94f;
-                x = std::min(x, 10.f);
+                x = SimdBlocks::min(x, float_4(10.f));
                 buffer[i] = x;
             }
             break;
-        case Shapes::AsymSpline:
+        case Shapes::AsymSpline: {
+            const int* index = asymCurveIndex + bank * 4;
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
+                float_4 x = buffer[i];
                 x *= .15f;
-                x = asymShaper.lookup(x, asymCurveindex);
+                x = asymShaper.lookup(x, index);
                 x *= 6.1f;
                 buffer[i] = x;
             }
-            break;
+        } break;
         case Shapes::Clip:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
+                float_4 x = buffer[i];
                 x *= 3;
-                x = std::min(3.f, x);
-                x = std::max(-3.f, x);
+                x = SimdBlocks::min(float_4(3.f), x);
+                x = SimdBlocks::max(float_4(-3.f), x);
                 x *= 1.2f;
                 buffer[i] = x;
             }
             break;
         case Shapes::EmitterCoupled:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
+                float_4 x = buffer[i];
                 x *= .25;
-                x = LookupTable<float>::lookup(*tanhLookup.get(), x, true);
+                x = LookupTable_4::lookup(*tanhLookup.get(), x);
                 x *= 5.4f;
                 buffer[i] = x;
             }
             break;
         case Shapes::HalfWave:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = std::max(0.f, x);
+                float_4 x = buffer[i];
+                x = SimdBlocks::max(float_4::zero(), x);
                 x *= 1.4f * 1.26f;
-                x = std::min(x, 10.f);
+                x = SimdBlocks::min(x, float_4(10.f));
                 buffer[i] = x;
             }
             break;
         case Shapes::Fold:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = AudioMath::fold(x);
+                float_4 x = buffer[i];
+                x = SimdBlocks::fold(x);
                 x *= 5.6f;
                 buffer[i] = x;
             }
             break;
         case Shapes::Fold2:
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = .3f * AudioMath::fold(x);
-                if (x > 0) {
-                    x = LookupTable<float>::lookup(*sinLookup, 1.3f * x, false);
-                } else {
-                    x = -LookupTable<float>::lookup(*sinLookup, -x, false);
-                }
-                if (x > 0) x = std::sqrt(x);
+                float_4 x = buffer[i];
+                x = .3f * SimdBlocks::fold(x);
+
+                // sin(x) is odd, so look up |x| and put the sign back
+                const float_4 positive = x > float_4::zero();
+                x = LookupTable_4::lookup(*sinLookup, SimdBlocks::ifelse(positive, 1.3f * x, -x));
+                x = SimdBlocks::ifelse(positive, x, -x);
+
+                const float_4 root = rack::simd::sqrt(SimdBlocks::max(x, float_4::zero()));
+                x = SimdBlocks::ifelse(x > float_4::zero(), root, x);
                 x *= 4.4f;
                 buffer[i] = x;
             }
             break;
 
         case Shapes::Crush: {
-            float invGain = 1 + (1 - _gainInput) * 100;  //0..10
-            invGain *= .01f;
-            invGain = std::max(invGain, .09f);
-            assert(invGain >= .09);
+            const float_4 invGain = crushGain[bank];
             for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];  // for crush, no gain has been applied
+                float_4 x = buffer[i];  // for crush, no gain has been applied
 
                 x *= invGain;
-                x = std::round(x + .5f) - .5f;
+                x = rack::simd::round(x + .5f) - .5f;
                 x /= invGain;
                 buffer[i] = x;
             }
@@ -412,6 +690,48 @@ void Shaper<TBase>::processBuffer(float* buffer) const {
     }
 }
 
+template <class TBase>
+template <class TShape>
+void Shaper<TBase>::runADAA(float_4* buffer, int numSamples, ADAAState* state, int numLanes, int order) {
+    float lanes[4][maxOversample] = {};
+    for (int lane = 0; lane < numLanes; ++lane) {
+        for (int i = 0; i < numSamples; ++i) {
+            lanes[lane][i] = buffer[i][lane];
+        }
+        if (order == 2) {
+            ADAA2<TShape>::run(lanes[lane], numSamples, state[lane]);
+        } else {
+            ADAA1<TShape>::run(lanes[lane], numSamples, state[lane]);
+        }
+    }
+    for (int i = 0; i < numSamples; ++i) {
+        buffer[i] = float_4(lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]);
+    }
+}
+
+template <class TBase>
+void Shaper<TBase>::processBufferADAA(float_4* buffer, ADAAState* state, int numLanes) const {
+    switch (shape) {
+        case Shapes::FullWave:
+            runADAA<ShaperADAAShapes::FullWave>(buffer, curOversample, state, numLanes, adaaOrder);
+            break;
+        case Shapes::HalfWave:
+            runADAA<ShaperADAAShapes::HalfWave>(buffer, curOversample, state, numLanes, adaaOrder);
+            break;
+        case Shapes::Clip:
+            runADAA<ShaperADAAShapes::Clip>(buffer, curOversample, state, numLanes, adaaOrder);
+            break;
+        case Shapes::EmitterCoupled:
+            runADAA<ShaperADAAShapes::EmitterCoupled>(buffer, curOversample, state, numLanes, adaaOrder);
+            break;
+        case Shapes::Fold:
+            runADAA<ShaperADAAShapes::Fold>(buffer, curOversample, state, numLanes, adaaOrder);
+            break;
+        default:
+            assert(false);
+    }
+}
+
 template <class TBase>
 int ShaperDescription<TBase>::getNumParams() {
     return Shaper<TBase>::NUM_PARAMS;
@@ -447,6 +767,9 @@ IComposite::Config ShaperDescription<TBase>::getParam(int i) {
         case Shaper<TBase>::PARAM_ACDC:
             ret = {0.0f, 1.f, 0, "AC/DC"};
             break;
+        case Shaper<TBase>::PARAM_ADAA:
+            ret = {0.0f, 2.f, 0, "Anti-alias (ADAA)"};
+            break;
         default:
             assert(false);
     }
@@ -2,10 +2,12 @@
 #pragma once
 
 #include "GateTrigger.h"
-#include "IIRDecimator.h"
 #include "NonUniformLookupTable.h"
+#include "ObjectCache.h"
+#include "PolyphaseDecimator.h"
+#include "SimdBlocks.h"
 #include "SqPort.h"
-#include "StateVariable4PHP.h"
+#include "StateVariable4PHP_4.h"
 
 class SawtoothDetuneCurve {
 public:
@@ -56,51 +58,63 @@ public:
 };
 
 /**
- * the signal processing for one channel
- * of saws
+ * The saws for one channel.
+ *
+ * The seven saws are padded to eight, so they fit in two float_4.
+ * The extra saw never moves, and has zero gain.
+ *
+ * The mixing down, decimation and filtering is done by SuperDspCommon,
+ * four channels at a time.
  */
 class SuperDsp {
 public:
     SuperDsp();
+
     /**
-     * divisor is 4 for 4X oversampling, etc.
+     * Per sample bookkeeping. The audio is generated by SuperDspCommon.
      */
-    void setupDecimationRatio(int divisor);
-
-    void step(const SuperDpsCommonData&,
-              int channel, int oversampleRate, bool isStereo, float* bufferLeft, float* bufferRight,
-              SqOutput& leftOut, SqOutput& rightOut, SqInput& triggerInput);
+    void step(const SuperDpsCommonData&, int channel, SqInput& triggerInput);
 
     void updatePhaseInc(const SuperDpsCommonData&,
                         int channel, int oversampleRate, float sampleTime, SqInput& cvInput,
                         float fineTuneParam, float semiParam, float octaveParam, SqInput& fmInput,
                         float fmParam, SqInput& detuneInput, float detuneParam, float detuneTrimParam);
-    void updateHPFilters(bool isStereo);
     void updateMix(const SuperDpsCommonData& data, int channel, SqInput& mixInput, float mixParam, float mixTrimParam);
     void updateStereoGains(bool hardPan);
 
+    /**
+     * cutoff for the DC blocking high pass in classic mode.
+     */
+    float getHPCutoff() const {
+        return std::min(globalPhaseInc, .1f);
+    }
+
+    /**
+     * Run all the saws for numSamples samples.
+     * Output is not completely mixed down - it must be summed across the lanes.
+     */
+    void runSaws(float_4* mix, int numSamples);
+    void runSawsStereo(float_4* left, float_4* right, int numSamples);
+
     int _stepCalls = 0;
     int _updatePhaseIncCalls = 0;
 
 private:
-    IIRDecimator<float> decimatorLeft;
-    IIRDecimator<float> decimatorRight;
-    StateVariable4PHP hpfLeft;
-    StateVariable4PHP hpfRight;
     GateTrigger gateTrigger;
 
     static const int numSaws = 7;
-    float globalPhaseInc = 0;
-    float phase[numSaws] = {0};
-    float phaseInc[numSaws] = {0};
+    static const int numSawsPadded = 8;
+    static const int numSawBanks = numSawsPadded / 4;
 
-    float gainCenter = 0;
-    float gainSides = 0;
+    float globalPhaseInc = 0;
+    float_4 phase[numSawBanks] = {float_4::zero(), float_4::zero()};
+    float_4 phaseInc[numSawBanks] = {float_4::zero(), float_4::zero()};
 
-    // current left and right gains
-    float sawGainsStereo[2][numSaws] = {
-        {.2f},
-        {.2f}};
+    // current gains
+    float_4 sawGainsMono[numSawBanks] = {float_4::zero(), float_4::zero()};
+    float_4 sawGainsStereo[2][numSawBanks] = {
+        {float_4::zero(), float_4::zero()},
+        {float_4::zero(), float_4::zero()}};
 
     float sawGainsNorm[2][numSaws] = {
         {1.f, .26f, .87f, .71f, .5f, .97f, 0.f},
@@ -120,122 +134,53 @@ private:
         1.06f,
         1.107f};
 
-    void updateAudioClassic(int channel, SqOutput& leftOut, SqOutput& rightOut);
     void updateTrigger(const SuperDpsCommonData& data, SqInput& triggerInput, int channel);
-    void updateAudioClean(int channel, float* buffer, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate);
-    void updateAudioClassicStereo(int channel, SqOutput& leftOut, SqOutput& rightOut);
-    void updateAudioCleanStereo(int channel, float* bufferLeft, float* bufferRight, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate);
-    void runSaws(float& left);
-    void runSawsStereo(float& left, float& right);
+    static float_4 advance(float_4 phase, float_4 phaseInc);
 };
 
 inline SuperDsp::SuperDsp() : gateTrigger(true) {
 }
 
-// is this function even necessary? I think it's just initial setup
-inline void SuperDsp::setupDecimationRatio(int decimateDiv) {
-    decimatorLeft.setup(decimateDiv);
-    decimatorRight.setup(decimateDiv);
-}
-
-inline void SuperDsp::step(const SuperDpsCommonData& data,
-                           int channel, int oversampleRate, bool isStereo, float* bufferLeft, float* bufferRight,
-                           SqOutput& leftOut, SqOutput& rightOut,
-                           Input& triggerInput) {
+inline void SuperDsp::step(const SuperDpsCommonData& data, int channel, Input& triggerInput) {
     ++_stepCalls;
-    if ((oversampleRate == 1) && !isStereo) {
-        updateAudioClassic(channel, leftOut, rightOut);
-    } else if ((oversampleRate == 1) && isStereo) {
-        updateAudioClassicStereo(channel, leftOut, rightOut);
-    } else if ((oversampleRate != 1) && !isStereo) {
-        updateAudioClean(channel, bufferLeft, leftOut, rightOut, oversampleRate);
-    } else {
-        updateAudioCleanStereo(channel, bufferLeft, bufferRight, leftOut, rightOut, oversampleRate);
-    }
     updateTrigger(data, triggerInput, channel);
 }
 
-inline void SuperDsp::updateAudioClassic(int channel, SqOutput& leftOut, SqOutput& rightOut) {
-    float left;
-    runSaws(left);
-
-    const float output = hpfLeft.run(left);
-    leftOut.setVoltage(output, channel);
-    rightOut.setVoltage(output, channel);
-}
-
-inline void SuperDsp::updateAudioClean(int channel, float* buffer, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate) {
-    const int bufferSize = oversampleRate;
-    decimatorLeft.setup(bufferSize);
-    for (int i = 0; i < bufferSize; ++i) {
-        float left;
-        runSaws(left);
-        buffer[i] = left;
-    }
-
-    const float output = decimatorLeft.process(buffer);
-    leftOut.setVoltage(output, channel);
-    rightOut.setVoltage(output, channel);
-}
-
-inline void SuperDsp::updateAudioClassicStereo(int channel, SqOutput& leftOut, SqOutput& rightOut) {
-    float left, right;
-    runSawsStereo(left, right);
-
-    const float outputLeft = hpfLeft.run(left);
-    const float outputRight = hpfRight.run(right);
-    leftOut.setVoltage(outputLeft, channel);
-    rightOut.setVoltage(outputRight, channel);
-}
-
-inline void SuperDsp::updateAudioCleanStereo(int channel, float* bufferLeft, float* bufferRight, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate) {
-    const int bufferSize = oversampleRate;
-    decimatorLeft.setup(bufferSize);
-    decimatorRight.setup(bufferSize);
-    for (int i = 0; i < bufferSize; ++i) {
-        float left, right;
-        runSawsStereo(left, right);
-        bufferLeft[i] = left;
-        bufferRight[i] = right;
-    }
-
-    const float outputLeft = decimatorLeft.process(bufferLeft);
-    const float outputRight = decimatorRight.process(bufferRight);
-    leftOut.setVoltage(outputLeft, channel);
-    rightOut.setVoltage(outputRight, channel);
+inline float_4 SuperDsp::advance(float_4 phase, float_4 phaseInc) {
+    phase += phaseInc;
+    phase -= SimdBlocks::ifelse(phase > float_4(1), float_4(1), float_4::zero());
+    simd_assertLE(phase, float_4(1));
+    simd_assertGE(phase, float_4::zero());
+    return phase;
 }
 
-inline void SuperDsp::runSaws(float& left) {
-    float mix = 0;
-    for (int i = 0; i < numSaws; ++i) {
-        phase[i] += phaseInc[i];
-        if (phase[i] > 1) {
-            phase[i] -= 1;
-        }
-        assert(phase[i] <= 1);
-        assert(phase[i] >= 0);
-
-        const float gain = (i == numSaws / 2) ? gainCenter : gainSides;
-        mix += (phase[i] - .5f) * gain;  // experiment to get rid of DC
+inline void SuperDsp::runSaws(float_4* mix, int numSamples) {
+    // local copies, so the phases stay in registers
+    float_4 phase0 = phase[0];
+    float_4 phase1 = phase[1];
+    for (int i = 0; i < numSamples; ++i) {
+        phase0 = advance(phase0, phaseInc[0]);
+        phase1 = advance(phase1, phaseInc[1]);
+        // subtract .5 is an experiment to get rid of DC
+        mix[i] = (phase0 - .5f) * sawGainsMono[0] + (phase1 - .5f) * sawGainsMono[1];
     }
-
-    mix *= 4.5;  // too low 2 too high 10
-    left = mix;
+    phase[0] = phase0;
+    phase[1] = phase1;
 }
 
-inline void SuperDsp::runSawsStereo(float& left, float& right) {
-    left = right = 0;
-    for (int i = 0; i < numSaws; ++i) {
-        phase[i] += phaseInc[i];
-        if (phase[i] > 1) {
-            phase[i] -= 1;
-        }
-        assert(phase[i] <= 1);
-        assert(phase[i] >= 0);
-
-        left += (phase[i] - .5f) * sawGainsStereo[0][i];
-        right += (phase[i] - .5f) * sawGainsStereo[1][i];
+inline void SuperDsp::runSawsStereo(float_4* left, float_4* right, int numSamples) {
+    float_4 phase0 = phase[0];
+    float_4 phase1 = phase[1];
+    for (int i = 0; i < numSamples; ++i) {
+        phase0 = advance(phase0, phaseInc[0]);
+        phase1 = advance(phase1, phaseInc[1]);
+        const float_4 saw0 = phase0 - .5f;
+        const float_4 saw1 = phase1 - .5f;
+        left[i] = saw0 * sawGainsStereo[0][0] + saw1 * sawGainsStereo[0][1];
+        right[i] = saw0 * sawGainsStereo[1][0] + saw1 * sawGainsStereo[1][1];
     }
+    phase[0] = phase0;
+    phase[1] = phase1;
 }
 
 inline void SuperDsp::updatePhaseInc(const SuperDpsCommonData& data,
@@ -295,15 +240,7 @@ inline void SuperDsp::updatePhaseInc(const SuperDpsCommonData& data,
             phaseIncI /= oversampleRate;
         }
         assert(phaseIncI > 0 && phaseIncI < .1);
-        phaseInc[i] = phaseIncI;
-    }
-}
-
-inline void SuperDsp::updateHPFilters(bool isStereo) {
-    const float filterCutoff = std::min(globalPhaseInc, .1f);
-    hpfLeft.setCutoff(filterCutoff);
-    if (isStereo) {
-        hpfRight.setCutoff(filterCutoff);
+        phaseInc[i / 4][i % 4] = phaseIncI;
     }
 }
 
@@ -312,7 +249,7 @@ inline void SuperDsp::updateTrigger(const SuperDpsCommonData& data, Input& input
     gateTrigger.go(triggerInput);
     if (gateTrigger.trigger()) {
         for (int i = 0; i < numSaws; ++i) {
-            phase[i] = data.random();
+            phase[i / 4][i % 4] = data.random();
         }
     }
 }
@@ -323,15 +260,20 @@ inline void SuperDsp::updateMix(const SuperDpsCommonData& data, int channel, SqI
         mixParam,
         mixTrimParam);
 
-    gainCenter = -0.55366f * rawMixValue + 0.99785f;
+    const float gainCenter = -0.55366f * rawMixValue + 0.99785f;
+
+    const float gainSides = -0.73764f * rawMixValue * rawMixValue +
+                            1.2841f * rawMixValue + 0.044372f;
 
-    gainSides = -0.73764f * rawMixValue * rawMixValue +
-                1.2841f * rawMixValue + 0.044372f;
+    for (int i = 0; i < numSaws; ++i) {
+        const float gain = (i == numSaws / 2) ? gainCenter : gainSides;
+        sawGainsMono[i / 4][i % 4] = 4.5f * gain;  // too low 2 too high 10
+    }
 }
 
 inline void SuperDsp::updateStereoGains(bool hardPan) {
     for (int i = 0; i < numSaws; ++i) {
-        const float monoGain = 4.5f * ((i == numSaws / 2) ? gainCenter : gainSides);
+        const float monoGain = sawGainsMono[i / 4][i % 4];
 
         float l = monoGain;
         float r = monoGain;
@@ -344,8 +286,8 @@ inline void SuperDsp::updateStereoGains(bool hardPan) {
             r *= sawGainsHardPan[1][i];
         }
 
-        sawGainsStereo[0][i] = l;
-        sawGainsStereo[1][i] = r;
+        sawGainsStereo[0][i / 4][i % 4] = l;
+        sawGainsStereo[1][i / 4][i % 4] = r;
     }
 }
 
@@ -382,27 +324,180 @@ public:
     }
 
 private:
-    float bufferLeft[MAX_OVERSAMPLE] = {0};
-    float bufferRight[MAX_OVERSAMPLE] = {0};
+    static const int maxBanks = 4;
+    float_4 bufferLeft[MAX_OVERSAMPLE];
+    float_4 bufferRight[MAX_OVERSAMPLE];
+
+    /**
+     * Saw output for each channel in a bank, before it is summed across the lanes.
+     * Unused channels point at silence.
+     */
+    float_4 partialLeft[4][MAX_OVERSAMPLE];
+    float_4 partialRight[4][MAX_OVERSAMPLE];
+    float_4 silence[MAX_OVERSAMPLE] = {};
 
     SuperDsp dsp[16];  // maximum 16 channels
 
+    /**
+     * The decimators and filters each do four channels,
+     * one bank of channels per float_4.
+     */
+    PolyphaseDecimator<float_4> decimatorLeft[maxBanks];
+    PolyphaseDecimator<float_4> decimatorRight[maxBanks];
+    StateVariable4PHP_4 hpfLeft[maxBanks];
+    StateVariable4PHP_4 hpfRight[maxBanks];
+
+    /**
+     * A single oversampled channel doesn't use the banks. Transposing its saws
+     * against three silent channels, and decimating three silent lanes, made it
+     * slower than the scalar code it replaced.
+     */
+    float monoLeft[MAX_OVERSAMPLE];
+    float monoRight[MAX_OVERSAMPLE];
+    PolyphaseDecimator<float> monoDecimatorLeft;
+    PolyphaseDecimator<float> monoDecimatorRight;
+
     std::function<float(float)> expLookup =
         ObjectCache<float>::getExp2Ex();
     std::shared_ptr<LookupTableParams<float>> audioTaper =
         ObjectCache<float>::getAudioTaper();
+
+    void runSaws(int bank, int numChannels, int numSamples);
+    void runSawsStereo(int bank, int numChannels, int numSamples);
+    void stepMono(bool isStereo, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate);
+    static void sumLanes(float_4* output, const float_4* const* input, int numSamples);
+    static void sumLanes(float* output, const float_4* input, int numSamples);
 };
 
 inline void SuperDspCommon::setupDecimationRatio(int divisor, int numChannels) {
-    for (int i = 0; i < numChannels; ++i) {
-        dsp[i].setupDecimationRatio(divisor);
+    const int numBanks = (numChannels / 4) + ((numChannels % 4) ? 1 : 0);
+    for (int i = 0; i < numBanks; ++i) {
+        decimatorLeft[i].setup(divisor);
+        decimatorRight[i].setup(divisor);
+    }
+}
+
+/**
+ * output[i] = float_4(sum(input[0][i]), sum(input[1][i]), sum(input[2][i]), sum(input[3][i]))
+ */
+inline void SuperDspCommon::sumLanes(float_4* output, const float_4* const* input, int numSamples) {
+    for (int i = 0; i < numSamples; ++i) {
+        __m128 a = input[0][i].v;
+        __m128 b = input[1][i].v;
+        __m128 c = input[2][i].v;
+        __m128 d = input[3][i].v;
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        output[i] = float_4(a) + float_4(b) + float_4(c) + float_4(d);
+    }
+}
+
+/**
+ * output[i] = sum(input[i]), done four samples at a time.
+ */
+inline void SuperDspCommon::sumLanes(float* output, const float_4* input, int numSamples) {
+    assert((numSamples % 4) == 0);
+    for (int i = 0; i < numSamples; i += 4) {
+        __m128 a = input[i].v;
+        __m128 b = input[i + 1].v;
+        __m128 c = input[i + 2].v;
+        __m128 d = input[i + 3].v;
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)));
+    }
+}
+
+inline void SuperDspCommon::runSaws(int bank, int numChannels, int numSamples) {
+    const float_4* mix[4];
+    for (int i = 0; i < 4; ++i) {
+        if (i < numChannels) {
+            dsp[bank * 4 + i].runSaws(partialLeft[i], numSamples);
+            mix[i] = partialLeft[i];
+        } else {
+            mix[i] = silence;
+        }
+    }
+    sumLanes(bufferLeft, mix, numSamples);
+}
+
+inline void SuperDspCommon::runSawsStereo(int bank, int numChannels, int numSamples) {
+    const float_4* mixLeft[4];
+    const float_4* mixRight[4];
+    for (int i = 0; i < 4; ++i) {
+        if (i < numChannels) {
+            dsp[bank * 4 + i].runSawsStereo(partialLeft[i], partialRight[i], numSamples);
+            mixLeft[i] = partialLeft[i];
+            mixRight[i] = partialRight[i];
+        } else {
+            mixLeft[i] = silence;
+            mixRight[i] = silence;
+        }
+    }
+    sumLanes(bufferLeft, mixLeft, numSamples);
+    sumLanes(bufferRight, mixRight, numSamples);
+}
+
+inline void SuperDspCommon::stepMono(bool isStereo, SqOutput& leftOut, SqOutput& rightOut, int oversampleRate) {
+    monoDecimatorLeft.setup(oversampleRate);
+    float left;
+    float right;
+    if (isStereo) {
+        dsp[0].runSawsStereo(partialLeft[0], partialRight[0], oversampleRate);
+        sumLanes(monoLeft, partialLeft[0], oversampleRate);
+        sumLanes(monoRight, partialRight[0], oversampleRate);
+        monoDecimatorRight.setup(oversampleRate);
+        left = monoDecimatorLeft.process(monoLeft);
+        right = monoDecimatorRight.process(monoRight);
+    } else {
+        dsp[0].runSaws(partialLeft[0], oversampleRate);
+        sumLanes(monoLeft, partialLeft[0], oversampleRate);
+        left = monoDecimatorLeft.process(monoLeft);
+        right = left;
     }
+    leftOut.setVoltage(left, 0);
+    rightOut.setVoltage(right, 0);
 }
 
 inline void SuperDspCommon::step(int numChannels, bool isStereo, SqOutput& leftOut, SqOutput& rightOut,
                                  int oversampleRate, SqInput& triggerInput) {
+    if (numChannels == 1 && oversampleRate > 1) {
+        stepMono(isStereo, leftOut, rightOut, oversampleRate);
+        dsp[0].step(*this, 0, triggerInput);
+        return;
+    }
+    for (int bank = 0; bank < maxBanks; ++bank) {
+        const int baseChannel = bank * 4;
+        const int bankChannels = std::min(4, numChannels - baseChannel);
+        if (bankChannels <= 0) {
+            break;
+        }
+
+        float_4 left;
+        float_4 right;
+        if (isStereo) {
+            runSawsStereo(bank, bankChannels, oversampleRate);
+        } else {
+            runSaws(bank, bankChannels, oversampleRate);
+        }
+
+        if (oversampleRate == 1) {
+            left = hpfLeft[bank].run(bufferLeft[0]);
+            right = isStereo ? hpfRight[bank].run(bufferRight[0]) : left;
+        } else {
+            decimatorLeft[bank].setup(oversampleRate);
+            left = decimatorLeft[bank].process(bufferLeft);
+            if (isStereo) {
+                decimatorRight[bank].setup(oversampleRate);
+                right = decimatorRight[bank].process(bufferRight);
+            } else {
+                right = left;
+            }
+        }
+        leftOut.setVoltageSimd(left, baseChannel);
+        rightOut.setVoltageSimd(right, baseChannel);
+    }
+
     for (int i = 0; i < numChannels; ++i) {
-        dsp[i].step(*this, i, oversampleRate, isStereo, bufferLeft, bufferRight, leftOut, rightOut, triggerInput);
+        dsp[i].step(*this, i, triggerInput);
     }
 }
 
@@ -415,7 +510,13 @@ inline void SuperDspCommon::stepn(int n, int channel, int oversampleRate, float
     SuperDsp& d = dsp[channel];
 
     d.updatePhaseInc(*this, channel, oversampleRate, sampleTime, cvInput, fineTuneParam, semiParam, octaveParam, fmInput, fmParam, detuneInput, detuneParam, detuneTrimParam);
-    d.updateHPFilters(isStereo);
+
+    const float filterCutoff = d.getHPCutoff();
+    hpfLeft[channel / 4].setCutoff(channel % 4, filterCutoff);
+    if (isStereo) {
+        hpfRight[channel / 4].setCutoff(channel % 4, filterCutoff);
+    }
+
     d.updateMix(*this, channel, mixInput, mixParam, mixTrimParam);
     d.updateStereoGains(hardPan);
 }
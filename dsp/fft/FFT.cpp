@@ -2,13 +2,44 @@
 #include "AudioMath.h"
 #include "FFT.h"
 #include "FFTData.h"
+#include "FFTPlan.h"
 
 #include <assert.h>
+#include <atomic>
 #include "kiss_fft.h"
 #include "kiss_fftr.h"
 
 #include "AudioMath.h"
 
+static std::atomic<FFT::Backend> backend(FFT::Backend::Simd);
+
+void FFT::setBackend(Backend b)
+{
+    backend = b;
+}
+
+FFT::Backend FFT::getBackend()
+{
+    return backend;
+}
+
+/**
+ * Returns the SSE plan for data, making it if needed,
+ * or nullptr if we should use kiss.
+ */
+template <typename T>
+const FFTPlan* FFT::getPlan(const FFTData<T>& data)
+{
+    if (backend != FFT::Backend::Simd || !FFTPlan::supports(data.size())) {
+        return nullptr;
+    }
+    if (!data.plan) {
+        data.plan = FFTPlan::get(data.size());
+        data.planWork.resize(data.plan->workSize());
+    }
+    return data.plan.get();
+}
+
 
 bool FFT::forward(FFTDataCpx* out, const FFTDataReal& in)
 {
@@ -16,6 +47,17 @@ bool FFT::forward(FFTDataCpx* out, const FFTDataReal& in)
         return false;
     }
 
+    const float scale = float(1.0 / in.buffer.size());
+    if (const FFTPlan* plan = getPlan(in)) {
+        plan->forward(out->buffer.data(), in.buffer.data(), in.planWork.data(), scale);
+
+        // kiss doesn't write the upper bins, but they get scaled anyway
+        for (size_t i = in.buffer.size() / 2 + 1; i < in.buffer.size(); ++i) {
+            out->buffer[i] *= scale;
+        }
+        return true;
+    }
+
     // step 1: create the cfg, if needed
     if (in.kiss_cfg == 0) {
         bool inverse_fft = false;
@@ -41,7 +83,6 @@ bool FFT::forward(FFTDataCpx* out, const FFTDataReal& in)
     kiss_fftr(theCfg, in.buffer.data(), outBuffer);
 
     // step 4: scale
-    const float scale = float(1.0 / in.buffer.size());
     for (size_t i = 0; i < in.buffer.size(); ++i) {
         out->buffer[i] *= scale;
     }
@@ -55,6 +96,11 @@ bool FFT::inverse(FFTDataReal* out, const FFTDataCpx& in)
         return false;
     }
 
+    if (const FFTPlan* plan = getPlan(in)) {
+        plan->inverse(out->buffer.data(), in.buffer.data(), in.planWork.data());
+        return true;
+    }
+
     // step 1: create the cfg, if needed
     if (in.kiss_cfg == 0) {
         bool inverse_fft = true;
@@ -102,7 +148,12 @@ static float randomPhase()
     return phase;
 }
 
-static void makeNegSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
+static float getPhase(const std::vector<float>* phases, int bin)
+{
+    return phases ? (*phases)[bin] : randomPhase();
+}
+
+static void makeNegSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec, const std::vector<float>* phases)
 {
     const int numBins = int(output->size());
     const float lowFreqCorner = 40;
@@ -112,17 +163,17 @@ static void makeNegSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
  
     // fill bottom bins with 1.0 mag
     for (int i = 0; i <= bin40; ++i) {
-        output->set(i, std::polar(1.f, randomPhase()));
+        output->set(i, std::polar(1.f, getPhase(phases, i)));
     }
 
     // now go to the end and at slope
-    static float k = -spec.slope * log2(lowFreqCorner);
+    const float k = -spec.slope * log2(lowFreqCorner);
     for (int i = bin40 + 1; i < numBins; ++i) {
         if (i < numBins / 2) {
             const double f = FFT::bin2Freq(i, spec.sampleRate, numBins);
             const double gainDb = std::log2(f) * spec.slope + k;
             const float gain = float(AudioMath::gainFromDb(gainDb));
-            output->set(i, std::polar(gain, randomPhase()));
+            output->set(i, std::polar(gain, getPhase(phases, i)));
         } else {
             output->set(i, cpx(0, 0));
         }
@@ -130,7 +181,7 @@ static void makeNegSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
     output->set(0, 0);          // make sure dc bin zero
 }
 
-static void makePosSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
+static void makePosSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec, const std::vector<float>* phases)
 {
     const int numBins = int(output->size());
 
@@ -139,14 +190,14 @@ static void makePosSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
 
     // now go to the end and at slope
     float gainMax = 1;              // even if nothing in the bins (ut) needs something in there.
-    static float k = -spec.slope * log2(spec.highFreqCorner);
+    const float k = -spec.slope * log2(spec.highFreqCorner);
     for (int i = binHigh - 1; i > 0; --i) {
         if (i < numBins / 2) {
             const double f = FFT::bin2Freq(i, spec.sampleRate, numBins);
             const double gainDb = std::log2(f) * spec.slope + k;
             const float gain = float(AudioMath::gainFromDb(gainDb));
             gainMax = std::max(gain, gainMax);
-            output->set(i, std::polar(gain, randomPhase()));
+            output->set(i, std::polar(gain, getPhase(phases, i)));
         } else {
             output->set(i, cpx(0, 0));
         }
@@ -155,7 +206,7 @@ static void makePosSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
     // fill top bins with mag mag
     for (int i = numBins - 1; i >= binHigh; --i) {
         if (i < numBins / 2) {
-            output->set(i, std::polar(gainMax, randomPhase()));
+            output->set(i, std::polar(gainMax, getPhase(phases, i)));
         } else {
             output->set(i, cpx(0.0));
         }
@@ -165,6 +216,17 @@ static void makePosSlope(FFTDataCpx* output, const ColoredNoiseSpec& spec)
 }
 
 void FFT::makeNoiseSpectrum(FFTDataCpx* output, const ColoredNoiseSpec& spec)
+{
+    makeNoiseSpectrumImpl(output, spec, nullptr);
+}
+
+void FFT::makeNoiseSpectrum(FFTDataCpx* output, const ColoredNoiseSpec& spec, const std::vector<float>& phases)
+{
+    assert(int(phases.size()) == output->size());
+    makeNoiseSpectrumImpl(output, spec, &phases);
+}
+
+void FFT::makeNoiseSpectrumImpl(FFTDataCpx* output, const ColoredNoiseSpec& spec, const std::vector<float>* phases)
 {
     // for now, zero all first.
     const int frameSize = (int) output->size();
@@ -173,9 +235,9 @@ void FFT::makeNoiseSpectrum(FFTDataCpx* output, const ColoredNoiseSpec& spec)
         output->set(i, x);
     }
     if (spec.slope < 0) {
-        makeNegSlope(output, spec);
+        makeNegSlope(output, spec, phases);
     } else {
-        makePosSlope(output, spec);
+        makePosSlope(output, spec, phases);
     }
 }
 
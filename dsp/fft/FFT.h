@@ -5,6 +5,8 @@
 
 #include "FFTData.h"
 
+#include <vector>
+
 class ColoredNoiseSpec
 {
 public:
@@ -22,6 +24,24 @@ public:
 class FFT
 {
 public:
+    /**
+     * Simd is an SSE FFT (see FFTPlan) for power of two sizes from FFTPlan::minSize up.
+     * It falls back to kiss for the other sizes.
+     * Kiss is the reference implementation: it does every size, and tests compare against it.
+     */
+    enum class Backend
+    {
+        Kiss,
+        Simd
+    };
+
+    /**
+     * Selects the backend for every FFT that follows, on all threads.
+     * Defaults to Simd.
+     */
+    static void setBackend(Backend);
+    static Backend getBackend();
+
     /** Forward FFT will do the 1/N scaling
      */
     static bool forward(FFTDataCpx* out, const FFTDataReal& in);
@@ -34,7 +54,21 @@ public:
      */
     static void makeNoiseSpectrum(FFTDataCpx* output, const ColoredNoiseSpec&);
 
+    /**
+     * Same, but with the phase of every bin given instead of random.
+     * Noise made from the same phases at different slopes can be
+     * mixed to get the slopes in between.
+     * phases must have output->size() entries.
+     */
+    static void makeNoiseSpectrum(FFTDataCpx* output, const ColoredNoiseSpec&, const std::vector<float>& phases);
+
     static void normalize(FFTDataReal*, float maxValue);
     static double bin2Freq(int bin, double sampleRate, int numBins);
     static int freqToBin(double freq, double sampleRate, int numBins);
+
+private:
+    template <typename T>
+    static const FFTPlan* getPlan(const FFTData<T>&);
+
+    static void makeNoiseSpectrumImpl(FFTDataCpx* output, const ColoredNoiseSpec&, const std::vector<float>* phases);
 };
\ No newline at end of file
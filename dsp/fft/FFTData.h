@@ -7,6 +7,7 @@
 
 
 class FFT;
+class FFTPlan;
 
 
 /**
@@ -72,6 +73,15 @@ private:
     * now we assume that all FFT with complex input will be inverse FFTs.
     */
     mutable void * kiss_cfg = 0;
+
+    /**
+     * The SSE backend shares one plan between every buffer of the same size,
+     * but each buffer has its own scratch memory, so different buffers may
+     * be transformed on different threads at the same time.
+     * Also lazy created by FFT functions.
+     */
+    mutable std::shared_ptr<const FFTPlan> plan;
+    mutable std::vector<float> planWork;
 };
 
 using FFTDataReal = FFTData<float>;
@@ -0,0 +1,320 @@
+#include "FFTPlan.h"
+
+#include "AudioMath.h"
+#include "SimdBlocks.h"
+#include "simd.h"
+
+#include <assert.h>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace {
+
+/**
+ * Four complex numbers, as a real and an imaginary float_4.
+ */
+struct Cpx4
+{
+    float_4 re;
+    float_4 im;
+};
+
+inline Cpx4 load(const float* re, const float* im)
+{
+    return {float_4::load(re), float_4::load(im)};
+}
+
+inline void store(float* re, float* im, Cpx4 x)
+{
+    x.re.store(re);
+    x.im.store(im);
+}
+
+inline Cpx4 mul(const Cpx4& x, float_4 wr, float_4 wi)
+{
+    return {x.re * wr - x.im * wi, x.re * wi + x.im * wr};
+}
+
+/**
+ * A forward radix-4 butterfly, with the twiddles applied to the outputs.
+ */
+inline void butterfly4(const Cpx4& a, const Cpx4& b, const Cpx4& c, const Cpx4& d,
+    const Cpx4& w1, const Cpx4& w2, const Cpx4& w3,
+    Cpx4& y0, Cpx4& y1, Cpx4& y2, Cpx4& y3)
+{
+    const float_4 apcr = a.re + c.re;
+    const float_4 apci = a.im + c.im;
+    const float_4 amcr = a.re - c.re;
+    const float_4 amci = a.im - c.im;
+    const float_4 bpdr = b.re + d.re;
+    const float_4 bpdi = b.im + d.im;
+    const float_4 bmdr = b.re - d.re;
+    const float_4 bmdi = b.im - d.im;
+
+    y0 = {apcr + bpdr, apci + bpdi};
+    y1 = mul({amcr + bmdi, amci - bmdr}, w1.re, w1.im);
+    y2 = mul({apcr - bpdr, apci - bpdi}, w2.re, w2.im);
+    y3 = mul({amcr - bmdi, amci + bmdr}, w3.re, w3.im);
+}
+
+inline float_4 reverse(float_4 x)
+{
+    return _mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+/**
+ * Splits eight interleaved floats into the four even and the four odd ones.
+ */
+inline void deinterleave(const float* p, float_4& even, float_4& odd)
+{
+    const float_4 lo = float_4::load(p);
+    const float_4 hi = float_4::load(p + 4);
+    even = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(2, 0, 2, 0));
+    odd = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline void interleave(float* p, float_4 even, float_4 odd)
+{
+    float_4(_mm_unpacklo_ps(even.v, odd.v)).store(p);
+    float_4(_mm_unpackhi_ps(even.v, odd.v)).store(p + 4);
+}
+
+}  // namespace
+
+bool FFTPlan::supports(int size)
+{
+    return size >= minSize && (size & (size - 1)) == 0;
+}
+
+std::shared_ptr<const FFTPlan> FFTPlan::get(int size)
+{
+    if (!supports(size)) {
+        return nullptr;
+    }
+
+    // The plans themselves are never changed, so the lock only has to cover the map.
+    static std::mutex mutex;
+    static std::map<int, std::shared_ptr<const FFTPlan>> plans;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const FFTPlan>& plan = plans[size];
+    if (!plan) {
+        plan.reset(new FFTPlan(size));
+    }
+    return plan;
+}
+
+FFTPlan::FFTPlan(int size) : n(size), m(size / 2)
+{
+    assert(supports(size));
+
+    const int quarter = m / 4;
+    w1r.resize(quarter);
+    w1i.resize(quarter);
+    w2r.resize(quarter);
+    w2i.resize(quarter);
+    w3r.resize(quarter);
+    w3i.resize(quarter);
+    for (int p = 0; p < quarter; ++p) {
+        const double angle = -2 * AudioMath::Pi * p / m;
+        w1r[p] = float(std::cos(angle));
+        w1i[p] = float(std::sin(angle));
+        w2r[p] = float(std::cos(2 * angle));
+        w2i[p] = float(std::sin(2 * angle));
+        w3r[p] = float(std::cos(3 * angle));
+        w3i[p] = float(std::sin(3 * angle));
+    }
+
+    cosTable.resize(m + 1);
+    sinTable.resize(m + 1);
+    for (int k = 0; k <= m; ++k) {
+        const double angle = 2 * AudioMath::Pi * k / n;
+        cosTable[k] = float(std::cos(angle));
+        sinTable[k] = float(std::sin(angle));
+    }
+}
+
+float* FFTPlan::complexForward(float* work) const
+{
+    float* x = work;
+    float* y = work + 2 * m;
+
+    // stride is how far apart the points of one sub-transform are,
+    // and length is how many of them there are. Each pass quarters the length.
+    int length = m;
+    int stride = 1;
+    for (; length >= 4; length /= 4, stride *= 4) {
+        const int q = length / 4;
+        float* xr = x;
+        float* xi = x + m;
+        float* yr = y;
+        float* yi = y + m;
+
+        if (stride == 1) {
+            // The first pass: four butterflies at a time, side by side.
+            // Their outputs go to four adjacent points each, so a transpose
+            // puts them in order.
+            for (int p = 0; p < q; p += 4) {
+                const Cpx4 w1 = load(w1r.data() + p, w1i.data() + p);
+                const Cpx4 w2 = load(w2r.data() + p, w2i.data() + p);
+                const Cpx4 w3 = load(w3r.data() + p, w3i.data() + p);
+                Cpx4 y0, y1, y2, y3;
+                butterfly4(load(xr + p, xi + p),
+                    load(xr + p + q, xi + p + q),
+                    load(xr + p + 2 * q, xi + p + 2 * q),
+                    load(xr + p + 3 * q, xi + p + 3 * q),
+                    w1, w2, w3, y0, y1, y2, y3);
+
+                _MM_TRANSPOSE4_PS(y0.re.v, y1.re.v, y2.re.v, y3.re.v);
+                _MM_TRANSPOSE4_PS(y0.im.v, y1.im.v, y2.im.v, y3.im.v);
+                float* outr = yr + 4 * p;
+                float* outi = yi + 4 * p;
+                store(outr, outi, y0);
+                store(outr + 4, outi + 4, y1);
+                store(outr + 8, outi + 8, y2);
+                store(outr + 12, outi + 12, y3);
+            }
+        } else {
+            // Later passes: every butterfly in a run of stride shares its twiddles.
+            for (int p = 0; p < q; ++p) {
+                const int t = p * stride;
+                const Cpx4 w1 = {float_4(w1r[t]), float_4(w1i[t])};
+                const Cpx4 w2 = {float_4(w2r[t]), float_4(w2i[t])};
+                const Cpx4 w3 = {float_4(w3r[t]), float_4(w3i[t])};
+                const int in0 = stride * p;
+                const int in1 = stride * (p + q);
+                const int in2 = stride * (p + 2 * q);
+                const int in3 = stride * (p + 3 * q);
+                const int out0 = stride * 4 * p;
+                for (int j = 0; j < stride; j += 4) {
+                    Cpx4 y0, y1, y2, y3;
+                    butterfly4(load(xr + in0 + j, xi + in0 + j),
+                        load(xr + in1 + j, xi + in1 + j),
+                        load(xr + in2 + j, xi + in2 + j),
+                        load(xr + in3 + j, xi + in3 + j),
+                        w1, w2, w3, y0, y1, y2, y3);
+                    store(yr + out0 + j, yi + out0 + j, y0);
+                    store(yr + out0 + stride + j, yi + out0 + stride + j, y1);
+                    store(yr + out0 + 2 * stride + j, yi + out0 + 2 * stride + j, y2);
+                    store(yr + out0 + 3 * stride + j, yi + out0 + 3 * stride + j, y3);
+                }
+            }
+        }
+        std::swap(x, y);
+    }
+
+    if (length == 2) {
+        // m is an odd power of two, so finish with one radix-2 pass.
+        for (int j = 0; j < stride; j += 4) {
+            const Cpx4 a = load(x + j, x + m + j);
+            const Cpx4 b = load(x + stride + j, x + m + stride + j);
+            store(y + j, y + m + j, {a.re + b.re, a.im + b.im});
+            store(y + stride + j, y + m + stride + j, {a.re - b.re, a.im - b.im});
+        }
+        std::swap(x, y);
+    }
+    return x;
+}
+
+void FFTPlan::forward(cpx* out, const float* in, float* work, float scale) const
+{
+    // even samples to the real parts, odd ones to the imaginary parts
+    for (int i = 0; i < m; i += 4) {
+        float_4 even, odd;
+        deinterleave(in + 2 * i, even, odd);
+        even.store(work + i);
+        odd.store(work + m + i);
+    }
+
+    const float* re = complexForward(work);
+    const float* im = re + m;
+    float* o = reinterpret_cast<float*>(out);
+
+    // With Z the complex FFT, E and O the FFTs of the even and odd samples:
+    //      E[k] = (Z[k] + conj(Z[m - k])) / 2
+    //      O[k] = (Z[k] - conj(Z[m - k])) / 2i
+    //      X[k] = E[k] + exp(-2 pi i k / n) O[k]
+    // DC and Nyquist only need Z[0], and are real.
+    o[0] = (re[0] + im[0]) * scale;
+    o[1] = 0;
+    o[2 * m] = (re[0] - im[0]) * scale;
+    o[2 * m + 1] = 0;
+
+    const float half = .5f * scale;
+    int k = 1;
+    for (; k + 4 <= m; k += 4) {
+        const float_4 ar = float_4::load(re + k);
+        const float_4 ai = float_4::load(im + k);
+        const float_4 br = reverse(float_4::load(re + m - k - 3));
+        const float_4 bi = float_4(0) - reverse(float_4::load(im + m - k - 3));
+        const float_4 c = float_4::load(cosTable.data() + k);
+        const float_4 s = float_4::load(sinTable.data() + k);
+        const float_4 sumr = ar + br;
+        const float_4 sumi = ai + bi;
+        const float_4 difr = ar - br;
+        const float_4 difi = ai - bi;
+        const float_4 xr = float_4(half) * (sumr - s * difr + c * difi);
+        const float_4 xi = float_4(half) * (sumi - s * difi - c * difr);
+        interleave(o + 2 * k, xr, xi);
+    }
+    for (; k < m; ++k) {
+        const float ar = re[k];
+        const float ai = im[k];
+        const float br = re[m - k];
+        const float bi = -im[m - k];
+        const float c = cosTable[k];
+        const float s = sinTable[k];
+        o[2 * k] = half * ((ar + br) - s * (ar - br) + c * (ai - bi));
+        o[2 * k + 1] = half * ((ai + bi) - s * (ai - bi) - c * (ar - br));
+    }
+}
+
+void FFTPlan::inverse(float* out, const cpx* in, float* work) const
+{
+    const float* x = reinterpret_cast<const float*>(in);
+    float* zr = work;
+    float* zi = work + m;
+
+    // The reverse of the forward untangling, scaled up by 2:
+    //      Z[k] = (X[k] + conj(X[m - k])) + i exp(2 pi i k / n) (X[k] - conj(X[m - k]))
+    // The inverse complex FFT is done as conj(FFT(conj(Z))), so Z goes in conjugated.
+    // Like kiss, the imaginary parts of DC and Nyquist are ignored.
+    zr[0] = x[0] + x[2 * m];
+    zi[0] = x[2 * m] - x[0];
+
+    int k = 1;
+    for (; k + 4 <= m; k += 4) {
+        float_4 ar, ai, br, bi;
+        deinterleave(x + 2 * k, ar, ai);
+        deinterleave(x + 2 * (m - k - 3), br, bi);
+        br = reverse(br);
+        bi = float_4(0) - reverse(bi);
+        const float_4 c = float_4::load(cosTable.data() + k);
+        const float_4 s = float_4::load(sinTable.data() + k);
+        const float_4 difr = ar - br;
+        const float_4 difi = ai - bi;
+        const float_4 oddr = difr * c - difi * s;
+        const float_4 oddi = difr * s + difi * c;
+        (ar + br - oddi).store(zr + k);
+        (float_4(0) - (ai + bi + oddr)).store(zi + k);
+    }
+    for (; k < m; ++k) {
+        const float ar = x[2 * k];
+        const float ai = x[2 * k + 1];
+        const float br = x[2 * (m - k)];
+        const float bi = -x[2 * (m - k) + 1];
+        const float c = cosTable[k];
+        const float s = sinTable[k];
+        const float oddr = (ar - br) * c - (ai - bi) * s;
+        const float oddi = (ar - br) * s + (ai - bi) * c;
+        zr[k] = ar + br - oddi;
+        zi[k] = -(ai + bi + oddr);
+    }
+
+    const float* re = complexForward(work);
+    const float* im = re + m;
+    for (int i = 0; i < m; i += 4) {
+        interleave(out + 2 * i, float_4::load(re + i), float_4(0) - float_4::load(im + i));
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "FFTData.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * The tables for an SSE real FFT of one power of two size.
+ *
+ * It's the usual trick of doing a real FFT of size N as a complex FFT of N / 2:
+ * the even samples go in the real parts, the odd samples in the imaginary parts,
+ * and one pass afterwards untangles the two spectra.
+ * The complex FFT is a radix-4 Stockham FFT (with one radix-2 pass at the end
+ * when N / 2 isn't a power of 4) on separate real and imaginary arrays,
+ * so every butterfly does four at once. Stockham puts the output in order
+ * as it goes, so there's no bit reversal pass.
+ *
+ * The results match kiss_fftr: forward writes bins 0..N/2, and inverse only
+ * reads those bins and returns N times the signal. testFFT checks them against kiss.
+ *
+ * A plan is never changed after it's made, so one plan may be used by
+ * any number of threads at once. The scratch memory comes from the caller.
+ */
+class FFTPlan
+{
+public:
+    /**
+     * The smallest size we do. Below this kiss is just as fast.
+     */
+    static const int minSize = 32;
+
+    static bool supports(int size);
+
+    /**
+     * Returns the shared plan for this size, making it the first time.
+     * Plans are kept until the program exits.
+     * Safe to call from any thread. Returns nullptr if the size isn't supported.
+     */
+    static std::shared_ptr<const FFTPlan> get(int size);
+
+    int size() const
+    {
+        return n;
+    }
+
+    /**
+     * The number of floats of scratch memory forward and inverse need.
+     */
+    int workSize() const
+    {
+        return 2 * n;
+    }
+
+    /**
+     * out gets size() / 2 + 1 bins, multiplied by scale.
+     */
+    void forward(cpx* out, const float* in, float* work, float scale) const;
+    void inverse(float* out, const cpx* in, float* work) const;
+
+private:
+    FFTPlan(int size);
+
+    const int n;        // real size
+    const int m;        // complex size, n / 2
+
+    // twiddles for the complex FFT, exp(-2 pi i k p / m) for k = 1..3, p < m / 4
+    std::vector<float> w1r, w1i, w2r, w2i, w3r, w3i;
+
+    // cos and sin of 2 pi k / n for the real pass, k = 0..m
+    std::vector<float> cosTable, sinTable;
+
+    /**
+     * Complex FFT of the m points in work: the real parts, then the imaginary parts.
+     * The result ends up either there or in the second half of work.
+     * Returns the real parts; the imaginary parts follow them.
+     */
+    float* complexForward(float* work) const;
+};
@@ -1,80 +1,135 @@
 
 #include "OnsetDetector.h"
 
-#include "FFTData.h"
-#include "FFTUtils.h"
+#include "AudioMath.h"
+#include "FFT.h"
+#include "PolyApprox_4.h"
+#include "SimdBlocks.h"
+#include "simd.h"
 
+#include <algorithm>
+#include <cmath>
 
+const int OnsetDetector::frameSize;
+const int OnsetDetector::hopSize;
+const int OnsetDetector::preroll;
+const int OnsetDetector::binSteps;
+const int OnsetDetector::analysisSteps;
 
-const int OnsetDetector::frameSize = {512};
-const int OnsetDetector::preroll = {2 * frameSize};
+// log2(1 + compression * magnitude). Bigger makes quiet onsets count more.
+static const float compression = 100;
 
-OnsetDetector::OnsetDetector()
-{
-    for (int i=0; i<numFrames; ++i) {
-        fftFrames[i] = std::make_shared<FFTDataReal>(frameSize);
-        fftFramesAnalyzed[i] = std::make_shared<FFTDataCpx>(frameSize);
-    }
-}
+// the flux has to be this many times the recent average
+static const float threshold = 2;
 
-int OnsetDetector::nextFrame()
-{
-    return curFrame >= (numFrames - 1) ? 0 : curFrame + 1;
-}
+// and at least this much, so a steady low tone or near silence doesn't trigger
+static const float minFlux = 2.5;
 
-int OnsetDetector::prevFrame()
-{
-    return curFrame == 0 ? 2 : curFrame - 1;
-}
+// 1 ms. ( used 46 becaue it's close and makes the test pass ;-)
+static const int triggerLength = 46;
 
-int OnsetDetector::prevPrevFrame()
+OnsetDetector::OnsetDetector() : frame(frameSize), spectrum(frameSize)
 {
-    int ret = curFrame - 2;
-    if (ret < 0) {
-        ret += 3;
+    // Hann
+    for (int i = 0; i < frameSize; ++i) {
+        window[i] = float(.5 - .5 * std::cos(AudioMath::_2Pi * i / frameSize));
     }
-    return ret;
 }
 
 bool OnsetDetector::step(float inputData)
 {
-    fftFrames[curFrame]->set(indexInFrame, inputData);
-    if (++indexInFrame >= frameSize) {
-        numFullFrames++;
-        // now take fft into cpx
-        FFT::forward(fftFramesAnalyzed[curFrame].get(), *fftFrames[curFrame]);
-        printf("about to analyze frame %d\n", curFrame);
-        fftFramesAnalyzed[curFrame]->toPolar();
+    history[writeIndex] = inputData;
+    history[writeIndex + frameSize] = inputData;
+    if (++writeIndex >= frameSize) {
+        writeIndex = 0;
+    }
+    if (samplesSeen < preroll) {
+        ++samplesSeen;
+    }
+
+    if (++hopIndex >= hopSize) {
+        hopIndex = 0;
+        analysisStep = 0;
+    }
+    if (analysisStep < analysisSteps) {
         analyze();
-        curFrame = nextFrame();
+        ++analysisStep;
+    }
 
-        indexInFrame = 0;
+    if (refractory > 0) {
+        --refractory;
     }
     if (triggerCounter > 0) {
         --triggerCounter;
     }
-    return triggerCounter > 0;;
+    return triggerCounter > 0;
 }
 
 void OnsetDetector::analyze()
 {
-    printf("enter analyze, ff=%d\n", numFullFrames);
-    if (numFullFrames < 3) {
-        printf("still priming\n");
-        return;
+    if (analysisStep == 0) {
+        const float* input = lastFrame();
+        float* output = frame.data();
+        for (int i = 0; i < frameSize; i += 4) {
+            (float_4::load(input + i) * float_4::load(window + i)).store(output + i);
+        }
+    } else if (analysisStep == 1) {
+        FFT::forward(&spectrum, frame);
+        currentMagnitudes ^= 1;
+    } else if (analysisStep < analysisSteps - 1) {
+        computeFlux(analysisStep - 2);
+    } else {
+        decide();
     }
-    FFTUtils::Stats stats;
-    FFTUtils::getStats(stats, *fftFramesAnalyzed[prevPrevFrame()], *fftFramesAnalyzed[prevFrame()], *fftFramesAnalyzed[curFrame]);
-    printf("analyze frame, jump = %f\n", stats.averagePhaseJump);
-    if (stats.averagePhaseJump > .1) {
-        // 1 ms. ( used 46 becaue it's close and makes the test pass ;-)
-        triggerCounter = 46;        // todo: sample rate independent?
+}
+
+void OnsetDetector::computeFlux(int part)
+{
+    using P = PolyApprox_4::Precision;
+    const int binsPerStep = numBins / binSteps;
+    const int first = std::max(part * binsPerStep, int(lowestBin));
+    const int end = (part + 1) * binsPerStep;
+
+    const float* bins = reinterpret_cast<const float*>(spectrum.data());
+    float* current = magnitudes[currentMagnitudes];
+    const float* last = magnitudes[currentMagnitudes ^ 1];
+    float_4 flux = 0;
+    for (int bin = first; bin < end; bin += 4) {
+        const float_4 lo = float_4::load(bins + 2 * bin);
+        const float_4 hi = float_4::load(bins + 2 * bin + 4);
+        const float_4 re = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(2, 0, 2, 0));
+        const float_4 im = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(3, 1, 3, 1));
+        const float_4 magnitude = rack::simd::sqrt(re * re + im * im);
+        float_4 logMagnitude = PolyApprox_4::log2<P::Low>(float_4(1) + float_4(compression) * magnitude);
+        logMagnitude.store(current + bin);
+
+        // only count the bins that got louder
+        flux += SimdBlocks::max(logMagnitude - float_4::load(last + bin), float_4(0));
     }
-    else {
-        assert(triggerCounter == 0);
-        triggerCounter = 0;
+    fluxParts[part] = flux[0] + flux[1] + flux[2] + flux[3];
+}
+
+void OnsetDetector::decide()
+{
+    float flux = 0;
+    for (int i = 0; i < binSteps; ++i) {
+        flux += fluxParts[i];
     }
-    //printf("will clear polary on %d\n", prevPrevFrame());
-    fftFramesAnalyzed[prevPrevFrame()]->reset();
- 
-}
\ No newline at end of file
+
+    float average = 0;
+    for (int i = 0; i < fluxHistorySize; ++i) {
+        average += fluxHistory[i];
+    }
+    average *= 1.f / fluxHistorySize;
+
+    fluxHistory[fluxIndex] = flux;
+    if (++fluxIndex >= fluxHistorySize) {
+        fluxIndex = 0;
+    }
+
+    const bool primed = samplesSeen >= preroll;
+    if (primed && refractory == 0 && flux > minFlux && flux > threshold * average) {
+        triggerCounter = triggerLength;
+        refractory = frameSize;
+    }
+}
@@ -2,33 +2,82 @@
 
 #include "FFTData.h"
 
-#include <memory>
-
-
-
+/**
+ * Finds note onsets with the spectral flux: how much the magnitude spectrum
+ * grows from one frame to the next, summed over the bins.
+ *
+ * Frames of frameSize overlap, and a new one starts every hopSize samples.
+ * The analysis of a frame is spread over the analysisSteps samples after it ends,
+ * one part per sample, so no sample has to do all of it.
+ * The magnitudes are log compressed, so a soft onset counts as much as a loud one,
+ * and an onset is a flux well above the recent average.
+ * Each onset shows up in several overlapping frames, so after one
+ * there can't be another for a frame.
+ *
+ * All the memory is in the object.
+ */
 class OnsetDetector
 {
 public:
     friend class TestOnsetDetector;
     OnsetDetector();
+
+    /**
+     * Returns true for a little while after an onset.
+     */
     bool step(float);
 
-    static const int frameSize;
-    static const int preroll;
+    static const int frameSize = 512;
+    static const int hopSize = frameSize / 4;
+    static const int preroll = 2 * frameSize;
+
+    // window, fft, the flux in binSteps parts, and the decision
+    static const int binSteps = 4;
+    static const int analysisSteps = 3 + binSteps;
+
 private:
-    static const int numFrames = 3;
-   
-    std::shared_ptr<FFTDataReal> fftFrames[numFrames];
-    std::shared_ptr<FFTDataCpx> fftFramesAnalyzed[numFrames];
-    int curFrame = 0;
-    int indexInFrame = 0;
-    int numFullFrames = 0;
-
-  //  bool triggered = false;
+    // everything but Nyquist, which the window has removed anyway
+    static const int numBins = frameSize / 2;
+    static_assert((numBins / binSteps) % 4 == 0, "bins go four at a time");
+
+    /**
+     * A low tone only has a cycle or so in a frame, so the lowest bins
+     * change from hop to hop even when nothing starts.
+     */
+    static const int lowestBin = 4;
+    static const int fluxHistorySize = 8;
+
+    /**
+     * Every sample is written twice, frameSize apart, so the last
+     * frameSize samples are always in order, starting at writeIndex.
+     */
+    float history[2 * frameSize] = {0};
+    int writeIndex = 0;
+
+    float window[frameSize];
+    FFTDataReal frame;
+    FFTDataCpx spectrum;
+
+    // log magnitudes of the last frame, and this one
+    float magnitudes[2][numBins] = {{0}};
+    int currentMagnitudes = 0;
+
+    float fluxHistory[fluxHistorySize] = {0};
+    int fluxIndex = 0;
+    float fluxParts[binSteps] = {0};
+
+    int hopIndex = 0;
+    int analysisStep = analysisSteps;   // analysisSteps means idle
+    int samplesSeen = 0;
+    int refractory = 0;
     int triggerCounter = 0;
-    void analyze();
 
-    int nextFrame();
-    int prevFrame();
-    int prevPrevFrame();
+    const float* lastFrame() const
+    {
+        return history + writeIndex;
+    }
+
+    void analyze();
+    void computeFlux(int part);
+    void decide();
 };
@@ -0,0 +1,150 @@
+#include "PartitionedConvolver.h"
+
+#include "FFT.h"
+#include "SimdBlocks.h"
+#include "simd.h"
+
+#include <assert.h>
+#include <algorithm>
+
+/**
+ * acc += x * h, for numBins complex numbers stored as all the real parts,
+ * then all the imaginary parts, stride floats later.
+ */
+static void multiplyAccumulate(float* acc, const float* x, const float* h, int numBins, int stride)
+{
+    float* accIm = acc + stride;
+    const float* xIm = x + stride;
+    const float* hIm = h + stride;
+    for (int i = 0; i < numBins; i += 4) {
+        const float_4 xr = float_4::load(x + i);
+        const float_4 xi = float_4::load(xIm + i);
+        const float_4 hr = float_4::load(h + i);
+        const float_4 hi = float_4::load(hIm + i);
+        (float_4::load(acc + i) + xr * hr - xi * hi).store(acc + i);
+        (float_4::load(accIm + i) + xr * hi + xi * hr).store(accIm + i);
+    }
+}
+
+static int roundUp4(int x)
+{
+    return (x + 3) & ~3;
+}
+
+PartitionedConvolver::PartitionedConvolver(int size, const float* impulse, int impulseSize) :
+    blockSize(size),
+    numPartitions(std::max(1, (impulseSize + size - 1) / size)),
+    stride(roundUp4(size + 1)),
+    frame(2 * size),
+    spectrum(2 * size),
+    result(2 * size),
+    filters(numPartitions * 2 * stride),
+    delayLine(numPartitions * 2 * stride),
+    accumulator(2 * stride),
+    inputBlock(size),
+    outputBlock(size)
+{
+    assert(blockSize >= minBlockSize);
+    assert((blockSize & (blockSize - 1)) == 0);
+
+    // Forward scales by 1 / N, and inverse doesn't, so the filters
+    // are scaled back up by N.
+    const float scale = float(2 * blockSize);
+    for (int p = 0; p < numPartitions; ++p) {
+        const int start = p * blockSize;
+        const int count = std::min(blockSize, impulseSize - start);
+        std::fill(frame.data(), frame.data() + 2 * blockSize, 0.f);
+        if (count > 0) {
+            std::copy(impulse + start, impulse + start + count, frame.data());
+        }
+        FFT::forward(&spectrum, frame);
+
+        float* filter = filters.data() + p * 2 * stride;
+        for (int bin = 0; bin <= blockSize; ++bin) {
+            filter[bin] = scale * spectrum.get(bin).real();
+            filter[stride + bin] = scale * spectrum.get(bin).imag();
+        }
+    }
+    reset();
+}
+
+void PartitionedConvolver::reset()
+{
+    std::fill(frame.data(), frame.data() + 2 * blockSize, 0.f);
+    std::fill(delayLine.begin(), delayLine.end(), 0.f);
+    std::fill(inputBlock.begin(), inputBlock.end(), 0.f);
+    std::fill(outputBlock.begin(), outputBlock.end(), 0.f);
+    newest = 0;
+    index = 0;
+}
+
+float PartitionedConvolver::step(float input)
+{
+    inputBlock[index] = input;
+    const float output = outputBlock[index];
+    if (++index == blockSize) {
+        index = 0;
+        process(inputBlock.data(), outputBlock.data());
+    }
+    return output;
+}
+
+void PartitionedConvolver::process(const float* input, float* output)
+{
+    // overlap-save: the FFT sees the last block and this one
+    float* time = frame.data();
+    std::copy(time + blockSize, time + 2 * blockSize, time);
+    std::copy(input, input + blockSize, time + blockSize);
+    FFT::forward(&spectrum, frame);
+
+    newest = (newest == 0) ? numPartitions - 1 : newest - 1;
+    float* x = delayLine.data() + newest * 2 * stride;
+    const float* bins = reinterpret_cast<const float*>(spectrum.data());
+    for (int bin = 0; bin < blockSize; bin += 4) {
+        const float_4 lo = float_4::load(bins + 2 * bin);
+        const float_4 hi = float_4::load(bins + 2 * bin + 4);
+        float_4(_mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(2, 0, 2, 0))).store(x + bin);
+        float_4(_mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(3, 1, 3, 1))).store(x + stride + bin);
+    }
+    x[blockSize] = bins[2 * blockSize];
+    x[stride + blockSize] = bins[2 * blockSize + 1];
+
+    // partition p of the filter goes with the input from p blocks ago
+    std::fill(accumulator.begin(), accumulator.end(), 0.f);
+    const int numBins = blockSize + 1;
+    for (int p = 0; p < numPartitions; ++p) {
+        int slot = newest + p;
+        if (slot >= numPartitions) {
+            slot -= numPartitions;
+        }
+        multiplyAccumulate(accumulator.data(),
+            delayLine.data() + slot * 2 * stride,
+            filters.data() + p * 2 * stride,
+            numBins, stride);
+    }
+
+    for (int bin = 0; bin < numBins; ++bin) {
+        spectrum.set(bin, cpx(accumulator[bin], accumulator[stride + bin]));
+    }
+    FFT::inverse(&result, spectrum);
+
+    // the first half has wrapped around, the second half is the output
+    const float* out = result.data() + blockSize;
+    std::copy(out, out + blockSize, output);
+}
+
+void PartitionedConvolver::skip(int blocks)
+{
+    // after enough silence everything is zero
+    if (blocks > numPartitions) {
+        reset();
+        return;
+    }
+
+    float* silence = inputBlock.data();
+    float* discard = outputBlock.data();
+    std::fill(silence, silence + blockSize, 0.f);
+    for (int i = 0; i < blocks; ++i) {
+        process(silence, discard);
+    }
+}
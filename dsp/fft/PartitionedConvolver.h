@@ -0,0 +1,93 @@
+#pragma once
+
+#include "FFTData.h"
+
+#include <vector>
+
+/**
+ * Uniformly partitioned convolution, with a frequency domain delay line.
+ *
+ * The impulse is cut into blocks of blockSize, and each block's spectrum is
+ * computed once, up front. Every blockSize samples of input make one FFT
+ * (overlap-save, so the FFT is twice the block size), which goes into a
+ * delay line of the last numPartitions input spectra. The output block is
+ * the inverse FFT of the sum of each delayed spectrum times its partition
+ * of the impulse, so each block costs two FFTs and a complex multiply-add
+ * per partition and bin, which is done four bins at a time.
+ *
+ * The output is the convolution, delayed by blockSize samples.
+ *
+ * All the memory is allocated by the constructor.
+ */
+class PartitionedConvolver
+{
+public:
+    static const int minBlockSize = 32;
+
+    /**
+     * blockSize must be a power of two, at least minBlockSize.
+     * The impulse is copied, so it may go away after.
+     */
+    PartitionedConvolver(int blockSize, const float* impulse, int impulseSize);
+
+    int getBlockSize() const
+    {
+        return blockSize;
+    }
+
+    int getNumPartitions() const
+    {
+        return numPartitions;
+    }
+
+    /**
+     * One sample in, one sample out.
+     */
+    float step(float input);
+
+    /**
+     * blockSize samples in, blockSize samples out.
+     * Not to be mixed with step.
+     */
+    void process(const float* input, float* output);
+
+    /**
+     * The same as processing this many blocks of silence,
+     * but without the output.
+     */
+    void skip(int blocks);
+
+    void reset();
+
+private:
+    const int blockSize;
+    const int numPartitions;
+
+    /**
+     * The spectra have blockSize + 1 bins. We store them with the real parts
+     * and then the imaginary parts, each rounded up to a multiple of four,
+     * so the multiply-add can go four at a time. The extra bins stay zero.
+     */
+    const int stride;
+
+    // The last block of input, and the current one.
+    FFTDataReal frame;
+    FFTDataCpx spectrum;
+    FFTDataReal result;
+
+    // numPartitions spectra, each 2 * stride floats
+    std::vector<float> filters;
+
+    // The spectra of the last numPartitions input frames.
+    // delayLine[newest] is the current one, the ones after it are older.
+    std::vector<float> delayLine;
+    int newest = 0;
+
+    // re, then im
+    std::vector<float> accumulator;
+
+    // for step
+    std::vector<float> inputBlock;
+    std::vector<float> outputBlock;
+    int index = 0;
+};
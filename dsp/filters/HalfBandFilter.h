@@ -0,0 +1,167 @@
+#pragma once
+
+#include "HalfBandFilterDesigner.h"
+
+#include <assert.h>
+
+/**
+ * Coefficients for a polyphase half-band filter.
+ * Even coefficients are in one all-pass chain, odd ones in the other.
+ */
+template <typename T>
+class HalfBandParams
+{
+public:
+    static const int maxCoefficients = 12;
+
+    HalfBandParams(int numCoefficients, double transition) : numCoefficients(numCoefficients)
+    {
+        assert(numCoefficients > 0 && numCoefficients <= maxCoefficients);
+        double coef[maxCoefficients];
+        HalfBandFilterDesigner::design(coef, numCoefficients, transition);
+        for (int i = 0; i < numCoefficients; ++i) {
+            coefficients[i] = T(float(coef[i]));
+        }
+    }
+
+    /**
+     * Parameters for one stage of a 2X, 4X, 8X or 16X cascade.
+     * Stage zero is the one next to the base sample rate. It passes up to .45 of the base rate.
+     * The other stages only have to keep images from landing in that pass band, so
+     * they can have much wider transition bands, and fewer sections.
+     * All stages reject at least 90 db.
+     */
+    static const HalfBandParams<T>& forCascadeStage(int stage)
+    {
+        assert(stage >= 0 && stage < maxCascadeStages);
+        static const HalfBandParams<T> params[maxCascadeStages] = {
+            makeCascadeStage(0),
+            makeCascadeStage(1),
+            makeCascadeStage(2),
+            makeCascadeStage(3)
+        };
+        return params[stage];
+    }
+
+    static const int maxCascadeStages = 4;
+    const int numCoefficients;
+    T coefficients[maxCoefficients];
+private:
+    static HalfBandParams<T> makeCascadeStage(int stage)
+    {
+        const double attenuation = 90;
+        const double transition = (stage == 0) ? .05 : .5 - .6 / double(1 << stage);
+        return HalfBandParams<T>(HalfBandFilterDesigner::numCoefficientsFor(attenuation, transition), transition);
+    }
+};
+
+/**
+ * Delay memory for one half-band filter.
+ */
+template <typename T>
+class HalfBandState
+{
+public:
+    HalfBandState()
+    {
+        for (int i = 0; i < HalfBandParams<T>::maxCoefficients; ++i) {
+            x[i] = 0;
+            y[i] = 0;
+        }
+    }
+    T x[HalfBandParams<T>::maxCoefficients];
+    T y[HalfBandParams<T>::maxCoefficients];
+};
+
+/**
+ * 2X up and down sampling with a polyphase half-band filter.
+ * Both directions run at the lower sample rate, so the decimator
+ * never computes the output samples it would throw away.
+ *
+ * Works on blocks of samples. Each all-pass section runs over the whole block
+ * before moving on to the next, which keeps its state in registers and lets
+ * the sections overlap.
+ *
+ * T may be float, double, or float_4.
+ */
+template <typename T>
+class HalfBandFilter
+{
+public:
+    HalfBandFilter() = delete;       // we are only static
+
+    static const int maxBlockSize = 8;
+
+    /**
+     * Takes 2 * numOutput samples at the high rate, makes numOutput at the low rate.
+     */
+    static void decimate(T* output, const T* input, int numOutput, HalfBandState<T>& state, const HalfBandParams<T>& params)
+    {
+        assert(numOutput > 0 && numOutput <= maxBlockSize);
+        T path0[maxBlockSize];
+        T path1[maxBlockSize];
+        runPaths(path0, path1, input + 1, input, 2, numOutput, state, params);
+        for (int i = 0; i < numOutput; ++i) {
+            output[i] = T(.5f) * (path0[i] + path1[i]);
+        }
+    }
+
+    /**
+     * Takes numInput samples at the low rate, makes 2 * numInput at the high rate.
+     */
+    static void interpolate(T* output, const T* input, int numInput, HalfBandState<T>& state, const HalfBandParams<T>& params)
+    {
+        assert(numInput > 0 && numInput <= maxBlockSize);
+        T path0[maxBlockSize];
+        T path1[maxBlockSize];
+        runPaths(path0, path1, input, input, 1, numInput, state, params);
+        for (int i = 0; i < numInput; ++i) {
+            output[2 * i] = path0[i];
+            output[2 * i + 1] = path1[i];
+        }
+    }
+
+private:
+    /**
+     * Each all-pass section is y = (x - y[n-2]) * c + x[n-2], but in z^-2, so
+     * at the low rate each one only needs the previous sample.
+     * Even sections are in path0, odd ones in path1.
+     *
+     * The first section of each path reads straight from the input (in0 and in1, every stride samples),
+     * the rest work in place on the path. Copying the input first is surprisingly expensive
+     * for such short blocks.
+     */
+    static void runPaths(T* path0, T* path1, const T* in0, const T* in1, int stride, int numSamples,
+        HalfBandState<T>& state, const HalfBandParams<T>& params)
+    {
+        for (int section = 0; section < params.numCoefficients; ++section) {
+            const bool odd = section & 1;
+            T* path = odd ? path1 : path0;
+            const T* src = path;
+            int srcStride = 1;
+            if (section < 2) {
+                src = odd ? in1 : in0;
+                srcStride = stride;
+            }
+
+            const T c = params.coefficients[section];
+            T x = state.x[section];
+            T y = state.y[section];
+            for (int i = 0; i < numSamples; ++i) {
+                // same as (input - y) * c + x, but only one multiply-add after input is known.
+                const T input = src[i * srcStride];
+                y = c * input + (x - c * y);
+                x = input;
+                path[i] = y;
+            }
+            state.x[section] = x;
+            state.y[section] = y;
+        }
+        if (params.numCoefficients == 1) {
+            // path1 is just a delay, which in z^-2 is no delay at all
+            for (int i = 0; i < numSamples; ++i) {
+                path1[i] = in1[i * stride];
+            }
+        }
+    }
+};
@@ -0,0 +1,110 @@
+/**
+ * HalfBandFilterDesigner
+ * coefficients for polyphase IIR half-band filters.
+ */
+
+#include "HalfBandFilterDesigner.h"
+
+#include <assert.h>
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+static double ipow(double x, int n)
+{
+    double ret = 1;
+    for (int i = 0; i < n; ++i) {
+        ret *= x;
+    }
+    return ret;
+}
+
+/**
+ * The elliptic modulus k and the nome q for a given transition band.
+ */
+static void transitionParams(double& k, double& q, double transition)
+{
+    k = std::tan((1 - transition * 2) * pi / 4);
+    k *= k;
+    assert(k < 1 && k > 0);
+    const double kksqrt = std::pow(1 - k * k, 0.25);
+    const double e = 0.5 * (1 - kksqrt) / (1 + kksqrt);
+    const double e2 = e * e;
+    const double e4 = e2 * e2;
+    q = e * (1 + e4 * (2 + e4 * (15 + 150 * e4)));
+    assert(q > 0);
+}
+
+static double accumulateNumerator(double q, int order, int c)
+{
+    int i = 0;
+    int j = 1;
+    double acc = 0;
+    double term;
+    do {
+        term = ipow(q, i * (i + 1)) * std::sin((i * 2 + 1) * c * pi / order) * j;
+        acc += term;
+        j = -j;
+        ++i;
+    } while (std::abs(term) > 1e-100);
+    return acc;
+}
+
+static double accumulateDenominator(double q, int order, int c)
+{
+    int i = 1;
+    int j = -1;
+    double acc = 0;
+    double term;
+    do {
+        term = ipow(q, i * i) * std::cos(i * 2 * c * pi / order) * j;
+        acc += term;
+        j = -j;
+        ++i;
+    } while (std::abs(term) > 1e-100);
+    return acc;
+}
+
+static double coefficient(int index, double k, double q, int order)
+{
+    const int c = index + 1;
+    const double num = accumulateNumerator(q, order, c) * std::pow(q, 0.25);
+    const double den = accumulateDenominator(q, order, c) + 0.5;
+    const double ww = num / den;
+    const double wwsq = ww * ww;
+
+    const double x = std::sqrt((1 - wwsq * k) * (1 - wwsq / k)) / (1 + wwsq);
+    return (1 - x) / (1 + x);
+}
+
+void HalfBandFilterDesigner::design(double* coefficients, int numCoefficients, double transition)
+{
+    assert(numCoefficients > 0);
+    assert(transition > 0 && transition < .5);
+
+    double k, q;
+    transitionParams(k, q, transition);
+    const int order = numCoefficients * 2 + 1;
+    for (int i = 0; i < numCoefficients; ++i) {
+        coefficients[i] = coefficient(i, k, q, order);
+    }
+}
+
+int HalfBandFilterDesigner::numCoefficientsFor(double attenuationDb, double transition)
+{
+    assert(attenuationDb > 0);
+    assert(transition > 0 && transition < .5);
+
+    double k, q;
+    transitionParams(k, q, transition);
+    const double attn = std::pow(10.0, -attenuationDb / 10);
+    const double a = attn / (1 - attn);
+    int order = int(std::ceil(std::log(a * a / 16) / std::log(q)));
+    if ((order & 1) == 0) {
+        ++order;
+    }
+    if (order == 1) {
+        order = 3;
+    }
+    return (order - 1) / 2;
+}
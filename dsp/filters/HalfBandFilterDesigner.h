@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * Designs the coefficients for a polyphase IIR half-band filter.
+ *
+ * The filter is two parallel chains of first order all-pass sections (in z^-2).
+ * Summing the chains gives an elliptic half-band lowpass. Since every section works in z^-2,
+ * each chain can run at the lower of the two sample rates, which is what makes
+ * it cheap for 2X up and down sampling.
+ *
+ * The design method is the one from Laurent de Soras' HIIR library.
+ */
+class HalfBandFilterDesigner
+{
+public:
+    HalfBandFilterDesigner() = delete;       // we are only static
+
+    /**
+     * Fills in coefficients for a filter with a given number of all-pass sections.
+     *
+     * @param coefficients is where the coefficients go. Must have room for numCoefficients.
+     * @param transition is the normalized transition bandwidth (0 < transition < .5).
+     *      The passband ends at (.5 - transition) / 2 of the higher sample rate, the stop band
+     *      starts at (.5 + transition) / 2.
+     */
+    static void design(double* coefficients, int numCoefficients, double transition);
+
+    /**
+     * How many all-pass sections it will take to get the desired stop band attenuation.
+     */
+    static int numCoefficientsFor(double attenuationDb, double transition);
+};
@@ -4,8 +4,10 @@
 #include "IIRDecimator.h"
 #include "IIRUpsampler.h"
 #include "LookupTable.h"
+#include "LookupTable_4.h"
 #include "NonUniformLookupTable.h"
 #include "ObjectCache.h"
+#include "SimdBlocks.h"
 #include "TrapezoidalLowpass.h"
 
 #include <vector>
@@ -57,15 +59,12 @@ inline void EdgeTables::lookup(bool is4PLP, float edge, float* gains)
         gains[i] = x;
     }
 }
-
 /**
- * Moog-ish ladder filter, but lots of options
+ * The parts of LadderFilter that are the same for every sample type.
  */
-template <typename T>
-class LadderFilter
+class LadderFilterBase
 {
 public:
-    LadderFilter();
     enum class Types
     {
         _4PLP,
@@ -96,8 +95,27 @@ public:
         NUM_VOICINGS
     };
 
-    void run(T);
-    T getOutput();
+    static std::vector<std::string> getTypeNames();
+    static std::vector<std::string> getVoicingNames();
+
+protected:
+    static const int oversampleRate = 4;
+};
+
+template <typename T>
+class LadderFilter;
+
+/**
+ * The settings half of LadderFilter.
+ * Turns the knob values into filter coefficients, but does no audio processing.
+ *
+ * LadderFilter<float_4> uses one of these for each lane.
+ */
+template <typename T>
+class LadderFilterParams : public LadderFilterBase
+{
+public:
+    LadderFilterParams();
 
     /**
      * input range >0 to < .5
@@ -116,9 +134,6 @@ public:
 
     float getLEDValue(int tapNumber) const;
 
-    static std::vector<std::string> getTypeNames();
-    static std::vector<std::string> getVoicingNames();
-
     // Only calibration routines will do this
     void disableQComp()
     {
@@ -126,8 +141,9 @@ public:
     }
 
     void _dump(const std::string&);
-private:
-    TrapezoidalLowpass<T> lpfs[4];
+protected:
+    friend class LadderFilter<float_4>;
+
     EdgeTables edgeLookup;
 
     /**
@@ -147,11 +163,9 @@ private:
     T stageTaps[4] = {0, 0, 0, 1};
 
     T bassMakeupGain = 1;
-    T mixedOutput = 0;
     T requestedFeedback = 0;
     T adjustedFeedback = 0;
     T gain = T(.3);
-    T stageOutputs[4] = {0,0,0,0};
     T rawEdge = 0;
     T freqSpread = 0;
     T slope = 3;
@@ -172,11 +186,51 @@ private:
 
     std::shared_ptr<NonUniformLookupTableParams<T>> fs2gLookup = makeTrapFilter_Lookup<T>();
     std::shared_ptr<NonUniformLookupTableParams<T>> feedbackAdjust;
+
+    void updateFilter();
+    void updateSlope();
+    void updateFeedback();
+    void updateStageGains();
+    T processFeedback(T fcNorm, T feedback) const;
+    void initQLookup();
+
+    T getGfromNormFreq(T nf) const;
+};
+
+/**
+ * Moog-ish ladder filter, but lots of options
+ */
+template <typename T>
+class LadderFilter : public LadderFilterParams<T>
+{
+public:
+    using typename LadderFilterParams<T>::Voicing;
+    LadderFilter();
+
+    void run(T);
+    T getOutput();
+
+private:
+    using Base = LadderFilterParams<T>;
+    using Base::oversampleRate;
+    using Base::adjustedFeedback;
+    using Base::bassMakeupGain;
+    using Base::finalVolume;
+    using Base::gain;
+    using Base::stageG;
+    using Base::stageGain;
+    using Base::stageTaps;
+    using Base::voicing;
+
+    TrapezoidalLowpass<T> lpfs[4];
+
+    T mixedOutput = 0;
+    T stageOutputs[4] = {0,0,0,0};
+
     std::shared_ptr<LookupTableParams<T>> tanhLookup = ObjectCache<T>::getTanh5();
     std::shared_ptr<LookupTableParams<T>> expLookup = ObjectCache<T>::getExp2();
 
-    static const int oversampleRate = 4;
-    IIRUpsampler up;
+    IIRUpsampler<float> up;
     IIRDecimator<float> down;
 
     AsymWaveShaper shaper;
@@ -187,30 +241,24 @@ private:
     void runBufferFold(float* buffer, int);
     void runBufferFold2(float* buffer, int);
     void runBufferClean(float* buffer, int);
-
-    void updateFilter();
-    void updateSlope();
-    void updateFeedback();
-    void updateStageGains();
-    T processFeedback(T fcNorm, T feedback) const;
-    void initQLookup();
-
-
-   // void dump(const char* p);
-    T getGfromNormFreq(T nf) const;
 };
 
 template <typename T>
-LadderFilter<T>::LadderFilter()
+LadderFilterParams<T>::LadderFilterParams()
 {
     initQLookup();
+}
+
+template <typename T>
+LadderFilter<T>::LadderFilter()
+{
     // fix at 4X oversample
     up.setup(oversampleRate);
     down.setup(oversampleRate);
 }
 
 template <typename T>
-inline void LadderFilter<T>::_dump(const std::string& s)
+inline void LadderFilterParams<T>::_dump(const std::string& s)
 {
 #if 0
     printf("\ndump %s\n", s.c_str());
@@ -225,21 +273,20 @@ inline void LadderFilter<T>::_dump(const std::string& s)
             stageG[i]);
     }
     printf("volume = %f %f fina: %f\n", volume, lastVolume, finalVolume);
-    printf("mixedOutput =%f bassMakeupGain=%f\n", mixedOutput, bassMakeupGain);
-    printf("last input = %f\n", _lastInput);
+    printf("bassMakeupGain=%f\n", bassMakeupGain);
     fflush(stdout);
 #endif
 }
 
 template <typename T>
-inline float LadderFilter<T>::getLEDValue(int tapNumber) const
+inline float LadderFilterParams<T>::getLEDValue(int tapNumber) const
 {
     T ret =  (type == Types::_4PLP) ? stageTaps[tapNumber] : 0;  
     return float(ret);
 }
 
 template <typename T>
-inline void  LadderFilter<T>::updateSlope()
+inline void  LadderFilterParams<T>::updateSlope()
 {
     if (type != Types::_4PLP) {
         return;
@@ -260,7 +307,7 @@ inline void  LadderFilter<T>::updateSlope()
 }
 
 template <typename T>
-inline void LadderFilter<T>::setSlope(T _slope)
+inline void LadderFilterParams<T>::setSlope(T _slope)
 {
     if (slope == lastSlope) {
         return;
@@ -272,7 +319,7 @@ inline void LadderFilter<T>::setSlope(T _slope)
 }
 
 template <typename T>
-inline void LadderFilter<T>::setVolume(T vol)
+inline void LadderFilterParams<T>::setVolume(T vol)
 {
     if (lastVolume == vol) {
         return;
@@ -284,7 +331,7 @@ inline void LadderFilter<T>::setVolume(T vol)
 
 
 template <typename T>
-inline T LadderFilter<T>::getGfromNormFreq(T nf) const
+inline T LadderFilterParams<T>::getGfromNormFreq(T nf) const
 {
     nf *= (1.0 / oversampleRate);
     const T g2 = NonUniformLookupTable<T>::lookup(*fs2gLookup, nf);
@@ -292,7 +339,7 @@ inline T LadderFilter<T>::getGfromNormFreq(T nf) const
 }
 
 template <typename T>
-inline void LadderFilter<T>::setNormalizedFc(T input)
+inline void LadderFilterParams<T>::setNormalizedFc(T input)
 {
     if (input == lastNormalizedFc) {
         return;
@@ -321,7 +368,7 @@ inline void LadderFilter<T>::setNormalizedFc(T input)
 }
 
 template <typename T>
-void LadderFilter<T>::setBassMakeupGain(T g)
+void LadderFilterParams<T>::setBassMakeupGain(T g)
 {
     assert(g >= 1);     // must be
     assert(g < 10);     // tends to be
@@ -332,7 +379,7 @@ void LadderFilter<T>::setBassMakeupGain(T g)
 }
 
 template <typename T>
-void LadderFilter<T>::setGain(T g)
+void LadderFilterParams<T>::setGain(T g)
 {
     if (g != gain) {
         gain = g;
@@ -341,7 +388,7 @@ void LadderFilter<T>::setGain(T g)
 }
 
 template <typename T>
-void LadderFilter<T>::setFreqSpread(T s)
+void LadderFilterParams<T>::setFreqSpread(T s)
 {
     if (s == freqSpread) {
         return;
@@ -358,7 +405,7 @@ void LadderFilter<T>::setFreqSpread(T s)
 }
 
 template <typename T>
-void LadderFilter<T>::updateFilter()
+void LadderFilterParams<T>::updateFilter()
 {
     for (int i = 0; i < 4; ++i) {
         stageG[i] = _g * stageFreqOffsets[i];
@@ -372,7 +419,7 @@ void LadderFilter<T>::updateFilter()
 }
 
 template <typename T>
-void LadderFilter<T>::setEdge(T e)
+void LadderFilterParams<T>::setEdge(T e)
 {
     if (e == rawEdge) {
         return;
@@ -385,14 +432,14 @@ void LadderFilter<T>::setEdge(T e)
 }
 
 template <typename T>
-void LadderFilter<T>::updateStageGains()
+void LadderFilterParams<T>::updateStageGains()
 {
     edgeLookup.lookup((type == Types::_4PLP), float(rawEdge), stageGain);
 }
 
 #if 0
 template <typename T>
-void LadderFilter<T>::updateStageGains()
+void LadderFilterParams<T>::updateStageGains()
 {
     T k;
     if (rawEdge > .5) {
@@ -408,13 +455,13 @@ void LadderFilter<T>::updateStageGains()
 #endif
 
 template <typename T>
-void LadderFilter<T>::setVoicing(Voicing v)
+void LadderFilterParams<T>::setVoicing(Voicing v)
 {
     voicing = v;
 }
 
 template <typename T>
-void LadderFilter<T>::setType(Types t)
+void LadderFilterParams<T>::setType(Types t)
 {
     if (t == type)
         return;
@@ -533,7 +580,7 @@ inline T LadderFilter<T>::getOutput()
 }
 
 template <typename T>
-inline void LadderFilter<T>::setFeedback(T f)
+inline void LadderFilterParams<T>::setFeedback(T f)
 {
     if (f == requestedFeedback) {
         return;
@@ -544,7 +591,7 @@ inline void LadderFilter<T>::setFeedback(T f)
 }
 
 template <typename T>
-inline void LadderFilter<T>::updateFeedback()
+inline void LadderFilterParams<T>::updateFeedback()
 {
     if (!_disableQComp) {
 #if 0
@@ -703,8 +750,7 @@ BODY(NOPROC, NOPROC, NOPROC, NOPROC)
 PROC_END
 #endif
 
-template <typename T>
-inline  std::vector<std::string> LadderFilter<T>::getTypeNames()
+inline std::vector<std::string> LadderFilterBase::getTypeNames()
 {
     return {
         "4P LP",
@@ -725,8 +771,7 @@ inline  std::vector<std::string> LadderFilter<T>::getTypeNames()
     };
 }
 
-template <typename T>
-inline  std::vector<std::string> LadderFilter<T>::getVoicingNames()
+inline std::vector<std::string> LadderFilterBase::getVoicingNames()
 {
     return {
         "Transistor",
@@ -821,7 +866,7 @@ inline void LadderFilter<T>::runBufferClassic(T* buffer, int numSamples)
 
 #if 0 // old manual way
 template <typename T>
-inline T LadderFilter<T>::processFeedback(T fcNorm, T feedback) const
+inline T LadderFilterParams<T>::processFeedback(T fcNorm, T feedback) const
 {
     printf("doing old feedback\n");
    // double fNorm = lastNormalizedFc;
@@ -861,7 +906,7 @@ inline T LadderFilter<T>::processFeedback(T fcNorm, T feedback) const
 #else
 
 template <typename T>
-inline T LadderFilter<T>::processFeedback(T fcNorm, T feedback) const
+inline T LadderFilterParams<T>::processFeedback(T fcNorm, T feedback) const
 {
     const T x = feedback * T(.25);         // range 0..1
     const T y = x * (2 - x);            // still 0..1, but now a smooshed parabola
@@ -878,7 +923,7 @@ inline T LadderFilter<T>::processFeedback(T fcNorm, T feedback) const
 
 
 template <typename T>
-void LadderFilter<T>::initQLookup()
+void LadderFilterParams<T>::initQLookup()
 {
     std::shared_ptr<NonUniformLookupTableParams<T>> ret =
         std::make_shared<NonUniformLookupTableParams<T>>();
@@ -904,7 +949,7 @@ void LadderFilter<T>::initQLookup()
 }
 #if 0 // gain=40 = too much
 template <typename T>
-void LadderFilter<T>::initQLookup()
+void LadderFilterParams<T>::initQLookup()
 {
     std::shared_ptr<NonUniformLookupTableParams<T>> ret = 
         std::make_shared<NonUniformLookupTableParams<T>>(); 
@@ -990,3 +1035,257 @@ void LadderFilter<T>::initQLookup()
 #endif
 
 
+
+/**
+ * Four ladder filters at once, one per lane of a float_4.
+ *
+ * The settings are still calculated one lane at a time, by a LadderFilterParams<float>
+ * for each lane, but the audio path (upsampler, the four stages with their voicing
+ * nonlinearities, output mixer, decimator) runs on all four lanes together.
+ *
+ * Type, voicing and volume are shared by all the lanes.
+ */
+template <>
+class LadderFilter<float_4> : public LadderFilterBase
+{
+public:
+    LadderFilter();
+
+    void run(float_4);
+    float_4 getOutput();
+
+    void setNormalizedFc(int lane, float);
+    void setFeedback(int lane, float);
+    void setGain(int lane, float);
+    void setEdge(int lane, float);
+    void setFreqSpread(int lane, float);
+    void setBassMakeupGain(int lane, float);
+    void setSlope(int lane, float);
+
+    void setType(Types);
+    void setVoicing(Voicing);
+    void setVolume(float vol);
+
+    float getLEDValue(int lane, int tapNumber) const;
+    void _dump(int lane, const std::string&);
+private:
+    LadderFilterParams<float> laneParams[4];
+
+    /**
+     * set when any lane changes. The coefficients below
+     * will be gathered from the lanes before the next sample.
+     */
+    bool coefficientsDirty = true;
+
+    float_4 stageG[4];
+    float_4 stageGain[4];
+    float_4 stageTaps[4];
+    float_4 adjustedFeedback;
+    float_4 gain;
+    float_4 finalVolume;
+    float_4 bassMakeupGain;
+    Voicing voicing = Voicing::Classic;
+
+    TrapezoidalLowpass<float_4> lpfs[4];
+
+    float_4 mixedOutput = float_4::zero();
+    float_4 stageOutputs[4] = {float_4::zero(), float_4::zero(), float_4::zero(), float_4::zero()};
+
+    std::shared_ptr<LookupTableParams<float>> tanhLookup = ObjectCache<float>::getTanh5();
+
+    IIRUpsampler<float_4> up;
+    IIRDecimator<float_4> down;
+
+    void updateCoefficients();
+
+    void runBufferClassic(float_4* buffer, int);
+    void runBufferClip2(float_4* buffer, int);
+    void runBufferFold(float_4* buffer, int);
+    void runBufferFold2(float_4* buffer, int);
+    void runBufferClean(float_4* buffer, int);
+};
+
+inline LadderFilter<float_4>::LadderFilter()
+{
+    up.setup(oversampleRate);
+    down.setup(oversampleRate);
+}
+
+inline void LadderFilter<float_4>::updateCoefficients()
+{
+    for (int lane = 0; lane < 4; ++lane) {
+        const LadderFilterParams<float>& params = laneParams[lane];
+        for (int stage = 0; stage < 4; ++stage) {
+            stageG[stage][lane] = params.stageG[stage];
+            stageGain[stage][lane] = params.stageGain[stage];
+            stageTaps[stage][lane] = params.stageTaps[stage];
+        }
+        adjustedFeedback[lane] = params.adjustedFeedback;
+        gain[lane] = params.gain;
+        finalVolume[lane] = params.finalVolume;
+        bassMakeupGain[lane] = params.bassMakeupGain;
+    }
+    coefficientsDirty = false;
+}
+
+inline void LadderFilter<float_4>::setNormalizedFc(int lane, float x)
+{
+    laneParams[lane].setNormalizedFc(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setFeedback(int lane, float x)
+{
+    laneParams[lane].setFeedback(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setGain(int lane, float x)
+{
+    laneParams[lane].setGain(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setEdge(int lane, float x)
+{
+    laneParams[lane].setEdge(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setFreqSpread(int lane, float x)
+{
+    laneParams[lane].setFreqSpread(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setBassMakeupGain(int lane, float x)
+{
+    laneParams[lane].setBassMakeupGain(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setSlope(int lane, float x)
+{
+    laneParams[lane].setSlope(x);
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setType(Types t)
+{
+    for (int lane = 0; lane < 4; ++lane) {
+        laneParams[lane].setType(t);
+    }
+    coefficientsDirty = true;
+}
+
+inline void LadderFilter<float_4>::setVoicing(Voicing v)
+{
+    voicing = v;
+}
+
+inline void LadderFilter<float_4>::setVolume(float vol)
+{
+    for (int lane = 0; lane < 4; ++lane) {
+        laneParams[lane].setVolume(vol);
+    }
+    coefficientsDirty = true;
+}
+
+inline float LadderFilter<float_4>::getLEDValue(int lane, int tapNumber) const
+{
+    return laneParams[lane].getLEDValue(tapNumber);
+}
+
+inline void LadderFilter<float_4>::_dump(int lane, const std::string& s)
+{
+    laneParams[lane]._dump(s);
+}
+
+inline float_4 LadderFilter<float_4>::getOutput()
+{
+    return mixedOutput * 5 * bassMakeupGain;
+}
+
+inline void LadderFilter<float_4>::run(float_4 input)
+{
+    if (coefficientsDirty) {
+        updateCoefficients();
+    }
+    input *= gain;
+    float_4 buffer[oversampleRate];
+    up.process(buffer, input);
+
+    switch (voicing) {
+        case Voicing::Classic:
+            runBufferClassic(buffer, oversampleRate);
+            break;
+        case Voicing::Clip2:
+            runBufferClip2(buffer, oversampleRate);
+            break;
+        case Voicing::Fold:
+            runBufferFold(buffer, oversampleRate);
+            break;
+        case Voicing::Fold2:
+            runBufferFold2(buffer, oversampleRate);
+            break;
+        case Voicing::Clean:
+            runBufferClean(buffer, oversampleRate);
+            break;
+        default:
+            assert(false);
+    }
+    mixedOutput = down.process(buffer) * finalVolume;
+}
+
+/**
+ * float_4 versions of the process function macros, above.
+ */
+#define PROC_PREAMBLE_4(name) \
+    inline void LadderFilter<float_4>::name(float_4* buffer, int numSamples) { \
+        for (int i = 0; i < numSamples; ++i) { \
+            const float_4 input = buffer[i]; \
+            float_4 temp = input - adjustedFeedback * stageOutputs[3]; \
+            temp = SimdBlocks::max(float_4(-3), temp); \
+            temp = SimdBlocks::min(float_4(3), temp);
+
+#define PROC_END_4 \
+        temp = float_4::zero(); \
+        for (int i = 0; i < 4; ++i) { \
+            temp += stageOutputs[i] * stageTaps[i]; \
+        } \
+        temp = SimdBlocks::max(float_4(-1.7f), temp); \
+        temp = SimdBlocks::min(float_4(1.7f), temp); \
+        buffer[i] = temp; \
+     } \
+}
+
+#define TANH_4() temp = float_4(2) * LookupTable_4::lookup(*tanhLookup, float_4(.5f) * temp)
+
+#define CLIP_TOP_4()  temp = SimdBlocks::min(temp, float_4(1))
+#define CLIP_BOTTOM_4()  temp = SimdBlocks::max(temp, float_4(-1))
+
+#define FOLD_4() temp = SimdBlocks::fold(temp)
+#define FOLD_ATTEN_4() temp = SimdBlocks::fold(temp * .5f)
+
+#define FOLD_TOP_4() temp = SimdBlocks::ifelse(temp > float_4::zero(), SimdBlocks::fold(temp), temp)
+#define FOLD_BOTTOM_4() temp = SimdBlocks::ifelse(temp < float_4::zero(), SimdBlocks::fold(temp), temp)
+
+PROC_PREAMBLE_4(runBufferClassic)
+BODY(TANH_4, TANH_4, TANH_4, TANH_4)
+PROC_END_4
+
+PROC_PREAMBLE_4(runBufferClip2)
+BODY(CLIP_TOP_4, CLIP_BOTTOM_4, CLIP_TOP_4, CLIP_BOTTOM_4)
+PROC_END_4
+
+PROC_PREAMBLE_4(runBufferFold)
+BODY(FOLD_ATTEN_4, FOLD_4, FOLD_4, FOLD_4)
+PROC_END_4
+
+PROC_PREAMBLE_4(runBufferFold2)
+BODY(FOLD_TOP_4, FOLD_BOTTOM_4, FOLD_TOP_4, FOLD_BOTTOM_4)
+PROC_END_4
+
+PROC_PREAMBLE_4(runBufferClean)
+BODY(NOPROC, NOPROC, NOPROC, NOPROC)
+PROC_END_4
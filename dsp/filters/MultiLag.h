@@ -200,6 +200,15 @@ public:
         return memory[index];
     }
 
+    /**
+     * four outputs in a row, starting at index
+     */
+    __m128 get4(int index) const
+    {
+        assert(index + 4 <= N);
+        return _mm_loadu_ps(memory + index);
+    }
+
 private:
     float memory[N] = {0};
 
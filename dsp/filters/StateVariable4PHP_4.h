@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AudioMath.h"
+#include "SimdBlocks.h"
+
+/**
+ * Four channel version of StateVariable4PHP.
+ * Four pole Butterworth highpass made from two state variable sections,
+ * with a different cutoff for each lane.
+ *
+ * The math is the same as the HiPass mode of StateVariableFilter.
+ */
+class StateVariable4PHP_4
+{
+public:
+    float_4 run(float_4);
+
+    /**
+     * Set the cutoff of one lane.
+     * units are 1 == sample rate
+     */
+    void setCutoff(int lane, float fc);
+private:
+    float_4 fcGain = float_4(.001f);
+
+    float_4 z1[2] = {float_4::zero(), float_4::zero()};
+    float_4 z2[2] = {float_4::zero(), float_4::zero()};
+
+    static float_4 runSection(float_4 input, float_4& z1, float_4& z2, float_4 fcGain, float qGain);
+};
+
+inline float_4 StateVariable4PHP_4::runSection(float_4 input, float_4& z1, float_4& z2, float_4 fcGain, float qGain)
+{
+    const float_4 dLow = z2 + fcGain * z1;
+    const float_4 dHi = input - (z1 * qGain + dLow);
+    float_4 dBand = dHi * fcGain + z1;
+
+    // same clipping as StateVariableFilter
+    dBand = SimdBlocks::ifelse(dBand >= float_4(1000), float_4(999), dBand);
+    dBand = SimdBlocks::ifelse(dBand < float_4(-1000), float_4(-999), dBand);
+
+    z1 = dBand;
+    z2 = dLow;
+    return dHi;
+}
+
+inline float_4 StateVariable4PHP_4::run(float_4 input)
+{
+    // qGain is 1 / Q, with the same Q as StateVariable4PHP
+    float_4 output = runSection(input, z1[0], z2[0], fcGain, 1 / .54119f);
+    output = runSection(output, z1[1], z2[1], fcGain, 1 / 1.30656296f);
+    return output;
+}
+
+inline void StateVariable4PHP_4::setCutoff(int lane, float fc)
+{
+    assert(lane >= 0 && lane < 4);
+
+    // .3 is stable, .32 not
+    fc = std::min(fc, .3f);
+    fcGain[lane] = float(AudioMath::Pi) * 2 * fc;
+}
@@ -39,10 +39,21 @@ public:
     typedef float_4 (*processFunction)(float_4 input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static processFunction getProcPointer(Mode mode, int oversample);
 
+    /**
+     * Same as the function getProcPointer returns, but with the mode and
+     * oversample rate known at compile time, so it can all be inlined.
+     */
+    template <Mode M, int OVERSAMPLE>
+    static T run(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
+
     static T runLP(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runHP(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runBP(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runN(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
+    static T runLP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
+    static T runHP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
+    static T runBP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
+    static T runN2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runLP4(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runHP4(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
     static T runBP4(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params);
@@ -68,6 +79,23 @@ inline  typename StateVariableFilter2<T>::processFunction StateVariableFilter2<T
             default:
                 assert(false);
         }
+    } else if (oversample == 2) {
+         switch (mode) {
+            case Mode::LowPass:
+                return &runLP2;
+                break;
+            case Mode::HighPass:
+                    return &runHP2;
+                break;
+            case Mode::BandPass:
+                    return &runBP2;
+                break;
+            case Mode::Notch:
+                    return &runN2;
+                break;
+            default:
+                assert(false);
+        }
     } else if (oversample == 4) {
          switch (mode) {
             case Mode::LowPass:
@@ -90,6 +118,105 @@ inline  typename StateVariableFilter2<T>::processFunction StateVariableFilter2<T
     return nullptr;
 }
 
+template <typename T>
+template <typename StateVariableFilter2<T>::Mode M, int OVERSAMPLE>
+inline T StateVariableFilter2<T>::run(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params) {
+    static_assert(OVERSAMPLE == 1 || OVERSAMPLE == 2 || OVERSAMPLE == 4, "bad oversample");
+    switch (M) {
+        case Mode::LowPass:
+            return (OVERSAMPLE == 1) ? runLP(input, state, params) :
+                ((OVERSAMPLE == 2) ? runLP2(input, state, params) : runLP4(input, state, params));
+        case Mode::HighPass:
+            return (OVERSAMPLE == 1) ? runHP(input, state, params) :
+                ((OVERSAMPLE == 2) ? runHP2(input, state, params) : runHP4(input, state, params));
+        case Mode::BandPass:
+            return (OVERSAMPLE == 1) ? runBP(input, state, params) :
+                ((OVERSAMPLE == 2) ? runBP2(input, state, params) : runBP4(input, state, params));
+        case Mode::Notch:
+            return (OVERSAMPLE == 1) ? runN(input, state, params) :
+                ((OVERSAMPLE == 2) ? runN2(input, state, params) : runN4(input, state, params));
+    }
+    assert(false);
+    return input;
+}
+
+template <typename T>
+inline T StateVariableFilter2<T>::runHP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params)
+{
+    T dLow = state.z2 + params.fcGain * state.z1;
+    T dHi = input - (state.z1 * params.qGain + dLow);
+    T dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    dLow = state.z2 + params.fcGain * state.z1;
+    dHi = input - (state.z1 * params.qGain + dLow);
+    dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    return dHi;
+}
+
+template <typename T>
+inline T StateVariableFilter2<T>::runBP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params)
+{
+    T dLow = state.z2 + params.fcGain * state.z1;
+    T dHi = input - (state.z1 * params.qGain + dLow);
+    T dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    dLow = state.z2 + params.fcGain * state.z1;
+    dHi = input - (state.z1 * params.qGain + dLow);
+    dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    return dBand;
+}
+
+template <typename T>
+inline T StateVariableFilter2<T>::runN2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params)
+{
+    T dLow = state.z2 + params.fcGain * state.z1;
+    T dHi = input - (state.z1 * params.qGain + dLow);
+    T dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    dLow = state.z2 + params.fcGain * state.z1;
+    dHi = input - (state.z1 * params.qGain + dLow);
+    dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    return dLow + dHi;
+}
+
+/**
+ * At 1X and 2X the lowpass output is taken after the last integrator update.
+ * That doesn't change the frequency response, but keeps the delay through the
+ * filter under a sample, like the 4X version, so switching rates doesn't jump.
+ */
+template <typename T>
+inline T StateVariableFilter2<T>::runLP2(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params)
+{
+    T dLow = state.z2 + params.fcGain * state.z1;
+    T dHi = input - (state.z1 * params.qGain + dLow);
+    T dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    dLow = state.z2 + params.fcGain * state.z1;
+    dHi = input - (state.z1 * params.qGain + dLow);
+    dBand = dHi * params.fcGain + state.z1;  
+    state.z1 = dBand;
+    state.z2 = dLow;
+
+    return state.z2 + params.fcGain * state.z1;
+}
+
 template <typename T>
 inline T StateVariableFilter2<T>::runHP4(T input, StateVariableFilterState2<T>& state, const StateVariableFilterParams2<T>& params)
 {
@@ -218,7 +345,9 @@ inline T StateVariableFilter2<T>::runLP(T input, StateVariableFilterState2<T>& s
     const T dBand = dHi * params.fcGain + state.z1;  
     state.z1 = dBand;
     state.z2 = dLow;
-    return dLow;
+
+    // same as runLP2, take the output after the update
+    return state.z2 + params.fcGain * state.z1;
 }
 
 template <typename T>
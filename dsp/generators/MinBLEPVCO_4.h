@@ -0,0 +1,483 @@
+#pragma once
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "PolyApprox_4.h"
+#include "SimdBlocks.h"
+#include "dsp/minblep.hpp"
+#include "simd.h"
+
+/**
+ * Four MinBLEPVCOs, one per float_4 lane.
+ *
+ * Same waveforms and the same discontinuity logic as MinBLEPVCO,
+ * but each lane can have its own waveform, frequency and pulse width,
+ * and all four run in one pass.
+ *
+ * Sync is done with lane masks instead of callbacks:
+ *      step() lets lane 0 be the sync master for the lanes in setSyncEnabled,
+ *          which is what EV3 needs.
+ *      step(mask, crossing) takes the sync from outside, and getSyncOutMask /
+ *          getSyncOutCrossing report this step's edges, so one
+ *          instance can sync another (for polyphonic use).
+ *
+ * The MinBLEP residuals are the 16 x 16 impulse, pre-arranged so that
+ * a discontinuity is interpolated from two table rows with float_4 math,
+ * and the four lanes' residuals are mixed back into the output with one load.
+ */
+class MinBLEPVCO_4
+{
+public:
+    enum class Waveform
+    {
+        Sin, Tri, Saw, Square, Even, END
+    };
+
+    MinBLEPVCO_4();
+
+    void setWaveform(int lane, Waveform);
+
+    /**
+     * f is frequency / sample rate.
+     */
+    void setNormalizedFreq(float_4 f, float sampleTime);
+    void setPulseWidth(float_4 pw);
+
+    /**
+     * Mask of the lanes that will follow sync.
+     * For step(), lane 0 is the master, so it may not be in the mask.
+     * Tri lanes with sync enabled play sin, like MinBLEPVCO.
+     */
+    void setSyncEnabled(float_4 mask);
+
+    /**
+     * Lane 0 syncs the lanes in setSyncEnabled.
+     */
+    void step();
+
+    /**
+     * The lanes in syncMask (and also in setSyncEnabled) reset at
+     * syncCrossing (-1..0) samples from now.
+     */
+    void step(float_4 syncMask, float_4 syncCrossing);
+
+    float_4 getOutput() const
+    {
+        return output;
+    }
+
+    /**
+     * Lanes that sent out a sync edge in the last step, and where.
+     * These are the places MinBLEPVCO would call its SyncCallback.
+     */
+    float_4 getSyncOutMask() const
+    {
+        return syncOutMask;
+    }
+    float_4 getSyncOutCrossing() const
+    {
+        return syncOutCrossing;
+    }
+
+private:
+    static const int blepZeroCrossings = 16;
+    static const int blepOversample = 16;
+    static const int blepLength = 2 * blepZeroCrossings;
+    static_assert((blepLength & (blepLength - 1)) == 0, "ring buffer needs a power of two");
+
+    /**
+     * rows[k][j] is the residual (impulse - 1) for output sample j,
+     * with the discontinuity k / blepOversample samples before the current one.
+     * That makes each row contiguous in time.
+     */
+    class Residuals
+    {
+    public:
+        Residuals();
+        float rows[blepOversample + 1][blepLength];
+    };
+    static const Residuals& getResiduals();
+
+    /**
+     * A ring buffer of the residuals still to be played, with the lanes
+     * interleaved, so reading one sample for all four lanes is one load.
+     * Discontinuities are much rarer than samples, so inserting is the
+     * side that pays for the interleaving.
+     */
+    float_4 blepBuffer[blepLength] = {};
+    int blepPos = 0;
+    const Residuals& residuals;
+
+    enum WaveformBits
+    {
+        sinBit = 1,
+        triBit = 2,
+        sawBit = 4,
+        squareBit = 8,
+        evenBit = 16
+    };
+    Waveform waveforms[4] = {Waveform::Saw, Waveform::Saw, Waveform::Saw, Waveform::Saw};
+    int activeWaveforms = 0;
+    float_4 sinMask = {};
+    float_4 triMask = {};
+    float_4 sawMask = {};
+    float_4 squareMask = {};
+    float_4 evenMask = {};
+
+    float_4 phase = 0;
+    float_4 freq = float_4(1e-6f);
+    float sampleTime = 0;
+    float_4 pulseWidth = .5f;
+    float_4 sawDCComp = 0;
+    float_4 evenDCComp = 0;
+    float_4 pulseDCComp = 0;
+    float_4 lastSq = {};
+    float_4 tri = 0;
+    float_4 syncEnabled = {};
+    bool anySyncEnabled = false;
+
+    float_4 output = 0;
+    float_4 syncOutMask = {};
+    float_4 syncOutCrossing = 0;
+
+    void updateMasks();
+    bool getMasterSync(float& crossing) const;
+    void insertDiscontinuities(float_4 mask, float_4 crossing, float_4 jump);
+    void insertDiscontinuity(int lane, float crossing, float jump);
+    float_4 processResidual();
+
+    static float_4 sineLook(float_4 phase);
+    static float_4 evenLook(float_4 phase);
+};
+
+inline MinBLEPVCO_4::Residuals::Residuals()
+{
+    const int impulseLength = blepLength * blepOversample;
+    float impulse[impulseLength + 1];
+    ::rack::dsp::minBlepImpulse(blepZeroCrossings, blepOversample, impulse);
+    impulse[impulseLength] = 1;
+
+    for (int k = 0; k <= blepOversample; ++k) {
+        for (int j = 0; j < blepLength; ++j) {
+            const int index = j * blepOversample + k;
+            rows[k][j] = impulse[index] - 1;
+        }
+    }
+}
+
+inline const MinBLEPVCO_4::Residuals& MinBLEPVCO_4::getResiduals()
+{
+    static const Residuals theResiduals;
+    return theResiduals;
+}
+
+inline MinBLEPVCO_4::MinBLEPVCO_4() : residuals(getResiduals())
+{
+    updateMasks();
+}
+
+inline void MinBLEPVCO_4::setWaveform(int lane, Waveform wf)
+{
+    assert(lane >= 0 && lane < 4);
+    if (waveforms[lane] != wf) {
+        waveforms[lane] = wf;
+        updateMasks();
+    }
+}
+
+inline void MinBLEPVCO_4::setSyncEnabled(float_4 mask)
+{
+    const int bits = rack::simd::movemask(mask);
+    const int oldBits = rack::simd::movemask(syncEnabled);
+    if (bits != oldBits) {
+        syncEnabled = mask;
+        anySyncEnabled = bits != 0;
+        updateMasks();
+    }
+}
+
+inline void MinBLEPVCO_4::updateMasks()
+{
+    float_4 isSin, isTri, isSaw, isSquare, isEven;
+    for (int i = 0; i < 4; ++i) {
+        isSin[i] = waveforms[i] == Waveform::Sin;
+        isTri[i] = waveforms[i] == Waveform::Tri;
+        isSaw[i] = waveforms[i] == Waveform::Saw;
+        isSquare[i] = waveforms[i] == Waveform::Square;
+        isEven[i] = waveforms[i] == Waveform::Even;
+    }
+
+    // Tri sync doesn't work -> use sin
+    const float_4 zero = 0;
+    triMask = (isTri != zero) & SimdBlocks::ifelse(syncEnabled, SimdBlocks::maskFalse(), SimdBlocks::maskTrue());
+    sinMask = (isSin != zero) | ((isTri != zero) & syncEnabled);
+    sawMask = isSaw != zero;
+    squareMask = isSquare != zero;
+    evenMask = isEven != zero;
+
+    activeWaveforms = 0;
+    activeWaveforms |= rack::simd::movemask(sinMask) ? sinBit : 0;
+    activeWaveforms |= rack::simd::movemask(triMask) ? triBit : 0;
+    activeWaveforms |= rack::simd::movemask(sawMask) ? sawBit : 0;
+    activeWaveforms |= rack::simd::movemask(squareMask) ? squareBit : 0;
+    activeWaveforms |= rack::simd::movemask(evenMask) ? evenBit : 0;
+}
+
+inline void MinBLEPVCO_4::setNormalizedFreq(float_4 f, float st)
+{
+    freq = SimdBlocks::min(SimdBlocks::max(f, float_4(1e-6f)), float_4(.5f));
+    sampleTime = st;
+
+    const float sawCorrect = -4.6125;
+    sawDCComp = freq * float_4(sawCorrect);
+    evenDCComp = float_4(2) * sawDCComp;
+}
+
+inline void MinBLEPVCO_4::setPulseWidth(float_4 pw)
+{
+    pulseWidth = pw;
+    pulseDCComp = pw * float_4(2) - float_4(1);
+}
+
+inline void MinBLEPVCO_4::insertDiscontinuity(int lane, float crossing, float jump)
+{
+    // the discontinuity is between two rows of the residual table
+    const float x = -crossing * blepOversample;
+    const int k = std::min(int(x), blepOversample - 1);
+    const float_4 frac(x - k);
+    const float_4 jump4(jump);
+
+    const float* row0 = residuals.rows[k];
+    const float* row1 = residuals.rows[k + 1];
+    float* buffer = reinterpret_cast<float*>(blepBuffer);
+    for (int j = 0; j < blepLength; j += 4) {
+        const float_4 r0 = float_4::load(row0 + j);
+        const float_4 r1 = float_4::load(row1 + j);
+        const float_4 residual = (r0 + frac * (r1 - r0)) * jump4;
+        for (int i = 0; i < 4; ++i) {
+            const int index = (blepPos + j + i) & (blepLength - 1);
+            buffer[index * 4 + lane] += residual[i];
+        }
+    }
+}
+
+inline void MinBLEPVCO_4::insertDiscontinuities(float_4 mask, float_4 crossing, float_4 jump)
+{
+    // like MinBlepGenerator, ignore crossings that aren't in the last sample
+    mask = mask & (crossing > float_4(-1)) & (crossing <= float_4(0));
+    const int bits = rack::simd::movemask(mask);
+    if (!bits) {
+        return;
+    }
+    for (int lane = 0; lane < 4; ++lane) {
+        if (bits & (1 << lane)) {
+            insertDiscontinuity(lane, crossing[lane], jump[lane]);
+        }
+    }
+}
+
+inline float_4 MinBLEPVCO_4::processResidual()
+{
+    const float_4 ret = blepBuffer[blepPos];
+    blepBuffer[blepPos] = 0;
+    blepPos = (blepPos + 1) & (blepLength - 1);
+    return ret;
+}
+
+inline float_4 MinBLEPVCO_4::sineLook(float_4 input)
+{
+    // MinBLEPVCO's sin is really -cos
+    return -PolyApprox_4::sin2pi<PolyApprox_4::Precision::Medium>(input + float_4(.25f));
+}
+
+inline float_4 MinBLEPVCO_4::evenLook(float_4 input)
+{
+    const float_4 doubleSaw = SimdBlocks::ifelse(input < float_4(.5f),
+                                                 float_4(-1) + float_4(4) * input,
+                                                 float_4(-1) + float_4(4) * (input - float_4(.5f)));
+    return float_4(.55f) * (doubleSaw + float_4(1.27f) * sineLook(input));
+}
+
+/**
+ * Does lane 0 send out a sync edge this sample?
+ * Predicts what step will do to lane 0, which is never synced itself.
+ */
+inline bool MinBLEPVCO_4::getMasterSync(float& crossing) const
+{
+    const float p = phase[0] + freq[0];
+    crossing = -(p - 1) / freq[0];
+    switch (waveforms[0]) {
+        case Waveform::Square: {
+            if (!(p > 1)) {
+                return false;
+            }
+            const bool newSq = (p - 1) >= pulseWidth[0];
+            const bool wasSq = rack::simd::movemask(lastSq) & 1;
+            return newSq != wasSq;
+        }
+        case Waveform::END:
+            return false;
+        default:
+            return p >= 1;
+    }
+}
+
+inline void MinBLEPVCO_4::step()
+{
+    float crossing = 0;
+    if (anySyncEnabled && getMasterSync(crossing)) {
+        step(syncEnabled, float_4(crossing));
+    } else {
+        step(SimdBlocks::maskFalse(), float_4(0));
+    }
+}
+
+inline void MinBLEPVCO_4::step(float_4 syncMask, float_4 syncCrossing)
+{
+    const float_4 one = 1;
+    const float_4 half = .5f;
+    const float_4 f = freq;
+
+    syncMask = syncMask & syncEnabled;
+    const float_4 notSync = SimdBlocks::ifelse(syncMask, SimdBlocks::maskFalse(), SimdBlocks::maskTrue());
+
+    // How far past the reset we will be, when synced
+    const float_4 excess = -syncCrossing * f;
+
+    float_4 nextPhase = phase;
+    float_4 base = 0;          // the output, before the residual is added
+    float_4 residualGain = 0;  // what the residual is multiplied by
+    float_4 triSquare = 0;
+    syncOutMask = SimdBlocks::maskFalse();
+    syncOutCrossing = 0;
+
+    if (activeWaveforms & sawBit) {
+        const float_4 predicted = phase + f;
+        float_4 p = SimdBlocks::ifelse(syncMask, excess, predicted);
+        p = SimdBlocks::ifelse(p >= one, p - one, p);
+
+        // see if we jumped
+        const float_4 jumped = (p != predicted) & sawMask;
+        const float_4 crossing = SimdBlocks::ifelse(syncMask, syncCrossing, -p / f);
+        insertDiscontinuities(jumped, crossing, p - predicted);
+
+        syncOutMask = syncOutMask | jumped;
+        syncOutCrossing = SimdBlocks::ifelse(jumped, crossing, syncOutCrossing);
+        nextPhase = SimdBlocks::ifelse(sawMask, p, nextPhase);
+
+        // residual is in phase units, and saw is 2 * phase
+        const float_4 saw = float_4(5) * (float_4(-1) + float_4(2) * p + sawDCComp);
+        base = SimdBlocks::ifelse(sawMask, saw, base);
+        residualGain = SimdBlocks::ifelse(sawMask, float_4(10), residualGain);
+    }
+
+    if (activeWaveforms & squareBit) {
+        float_4 p = SimdBlocks::ifelse(syncMask, excess, phase + f);
+        const float_4 overflow = p > one;
+        p = SimdBlocks::ifelse(overflow, p - one, p);
+
+        const float_4 newSq = p >= pulseWidth;
+        const float_4 edge = (newSq ^ lastSq) & squareMask;
+        lastSq = SimdBlocks::ifelse(squareMask, newSq, lastSq);
+
+        float_4 crossing = SimdBlocks::ifelse(overflow, -p / f, -(p - pulseWidth) / f);
+        crossing = SimdBlocks::ifelse(syncMask, syncCrossing, crossing);
+        const float_4 jump = SimdBlocks::ifelse(newSq, float_4(2), float_4(-2));
+        insertDiscontinuities(edge, crossing, jump);
+
+        // crossing the pulse width isn't a sync edge
+        const float_4 out = edge & (syncMask | overflow);
+        syncOutMask = syncOutMask | out;
+        syncOutCrossing = SimdBlocks::ifelse(out, crossing, syncOutCrossing);
+        nextPhase = SimdBlocks::ifelse(squareMask, p, nextPhase);
+
+        const float_4 square = float_4(5) * (SimdBlocks::ifelse(newSq, one, float_4(-1)) + pulseDCComp);
+        base = SimdBlocks::ifelse(squareMask, square, base);
+        residualGain = SimdBlocks::ifelse(squareMask, float_4(5), residualGain);
+    }
+
+    if (activeWaveforms & sinBit) {
+        // synced sin jumps to the middle of the cycle
+        const float_4 synced = syncMask & sinMask;
+        const float_4 newPhase = half + excess;
+        if (rack::simd::movemask(synced)) {
+            insertDiscontinuities(synced, syncCrossing, sineLook(newPhase) - sineLook(phase));
+        }
+
+        float_4 p = phase + f;
+        const float_4 wrapped = (p >= one) & notSync & sinMask;
+        p = SimdBlocks::ifelse(p >= one, p - one, p);
+        p = SimdBlocks::ifelse(syncMask, newPhase, p);
+
+        syncOutMask = syncOutMask | wrapped;
+        syncOutCrossing = SimdBlocks::ifelse(wrapped, -p / f, syncOutCrossing);
+        nextPhase = SimdBlocks::ifelse(sinMask, p, nextPhase);
+
+        base = SimdBlocks::ifelse(sinMask, float_4(5) * sineLook(p), base);
+        residualGain = SimdBlocks::ifelse(sinMask, float_4(5), residualGain);
+    }
+
+    if (activeWaveforms & triBit) {
+        float_4 p = phase + f;
+        const float_4 rising = (phase < half) & (p >= half) & triMask;
+        insertDiscontinuities(rising, -(p - half) / f, float_4(2));
+
+        const float_4 wrapped = (p >= one) & triMask;
+        p = SimdBlocks::ifelse(p >= one, p - one, p);
+        const float_4 crossing = -p / f;
+        insertDiscontinuities(wrapped, crossing, float_4(-2));
+
+        syncOutMask = syncOutMask | wrapped;
+        syncOutCrossing = SimdBlocks::ifelse(wrapped, crossing, syncOutCrossing);
+        nextPhase = SimdBlocks::ifelse(triMask, p, nextPhase);
+
+        // integrated below, after the residual is known
+        triSquare = SimdBlocks::ifelse(p < half, float_4(-1), one);
+    }
+
+    if (activeWaveforms & evenBit) {
+        float_4 p = phase + f;
+        const float_4 newPhase = half + excess;
+        const float_4 syncJump = evenLook(newPhase) - evenLook(p);
+        p = SimdBlocks::ifelse(syncMask, newPhase, p);
+
+        const float_4 jump5 = (phase < half) & (p >= half);
+        const float_4 jump1 = p >= one;
+        p = SimdBlocks::ifelse(jump1, p - one, p);
+
+        const float_4 synced = syncMask & evenMask;
+        insertDiscontinuities(synced, syncCrossing, syncJump);
+
+        // The double saw drops. It is scaled by .55 on the way out,
+        // so the jump is too.
+        const float_4 dropped = (jump1 | jump5) & notSync & evenMask;
+        const float_4 crossing = SimdBlocks::ifelse(jump1, -p / f, -(p - half) / f);
+        insertDiscontinuities(dropped, crossing, float_4(-2 * .55f));
+
+        const float_4 out = synced | (dropped & jump1);
+        syncOutMask = syncOutMask | out;
+        syncOutCrossing = SimdBlocks::ifelse(synced, syncCrossing, SimdBlocks::ifelse(out, crossing, syncOutCrossing));
+        nextPhase = SimdBlocks::ifelse(evenMask, p, nextPhase);
+
+        const float_4 doubleSaw = SimdBlocks::ifelse(p < half,
+                                                     float_4(-1) + float_4(4) * p,
+                                                     float_4(-1) + float_4(4) * (p - half));
+        const float_4 even = float_4(.55f) * (doubleSaw + evenDCComp + float_4(1.27f) * sineLook(p));
+        base = SimdBlocks::ifelse(evenMask, float_4(5) * even, base);
+        residualGain = SimdBlocks::ifelse(evenMask, float_4(5), residualGain);
+    }
+
+    phase = nextPhase;
+    const float_4 residual = processResidual();
+    output = base + residualGain * residual;
+
+    if (activeWaveforms & triBit) {
+        // Integrate square for triangle
+        float_4 t = tri + float_4(4) * (triSquare + residual) * f;
+        t *= float_4(1 - 40 * sampleTime);
+        tri = SimdBlocks::ifelse(triMask, t, tri);
+        output = SimdBlocks::ifelse(triMask, float_4(5) * tri, output);
+    }
+}
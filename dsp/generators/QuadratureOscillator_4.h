@@ -0,0 +1,64 @@
+#pragma once
+
+#include "PolyApprox_4.h"
+#include "SimdBlocks.h"
+
+/**
+ * Four sin / cos oscillators, one per lane.
+ *
+ * Instead of a phase and a sin lookup, each lane is a unit vector that
+ * is rotated by the frequency every sample, so a sample costs
+ * a complex multiply. The length of the vector is pulled back to one
+ * every sample, so it doesn't drift.
+ *
+ * Like SinOscillator<T, true>, the frequency may be negative,
+ * and may change without a phase discontinuity.
+ */
+class QuadratureOscillator_4
+{
+public:
+    /**
+     * units are 1 == sample rate.
+     */
+    void setFrequency(float_4 freq);
+
+    /**
+     * sinOut and cosOut are 90 degrees apart, and range from -1 to 1
+     */
+    void run(float_4& sinOut, float_4& cosOut);
+
+private:
+    float_4 sinState = float_4(0);
+    float_4 cosState = float_4(1);
+
+    // rotation per sample.
+    float_4 sinInc = float_4(0);
+    float_4 cosInc = float_4(1);
+    float_4 lastFreq = float_4(0);
+};
+
+inline void QuadratureOscillator_4::setFrequency(float_4 freq)
+{
+    // this is usually called every sample, but the frequency usually doesn't change
+    const float_4 changed = freq != lastFreq;
+    if (!rack::simd::movemask(changed)) {
+        return;
+    }
+    lastFreq = freq;
+    sinInc = PolyApprox_4::sin2pi<PolyApprox_4::Precision::High>(freq);
+    cosInc = PolyApprox_4::sin2pi<PolyApprox_4::Precision::High>(freq + float_4(.25f));
+}
+
+inline void QuadratureOscillator_4::run(float_4& sinOut, float_4& cosOut)
+{
+    const float_4 s = sinState * cosInc + cosState * sinInc;
+    const float_4 c = cosState * cosInc - sinState * sinInc;
+
+    // first order correction towards unit length. Good enough, since the error is tiny.
+    const float_4 gain = float_4(1.5f) - float_4(.5f) * (s * s + c * c);
+    sinState = s * gain;
+    cosState = c * gain;
+
+    sinOut = sinState;
+    cosOut = cosState;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "AudioMath.h"
+#include "SimdBlocks.h"
+#include "ThreadServer.h"
+#include "ThreadSharedState.h"
+
+/**
+ * Support for rendering the Sines organ from wavetables.
+ *
+ * With static drawbars each voice is a fixed mix of nine sines, so the mix
+ * can be rendered once into a single cycle table, and each voice becomes one
+ * table read instead of nine oscillators.
+ *
+ * The tables are mipmapped by octave. Each level only has the partials
+ * that stay under .47 * sample rate (the same limit as SinesVCO) all the way
+ * to the top of its octave, so nothing aliases.
+ *
+ * The tables use exact harmonic ratios, where the oscillators use
+ * equal tempered intervals. So the 5 1/3', 2 2/3' and 1 1/3' drawbars are
+ * about two cents flat of the oscillators, and the 1 3/5' is 14 cents flat.
+ */
+class SinesWavetable {
+public:
+    static const int tableSize = 1024;
+    static const int numLevels = 11;
+    static const int numDrawbars = 9;
+
+    /**
+     * The fundamental (the 16' drawbar) of the lowest level.
+     * Level n covers lowestFreq * 2 ** n up to twice that.
+     */
+    static constexpr float lowestFreq = 8;
+
+    /**
+     * Harmonic number of each drawbar, relative to the 16' drawbar.
+     */
+    static int harmonic(int drawbar) {
+        assert(drawbar >= 0 && drawbar < numDrawbars);
+        static const int harmonics[numDrawbars] = {1, 3, 2, 4, 6, 8, 10, 12, 16};
+        return harmonics[drawbar];
+    }
+
+    /**
+     * Everything needed to render the tables.
+     * Gains are in the same order as the drawbars.
+     */
+    class Recipe {
+    public:
+        float drawbarGains[numDrawbars] = {0};
+        float percussionGains[numDrawbars] = {0};
+        float sampleRate = 0;
+
+        bool operator==(const Recipe& other) const;
+        bool operator!=(const Recipe& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * One mipmapped table for the drawbars, and one for the percussion.
+     * There is an extra sample at the end of each level, so interpolation
+     * doesn't have to wrap.
+     */
+    class Tables {
+    public:
+        float drawbars[numLevels][tableSize + 1];
+        float percussion[numLevels][tableSize + 1];
+    };
+
+    static void render(Tables& tables, const Recipe& recipe);
+
+    /**
+     * Which table to use for a given fundamental frequency in Hz.
+     */
+    static int getLevel(float freq);
+
+    /**
+     * Reads a table, with linear interpolation.
+     * phase is 0..1
+     */
+    static float lookup(const float* table, float phase);
+
+private:
+    static void renderLevel(float* table, const float* gains, int level, float sampleRate);
+};
+
+inline bool SinesWavetable::Recipe::operator==(const Recipe& other) const {
+    if (sampleRate != other.sampleRate) {
+        return false;
+    }
+    for (int i = 0; i < numDrawbars; ++i) {
+        if ((drawbarGains[i] != other.drawbarGains[i]) ||
+            (percussionGains[i] != other.percussionGains[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void SinesWavetable::render(Tables& tables, const Recipe& recipe) {
+    assert(recipe.sampleRate > 0);
+    for (int level = 0; level < numLevels; ++level) {
+        renderLevel(tables.drawbars[level], recipe.drawbarGains, level, recipe.sampleRate);
+        renderLevel(tables.percussion[level], recipe.percussionGains, level, recipe.sampleRate);
+    }
+}
+
+inline void SinesWavetable::renderLevel(float* table, const float* gains, int level, float sampleRate) {
+    const double topOfLevel = lowestFreq * std::pow(2.0, level + 1);
+    const double maxFreq = sampleRate * .47;
+    for (int i = 0; i <= tableSize; ++i) {
+        const double phase = 2 * AudioMath::Pi * double(i) / tableSize;
+        double x = 0;
+        for (int drawbar = 0; drawbar < numDrawbars; ++drawbar) {
+            const int h = harmonic(drawbar);
+            if (gains[drawbar] != 0 && (h * topOfLevel < maxFreq)) {
+                x += gains[drawbar] * std::sin(h * phase);
+            }
+        }
+        table[i] = float(x);
+    }
+}
+
+inline int SinesWavetable::getLevel(float freq) {
+    const float lowest = lowestFreq;
+    const float octave = std::log2(std::max(freq, lowest) * (1.f / lowest));
+    return std::min(int(octave), numLevels - 1);
+}
+
+inline float SinesWavetable::lookup(const float* table, float phase) {
+    assert(phase >= 0 && phase <= 1);
+    const float x = phase * tableSize;
+    const int index = std::min(int(x), tableSize - 1);
+    const float frac = x - index;
+    return table[index] + frac * (table[index + 1] - table[index]);
+}
+
+/**
+ * Sent to the SinesTableServer with a recipe filled in,
+ * comes back with the tables rendered.
+ */
+class SinesTableMessage : public ThreadMessage {
+public:
+    SinesTableMessage() : ThreadMessage(Type::SINES),
+                          tables(new SinesWavetable::Tables()) {
+    }
+
+    SinesWavetable::Recipe recipe;
+    std::unique_ptr<SinesWavetable::Tables> tables;
+};
+
+class SinesTableServer : public ThreadServer {
+public:
+    SinesTableServer(std::shared_ptr<ThreadSharedState> state) : ThreadServer(state) {
+    }
+
+protected:
+    /**
+     * This is called on the server thread, not the audio thread.
+     */
+    void handleMessage(ThreadMessage* msg) override {
+        if (msg->type != ThreadMessage::Type::SINES) {
+            assert(false);
+            return;
+        }
+        SinesTableMessage* tableMessage = static_cast<SinesTableMessage*>(msg);
+        SinesWavetable::render(*tableMessage->tables, tableMessage->recipe);
+        sendMessageToClient(tableMessage);
+    }
+};
@@ -9,6 +9,7 @@
 #if 1
 #include "simd.h"
 #include "SimdBlocks.h"
+#include "PolyApprox_4.h"
 #include "dsp/minblep.hpp"
 #include "dsp/approx.hpp"
 #include "dsp/filter.hpp"
@@ -105,7 +106,8 @@ inline void VoltageControlledOscillator<OV, Q, T, I>::setupSub(int channels, T p
 	
 	assert(index >= 0);
 
-	freq = dsp::FREQ_C4 * dsp::approxExp2_taylor5(pitch + 30) / 1073741824;
+	// exp2 is good to .0002 cents, and doesn't need the +30 trick to stay positive
+	freq = dsp::FREQ_C4 * PolyApprox_4::exp2<PolyApprox_4::Precision::High>(pitch);
 //	printf("\n********* in setup sub index = %d pitch=%s converted to freq=%s\n", index, toStr(pitch).c_str(), toStr(freq).c_str());
 #if 0
 	printf("\nin setup sub[%d] freq = %s\nfrom pitch= %s\n",
@@ -3,7 +3,8 @@
 
 #include "simd.h"
 #include "SimdBlocks.h"
-#include "IIRDecimator.h"
+#include "PolyApprox_4.h"
+#include "PolyphaseDecimator.h"
 
 /**
  * SIMD FM VCO block
@@ -27,7 +28,6 @@ public:
 #if 1
         int bufferIndex;
 
-        __m128 twoPi = {_mm_set_ps1(2 * 3.141592653589793238)};
         float_4 phaseMod = (feedback * lastOutput);
         phaseMod += fmInput;
 
@@ -36,7 +36,7 @@ public:
             phaseAcc += normalizedFreq;
             phaseAcc = SimdBlocks::wrapPhase01(phaseAcc);
             float_4 phase = SimdBlocks::wrapPhase01(phaseAcc + phaseMod);
-            float_4 s = SimdBlocks::sinTwoPi(phase * twoPi);
+            float_4 s = PolyApprox_4::sin2pi<PolyApprox_4::Precision::Low>(phase);
             s *= 5;
             buffer[bufferIndex] = s;
         }
@@ -118,12 +118,10 @@ public:
         phaseAcc = SimdBlocks::wrapPhase01(phaseAcc);
         phaseAcc = SimdBlocks::ifelse(syncNow, float_4::zero(), phaseAcc);
 
-        float_4 twoPi (2 * 3.141592653589793238f);
-
         float_4 phase = SimdBlocks::wrapPhase01(phaseAcc + phaseModulation);
         if (waveform == WaveForm::Fold) {
 
-            s = SimdBlocks::sinTwoPi(phase * twoPi);
+            s = PolyApprox_4::sin2pi<PolyApprox_4::Precision::Low>(phase);
             s *= correctedWaveShapeMultiplier;
             s = SimdBlocks::fold(s);
         } else if (waveform == WaveForm::SawTri) {
@@ -133,7 +131,7 @@ public:
             simd_assertLE(x, float_4(1));
             s = SimdBlocks::ifelse( x < k, x * aLeft,  aRight * x + bRight);
         } else if (waveform == WaveForm::Sine) {
-            s = SimdBlocks::sinTwoPi(phase * twoPi);
+            s = PolyApprox_4::sin2pi<PolyApprox_4::Precision::Low>(phase);
         } else {
             s = 0;
         }
@@ -166,7 +164,7 @@ public:
 private:
     float_4 phaseAcc = float_4::zero();
     float_4 lastSyncValue = float_4::zero();
-    IIRDecimator<float_4> downsampler;
+    PolyphaseDecimator<float_4> downsampler;
 
     bool syncEnabled = false;
 };
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cmath>
+
+/**
+ * State for anti-derivative anti-aliasing (ADAA), first or second order.
+ * Holds the previous input, and the anti-derivative at that input.
+ */
+class ADAAState
+{
+public:
+    double lastX = 0;
+
+    /**
+     * F(lastX) for first order, F2(lastX) for second order.
+     */
+    double lastF = 0;
+
+    /**
+     * Second order only: the input before lastX, and the
+     * divided difference of F2 between the two.
+     */
+    double lastX2 = 0;
+    double lastD = 0;
+
+    /**
+     * Which shape and order lastF was computed with.
+     * When either changes we must re-evaluate it.
+     */
+    int shapeId = -1;
+    int order = 0;
+};
+
+/**
+ * First order ADAA.
+ *
+ * Instead of evaluating the wave shaper f(x) at each sample, we take the average value of f
+ * over the straight line between the previous input and the current one:
+ *
+ *      y[n] = (F(x[n]) - F(x[n-1])) / (x[n] - x[n-1])
+ *
+ * where F is the anti-derivative of f. This is a little like running f at an infinite
+ * sample rate followed by a boxcar lowpass, so the aliasing from the sharp corners
+ * of clippers and folders is greatly reduced. The cost is a half sample of delay and
+ * a gentle high frequency roll-off.
+ *
+ * TShape must provide:
+ *      static const int id;
+ *      static double f(double x);     the wave shaper
+ *      static double F(double x);     its anti-derivative
+ *
+ * The math is in double, since F(x[n]) - F(x[n-1]) cancels most of the significant bits
+ * when the input is changing slowly.
+ */
+template <class TShape>
+class ADAA1
+{
+public:
+    ADAA1() = delete;       // we are only static
+
+    static void run(float* buffer, int numSamples, ADAAState& state)
+    {
+        if (state.shapeId != TShape::id || state.order != 1) {
+            state.lastF = TShape::F(state.lastX);
+            state.shapeId = TShape::id;
+            state.order = 1;
+        }
+
+        double lastX = state.lastX;
+        double lastF = state.lastF;
+        for (int i = 0; i < numSamples; ++i) {
+            const double x = buffer[i];
+            const double F = TShape::F(x);
+            const double dx = x - lastX;
+            double y;
+            if (std::abs(dx) > illConditionedDelta) {
+                y = (F - lastF) / dx;
+            } else {
+                // when the two inputs are too close the division falls apart,
+                // but then the answer is just f at the midpoint.
+                y = TShape::f(.5 * (x + lastX));
+            }
+            buffer[i] = float(y);
+            lastX = x;
+            lastF = F;
+        }
+        state.lastX = lastX;
+        state.lastF = lastF;
+    }
+
+private:
+    static constexpr double illConditionedDelta = 1e-5;
+};
+
+/**
+ * Second order ADAA.
+ *
+ * Averages f twice over the last three inputs, using the second anti-derivative F2:
+ *
+ *      D[n] = (F2(x[n]) - F2(x[n-1])) / (x[n] - x[n-1])
+ *      y[n] = 2 * (D[n] - D[n-1]) / (x[n] - x[n-2])
+ *
+ * This is like a triangle shaped lowpass instead of a boxcar, so the aliasing falls off
+ * much faster. The cost is a whole sample of delay, a little more high frequency roll-off,
+ * and evaluating F2, which is usually more work than F.
+ *
+ * TShape must provide everything ADAA1 needs, and:
+ *      static double F2(double x);    the anti-derivative of F
+ *
+ * Dividing by two differences makes this much more sensitive to rounding than ADAA1,
+ * so it switches to the limits at a larger input difference.
+ */
+template <class TShape>
+class ADAA2
+{
+public:
+    ADAA2() = delete;       // we are only static
+
+    static void run(float* buffer, int numSamples, ADAAState& state)
+    {
+        if (state.shapeId != TShape::id || state.order != 2) {
+            // start as if the input had been sitting still at lastX
+            state.lastX2 = state.lastX;
+            state.lastF = TShape::F2(state.lastX);
+            state.lastD = TShape::F(state.lastX);
+            state.shapeId = TShape::id;
+            state.order = 2;
+        }
+
+        double lastX = state.lastX;
+        double lastX2 = state.lastX2;
+        double lastF = state.lastF;
+        double lastD = state.lastD;
+        for (int i = 0; i < numSamples; ++i) {
+            const double x = buffer[i];
+            const double F = TShape::F2(x);
+            const double dx = x - lastX;
+
+            // when the two inputs are too close, D is just F at the midpoint
+            const double D = (std::abs(dx) > illConditionedDelta) ?
+                (F - lastF) / dx :
+                TShape::F(.5 * (x + lastX));
+
+            const double dx2 = x - lastX2;
+            double y;
+            if (std::abs(dx2) > illConditionedDelta) {
+                y = 2 * (D - lastD) / dx2;
+            } else {
+                // x and lastX2 are the same, so use the limit as they come together
+                const double xBar = .5 * (x + lastX2);
+                const double delta = xBar - lastX;
+                if (std::abs(delta) > illConditionedDelta) {
+                    y = 2 * (TShape::F(xBar) + (lastF - TShape::F2(xBar)) / delta) / delta;
+                } else {
+                    y = TShape::f(.5 * (xBar + lastX));
+                }
+            }
+            buffer[i] = float(y);
+            lastX2 = lastX;
+            lastX = x;
+            lastF = F;
+            lastD = D;
+        }
+        state.lastX = lastX;
+        state.lastX2 = lastX2;
+        state.lastF = lastF;
+        state.lastD = lastD;
+    }
+
+private:
+    static constexpr double illConditionedDelta = 1e-4;
+};
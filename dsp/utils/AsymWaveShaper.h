@@ -4,6 +4,7 @@
 #include <map>
 #include <vector>
 #include "LookupTable.h"
+#include "LookupTable_4.h"
 
 using Spline = std::vector< std::pair<double, double> >;
 
@@ -82,6 +83,20 @@ public:
         return y;
     }
 
+    /**
+     * Same as the scalar lookup, but each lane has its own symmetry index.
+     */
+    float_4 lookup(float_4 x, const int* index) const
+    {
+        const float_4 x_scaled = rack::simd::clamp((x + 1) * float(iNumPoints / 2), float_4::zero(), float_4(iNumPoints - 1));
+        const LookupTableParams<float>* laneTables[4];
+        for (int i = 0; i < 4; ++i) {
+            assert(index[i] >= 0 && index[i] < iSymmetryTables);
+            laneTables[i] = tables + index[i];
+        }
+        return LookupTable_4::lookup(laneTables, x_scaled);
+    }
+
     static void genTableValues(const Spline& spline, int numPoints);
     static void genTable(int index, double symmetry);
     static Spline makeSplineRight(double symmetry);
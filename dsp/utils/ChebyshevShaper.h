@@ -0,0 +1,142 @@
+#pragma once
+
+#include <assert.h>
+
+#include "SimdBlocks.h"
+#include "simd.h"
+
+/**
+ * The ten Chebyshev waveshapers of Poly<double, 10>, mixed together,
+ * but in float or float_4.
+ *
+ * Poly makes x ** 1 .. x ** 10 and expands every polynomial, every sample.
+ * Here the harmonic gains are used directly as the coefficients of a
+ * Chebyshev series, and the whole mix is one pass of Clenshaw's recurrence:
+ * two multiply-adds per harmonic. Clenshaw is stable for |x| <= 1,
+ * so float is accurate enough (testChebyshevShaper checks it against Poly).
+ *
+ * Like Poly, the even harmonics have the DC removed that they would make
+ * from a sine of amplitude inputGain. That only depends on the gains and
+ * inputGain, so it is pre-combined into one constant term, which is only
+ * recomputed when one of them changes.
+ *
+ * T may be float or float_4. With float_4 each lane is a separate channel with
+ * its own inputGain, and all the lanes share the harmonic gains.
+ */
+template <typename T>
+class ChebyshevShaper
+{
+public:
+    static const int order = 10;
+    static_assert((order & 1) == 0, "run does two steps at a time");
+
+    /**
+     * index 0 is the fundamental, 1 the second harmonic, and so on.
+     */
+    void setGain(int index, float value);
+
+    /**
+     * The amplitude of the sine going in, used to find the DC.
+     */
+    void setInputGain(T gain);
+
+    /**
+     * x should be -1..1
+     */
+    T run(T x);
+
+private:
+    // coefficients[k] is the gain of Chebyshev polynomial k + 1
+    T coefficients[order] = {};
+
+    // the constant term: minus all the DC
+    T dc = 0;
+    T inputGain = 0;
+    bool dirty = true;
+
+    void updateDC();
+
+    static bool differs(float a, float b)
+    {
+        return a != b;
+    }
+    static bool differs(float_4 a, float_4 b)
+    {
+        return rack::simd::movemask(a != b);
+    }
+};
+
+template <typename T>
+inline void ChebyshevShaper<T>::setGain(int index, float value)
+{
+    assert(index >= 0 && index < order);
+    const T x = value;
+    if (differs(x, coefficients[index])) {
+        coefficients[index] = x;
+        dirty = true;
+    }
+}
+
+template <typename T>
+inline void ChebyshevShaper<T>::setInputGain(T gain)
+{
+    if (differs(gain, inputGain)) {
+        inputGain = gain;
+        dirty = true;
+    }
+}
+
+template <typename T>
+inline T ChebyshevShaper<T>::run(T x)
+{
+    if (dirty) {
+        updateDC();
+    }
+
+    // b[k] = c[k] + 2x * b[k + 1] - b[k + 2], from the top down,
+    // and the result is c[-1] + x * b[0] - b[1].
+    // This is done two steps at a time, with both new b's from the last two:
+    // b[k - 1] = c[k - 1] + 2x * c[k] + (4x**2 - 1) * b[k + 1] - 2x * b[k + 2]
+    // That halves the length of the dependency chain, which is what limits
+    // the speed for one bank.
+    const T twoX = x + x;
+    const T q = twoX * twoX - T(1);
+    T b1 = coefficients[order - 1];  // b[k + 1]
+    T b2 = 0;                        // b[k + 2]
+    for (int k = order - 2; k >= 2; k -= 2) {
+        const T b0 = (coefficients[k] - b2) + twoX * b1;
+        const T bm1 = (coefficients[k - 1] + twoX * coefficients[k] - twoX * b2) + q * b1;
+        b2 = b0;
+        b1 = bm1;
+    }
+
+    // now b1 is b[1], and b2 is b[2]. Do the last step and the result together.
+    return (dc + x * coefficients[0] - x * b2) + (twoX * x - T(1)) * b1;
+}
+
+template <typename T>
+inline void ChebyshevShaper<T>::updateDC()
+{
+    dirty = false;
+
+    // The same sums as Poly::calcDC: Wn is the mean of sin ** n over a cycle
+    const T g2 = inputGain * inputGain;
+    const T s2 = g2 * T(2.0 / 4.0);
+    const T s4 = g2 * s2 * T(3.0 / 4.0);
+    const T s6 = g2 * s4 * T(5.0 / 6.0);
+    const T s8 = g2 * s6 * T(7.0 / 8.0);
+    const T s10 = g2 * s8 * T(9.0 / 10.0);
+
+    // The mean of each even polynomial, which includes its constant term (+-1)
+    const T dc2 = T(2) * s2 - T(1);
+    const T dc4 = T(8) * s4 - T(8) * s2 + T(1);
+    const T dc6 = T(32) * s6 - T(48) * s4 + T(18) * s2 - T(1);
+    const T dc8 = T(128) * s8 - T(256) * s6 + T(160) * s4 - T(32) * s2 + T(1);
+    const T dc10 = T(512) * s10 - T(1280) * s8 + T(1120) * s6 - T(400) * s4 + T(50) * s2 - T(1);
+
+    dc = T(0) - (coefficients[1] * dc2 +
+                 coefficients[3] * dc4 +
+                 coefficients[5] * dc6 +
+                 coefficients[7] * dc8 +
+                 coefficients[9] * dc10);
+}
@@ -5,9 +5,12 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 
 #include "MultiLag2.h"
+#include "PolyApprox_4.h"
 #include "SqMath.h"
 
 class Cmprsr {
@@ -26,8 +29,44 @@ public:
         NUM_RATIOS
     };
 
+    /**
+     * The different ways the envelope is turned into gain.
+     */
+    enum class CurveType {
+        Limit,
+        HardKnee,
+        Table
+    };
+
     float_4 step(float_4);
     float_4 stepPoly(float_4);
+
+    /**
+     * Same as step, but with the curve and envelope follower picked at compile time.
+     * Composites that run all their banks with the same settings call this
+     * directly, so nothing is called through a pointer.
+     */
+    template <CurveType CURVE, bool REDUCE_DISTORTION>
+    float_4 stepKernel(float_4);
+
+    /**
+     * The lookahead version of stepKernel. The audio is delayed by the lookahead,
+     * and the detector looks at a window of that many samples ahead of it.
+     * The gain is only worked out once every lookaheadBlockSize samples,
+     * and ramped in between.
+     * If RMS the detector is the RMS of the window, otherwise its peak.
+     * setLookahead must have been called first.
+     */
+    template <CurveType CURVE, bool RMS>
+    float_4 stepLookahead(float_4);
+
+    /**
+     * The input that went with the last output from stepLookahead.
+     * For mixing in dry signal.
+     */
+    float_4 getDelayedInput() const;
+    CurveType getCurveType() const;
+    bool getReduceDistortion() const;
     void setTimes(float attackMs, float releaseMs, float sampleTime, bool enableDistortionReduction);
     void setThreshold(float th);
     void setCurve(Ratios);
@@ -38,6 +77,26 @@ public:
 
     void setNumChannels(int);
 
+    /**
+     * Gain is computed once per block of this many samples in lookahead mode.
+     */
+    static const int lookaheadBlockSize = 16;
+
+    /**
+     * Big enough for the longest lookahead Compressor2 offers (5 ms)
+     * at 192k. Above that setLookahead clamps to this.
+     */
+    static const int maxLookahead = 1024;
+
+    /**
+     * samples will be rounded to a whole number of blocks, and is at least two blocks.
+     * It is clamped to maxLookahead, so check getLookahead to see what you got.
+     * Nothing changes if called with the same values again.
+     */
+    void setLookahead(int samples, bool rms);
+    int getLookahead() const;
+    bool getLookaheadRMS() const;
+
     const MultiLag2& _lag() const;
     static const std::vector<std::string>& ratios();
     static const std::vector<std::string>& ratiosLong();
@@ -61,10 +120,45 @@ private:
 
     int ratioIndex[4] = { 0 };
     Ratios ratio[4] = { Ratios::HardLimit, Ratios::HardLimit, Ratios::HardLimit, Ratios::HardLimit };
+
+    /**
+     * Above threshold a hard knee curve is just gain = level ** hardKneeExponent,
+     * so we can compute it four at a time instead of using the lookup table.
+     * Zero for the ratios that are not hard knee.
+     */
+    float_4 hardKneeExponent = float_4(0);
+    float_4 activeLanes = SimdBlocks::maskTrue();
     //int ratioIndex = 0;
    // Ratios ratio = Ratios::HardLimit;
     int maxChannel = 3;
 
+    /**
+     * Lookahead state. The window is the last lookaheadBlocks blocks,
+     * the same length as the delay. That way every sample is covered by
+     * the window at both ends of the gain ramp it is played under.
+     */
+    float_4 delayLine[maxLookahead];
+    float_4 blockLevels[maxLookahead / lookaheadBlockSize];
+    float_4 blockAccumulator = 0;
+    float_4 blockEnvelope = 0;
+    float_4 blockAttackL = 0;
+    float_4 blockReleaseL = 0;
+    float_4 targetGain = 1;
+    float_4 gainStep = 0;
+    float_4 delayedInput = 0;
+    int lookahead = 0;
+    int lookaheadBlocks = 0;
+    bool lookaheadRMS = false;
+    int delayIndex = 0;
+    int blockIndex = 0;
+    int blockPhase = 0;
+
+    template <CurveType CURVE>
+    float_4 computeGain(float_4 envelope) const;
+
+    template <CurveType CURVE, bool RMS>
+    void endLookaheadBlock();
+
 #ifdef _SQATOMIC
     std::atomic<float_4> gain_;
 #else
@@ -74,12 +168,10 @@ private:
     static CompCurves::LookupPtr ratioCurves[int(Ratios::NUM_RATIOS)];
 
     using processFunction = float_4 (Cmprsr::*)(float_4 input);
-    processFunction procFun = &Cmprsr::stepGeneric;
+    processFunction procFun = &Cmprsr::stepKernel<CurveType::Limit, false>;
     void updateProcFun();
 
-    float_4 stepGeneric(float_4);
-    float_4 step1NoDistComp(float_4);
-    float_4 step1Comp(float_4);
+    static float getHardKneeExponent(Ratios);
 };
 
 inline float_4 Cmprsr::getGain() const {
@@ -88,23 +180,38 @@ inline float_4 Cmprsr::getGain() const {
 
 inline void Cmprsr::setNumChannels(int ch) {
     maxChannel = ch - 1;
+    activeLanes = float_4(0, 1, 2, 3) <= float_4(float(maxChannel));
     updateProcFun();
 }
 
 
 // only called for non poly
 inline void Cmprsr::updateProcFun() {
-    // printf("in update, max = %d\n", maxChannel);
-    procFun = &Cmprsr::stepGeneric;
-    if (maxChannel == 0 && (ratio[0] != Ratios::HardLimit)) {
-        if (reduceDistortion) {
-            procFun = &Cmprsr::step1NoDistComp;
-        } else {
-            procFun = &Cmprsr::step1Comp;
-        }
+    const CurveType curve = getCurveType();
+    switch (curve) {
+        case CurveType::Limit:
+            procFun = reduceDistortion ? &Cmprsr::stepKernel<CurveType::Limit, true> : &Cmprsr::stepKernel<CurveType::Limit, false>;
+            break;
+        case CurveType::HardKnee:
+            procFun = reduceDistortion ? &Cmprsr::stepKernel<CurveType::HardKnee, true> : &Cmprsr::stepKernel<CurveType::HardKnee, false>;
+            break;
+        case CurveType::Table:
+            procFun = reduceDistortion ? &Cmprsr::stepKernel<CurveType::Table, true> : &Cmprsr::stepKernel<CurveType::Table, false>;
+            break;
     }
 }
 
+inline Cmprsr::CurveType Cmprsr::getCurveType() const {
+    if (ratio[0] == Ratios::HardLimit) {
+        return CurveType::Limit;
+    }
+    return (hardKneeExponent[0] != 0) ? CurveType::HardKnee : CurveType::Table;
+}
+
+inline bool Cmprsr::getReduceDistortion() const {
+    return reduceDistortion;
+}
+
 inline void Cmprsr::setCurve(Ratios r) {
     ratio[0] = r;
     ratio[1] = r;
@@ -115,6 +222,9 @@ inline void Cmprsr::setCurve(Ratios r) {
     ratioIndex[1] = int(r);
     ratioIndex[2] = int(r);
     ratioIndex[3] = int(r);
+
+    hardKneeExponent = float_4(getHardKneeExponent(r));
+    updateProcFun();
 }
 
 inline void Cmprsr::setCurvePoly(const Ratios* r) {
@@ -127,80 +237,170 @@ inline void Cmprsr::setCurvePoly(const Ratios* r) {
     ratioIndex[1] = int(r[1]);
     ratioIndex[2] = int(r[2]);
     ratioIndex[3] = int(r[3]);
+
+    for (int i = 0; i < 4; ++i) {
+        hardKneeExponent[i] = getHardKneeExponent(r[i]);
+    }
+}
+
+inline float Cmprsr::getHardKneeExponent(Ratios r) {
+    switch (r) {
+        case Ratios::_2_1_hard:
+            return 1.f / 2.f - 1;
+        case Ratios::_4_1_hard:
+            return 1.f / 4.f - 1;
+        case Ratios::_8_1_hard:
+            return 1.f / 8.f - 1;
+        case Ratios::_20_1_hard:
+            return 1.f / 20.f - 1;
+        default:
+            return 0;
+    }
 }
 
 inline float_4 Cmprsr::step(float_4 input) {
     return (this->*procFun)(input);
 }
 
-// only non poly
-inline float_4 Cmprsr::step1Comp(float_4 input) {
+// only non-poly
+template <Cmprsr::CurveType CURVE, bool REDUCE_DISTORTION>
+inline float_4 Cmprsr::stepKernel(float_4 input) {
     assert(wasInit());
-    //printf("step1Comp gain = %s\n", toStr(gain_).c_str());
-    lag.step(rack::simd::abs(input));
-    float_4 envelope = lag.get();
 
-    CompCurves::LookupPtr table = ratioCurves[ratioIndex[0]];
-    //   gain = float_4(1);
-    const float_4 level = envelope * invThreshold;
+    float_4 envelope;
+    lag.step(rack::simd::abs(input));
+    if (REDUCE_DISTORTION) {
+        attackFilter.step(lag.get());
+        envelope = attackFilter.get();
+    } else {
+        envelope = lag.get();
+    }
 
-    // gain[0] = CompCurves::lookup(table, level[0]);
-    float_4 t = gain_;
-    t[0] = CompCurves::lookup(table, level[0]);
-    gain_ = t;
+    gain_ = computeGain<CURVE>(envelope);
     return gain_ * input;
 }
 
-// only non poly
-inline float_4 Cmprsr::step1NoDistComp(float_4 input) {
+/**
+ * The gain for an envelope. Lanes past the last channel keep the gain they had.
+ */
+template <Cmprsr::CurveType CURVE>
+inline float_4 Cmprsr::computeGain(float_4 envelope) const {
+    switch (CURVE) {
+        case CurveType::Limit: {
+            float_4 reductionGain = threshold / envelope;
+            return SimdBlocks::ifelse(envelope > threshold, reductionGain, 1);
+        }
+        case CurveType::HardKnee: {
+            // below threshold level is clamped to 1, so gain is 1
+            const float_4 level = SimdBlocks::max(envelope * invThreshold, float_4(1));
+            const float_4 gain = PolyApprox_4::exp2<PolyApprox_4::Precision::Low>(
+                hardKneeExponent * PolyApprox_4::log2<PolyApprox_4::Precision::Low>(level));
+            return SimdBlocks::ifelse(activeLanes, gain, gain_);
+        }
+        case CurveType::Table: {
+            CompCurves::LookupPtr table = ratioCurves[ratioIndex[0]];
+            const float_4 level = envelope * invThreshold;
+
+            float_4 t = gain_;
+            for (int i = 0; i <= maxChannel; ++i) {
+                t[i] = CompCurves::lookup(table, level[i]);
+            }
+            return t;
+        }
+    }
+    assert(false);
+    return gain_;
+}
+
+template <Cmprsr::CurveType CURVE, bool RMS>
+inline float_4 Cmprsr::stepLookahead(float_4 input) {
     assert(wasInit());
+    assert(lookahead > 0);
 
-    //printf("step1NoDist gain = %s\n", toStr(gain_).c_str());
-    lag.step(rack::simd::abs(input));
-    attackFilter.step(lag.get());
-    float_4 envelope = attackFilter.get();
+    // reduce this block down to one level: the peak, or the sum of squares
+    if (RMS) {
+        blockAccumulator += input * input;
+    } else {
+        blockAccumulator = SimdBlocks::max(blockAccumulator, rack::simd::abs(input));
+    }
 
-    CompCurves::LookupPtr table = ratioCurves[ratioIndex[0]];
+    delayedInput = delayLine[delayIndex];
+    delayLine[delayIndex] = input;
+    if (++delayIndex == lookahead) {
+        delayIndex = 0;
+    }
 
-    const float_4 level = envelope * invThreshold;
+    gain_ += gainStep;
+    const float_4 output = delayedInput * gain_;
 
-    float_4 t = gain_;
-    t[0] = CompCurves::lookup(table, level[0]);
-    gain_ = t;
-    return gain_ * input;
+    if (++blockPhase == lookaheadBlockSize) {
+        blockPhase = 0;
+        endLookaheadBlock<CURVE, RMS>();
+    }
+    return output;
 }
 
-// only non-poly
-inline float_4 Cmprsr::stepGeneric(float_4 input) {
-    assert(wasInit());
+template <Cmprsr::CurveType CURVE, bool RMS>
+inline void Cmprsr::endLookaheadBlock() {
+    blockLevels[blockIndex] = blockAccumulator;
+    if (++blockIndex == lookaheadBlocks) {
+        blockIndex = 0;
+    }
+    blockAccumulator = 0;
 
-    float_4 envelope;
-    if (reduceDistortion) {
-        lag.step(rack::simd::abs(input));
-        attackFilter.step(lag.get());
-        envelope = attackFilter.get();
-    } else {
-        lag.step(rack::simd::abs(input));
-        envelope = lag.get();
+    float_4 level = blockLevels[0];
+    for (int i = 1; i < lookaheadBlocks; ++i) {
+        level = RMS ? level + blockLevels[i] : SimdBlocks::max(level, blockLevels[i]);
+    }
+    if (RMS) {
+        level = rack::simd::sqrt(level * (1.f / float(lookahead)));
     }
 
-    if (ratio[0] == Ratios::HardLimit) {
-        float_4 reductionGain = threshold / envelope;
-        gain_ = SimdBlocks::ifelse(envelope > threshold, reductionGain, 1);
-        return gain_ * input;
-    } else {
-        CompCurves::LookupPtr table = ratioCurves[ratioIndex[0]];
-        const float_4 level = envelope * invThreshold;
+    // the attack and release, run once per block
+    const float_4 l = SimdBlocks::ifelse(level >= blockEnvelope, blockAttackL, blockReleaseL);
+    blockEnvelope = level + l * (blockEnvelope - level);
 
-        float_4 t = gain_;
-        for (int i = 0; i < 4; ++i) {
-            if (i <= maxChannel) {
-                t[i] = CompCurves::lookup(table, level[i]);
-            }
-        }
-        gain_ = t;
-        return gain_ * input;
+    // snap to the end of the last ramp, so rounding doesn't build up
+    gain_ = targetGain;
+    targetGain = computeGain<CURVE>(blockEnvelope);
+    gainStep = (targetGain - gain_) * (1.f / float(lookaheadBlockSize));
+}
+
+inline float_4 Cmprsr::getDelayedInput() const {
+    return delayedInput;
+}
+
+inline int Cmprsr::getLookahead() const {
+    return lookahead;
+}
+
+inline bool Cmprsr::getLookaheadRMS() const {
+    return lookaheadRMS;
+}
+
+inline void Cmprsr::setLookahead(int samples, bool rms) {
+    const int minBlocks = 2;
+    const int blocks = std::max(minBlocks, std::min(int(maxLookahead), samples) / lookaheadBlockSize);
+    if (blocks * lookaheadBlockSize == lookahead && rms == lookaheadRMS) {
+        return;
     }
+
+    lookahead = blocks * lookaheadBlockSize;
+    lookaheadBlocks = blocks;
+    lookaheadRMS = rms;
+    for (int i = 0; i < lookahead; ++i) {
+        delayLine[i] = 0;
+    }
+    for (int i = 0; i < lookaheadBlocks; ++i) {
+        blockLevels[i] = 0;
+    }
+    blockAccumulator = 0;
+    blockEnvelope = 0;
+    delayIndex = 0;
+    blockIndex = 0;
+    blockPhase = 0;
+    targetGain = gain_;
+    gainStep = 0;
 }
 
 // only non-poly
@@ -289,6 +489,10 @@ inline void Cmprsr::setTimes(float attackMs, float releaseMs, float sampleTime,
     const float releaseHz = 1000.f / (releaseMs * correction);
     const float normRelease = releaseHz * sampleTime;
 
+    // a one pole filter run once per block is the per sample one to the power of the block size
+    blockReleaseL = std::pow(LowpassFilter<float>::computeLfromFs(normRelease), float(lookaheadBlockSize));
+    blockAttackL = 0;
+
     if (attackMs < .1) {
         reduceDistortion = false;  // no way to do this at zero attack
         lag.setInstantAttack(true);
@@ -300,6 +504,7 @@ inline void Cmprsr::setTimes(float attackMs, float releaseMs, float sampleTime,
         lag.setInstantAttack(false);
 
         const float normAttack = attackHz * sampleTime;
+        blockAttackL = std::pow(LowpassFilter<float>::computeLfromFs(normAttack), float(lookaheadBlockSize));
         if (enableDistortionReduction) {
             lag.setAttack(normAttack * 4);
             attackFilter.setCutoff(normAttack * 1);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "LookupTable.h"
+#include "simd.h"
+
+/**
+ * float_4 versions of LookupTable<float>::lookup.
+ *
+ * The index math and interpolation are done four at a time.
+ * SSE has no gather, so the table entries are still fetched one lane at a time.
+ *
+ * Inputs outside the table domain are clamped, like lookup with allowOutsideDomain = true.
+ */
+class LookupTable_4
+{
+public:
+    LookupTable_4() = delete;       // we are only static
+
+    static float_4 lookup(const LookupTableParams<float>& params, float_4 input);
+
+    /**
+     * Each lane uses its own table.
+     * All four tables must have the same domain and number of bins.
+     */
+    static float_4 lookup(const LookupTableParams<float>* const* laneParams, float_4 input);
+
+private:
+    static float_4 scale(const LookupTableParams<float>& params, float_4 input, int32_4& index);
+};
+
+inline float_4 LookupTable_4::scale(const LookupTableParams<float>& params, float_4 input, int32_4& index)
+{
+    assert(params.isValid());
+    input = rack::simd::clamp(input, float_4(params.xMin), float_4(params.xMax));
+    const float_4 scaledInput = input * params.a + params.b;
+
+    // truncate, same as cvtt in the scalar version
+    index = int32_4(scaledInput);
+    return rack::simd::clamp(scaledInput - float_4(index), float_4::zero(), float_4(1));
+}
+
+inline float_4 LookupTable_4::lookup(const LookupTableParams<float>& params, float_4 input)
+{
+    int32_4 index;
+    const float_4 fraction = scale(params, input, index);
+
+    float_4 y0;
+    float_4 slope;
+    for (int i = 0; i < 4; ++i) {
+        assert(index[i] >= 0 && index[i] <= params.numBins_i);
+        const float* entry = params.entries + (2 * index[i]);
+        y0[i] = entry[0];
+        slope[i] = entry[1];
+    }
+    return y0 + fraction * slope;
+}
+
+inline float_4 LookupTable_4::lookup(const LookupTableParams<float>* const* laneParams, float_4 input)
+{
+    int32_4 index;
+    const float_4 fraction = scale(*laneParams[0], input, index);
+
+    float_4 y0;
+    float_4 slope;
+    for (int i = 0; i < 4; ++i) {
+        const LookupTableParams<float>& params = *laneParams[i];
+        assert(params.numBins_i == laneParams[0]->numBins_i);
+        assert(index[i] >= 0 && index[i] <= params.numBins_i);
+        const float* entry = params.entries + (2 * index[i]);
+        y0[i] = entry[0];
+        slope[i] = entry[1];
+    }
+    return y0 + fraction * slope;
+}
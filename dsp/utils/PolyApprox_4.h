@@ -0,0 +1,258 @@
+#pragma once
+
+#include "SimdBlocks.h"
+#include "simd.h"
+
+/**
+ * Branch-free float_4 approximations of the common audio math functions.
+ *
+ * Everything is a minimax polynomial (Remez exchange, fit in double precision)
+ * after an exact range reduction, so there are no tables and no lane-by-lane gathers.
+ *
+ * Each function comes in three precision tiers. The errors below are the max error
+ * of the polynomial on its reduced range. In float the High tier, and Medium log2,
+ * are limited by rounding to a few ulp. testPolyApprox.cpp checks the float errors.
+ *
+ *                   Low           Medium        High
+ *   sin2pi (abs)    6.8e-5        5.9e-7        3.3e-9
+ *   exp2   (rel)    7.5e-5        2.6e-6        7.5e-8
+ *   log2   (abs)    5.6e-6        3.0e-8        1.7e-10
+ *   tanh   (abs)    4e-5          1.3e-6        1.3e-7 (measured)
+ *   dB conversions  follow exp2 and log2
+ *
+ * Speed, in a tight loop at -O3: exp2 is about four times faster than four calls to
+ * ObjectCache::getExp2Ex, and sin2pi costs about the same as SimdBlocks::sinTwoPi.
+ * tanh is slower than LookupTable_4 on the getTanh5 table, so use it where the table's
+ * limited domain or accuracy is a problem, not for speed.
+ *
+ * For reference, one cent of pitch is a relative error of 5.8e-4, and
+ * .001 dB is a relative error of 1.2e-4.
+ */
+class PolyApprox_4
+{
+public:
+    PolyApprox_4() = delete;       // we are only static
+
+    enum class Precision
+    {
+        Low,
+        Medium,
+        High
+    };
+
+    /**
+     * sin(2 * pi * x), for any x.
+     * Unlike SimdBlocks::sinTwoPi, x is in cycles, not radians, and it works
+     * for any |x| < 2 ** 31.
+     */
+    template <Precision P = Precision::Medium>
+    static float_4 sin2pi(float_4 x);
+
+    /**
+     * 2 ** x. x is clamped to -126..126, so the result is always a normal float.
+     */
+    template <Precision P = Precision::Medium>
+    static float_4 exp2(float_4 x);
+
+    /**
+     * log base 2 of x.
+     * x must be a positive, normal float.
+     */
+    template <Precision P = Precision::Medium>
+    static float_4 log2(float_4 x);
+
+    template <Precision P = Precision::Medium>
+    static float_4 tanh(float_4 x);
+
+    /**
+     * decibels to voltage gain, same as AudioMath::gainFromDb
+     */
+    template <Precision P = Precision::Medium>
+    static float_4 gainFromDb(float_4 db);
+
+    /**
+     * voltage gain to decibels, same as AudioMath::db.
+     * gains below 1e-30 are clamped.
+     */
+    template <Precision P = Precision::Medium>
+    static float_4 db(float_4 gain);
+
+    /**
+     * Equal power pan law, the same curves as the mixers' pan lookup tables.
+     * pan goes from -1 (all left) to 1 (all right).
+     * returns the left gain in lane 0 and the right gain in lane 1.
+     */
+    static float_4 panGains(float pan);
+
+    /**
+     * The same pan law, for four pans at once.
+     */
+    static void panGains(float_4 pan, float_4& left, float_4& right);
+
+private:
+    /**
+     * floor using truncating conversion, so there are no per-lane calls.
+     * good for |x| < 2 ** 31
+     */
+    static float_4 floor(float_4 x);
+};
+
+inline float_4 PolyApprox_4::floor(float_4 x)
+{
+    const float_4 truncated = float_4(_mm_cvtepi32_ps(_mm_cvttps_epi32(x.v)));
+
+    // truncation rounds negative numbers up, so move those down one
+    const float_4 tooBig = truncated > x;
+    return truncated - float_4(_mm_and_ps(tooBig.v, _mm_set1_ps(1)));
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::sin2pi(float_4 x)
+{
+    // reduce to -.5 .. .5 cycles
+    float_4 r = x - floor(x + float_4(.5f));
+
+    // then fold to -.25 .. .25, where sin is odd and monotonic
+    r = SimdBlocks::ifelse(r > float_4(.25f), float_4(.5f) - r, r);
+    r = SimdBlocks::ifelse(r < float_4(-.25f), float_4(-.5f) - r, r);
+
+    const float_4 r2 = r * r;
+    float_4 p;
+    if (P == Precision::Low) {
+        p = float_4(73.58551475358833f);
+        p = p * r2 + float_4(-41.095242688673544f);
+        p = p * r2 + float_4(6.2812800766395025f);
+    } else if (P == Precision::Medium) {
+        p = float_4(-70.99343328283771f);
+        p = p * r2 + float_4(81.34076888870632f);
+        p = p * r2 + float_4(-41.33714237112285f);
+        p = p * r2 + float_4(6.283164044302507f);
+    } else {
+        p = float_4(39.536706079069f);
+        p = p * r2 + float_4(-76.54978229540383f);
+        p = p * r2 + float_4(81.60100407334201f);
+        p = p * r2 + float_4(-41.34165503141758f);
+        p = p * r2 + float_4(6.283185160089484f);
+    }
+    return p * r;
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::exp2(float_4 x)
+{
+    x = SimdBlocks::max(x, float_4(-126));
+    x = SimdBlocks::min(x, float_4(126));
+
+    const float_4 xi = floor(x);
+    const float_4 xf = x - xi;
+
+    // 2 ** xi, made by putting xi directly into the exponent bits
+    const __m128i exponent = _mm_add_epi32(_mm_cvttps_epi32(xi.v), _mm_set1_epi32(127));
+    const float_4 scale = float_4(_mm_castsi128_ps(_mm_slli_epi32(exponent, 23)));
+
+    // 2 ** xf, 0 <= xf < 1
+    float_4 p;
+    if (P == Precision::Low) {
+        p = float_4(0.07802452266443176f);
+        p = p * xf + float_4(0.22606715539313021f);
+        p = p * xf + float_4(0.695833540506448f);
+        p = p * xf + float_4(0.99992521856401f);
+    } else if (P == Precision::Medium) {
+        p = float_4(0.013534167911694569f);
+        p = p * xf + float_4(0.0520114606190554f);
+        p = p * xf + float_4(0.2414427568861899f);
+        p = p * xf + float_4(0.693003834471064f);
+        p = p * xf + float_4(1.0000025933706653f);
+    } else {
+        p = float_4(0.0018775766733667028f);
+        p = p * xf + float_4(0.00898934009471393f);
+        p = p * xf + float_4(0.055826318050039916f);
+        p = p * xf + float_4(0.24015361704533342f);
+        p = p * xf + float_4(0.6931530732000758f);
+        p = p * xf + float_4(0.9999999250635297f);
+    }
+    return p * scale;
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::log2(float_4 x)
+{
+    simd_assertGT(x, float_4(0));
+    const __m128i bits = _mm_castps_si128(x.v);
+
+    // split x into exponent and a mantissa m, 1 <= m < 2
+    const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    const __m128i mantissaBits = _mm_or_si128(
+        _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+        _mm_set1_epi32(0x3f800000));
+    float_4 m = float_4(_mm_castsi128_ps(mantissaBits));
+    float_4 e = float_4(_mm_cvtepi32_ps(exponent));
+
+    // move m into sqrt(.5) .. sqrt(2), so it is centered on one
+    const float_4 big = m > float_4(1.41421356f);
+    m = SimdBlocks::ifelse(big, m * float_4(.5f), m);
+    e = SimdBlocks::ifelse(big, e + float_4(1), e);
+
+    // log2(m) = log2((1 + s) / (1 - s)), which is odd in s
+    const float_4 s = (m - float_4(1)) / (m + float_4(1));
+    const float_4 s2 = s * s;
+    float_4 p;
+    if (P == Precision::Low) {
+        p = float_4(0.9835345091049235f);
+        p = p * s2 + float_4(2.8852285696114786f);
+    } else if (P == Precision::Medium) {
+        p = float_4(0.5989738856819722f);
+        p = p * s2 + float_4(0.9614708089541963f);
+        p = p * s2 + float_4(2.885391289368926f);
+    } else {
+        p = float_4(0.43425594126640527f);
+        p = p * s2 + float_4(0.576584541404453f);
+        p = p * s2 + float_4(0.961800759210811f);
+        p = p * s2 + float_4(2.8853900727521617f);
+    }
+    return p * s + e;
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::tanh(float_4 x)
+{
+    // tanh(9) is 1 to within float precision, and this keeps exp2 in range
+    x = SimdBlocks::max(x, float_4(-9));
+    x = SimdBlocks::min(x, float_4(9));
+
+    // tanh(x) = (e ** 2x - 1) / (e ** 2x + 1)
+    const float_4 e2x = exp2<P>(x * float_4(2.8853900817779268f));
+    return (e2x - float_4(1)) / (e2x + float_4(1));
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::gainFromDb(float_4 db)
+{
+    // log2(10) / 20
+    return exp2<P>(db * float_4(0.16609640474436813f));
+}
+
+template <PolyApprox_4::Precision P>
+inline float_4 PolyApprox_4::db(float_4 gain)
+{
+    gain = SimdBlocks::max(gain, float_4(1e-30f));
+
+    // 20 / log2(10)
+    return log2<P>(gain) * float_4(6.0205999132796239f);
+}
+
+inline float_4 PolyApprox_4::panGains(float pan)
+{
+    assert(pan >= -1 && pan <= 1);
+
+    // right = sin((pan + 1) * pi / 4), left is the same curve backwards
+    const float x = (pan + 1) * .125f;
+    return sin2pi<Precision::Medium>(float_4(.25f - x, x, 0, 0));
+}
+
+inline void PolyApprox_4::panGains(float_4 pan, float_4& left, float_4& right)
+{
+    const float_4 x = (pan + float_4(1)) * float_4(.125f);
+    left = sin2pi<Precision::Medium>(float_4(.25f) - x);
+    right = sin2pi<Precision::Medium>(x);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "HalfBandFilter.h"
+
+#include <assert.h>
+
+/**
+ * Inverse of the PolyphaseDecimator.
+ * Drop in replacement for IIRUpsampler, but also works with float_4.
+ *
+ * Takes a single sample at a lower sample rate, and converts it
+ * to a buffer of data at the higher sample rate, one 2X half-band stage at a time.
+ * The half-band filters interpolate directly, so there is no zero packing
+ * and no gain correction.
+ *
+ * Oversample factor must be 1, 2, 4, 8 or 16.
+ */
+template <typename T>
+class PolyphaseUpsampler
+{
+public:
+    /**
+     * Will set the oversample factor.
+     * Cheap to call if the factor has not changed.
+     */
+    void setup(int oversampleFactor)
+    {
+        if (oversampleFactor != oversample) {
+            oversample = oversampleFactor;
+            numStages = 0;
+            for (int i = oversample; i > 1; i /= 2) {
+                assert((i & 1) == 0);
+                ++numStages;
+            }
+            assert(numStages <= maxStages);
+            for (int i = 0; i < numStages; ++i) {
+                params[i] = &HalfBandParams<T>::forCascadeStage(i);
+                state[i] = HalfBandState<T>();
+            }
+        }
+    }
+
+    /**
+     * processes one sample of input. Output is a buffer of data at the
+     * higher sample rate. Buffer size is just the oversample amount.
+     */
+    void process(T * outputBuffer, T input)
+    {
+        if (numStages == 0) {
+            outputBuffer[0] = input;
+            return;
+        }
+
+        // ping-pong between a temp buffer and the output.
+        // Start in the right place so the last stage writes the output.
+        T temp[maxOversample / 2];
+        T* dest = (numStages & 1) ? outputBuffer : temp;
+        T* src = (numStages & 1) ? temp : outputBuffer;
+        src[0] = input;
+        int size = 1;
+        for (int stage = 0; stage < numStages; ++stage) {
+            HalfBandFilter<T>::interpolate(dest, src, size, state[stage], *params[stage]);
+            size *= 2;
+            T* t = src;
+            src = dest;
+            dest = t;
+        }
+        assert(size == oversample);
+    }
+
+private:
+    static const int maxStages = HalfBandParams<T>::maxCascadeStages;
+    static const int maxOversample = 1 << maxStages;
+
+    int oversample = -1;
+    int numStages = 0;
+
+    const HalfBandParams<T>* params[maxStages] = {nullptr};
+    HalfBandState<T> state[maxStages];
+};
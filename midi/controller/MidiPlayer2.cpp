@@ -175,12 +175,13 @@ bool MidiPlayer2::playOnce(double metricTime, float quantizeInterval)
   
                 // find a voice to play
                 MidiVoice* voice = voiceAssigner.getNext(note->pitchCV);
-                assert(voice);
-
-                // play the note
-                const double durationQuantized = TimeUtils::quantize(note->duration, quantizeInterval, false);  
-                double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
-                voice->playNote(note->pitchCV, float(eventStart), float(quantizedNoteEnd));
+                // in the note priority modes, a new note may lose out and not play
+                if (voice) {
+                    // play the note
+                    const double durationQuantized = TimeUtils::quantize(note->duration, quantizeInterval, false);  
+                    double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
+                    voice->playNote(note->pitchCV, float(eventStart), float(quantizedNoteEnd));
+                }
                 ++curEvent;
             }
             break;
@@ -170,6 +170,12 @@ void MidiPlayer4::setNumVoices(int track, int numVoices)
 
 }
 
+void MidiPlayer4::setVoiceAssignMode(int track, MidiVoiceAssigner::Mode mode)
+{
+    assert(track>=0 && track < 4);
+    trackPlayers[track]->setVoiceAssignMode(mode);
+}
+
 void MidiPlayer4::setSampleCountForRetrigger(int count)
 {
      for (int i=0; i < MidiSong4::numTracks; ++i) {
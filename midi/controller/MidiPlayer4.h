@@ -37,6 +37,7 @@ public:
     void step();
 
     void setNumVoices(int track, int numVoices);
+    void setVoiceAssignMode(int track, MidiVoiceAssigner::Mode);
     void setSampleCountForRetrigger(int);
     void updateSampleCount(int numElapsed);
 
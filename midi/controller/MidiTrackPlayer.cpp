@@ -129,6 +129,12 @@ void MidiTrackPlayer::setNumVoices(int _numVoices) {
     voiceAssigner.setNumVoices(numVoices);
 }
 
+void MidiTrackPlayer::setVoiceAssignMode(MidiVoiceAssigner::Mode mode) {
+    if (mode != voiceAssigner.getMode()) {
+        voiceAssigner.setMode(mode);
+    }
+}
+
 void MidiTrackPlayer::setNextSectionRequest(int section) {
     // printf("called set next section with %d\n", section);
 
@@ -358,12 +364,13 @@ bool MidiTrackPlayer::playOnce(double metricTime, float quantizeInterval) {
 
                 // find a voice to play
                 MidiVoice* voice = voiceAssigner.getNext(note->pitchCV);
-                assert(voice);
-
-                // play the note
-                const double durationQuantized = TimeUtils::quantize(note->duration, quantizeInterval, false);
-                double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
-                voice->playNote(note->pitchCV, float(eventStart), float(quantizedNoteEnd));
+                // in the note priority modes, a new note may lose out and not play
+                if (voice) {
+                    // play the note
+                    const double durationQuantized = TimeUtils::quantize(note->duration, quantizeInterval, false);
+                    double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
+                    voice->playNote(note->pitchCV, float(eventStart), float(quantizedNoteEnd));
+                }
                 ++playback.curEvent;
                 // printfprintf("just inc curEvent 129\n");
             } break;
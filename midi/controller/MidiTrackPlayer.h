@@ -46,6 +46,11 @@ public:
     void step();
     void reset(bool resetGates, bool resetSectionIndex);
     void setNumVoices(int numVoices);
+
+    /**
+     * Cheap to call every sample, only does something when the mode changes.
+     */
+    void setVoiceAssignMode(MidiVoiceAssigner::Mode);
     void setSampleCountForRetrigger(int);
     void updateSampleCount(int numElapsed);
     std::shared_ptr<MidiSong4> getSong();
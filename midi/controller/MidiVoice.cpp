@@ -1,6 +1,7 @@
 
 #include "IMidiPlayerHost.h"
 #include "MidiVoice.h"
+#include "MidiVoiceAssigner.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -15,6 +16,32 @@ void MidiVoice::setHost(IMidiPlayerHost4* ph)
     host = ph;
 }
 
+void MidiVoice::setAssigner(MidiVoiceAssigner* a)
+{
+    assigner = a;
+}
+
+void MidiVoice::setState(State s)
+{
+    if (s != curState) {
+        const State oldState = curState;
+        curState = s;
+        if (assigner) {
+            assigner->onVoiceStateChanged(this, oldState);
+        }
+    }
+}
+
+void MidiVoice::setPitch(float p)
+{
+    if (p != curPitch) {
+        curPitch = p;
+        if (assigner) {
+            assigner->onVoicePitchChanged(this);
+        }
+    }
+}
+
 void MidiVoice::setIndex(int i)
 {
     index = i;
@@ -43,7 +70,7 @@ float MidiVoice::pitch() const
 
 void MidiVoice::_setState(State s)
 {
-    curState = s;
+    setState(s);
 }
 
 void MidiVoice::setSampleCountForRetrigger(int samples)
@@ -60,7 +87,7 @@ void MidiVoice::updateSampleCount(int samples)
         retriggerSampleCounter -= samples;
         if (retriggerSampleCounter <= 0) {
             retriggerSampleCounter = 0;
-            curState = State::Playing;
+            setState(State::Playing);
             setCV(delayedNotePitch);
             noteOffTime = delayedNoteEndtime;
             setGate(true);
@@ -79,10 +106,14 @@ void MidiVoice::playNote(float pitch, double currentTime, float endTime)
 #ifdef _MLOG
         printf(" mv retrigger. interval = %d\n", numSamplesInRetrigger);
 #endif
-        curState = State::ReTriggering;
+        setState(State::ReTriggering);
 
        // printf("gate low in normal gate off logic\n");
         setGate(false);
+
+        // The CV waits for the gate to come back, but this voice is already
+        // playing the new note as far as the assigner is concerned.
+        setPitch(pitch);
         delayedNotePitch = pitch;
         delayedNoteEndtime = endTime;
         retriggerSampleCounter = numSamplesInRetrigger;
@@ -93,13 +124,16 @@ void MidiVoice::playNote(float pitch, double currentTime, float endTime)
 #ifdef _MLOG
         printf("don't retrigger\n");
 #endif
-        this->curPitch = pitch;
+        setPitch(pitch);
         this->noteOffTime = endTime;
 
-        this->curState = State::Playing;
+        setState(State::Playing);
         setCV(pitch);
         setGate(true);
     }
+    if (assigner) {
+        assigner->onVoiceNoteStarted(this);
+    }
 }
 
 bool MidiVoice::updateToMetricTime(double metricTime)
@@ -116,7 +150,7 @@ bool MidiVoice::updateToMetricTime(double metricTime)
         lastNoteOffTime = noteOffTime; 
         //lastNoteOffTime = metricTime;
         noteOffTime = -1;
-        curState = State::Idle;
+        setState(State::Idle);
         ret = true;
     }
     return ret;
@@ -129,9 +163,9 @@ void MidiVoice::reset(bool clearGate)
 #endif    
     noteOffTime = -1;           // the absolute metric time when the 
                                 // currently playing note should stop
-    curPitch = -100;            // the pitch of the last note played in this voice
+    setPitch(-100);             // the pitch of the last note played in this voice
     lastNoteOffTime = -1;
-    curState = State::Idle;
+    setState(State::Idle);
     retriggerSampleCounter = 0;
     if (clearGate) {
        // printf("gate off from reset call\n");
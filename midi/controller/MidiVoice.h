@@ -3,6 +3,7 @@
 
 // #define _MLOG
 class IMidiPlayerHost4;
+class MidiVoiceAssigner;
 
 /**
  * Midi voice represents one "voice" of playback, so typically
@@ -27,6 +28,13 @@ public:
     void setTrack(int);
     void setSampleCountForRetrigger(int samples);
 
+    /**
+     * In the modes that need it the assigner gets told every time our
+     * state or pitch changes, so that it never has to go looking.
+     * Otherwise it is null.
+     */
+    void setAssigner(MidiVoiceAssigner*);
+
     /**
      * Will always play the note, not matter what state it is in.
      * Clever voice assignment should have been done long before calling this.
@@ -83,6 +91,7 @@ private:
     int numSamplesInRetrigger = 0;
 
     IMidiPlayerHost4* host = nullptr;
+    MidiVoiceAssigner* assigner = nullptr;
 
     State curState = State::Idle;
 
@@ -96,4 +105,6 @@ private:
 
     void setGate(bool);
     void setCV(float);
+    void setState(State);
+    void setPitch(float);
 };
\ No newline at end of file
@@ -1,19 +1,36 @@
-
 #include "MidiVoiceAssigner.h"
 #include "MidiVoice.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int lowestBit(uint32_t x)
+{
+    assert(x);
+#ifdef _MSC_VER
+    unsigned long ret;
+    _BitScanForward(&ret, x);
+    return int(ret);
+#else
+    return __builtin_ctz(x);
+#endif
+}
 
 MidiVoiceAssigner::MidiVoiceAssigner(MidiVoice* vx, int maxVoices) :
     voices(vx),
     maxVoices(maxVoices),
     numVoices(maxVoices)
 {
-    assert(maxVoices > 0 && maxVoices <= 16);
+    assert(maxVoices > 0 && maxVoices <= maxPossibleVoices);
     for (int i = 0; i < maxVoices; ++i) {
         assert(voices[i].state() == MidiVoice::State::Idle);
     }
+    setNumVoices(maxVoices);
 }
 
 void MidiVoiceAssigner::reset()
@@ -28,6 +45,25 @@ void MidiVoiceAssigner::setNumVoices(int voices)
     if (nextVoice >= numVoices) {
         nextVoice = 0;          // make sure it's valid
     }
+    activeMask = (numVoices >= 32) ? 0xffffffff : ((1u << numVoices) - 1);
+    rebuild();
+}
+
+void MidiVoiceAssigner::setMode(Mode m)
+{
+    mode = m;
+
+    // only the modes that track the voices want to hear from them
+    MidiVoiceAssigner* listener = tracksVoices() ? this : nullptr;
+    for (int i = 0; i < maxVoices; ++i) {
+        voices[i].setAssigner(listener);
+    }
+    rebuild();
+}
+
+bool MidiVoiceAssigner::tracksVoices() const
+{
+    return mode != Mode::ReUse && mode != Mode::Rotate;
 }
 
 MidiVoice* MidiVoiceAssigner::getNext(float pitch)
@@ -37,12 +73,24 @@ MidiVoice* MidiVoiceAssigner::getNext(float pitch)
         case Mode::ReUse:
             nextVoice = getNextReUse(pitch);
             break;
+        case Mode::Rotate:
+            nextVoice = getNextRotate(getIdleVoices());
+            break;
+        case Mode::StealOldest:
+            nextVoice = getNextStealOldest();
+            break;
+        case Mode::LowPriority:
+        case Mode::HighPriority:
+            nextVoice = getNextPriority(pitch);
+            break;
         default:
             assert(false);
     }
 #if defined(_MLOG)
-    printf("MidiVoiceAssigner::getNext(pitch=%.2f), ret voice #%d state=%d\n",
-        pitch, nextVoice->_getIndex(), nextVoice->state()); 
+    if (nextVoice) {
+        printf("MidiVoiceAssigner::getNext(pitch=%.2f), ret voice #%d state=%d\n",
+            pitch, nextVoice->_getIndex(), nextVoice->state());
+    }
     fflush(stdout);
 #endif
     return nextVoice;
@@ -61,14 +109,33 @@ int MidiVoiceAssigner::advance(int vxNum)
     return wrapAround(vxNum + 1);
 }
 
+int MidiVoiceAssigner::indexOf(const MidiVoice* vx) const
+{
+    const int ret = int(vx - voices);
+    assert(ret >= 0 && ret < maxVoices);
+    return ret;
+}
+
+uint32_t MidiVoiceAssigner::getIdleVoices() const
+{
+    uint32_t idle = 0;
+    for (int i = 0; i < numVoices; ++i) {
+        idle |= uint32_t(voices[i].state() == MidiVoice::State::Idle) << i;
+    }
+    return idle;
+}
+
 MidiVoice* MidiVoiceAssigner::getNextReUse(float pitch)
 {
     assert(numVoices > 0);
 
+    // This is the default mode, so it gets no help from the voices: they don't
+    // call back, and we just look. With 16 voices that's cheaper than keeping score.
+
     // first, look for a voice already playing this pitch, but idle
     for (int i = 0; i < numVoices; ++i) {
         if ((voices[i].pitch() == pitch) &&
-         (voices[i].state() == MidiVoice::State::Idle)) {
+            (voices[i].state() == MidiVoice::State::Idle)) {
             // OK, we found an idle voice at the desired pitch
             if (i == nextVoice) {
                 nextVoice = advance(nextVoice);
@@ -79,8 +146,7 @@ MidiVoice* MidiVoiceAssigner::getNextReUse(float pitch)
 
     // next, look for any idle voice, starting at next voice
     for (int i = 0; i < numVoices; ++i) {
-        int candidateVoice = wrapAround(i + nextVoice);
-     
+        const int candidateVoice = wrapAround(i + nextVoice);
         if (voices[candidateVoice].state() == MidiVoice::State::Idle) {
             nextVoice = advance(candidateVoice);
             return voices + candidateVoice;
@@ -88,7 +154,243 @@ MidiVoice* MidiVoiceAssigner::getNextReUse(float pitch)
     }
 
     // If no idle voices, use the next one
+    return steal();
+}
+
+MidiVoice* MidiVoiceAssigner::getNextRotate(uint32_t idle)
+{
+    assert(numVoices > 0);
+    if (idle) {
+        // first idle voice at or after nextVoice, else wrap around to the first idle one.
+        const uint32_t atOrAfter = idle & ~((1u << nextVoice) - 1);
+        const int candidateVoice = lowestBit(atOrAfter ? atOrAfter : idle);
+        nextVoice = advance(candidateVoice);
+        return voices + candidateVoice;
+    }
+
+    // If no idle voices, use the next one
+    return steal();
+}
+
+MidiVoice* MidiVoiceAssigner::steal()
+{
     int i = nextVoice;
     nextVoice = advance(nextVoice);
-    return voices + i;            
-}
\ No newline at end of file
+    return voices + i;
+}
+
+MidiVoice* MidiVoiceAssigner::getNextStealOldest()
+{
+    if (idleList.head >= 0) {
+        return voices + idleList.head;
+    }
+    if (busyList.head >= 0) {
+        return voices + busyList.head;
+    }
+
+    // can only get here if voice were changed behind our back
+    assert(false);
+    return steal();
+}
+
+MidiVoice* MidiVoiceAssigner::getNextPriority(float pitch)
+{
+    if (idleList.head >= 0) {
+        return voices + idleList.head;
+    }
+
+    // All voices are busy. The top of the heap is the note that loses
+    // to all the others, so see if the new one beats it.
+    if (!heapValid) {
+        buildHeap();
+    }
+    if (heapSize == 0) {
+        assert(false);
+        return steal();
+    }
+    const int loser = heap[0];
+    const float loserPitch = heapPitch[loser];
+    const bool newNoteWins = (mode == Mode::LowPriority) ? (pitch < loserPitch) : (pitch > loserPitch);
+    return newNoteWins ? voices + loser : nullptr;
+}
+
+/***************** Keeping track of the voices ***********************/
+
+void MidiVoiceAssigner::onVoiceStateChanged(MidiVoice* vx, MidiVoice::State oldState)
+{
+    // Playing -> ReTriggering (and back) is still the same note, as far as the lists are concerned
+    const int i = indexOf(vx);
+    const bool wasIdle = oldState == MidiVoice::State::Idle;
+    const bool isIdle = vx->state() == MidiVoice::State::Idle;
+    if ((activeMask & (1u << i)) && (wasIdle != isIdle)) {
+        unlink(wasIdle ? idleList : busyList, i);
+        append(isIdle ? idleList : busyList, i);
+        if (isIdle && heapValid) {
+            clearHeap();
+        }
+    }
+}
+
+void MidiVoiceAssigner::onVoiceNoteStarted(MidiVoice* vx)
+{
+    // A stolen voice is now the newest note, so move it to the back of the line.
+    // A voice that just left the idle list is already there.
+    const int i = indexOf(vx);
+    if ((activeMask & (1u << i)) && (vx->state() != MidiVoice::State::Idle) && (busyList.tail != i)) {
+        unlink(busyList, i);
+        append(busyList, i);
+        if (heapPos[i] >= 0) {
+            heapUpdate(i);
+        }
+    }
+}
+
+void MidiVoiceAssigner::onVoicePitchChanged(MidiVoice* vx)
+{
+    const int i = indexOf(vx);
+    if (heapPos[i] >= 0) {
+        heapPitch[i] = vx->pitch();
+        heapUpdate(i);
+    }
+}
+
+MidiVoiceAssigner::VoiceList& MidiVoiceAssigner::listFor(MidiVoice::State state)
+{
+    return (state == MidiVoice::State::Idle) ? idleList : busyList;
+}
+
+void MidiVoiceAssigner::rebuild()
+{
+    idleList = VoiceList();
+    busyList = VoiceList();
+    heapSize = 0;
+    heapValid = false;
+    for (int i = 0; i < maxPossibleVoices; ++i) {
+        heapPos[i] = -1;
+    }
+    if (!tracksVoices()) {
+        return;
+    }
+    for (int i = 0; i < numVoices; ++i) {
+        append(listFor(voices[i].state()), i);
+    }
+}
+
+void MidiVoiceAssigner::unlink(VoiceList& list, int index)
+{
+    const int p = prev[index];
+    const int n = next[index];
+    if (p >= 0) {
+        next[p] = n;
+    } else {
+        assert(list.head == index);
+        list.head = n;
+    }
+    if (n >= 0) {
+        prev[n] = p;
+    } else {
+        assert(list.tail == index);
+        list.tail = p;
+    }
+}
+
+void MidiVoiceAssigner::append(VoiceList& list, int index)
+{
+    prev[index] = list.tail;
+    next[index] = -1;
+    if (list.tail >= 0) {
+        next[list.tail] = index;
+    } else {
+        list.head = index;
+    }
+    list.tail = index;
+    if (&list == &busyList) {
+        startOrder[index] = nextStartOrder++;
+    }
+}
+
+/***************** The heap of busy voices ***********************/
+
+/**
+ * True if voice a would be given up before voice b.
+ */
+bool MidiVoiceAssigner::losesTo(int a, int b) const
+{
+    const float pa = heapPitch[a];
+    const float pb = heapPitch[b];
+    if (pa != pb) {
+        return (mode == Mode::LowPriority) ? (pa > pb) : (pa < pb);
+    }
+    // unsigned difference, so the counter may wrap
+    return int(startOrder[a] - startOrder[b]) < 0;
+}
+
+void MidiVoiceAssigner::heapSwap(int i, int j)
+{
+    std::swap(heap[i], heap[j]);
+    heapPos[heap[i]] = i;
+    heapPos[heap[j]] = j;
+}
+
+void MidiVoiceAssigner::siftUp(int pos)
+{
+    while (pos > 0) {
+        const int parent = (pos - 1) / 2;
+        if (!losesTo(heap[pos], heap[parent])) {
+            break;
+        }
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void MidiVoiceAssigner::siftDown(int pos)
+{
+    for (;;) {
+        int best = pos;
+        const int left = 2 * pos + 1;
+        const int right = left + 1;
+        if (left < heapSize && losesTo(heap[left], heap[best])) {
+            best = left;
+        }
+        if (right < heapSize && losesTo(heap[right], heap[best])) {
+            best = right;
+        }
+        if (best == pos) {
+            break;
+        }
+        heapSwap(pos, best);
+        pos = best;
+    }
+}
+
+void MidiVoiceAssigner::buildHeap()
+{
+    assert(heapSize == 0);
+    for (int i = busyList.head; i >= 0; i = next[i]) {
+        heap[heapSize] = i;
+        heapPos[i] = heapSize;
+        heapPitch[i] = voices[i].pitch();
+        ++heapSize;
+    }
+    for (int pos = heapSize / 2 - 1; pos >= 0; --pos) {
+        siftDown(pos);
+    }
+    heapValid = true;
+}
+
+void MidiVoiceAssigner::clearHeap()
+{
+    for (int pos = 0; pos < heapSize; ++pos) {
+        heapPos[heap[pos]] = -1;
+    }
+    heapSize = 0;
+    heapValid = false;
+}
+
+void MidiVoiceAssigner::heapUpdate(int index)
+{
+    const int pos = heapPos[index];
+    siftUp(pos);
+    siftDown(heapPos[index]);
+}
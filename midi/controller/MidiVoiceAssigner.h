@@ -1,19 +1,56 @@
 #pragma once
 
-class MidiVoice;
+#include "MidiVoice.h"
 
+#include <stdint.h>
+
+/**
+ * Picks which voice plays the next note.
+ *
+ * ReUse and Rotate look at the voices when asked. That is one quick pass over
+ * at most 16 voices, so the voices don't have to report anything.
+ *
+ * The other modes need to know the order things happened in, so in those modes the
+ * voices tell us whenever their state or pitch changes. We keep lists
+ * of the voices in the order they went idle and in the order they started playing.
+ *
+ * The priority modes only have to choose between busy voices when none are idle.
+ * Then they build a heap of the busy voices, with the note that would lose at the top,
+ * and keep it up to date until a voice goes idle again.
+ */
 class MidiVoiceAssigner
 {
 public:
     enum class Mode
     {
-        ReUse,          // default
-        Rotate
+        ReUse,          // default. Prefer an idle voice that was last used for this pitch, then rotate.
+        Rotate,         // plain round robin over the idle voices.
+        StealOldest,    // use the voice that has been idle longest. If none, steal the oldest note (last note priority).
+        LowPriority,    // if no idle voice, a new note only sounds if it is lower than one that is playing.
+        HighPriority    // if no idle voice, a new note only sounds if it is higher than one that is playing.
     };
     MidiVoiceAssigner(MidiVoice* vx, int maxVoices);
     void setNumVoices(int);
+    void setMode(Mode);
+    Mode getMode() const
+    {
+        return mode;
+    }
+
+    /**
+     * Returns the voice to play the note on.
+     * In the priority modes may return nullptr, meaning the new note
+     * lost out and should not be played.
+     */
     MidiVoice* getNext(float pitch);
     void reset();
+
+    /**
+     * called by the voices, only in the modes that track them.
+     */
+    void onVoiceStateChanged(MidiVoice*, MidiVoice::State oldState);
+    void onVoicePitchChanged(MidiVoice*);
+    void onVoiceNoteStarted(MidiVoice*);
 private:
     MidiVoice* const voices;
     const int maxVoices;
@@ -22,7 +59,71 @@ private:
 
     Mode mode = Mode::ReUse;
 
+    /**
+     * bit per voice. Only the first numVoices are used.
+     */
+    uint32_t activeMask = 0;
+
+    /**
+     * Doubly linked lists of voice indexes, oldest at the head.
+     * The idle list is in order of when the voice went idle,
+     * the busy list in order of when the note started.
+     * Only active voices are in the lists.
+     */
+    class VoiceList
+    {
+    public:
+        int head = -1;
+        int tail = -1;
+    };
+    static const int maxPossibleVoices = 16;
+    int prev[maxPossibleVoices];
+    int next[maxPossibleVoices];
+    VoiceList idleList;
+    VoiceList busyList;
+
+    /**
+     * When each voice joined the busy list. Breaks ties in the heap
+     * the same way the busy list would: the older note loses.
+     */
+    unsigned int startOrder[maxPossibleVoices] = {0};
+    unsigned int nextStartOrder = 0;
+
+    /**
+     * Binary heap of the busy voices, for the priority modes.
+     * Only valid while all the voices are busy.
+     * heapPos is where each voice is in the heap, or -1.
+     * heapPitch is a copy of each voice's pitch, so sifting doesn't have to ask.
+     */
+    int heap[maxPossibleVoices];
+    int heapPos[maxPossibleVoices];
+    float heapPitch[maxPossibleVoices];
+    int heapSize = 0;
+    bool heapValid = false;
+
     MidiVoice* getNextReUse(float pitch);
+    MidiVoice* getNextRotate(uint32_t idle);
+    MidiVoice* getNextStealOldest();
+    MidiVoice* getNextPriority(float pitch);
+    MidiVoice* steal();
+
     int wrapAround(int vxNum);
     int advance(int vxNum);
-};
\ No newline at end of file
+    int indexOf(const MidiVoice*) const;
+    uint32_t getIdleVoices() const;
+
+    bool tracksVoices() const;
+    void rebuild();
+
+    void unlink(VoiceList&, int index);
+    void append(VoiceList&, int index);
+    VoiceList& listFor(MidiVoice::State);
+
+    bool losesTo(int a, int b) const;
+    void buildHeap();
+    void clearHeap();
+    void heapUpdate(int index);
+    void heapSwap(int i, int j);
+    void siftUp(int pos);
+    void siftDown(int pos);
+};
@@ -23,6 +23,7 @@ public:
     ~NewSongDataDataCommand();
     void execute(MidiSequencerPtr, SequencerWidget*) override;
     void undo(MidiSequencerPtr, SequencerWidget*) override;
+    size_t getMemoryUsage() const override;
 
     static NewSongDataDataCommandPtr makeLoadMidiFileCommand(
         MidiSongPtr, 
@@ -50,4 +50,16 @@ void NewSongDataDataCommand::undo(MidiSequencerPtr sequencer, SequencerWidget* w
         updater(true, sequencer, oldSong, widget);
     }
     updater(false, sequencer, oldSong, widget);
-}
\ No newline at end of file
+}
+size_t NewSongDataDataCommand::getMemoryUsage() const
+{
+    // Whichever song is not currently playing is only held by us.
+    size_t ret = sizeof(NewSongDataDataCommand) + name.capacity();
+    if (newSong && newSong.use_count() == 1) {
+        ret += newSong->getMemoryUsage();
+    }
+    if (oldSong && oldSong.use_count() == 1) {
+        ret += oldSong->getMemoryUsage();
+    }
+    return ret;
+}
@@ -27,6 +27,7 @@ ReplaceDataCommand::ReplaceDataCommand(
     song->getTrack(trackNumber)->assertValid();
     assertValid();
     originalTrackLength = song->getTrack(trackNumber)->getLength();     /// save off
+    compact();
 }
 
 ReplaceDataCommand::ReplaceDataCommand(
@@ -39,6 +40,34 @@ ReplaceDataCommand::ReplaceDataCommand(
     assert(song->getTrack(trackNumber));
     song->getTrack(trackNumber)->assertValid();
     assertValid();
+    compact();
+}
+
+void ReplaceDataCommand::compact()
+{
+    // The factories build these up with push_back, so there is usually slack.
+    // We may sit in the undo history for a long time, so give it back.
+    removeData.shrink_to_fit();
+    addData.shrink_to_fit();
+}
+
+size_t ReplaceDataCommand::getMemoryUsage() const
+{
+    size_t ret = SqCommand::getMemoryUsage() + sizeof(ReplaceDataCommand) - sizeof(SqCommand);
+    ret += (removeData.capacity() + addData.capacity()) * sizeof(MidiEventPtr);
+
+    size_t ownedEvents = 0;
+    for (const auto& ev : removeData) {
+        if (ev.use_count() == 1) {
+            ++ownedEvents;
+        }
+    }
+    for (const auto& ev : addData) {
+        if (ev.use_count() == 1) {
+            ++ownedEvents;
+        }
+    }
+    return ret + ownedEvents * MidiTrack::getEventMemoryUsage();
 }
 
 void ReplaceDataCommand::assertValid() const
@@ -77,13 +106,7 @@ void ReplaceDataCommand::execute(MidiSequencerPtr seq, SequencerWidget*)
         mt->setLength(newTrackLength);
     }
 
-    for (auto it : addData) {
-        mt->insertEvent(it);
-    }
-
-    for (auto it : removeData) {
-        mt->deleteEvent(*it);
-    }
+    mt->replaceEvents(removeData, addData);
 
     //  if we need to make track shorter, do it last
     if (isNewLengthRequested && !isNewLengthLonger) {
@@ -102,12 +125,10 @@ void ReplaceDataCommand::execute(MidiSequencerPtr seq, SequencerWidget*)
     }
 
     seq->assertValid();
-    
+
+    // the events we just inserted are in the track, so we can select them directly
     for (auto it : addData) {
-        auto foundIter = mt->findEventDeep(*it);      // find an event in the track that matches the one we just inserted
-        assert(foundIter != mt->end());
-        MidiEventPtr evt = foundIter->second;
-        selection->extendSelection(evt);
+        selection->extendSelection(it);
     }
     seq->assertValid();
 }
@@ -129,13 +150,8 @@ void ReplaceDataCommand::undo(MidiSequencerPtr seq, SequencerWidget*)
         mt->setLength(originalTrackLength);
     }
 
-    // to undo the insertion, delete all of them
-    for (auto it : addData) {
-        mt->deleteEvent(*it);
-    }
-    for (auto it : removeData) {
-        mt->insertEvent(it);
-    }
+    // to undo the insertion, delete all of them and put back the originals
+    mt->replaceEvents(addData, removeData);
 
         // If we need to make track shorter, do it last
     if (isNewLengthRequested && !isNewLengthLonger) {
@@ -146,10 +162,7 @@ void ReplaceDataCommand::undo(MidiSequencerPtr seq, SequencerWidget*)
     assert(selection);
     selection->clear();
     for (auto it : removeData) {
-        auto foundIter = mt->findEventDeep(*it);      // find an event in the track that matches the one we just inserted
-        assert(foundIter != mt->end());
-        MidiEventPtr evt = foundIter->second;
-        selection->extendSelection(evt);
+        selection->extendSelection(it);
     }
     // TODO: move cursor
 }
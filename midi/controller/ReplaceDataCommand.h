@@ -25,6 +25,12 @@ public:
     virtual void execute(MidiSequencerPtr, SequencerWidget*) override;
     virtual void undo(MidiSequencerPtr, SequencerWidget*) override;
 
+    /**
+     * Events that are still in the track (or selected) are shared with it,
+     * so only the ones we are keeping alive by ourselves are counted.
+     */
+    virtual size_t getMemoryUsage() const override;
+
     // TODO: get rid of obsolete arguments.
     ReplaceDataCommand(
         std::shared_ptr<MidiSong> song,
@@ -142,5 +148,6 @@ private:
         ScalePtr);
 
     void assertValid() const;
+    void compact();
 };
 
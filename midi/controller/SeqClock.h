@@ -48,6 +48,14 @@ public:
      */
     ClockResults update(int samplesElapsed, float externalClock, bool runStop, float reset);
 
+    /**
+     * Cheap enough to call every sample, even when update() is only called every few.
+     * Returns true if the clock or reset input just went high. When that happens
+     * the caller should call update() on this sample, rather than waiting for the
+     * end of the block, so that the notes it triggers start exactly on the clock edge.
+     */
+    bool isEdgePending(float externalClock, float reset);
+
     void setup(ClockRate inputSetting, float, float sampleTime);
     void reset(bool internalClock);
 
@@ -74,13 +82,21 @@ private:
     GateTrigger clockProcessor;
     GateTrigger resetProcessor;
     OneShot resetLockout;
+
+    /**
+     * these run every sample, just to find the edges.
+     */
+    GateTrigger clockEdgeDetector;
+    GateTrigger resetEdgeDetector;
 };
 
 // We don't want reset logic on clock, as clock high should not be ignoreed.
 // Probably don't want on reset either.
 inline SeqClock::SeqClock() :
     clockProcessor(false),
-    resetProcessor(false)
+    resetProcessor(false),
+    clockEdgeDetector(false),
+    resetEdgeDetector(false)
 {
     resetLockout.setDelayMs(1);
     resetLockout.setSampleTime(1.f / 44100.f);
@@ -131,6 +147,13 @@ inline SeqClock::ClockResults SeqClock::update(int samplesElapsed, float externa
     return results;
 }
 
+inline bool SeqClock::isEdgePending(float externalClock, float reset)
+{
+    clockEdgeDetector.go(externalClock);
+    resetEdgeDetector.go(reset);
+    return clockEdgeDetector.trigger() || resetEdgeDetector.trigger();
+}
+
 inline void SeqClock::reset(bool internalClock)
 {
 #ifdef _LOGX
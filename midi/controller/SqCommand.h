@@ -16,6 +16,15 @@ public:
     virtual ~SqCommand() {}
     virtual void execute(MidiSequencerPtr seq, SequencerWidget* widget) = 0;
     virtual void undo(MidiSequencerPtr seq, SequencerWidget*) = 0;
+
+    /**
+     * Estimate of the memory held by this undo record, in bytes.
+     * Data that is still shared with the live song should not be counted.
+     */
+    virtual size_t getMemoryUsage() const
+    {
+        return sizeof(SqCommand) + name.capacity();
+    }
     std::string name = "Seq++";
 };
 
@@ -25,6 +34,10 @@ public:
     virtual ~Sq4Command() {}
     virtual void execute(MidiSequencer4Ptr seq, Sequencer4Widget* widget) = 0;
     virtual void undo(MidiSequencer4Ptr seq, Sequencer4Widget*) = 0;
+    virtual size_t getMemoryUsage() const
+    {
+        return sizeof(Sq4Command) + name.capacity();
+    }
     std::string name = "4X4";
 };
 
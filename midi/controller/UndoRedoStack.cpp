@@ -20,6 +20,7 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd
     cmd->execute(seq, nullptr);     // only used for unit tests, maybe we can get away with this
     undoList.push_front(cmd);
     redoList.clear();   
+    enforceMemoryLimit();
 }
 
 void UndoRedoStack::execute4(MidiSequencer4Ptr seq, std::shared_ptr<Sq4Command> cmd)
@@ -27,6 +28,7 @@ void UndoRedoStack::execute4(MidiSequencer4Ptr seq, std::shared_ptr<Sq4Command>
     cmd->execute(seq, nullptr);     // only used for unit tests, maybe we can get away with this
     undo4List.push_front(cmd);
     redo4List.clear();   
+    enforceMemoryLimit();
 }
 
 void UndoRedoStack::undo(MidiSequencerPtr seq)
@@ -69,4 +71,59 @@ void UndoRedoStack::redo4(MidiSequencer4Ptr seq)
     undo4List.push_front(cmd);
 }
 
-#endif
\ No newline at end of file
+size_t UndoRedoStack::getMemoryUsed() const
+{
+    size_t ret = 0;
+    for (auto& cmd : undoList) {
+        ret += cmd->getMemoryUsage();
+    }
+    for (auto& cmd : redoList) {
+        ret += cmd->getMemoryUsage();
+    }
+    for (auto& cmd : undo4List) {
+        ret += cmd->getMemoryUsage();
+    }
+    for (auto& cmd : redo4List) {
+        ret += cmd->getMemoryUsage();
+    }
+    return ret;
+}
+
+void UndoRedoStack::setMaxMemory(size_t max)
+{
+    maxMemory = max;
+    enforceMemoryLimit();
+}
+
+template <class T>
+static bool trimOldest(std::list<T>& list, size_t& used, size_t keep)
+{
+    if (list.size() <= keep) {
+        return false;
+    }
+    const size_t mem = list.back()->getMemoryUsage();
+    list.pop_back();
+    used = (mem < used) ? used - mem : 0;
+    return true;
+}
+
+void UndoRedoStack::enforceMemoryLimit()
+{
+    if (maxMemory == 0) {
+        return;
+    }
+    size_t used = getMemoryUsed();
+
+    // Redo records are the least likely to be used, so they go first.
+    // Then the oldest undo, but never the one just made.
+    // In both lists the oldest/most distant one is at the back.
+    while (used > maxMemory) {
+        if (trimOldest(redoList, used, 0)) continue;
+        if (trimOldest(redo4List, used, 0)) continue;
+        if (trimOldest(undoList, used, 1)) continue;
+        if (trimOldest(undo4List, used, 1)) continue;
+        break;
+    }
+}
+
+#endif
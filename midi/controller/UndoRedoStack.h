@@ -28,8 +28,27 @@ public:
     void execute4(MidiSequencer4Ptr, std::shared_ptr<Sq4Command>);
     void execute4(MidiSequencer4Ptr, Sequencer4Widget*, std::shared_ptr<Sq4Command>);
     void setModuleId(int);
+
+    /**
+     * Memory held by this module's entries in the VCV history, in bytes.
+     */
+    size_t getMemoryUsed() const;
+
+    /**
+     * When our entries in the VCV history use more than this, the oldest ones are
+     * removed from it. Zero means no limit.
+     */
+    void setMaxMemory(size_t);
+    size_t getMaxMemory() const
+    {
+        return maxMemory;
+    }
 private:
     int moduleId=-1;
+    size_t maxMemory = defaultMaxMemory;
+    void enforceMemoryLimit();
+public:
+    static const size_t defaultMaxMemory = 64 * 1024 * 1024;
 };
 
 using UndoRedoStackPtr = std::shared_ptr<UndoRedoStack>;
@@ -56,6 +75,24 @@ public:
     void undo4(MidiSequencer4Ptr);
     void redo4(MidiSequencer4Ptr);
 
+    /**
+     * Memory held by all the undo and redo records, in bytes.
+     * Data shared with the live song is not counted.
+     */
+    size_t getMemoryUsed() const;
+
+    /**
+     * When the history uses more than this, the most distant redo records are thrown away,
+     * then the oldest undo records. The most recent undo record is always kept.
+     * Zero means no limit.
+     */
+    void setMaxMemory(size_t);
+    size_t getMaxMemory() const
+    {
+        return maxMemory;
+    }
+
+    static const size_t defaultMaxMemory = 64 * 1024 * 1024;
 private:
 
     // It doesn't really "work" to have lists of differnt types of commands,
@@ -65,6 +102,8 @@ private:
     std::list<std::shared_ptr<Sq4Command>> undo4List;
     std::list<std::shared_ptr<Sq4Command>> redo4List;
 
+    size_t maxMemory = defaultMaxMemory;
+    void enforceMemoryLimit();
 };
 
 using UndoRedoStackPtr = std::shared_ptr<UndoRedoStack>;
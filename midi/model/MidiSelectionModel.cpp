@@ -125,8 +125,9 @@ void MidiSelectionModel::add(MidiEventPtr evt)
 bool MidiSelectionModel::isSelected(MidiEventPtr evt) const
 {
     assert(evt);
-    auto it = std::find(selection.begin(), selection.end(), evt);
-    return it != selection.end();
+    // the set is ordered by value, so find the equivalent entry then check it's the same instance
+    auto it = selection.find(evt);
+    return (it != selection.end()) && (*it == evt);
 }
 
 MidiEventPtr MidiSelectionModel::getLast()
@@ -78,7 +78,7 @@ public:
 
     /** Returns true is this object instance is in selection.
      * i.e. changes on pointer value.
-     * O(1)
+     * O(log n)
      */
     bool isSelected(MidiEventPtr) const;
 
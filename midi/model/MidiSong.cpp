@@ -28,6 +28,16 @@ bool MidiSong::trackExists(int tkNum) const
     return bool(tracks[tkNum]);
 }
 
+size_t MidiSong::getMemoryUsage() const
+{
+    size_t ret = sizeof(MidiSong);
+    for (auto track : tracks) {
+        if (track) {
+            ret += track->getMemoryUsage();
+        }
+    }
+    return ret;
+}
 
 void MidiSong::addTrack(int index, std::shared_ptr<MidiTrack> track)
 {
@@ -50,6 +50,11 @@ public:
 
     bool trackExists(int tkNum) const;
 
+    /**
+     * Rough estimate of the heap used by all the tracks, in bytes.
+     */
+    size_t getMemoryUsage() const;
+
     /**
      * factory method to generate test content
      */
@@ -26,6 +26,20 @@ int MidiTrack::size() const
     return (int) events.size();
 }
 
+size_t MidiTrack::getEventMemoryUsage()
+{
+    // make_shared puts the control block and the event in one allocation.
+    // Notes are the largest event we have, so use them for all.
+    return sizeof(MidiNoteEvent) + 2 * sizeof(long);
+}
+
+size_t MidiTrack::getMemoryUsage() const
+{
+    // multimap nodes are three pointers and a color, plus the value
+    const size_t nodeSize = 4 * sizeof(void*) + sizeof(container::value_type);
+    return sizeof(MidiTrack) + events.size() * (nodeSize + getEventMemoryUsage());
+}
+
 void MidiTrack::assertValid() const
 {
 #ifndef NDEBUG
@@ -105,6 +119,94 @@ void MidiTrack::deleteEvent(const MidiEvent& evIn)
     assert(false);          // If you get here it means the event to be deleted was not in the track
 }
 
+/**
+ * Orders events the same way the track does (by start time), with ties
+ * broken by MidiEvent::operator <, so that events that are == sort next to each other.
+ */
+static bool lessTimeThenValue(const MidiEventPtr& a, const MidiEventPtr& b)
+{
+    if (a->startTime != b->startTime) {
+        return a->startTime < b->startTime;
+    }
+    return *a < *b;
+}
+
+void MidiTrack::replaceEvents(const std::vector<MidiEventPtr>& toRemove, const std::vector<MidiEventPtr>& toAdd)
+{
+    assert(lock);
+    assert(lock->locked());
+
+    // For small edits to a big track it's cheaper to just patch the map.
+    const size_t numEdits = toRemove.size() + toAdd.size();
+    if (numEdits * mergeThreshold < events.size()) {
+        for (auto it : toRemove) {
+            deleteEvent(*it);
+        }
+        for (auto it : toAdd) {
+            insertEvent(it);
+        }
+        return;
+    }
+
+    std::vector<MidiEventPtr> sortedRemove(toRemove);
+    std::sort(sortedRemove.begin(), sortedRemove.end(), lessTimeThenValue);
+    std::vector<bool> removed(sortedRemove.size(), false);
+
+    // stable, so that new events at the same time keep the order they were passed in
+    std::vector<MidiEventPtr> sortedAdd(toAdd);
+    std::stable_sort(sortedAdd.begin(), sortedAdd.end(), [](const MidiEventPtr& a, const MidiEventPtr& b) {
+        return a->startTime < b->startTime;
+    });
+
+    container merged;
+    auto itAdd = sortedAdd.begin();
+    auto itRemoveFirst = sortedRemove.begin();     // first remove candidate at or after the current time
+    for (const auto& it : events) {
+        const MidiEventPtr& ev = it.second;
+
+        // new events go after the old ones with the same start time, like multimap::insert
+        while (itAdd != sortedAdd.end() && (*itAdd)->startTime < ev->startTime) {
+            merged.emplace_hint(merged.end(), (*itAdd)->startTime, *itAdd);
+            ++itAdd;
+        }
+
+        while (itRemoveFirst != sortedRemove.end() && (*itRemoveFirst)->startTime < ev->startTime) {
+            ++itRemoveFirst;
+        }
+
+        // look for an equivalent event in the remove list that is not already used up
+        bool isRemoved = false;
+        for (auto itRemove = std::lower_bound(itRemoveFirst, sortedRemove.end(), ev, lessTimeThenValue);
+            itRemove != sortedRemove.end() && !lessTimeThenValue(ev, *itRemove);
+            ++itRemove) {
+            const size_t index = itRemove - sortedRemove.begin();
+            if (!removed[index]) {
+                removed[index] = true;
+                isRemoved = true;
+                break;
+            }
+        }
+        if (!isRemoved) {
+            merged.emplace_hint(merged.end(), it.first, ev);
+        }
+    }
+
+    for (; itAdd != sortedAdd.end(); ++itAdd) {
+        merged.emplace_hint(merged.end(), (*itAdd)->startTime, *itAdd);
+    }
+
+    for (size_t i = 0; i < removed.size(); ++i) {
+        if (!removed[i]) {
+            printf("could not delete event %p\n", sortedRemove[i].get());
+            this->_dump();
+            fflush(stdout);
+            assert(false);          // If you get here it means the event to be deleted was not in the track
+        }
+    }
+
+    events.swap(merged);
+}
+
 void MidiTrack::setLength(float newTrackLength)
 {
     assert(lock);
@@ -30,10 +30,30 @@ public:
     int size() const;
     void assertValid() const;
 
+    /**
+     * Rough estimate of the heap used by this track and its events, in bytes.
+     * Used for undo history accounting, so it only needs to be in the right ballpark.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Estimate of the heap used by one event that is held by a shared_ptr.
+     */
+    static size_t getEventMemoryUsage();
+
     void insertEvent(MidiEventPtr ev);
     void deleteEvent(const MidiEvent&);
     void insertEnd(MidiEvent::time_t time);
 
+    /**
+     * Batch edit: removes every event in toRemove (matched with ==, like deleteEvent),
+     * then inserts every event in toAdd.
+     * Large edits are done in a single merge pass over the track, so the cost is
+     * O(n + k log k) instead of one search of the track per event.
+     * Undo is just the same call with the two vectors swapped.
+     */
+    void replaceEvents(const std::vector<MidiEventPtr>& toRemove, const std::vector<MidiEventPtr>& toAdd);
+
     float getLength() const;
     std::shared_ptr<MidiEndEvent> getEndEvent();
     std::shared_ptr<MidiNoteEvent> getFirstNote();
@@ -117,6 +137,12 @@ public:
 private:
     container events;
 
+    /**
+     * replaceEvents will edit in place when the number of edits
+     * times this is less than the size of the track.
+     */
+    static const int mergeThreshold = 16;
+
     static MidiTrackPtr makeTest1(std::shared_ptr<MidiLock>);
     static MidiTrackPtr makeTestCmaj(std::shared_ptr<MidiLock>);
   //  static MidiTrackPtr makeTestEmpty(std::shared_ptr<MidiLock>);
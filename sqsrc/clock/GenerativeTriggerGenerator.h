@@ -41,20 +41,22 @@ private:
 
 
 /* wraps up some stochastic gnerative grammar stuff feeding
- * a trigger sequencer
+ * a trigger sequencer.
+ *
+ * Sequences are generated ahead of time into a small ring of buffers,
+ * so that usually a clock only has to switch to the next one.
+ * Call fillLookahead() at control rate to keep the ring full.
  */
 class GenerativeTriggerGenerator
 {
 public:
     GenerativeTriggerGenerator(AudioMath::RandomUniformFunc r, const ProductionRule * rules, int numRules, GKEY initialState) :
         _r(r),
-        _rules(rules),
-        _numRules(numRules),
-        _initKey(initialState)
+        _grammar(rules, numRules, initialState)
     {
-        _data[0].delay = 0;
-        _data[0].evt = TriggerSequencer::END;
-        _seq = new TriggerSequencer(_data);
+        _data[0][0].delay = 0;
+        _data[0][0].evt = TriggerSequencer::END;
+        _seq = new TriggerSequencer(_data[0]);
     }
     ~GenerativeTriggerGenerator()
     {
@@ -64,9 +66,10 @@ public:
 
     void setGrammar(const ProductionRule * rules, int numRules, GKEY initialState)
     {
-        _rules = rules;
-        _numRules = numRules;
-        _initKey = initialState;
+        _grammar = CompiledGrammar(rules, numRules, initialState);
+
+        // throw away anything generated from the old grammar
+        _numReady = 0;
     }
 
     // returns true if trigger generated
@@ -75,36 +78,76 @@ public:
         _seq->clock();
         bool ret = _seq->getTrigger();
         if (_seq->getEnd()) {
-            // when we finish playing the seq, generate a new random one
-            generate();
+            // when we finish playing the seq, move to the next random one
+            if (_numReady == 0) {
+                // lookahead didn't keep up, so do it now
+                generate(nextSlot(_playing));
+                ++_numReady;
+            }
+            _playing = nextSlot(_playing);
+            --_numReady;
+            _seq->reset(_data[_playing]);
+            assert(!_seq->getEnd());
             ret |= _seq->getTrigger();
             //printf("this should be getTrigger!!!\n");
         }
         return ret;
     }
+
+    /**
+     * Generate sequences into all the free lookahead buffers.
+     * Does nothing if they are already full, so it is cheap to call often.
+     */
+    void fillLookahead()
+    {
+        while (_numReady < lookaheadSize - 1) {
+            int slot = _playing;
+            for (int i = 0; i <= _numReady; ++i) {
+                slot = nextSlot(slot);
+            }
+            generate(slot);
+            ++_numReady;
+        }
+    }
 private:
+    // one playing, the rest ready to go
+    static const int lookaheadSize = 4;
+
     TriggerSequencer * _seq;
-    TriggerSequencer::Event _data[33];
+    TriggerSequencer::Event _data[lookaheadSize][CompiledGrammar::maxSymbols + 1];
+    int _playing = 0;
+    int _numReady = 0;
+
     AudioMath::RandomUniformFunc _r;
-    const ProductionRule * _rules;
-    int _numRules;
-    GKEY _initKey;
-    //
-    void generate()
+    CompiledGrammar _grammar;
+
+    static int nextSlot(int slot)
+    {
+        return (slot + 1 == lookaheadSize) ? 0 : slot + 1;
+    }
+
+    void generate(int slot)
     {
-        GTGEvaluator es(_r, _data);
-        es.rules = _rules;
-        es.numRules = _numRules;
-        ProductionRule::evaluate(es, _initKey);
-
-        es.writeEnd();
-        TriggerSequencer::isValid(_data);
-        _seq->reset(_data);
-        assert(!_seq->getEnd());
+        GKEY keys[CompiledGrammar::maxSymbols];
+        const int numKeys = _grammar.evaluate(_r, keys, CompiledGrammar::maxSymbols);
+
+        // each trigger is delayed by the duration of the previous symbol
+        TriggerSequencer::Event * buf = _data[slot];
+        int delay = 0;
+        for (int i = 0; i < numKeys; ++i) {
+            buf->evt = TriggerSequencer::TRIGGER;
+            buf->delay = delay;
+            ++buf;
+            delay = _grammar.getDuration(keys[i]);
+        }
+        buf->evt = TriggerSequencer::END;
+        buf->delay = delay;
+
+        TriggerSequencer::isValid(_data[slot]);
 #if 0
         printf("just generated trigger seq\n");
         TriggerSequencer::Event * p;
-        for (p = _data; p->evt != TriggerSequencer::END; ++p) {
+        for (p = _data[slot]; p->evt != TriggerSequencer::END; ++p) {
             printf("evt=%d, delay=%d\n", p->evt, p->delay);
         }
         printf("delay to end = %d\n", p->delay);
@@ -390,6 +390,82 @@ bool ProductionRule::isGrammarValid(const ProductionRule * rules, int numRules,
 
 
 
+/***************************************************************************************************************
+*
+* CompiledGrammar
+*
+***************************************************************************************************************/
+
+CompiledGrammar::CompiledGrammar(const ProductionRule * rules, int numRules, GKEY first) : firstRule(first)
+{
+    assert(numRules <= fullRuleTableSize);
+    assert(first >= sg_first && first < numRules);
+
+    int nextChild = 0;
+    for (int key = sg_first; key < numRules; ++key) {
+        Rule& rule = table[key];
+        rule.duration = ProductionRuleKeys::getDuration(key);
+        for (int i = 0; i < ProductionRule::numEntries; ++i) {
+            const ProductionRuleEntry& src = rules[key].entries[i];
+            Entry& dest = rule.entries[i];
+            dest.probability = src.probability;
+            if (src.code == sg_invalid) {
+                continue;
+            }
+
+            GKEY buffer[ProductionRuleKeys::bufferSize];
+            ProductionRuleKeys::breakDown(src.code, buffer);
+            dest.firstChild = nextChild;
+            for (GKEY * p = buffer; *p != sg_invalid; ++p) {
+                assert(nextChild < maxChildren);
+                children[nextChild++] = *p;
+                ++dest.numChildren;
+            }
+        }
+    }
+}
+
+int CompiledGrammar::evaluate(AudioMath::RandomUniformFunc& r, GKEY * outKeys, int maxKeys) const
+{
+    // Depth first, left to right, same as the recursive version.
+    // So children go on the stack in reverse order.
+    GKEY stack[maxStack];
+    int stackSize = 0;
+    int numKeys = 0;
+
+    stack[stackSize++] = firstRule;
+    while (stackSize > 0) {
+        const GKEY key = stack[--stackSize];
+        const Rule& rule = table[key];
+        const float random = r();
+        assert(random >= 0 && random <= 1);
+
+        const Entry* entry = nullptr;
+        for (int i = 0; i < ProductionRule::numEntries; ++i) {
+            if (rule.entries[i].probability >= random) {
+                entry = rule.entries + i;
+                break;
+            }
+        }
+        assert(entry);      // no rule fired
+
+        if (!entry || entry->numChildren == 0) {
+            assert(numKeys < maxKeys);
+            if (numKeys < maxKeys) {
+                outKeys[numKeys++] = key;
+            }
+        } else {
+            assert(stackSize + entry->numChildren <= maxStack);
+            if (stackSize + entry->numChildren <= maxStack) {
+                for (int j = entry->numChildren - 1; j >= 0; --j) {
+                    stack[stackSize++] = children[entry->firstChild + j];
+                }
+            }
+        }
+    }
+    return numKeys;
+}
+
 /*
 
 StochasticGrammarDictionary
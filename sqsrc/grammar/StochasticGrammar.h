@@ -173,7 +173,65 @@ private:
 };
 
 
- 
+/* class CompiledGrammar
+ * A grammar flattened into a table, so that it may be evaluated without
+ * recursion, virtual calls or allocation.
+ *
+ * Every rule's entries keep their cumulative probabilities, and each entry's
+ * expansion is already broken down into the list of keys it produces.
+ * Evaluation draws random numbers in the same order as ProductionRule::evaluate,
+ * so given the same random numbers it generates the same symbols.
+ */
+class CompiledGrammar
+{
+public:
+    // the most symbols one evaluation of a two bar rule can generate (all sixteenths)
+    static const int maxSymbols = 32;
+
+    CompiledGrammar()
+    {
+    }
+    CompiledGrammar(const ProductionRule * rules, int numRules, GKEY firstRule);
+
+    /**
+     * Evaluate the first rule, writing each terminal symbol to outKeys.
+     * returns the number of symbols written.
+     */
+    int evaluate(AudioMath::RandomUniformFunc& r, GKEY * outKeys, int maxKeys) const;
+
+    int getDuration(GKEY key) const
+    {
+        assert(key < fullRuleTableSize);
+        return table[key].duration;
+    }
+
+    GKEY getFirstRule() const
+    {
+        return firstRule;
+    }
+private:
+    class Entry
+    {
+    public:
+        float probability = 0;
+        unsigned short firstChild = 0;
+        unsigned short numChildren = 0;     // zero means terminate
+    };
+    class Rule
+    {
+    public:
+        Entry entries[ProductionRule::numEntries];
+        int duration = 0;
+    };
+
+    static const int maxChildren = fullRuleTableSize * ProductionRule::numEntries * (ProductionRuleKeys::bufferSize - 1);
+    static const int maxStack = 64;
+
+    Rule table[fullRuleTableSize];
+    GKEY children[maxChildren];
+    GKEY firstRule = sg_invalid;
+};
+
 /* class StochasticGrammarDictionary
  *
  * just a collection of pre-made grammars
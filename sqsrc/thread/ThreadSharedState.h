@@ -36,7 +36,11 @@ public:
         TEST1,
         TEST2,
         NOISE,    // used by ColoredNoise
-        SAMP
+        SAMP,
+        SINES,    // used by Sines wavetable mode
+        NOISE_BANK,  // used by ColoredNoise
+        CONVOLVER_LOAD,
+        CONVOLVER_TAIL
     };
     ThreadMessage(Type t) : type(t)
     {
@@ -23,18 +23,48 @@ public:
     {
         assert(lambda);
         assert(divisor > 0);        // Not initialized
+        ++elapsed;
         if (--counter == 0) {
-            counter = divisor;
-            lambda();
+            fire();
         }
     }
 
+    /**
+     * Like step(), but calls the lambda on this call,
+     * and starts a new count of 'n' from here.
+     */
+    void stepAndFire()
+    {
+        assert(lambda);
+        assert(divisor > 0);        // Not initialized
+        ++elapsed;
+        fire();
+    }
+
     int getDiv() const
     {
         return divisor;
     }
+
+    /**
+     * Only valid inside the lambda.
+     * returns the number of step calls since the previous lambda call.
+     * Will be getDiv(), unless stepAndFire cut the count short.
+     */
+    int getElapsed() const
+    {
+        return elapsed;
+    }
 private:
     std::function<void()> lambda = nullptr;
     int divisor = 0;
     int counter = 1;
+    int elapsed = 0;
+
+    void fire()
+    {
+        counter = divisor;
+        lambda();
+        elapsed = 0;
+    }
 };
\ No newline at end of file
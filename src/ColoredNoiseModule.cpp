@@ -73,7 +73,8 @@ struct ColoredNoiseWidget : ModuleWidget
     Label * slopeLabel;
     Label * signLabel;
 
-    DECLARE_MANUAL("Colors manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/colors.md");
+    ColoredNoiseModule* noiseModule = nullptr;
+    void appendContextMenu(Menu* theMenu) override;
 
 
 #ifdef _TIME_DRAWING
@@ -86,6 +87,36 @@ struct ColoredNoiseWidget : ModuleWidget
 #endif
 };
 
+void ColoredNoiseWidget::appendContextMenu(Menu* theMenu)
+{
+    MenuLabel *spacerLabel = new MenuLabel();
+    theMenu->addChild(spacerLabel);
+    ManualMenuItem* manual = new ManualMenuItem("Colors manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/colors.md");
+    theMenu->addChild(manual);
+
+    MenuLabel *polyLabel = new MenuLabel();
+    polyLabel->text = "Polyphony";
+    theMenu->addChild(polyLabel);
+
+    ColoredNoiseModule* mod = noiseModule;
+    const int choices[] = {1, 2, 4, 8, 16};
+    for (int channels : choices) {
+        SqMenuItem* item = new SqMenuItem(
+            [mod, channels]() {
+                return mod && int(std::round(::rack::appGet()->engine->getParam(mod, Comp::CHANNELS_PARAM))) == channels;
+            },
+            [mod, channels]() {
+                if (mod) {
+                    ::rack::appGet()->engine->setParam(mod, Comp::CHANNELS_PARAM, float(channels));
+                }
+            });
+        SqStream s;
+        s.add(channels);
+        item->text = s.str();
+        theMenu->addChild(item);
+    }
+}
+
 // The colors of noise (UI colors)
 static const unsigned char red[3] = {0xff, 0x04, 0x14};
 static const unsigned char pink[3] = {0xff, 0x3a, 0x6d};
@@ -208,6 +239,7 @@ ColoredNoiseWidget::ColoredNoiseWidget(ColoredNoiseModule* module)
 ColoredNoiseWidget::ColoredNoiseWidget(ColoredNoiseModule *module) : ModuleWidget(module)
 {
 #endif
+    noiseModule = module;
     std::shared_ptr<IComposite> icomp = Comp::getDescription();
     box.size = Vec(6 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
 
@@ -309,6 +309,28 @@ void CompressorWidget2::addControls(Compressor2Module *module, std::shared_ptr<I
     p->text = labels[3];
     p->setLabels(labels);
     addParam(p);
+
+    std::vector<std::string> detectorLabels = Comp::detectors();
+    p = SqHelper::createParam<PopupMenuParamWidget>(
+        icomp,
+        Vec(8, 76),
+        module,
+        Comp::DETECTOR_PARAM);
+    p->box.size.x = 73;  // width
+    p->box.size.y = 22;
+    p->text = detectorLabels[0];
+    p->setLabels(detectorLabels);
+    addParam(p);
+
+#ifdef _LAB
+    addLabel(
+        Vec(knobX3 - 4, 50 - 20),
+        "Look");
+#endif
+    addParam(SqHelper::createParam<Blue30Knob>(
+        icomp,
+        Vec(knobX3, 50),
+        module,  Comp::LOOKAHEAD_PARAM));
 }
 
 void CompressorWidget2::addJacks(Compressor2Module *module, std::shared_ptr<IComposite> icomp)
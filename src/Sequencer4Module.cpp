@@ -60,6 +60,21 @@ public:
     }
 };
 
+class VoiceModeParamQuantity : public ParamQuantity
+{
+public:
+    VoiceModeParamQuantity( const ParamQuantity& other) {
+        ParamQuantity* base = this;
+        *base = other;
+    }
+    std::string getDisplayValueString() override {
+        const unsigned int index = (unsigned int)(std::round(getValue()));
+        const std::vector<std::string> labels = Comp::getVoiceModeLabels();
+        assert(index < labels.size());
+        return index < labels.size() ? labels[index] : "";
+    }
+};
+
 class PadParamQuantity  : public ParamQuantity
 {
 public:
@@ -104,6 +119,13 @@ Sequencer4Module::Sequencer4Module() {
         {
              this->paramQuantities[Comp::NUM_VOICES_PARAM + i]->displayOffset += 1;
         }
+        {
+            auto orig = this->paramQuantities[Comp::VOICE_MODE0_PARAM + i];
+            auto p = new VoiceModeParamQuantity(*orig);
+
+            delete orig;
+            this->paramQuantities[Comp::VOICE_MODE0_PARAM + i] = p;
+        }
     }
 
     for (int track=0; track<MidiSong4::numTracks; ++track) {
@@ -225,6 +247,45 @@ private:
 
 };
 
+class VoiceModeItem : public ::rack::ui::MenuItem {
+public:
+    VoiceModeItem() = delete;
+    static ::rack::ui::MenuItem* make(Sequencer4Module* module, int track, int value) {
+        const int paramId = Comp::VOICE_MODE0_PARAM + track;
+        std::function<bool()> isCheckedFn = [module, paramId, value]() {
+            float x = ::rack::appGet()->engine->getParam(module, paramId);
+            return int(std::round(x)) == value;
+        };
+
+        std::function<void()> clickFn = [module, paramId, value]() {
+             ::rack::appGet()->engine->setParam(module, paramId, value);
+        };
+
+        return new SqMenuItem(isCheckedFn, clickFn);
+    }
+};
+
+class VoiceModeMenuItem : public ::rack::ui::MenuItem {
+public:
+    VoiceModeMenuItem(Sequencer4Module* module, int track) : module(module), track(track) {
+    }
+    ::rack::ui::Menu* createChildMenu() override {
+        ::rack::ui::Menu* menu = new ::rack::ui::Menu();
+
+        const std::vector<std::string> labels = Comp::getVoiceModeLabels();
+        for (int i = 0; i < int(labels.size()); ++i) {
+            ::rack::ui::MenuItem* item = VoiceModeItem::make(module, track, i);
+            item->text = labels[i];
+            menu->addChild(item);
+        }
+
+        return menu;
+    }
+private:
+    Sequencer4Module* const module;
+    const int track;
+};
+
 void Sequencer4Widget::appendContextMenu(Menu* theMenu) {
     ::rack::ui::MenuLabel* spacerLabel = new ::rack::ui::MenuLabel();
     theMenu->addChild(spacerLabel);
@@ -256,6 +317,15 @@ void Sequencer4Widget::appendContextMenu(Menu* theMenu) {
         item->text = "CV select base octave";
         theMenu->addChild(item);
 
+        for (int track = 0; track < MidiSong4::numTracks; ++track) {
+            auto modeItem = new VoiceModeMenuItem(sModule, track);
+            SqStream str;
+            str.add("Track ");
+            str.add(track + 1);
+            str.add(" voice assignment");
+            modeItem->text = str.str();
+            theMenu->addChild(modeItem);
+        }
     }
    
 }
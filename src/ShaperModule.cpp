@@ -56,7 +56,7 @@ struct ShaperWidget : ModuleWidget
 {
     ShaperWidget(ShaperModule *);
 
-    DECLARE_MANUAL("Shaper manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/shaper.md");
+    void appendContextMenu(Menu *menu) override;
     /**
      * Helper to add a text label to this widget
      */
@@ -92,6 +92,34 @@ private:
     void addSelector(ShaperModule* module, std::shared_ptr<IComposite> icomp);
 };
 
+void ShaperWidget::appendContextMenu(Menu* theMenu)
+{
+    MenuLabel *spacerLabel = new MenuLabel();
+    theMenu->addChild(spacerLabel);
+    ManualMenuItem* manual = new ManualMenuItem("Shaper manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/shaper.md");
+    theMenu->addChild(manual);
+
+    MenuLabel *adaaLabel = new MenuLabel();
+    adaaLabel->text = "Anti-alias (ADAA)";
+    theMenu->addChild(adaaLabel);
+
+    ::rack::engine::Module* mod = module;
+    const char* const labels[] = {"Off", "First order", "Second order"};
+    for (int order = 0; order < 3; ++order) {
+        SqMenuItem* item = new SqMenuItem(
+            [mod, order]() {
+                return mod && int(std::round(::rack::appGet()->engine->getParam(mod, Comp::PARAM_ADAA))) == order;
+            },
+            [mod, order]() {
+                if (mod) {
+                    ::rack::appGet()->engine->setParam(mod, Comp::PARAM_ADAA, float(order));
+                }
+            });
+        item->text = labels[order];
+        theMenu->addChild(item);
+    }
+}
+
 void ShaperWidget::step()
 {
     ModuleWidget::step();
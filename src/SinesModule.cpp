@@ -89,7 +89,7 @@ void SinesModule::process(const ProcessArgs& args)
 struct SinesWidget : ModuleWidget
 {
     SinesWidget(SinesModule *);
-    DECLARE_MANUAL("Organ Manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/og.md");
+    void appendContextMenu(Menu *menu) override;
 
     Label* addLabel(const Vec& v, const char* str, const NVGcolor& color = SqHelper::COLOR_BLACK)
     {
@@ -106,6 +106,18 @@ struct SinesWidget : ModuleWidget
     void addOtherControls(SinesModule *module, std::shared_ptr<IComposite> icomp);
 };
 
+void SinesWidget::appendContextMenu(Menu* theMenu)
+{
+    MenuLabel *spacerLabel = new MenuLabel();
+    theMenu->addChild(spacerLabel);
+    ManualMenuItem* manual = new ManualMenuItem("Organ Manual", "https://github.com/squinkylabs/SquinkyVCV/blob/main/docs/og.md");
+    theMenu->addChild(manual);
+
+    SqMenuItem_BooleanParam2 * item = new SqMenuItem_BooleanParam2(module, Comp::WAVETABLE_PARAM);
+    item->text = "Wavetable mode";
+    theMenu->addChild(item);
+}
+
 //static float topRow = 81;
 void SinesWidget::addOtherControls(SinesModule *module, std::shared_ptr<IComposite> icomp)
 {
@@ -11,8 +11,17 @@
 #include "../SequencerModule.h"
 #include "../Sequencer4Module.h"
 
+/**
+ * Common base so we can find our own actions in the VCV history.
+ */
+class SeqActionBase : public ::rack::history::ModuleAction
+{
+public:
+    virtual size_t getMemoryUsage() const = 0;
+};
+
 template<class SequencerPtr, class Command, class Module, class Widget>
-class SeqAction : public ::rack::history::ModuleAction
+class SeqAction : public SeqActionBase
 {
 public:
     SeqAction(const std::string& _name, std::shared_ptr<Command> command, int moduleId, const std::string& moduleName)
@@ -37,6 +46,10 @@ public:
             wrappedCommand->execute(seq, wid);
         }
     }
+    size_t getMemoryUsage() const override
+    {
+        return sizeof(*this) + name.capacity() + wrappedCommand->getMemoryUsage();
+    }
 
 private:
     std::shared_ptr<Command> wrappedCommand;
@@ -80,6 +93,57 @@ void UndoRedoStack::setModuleId(int id)
     this->moduleId = id;
 }
 
+static SeqActionBase* getOurAction(::rack::history::Action* action, int moduleId)
+{
+    SeqActionBase* ret = dynamic_cast<SeqActionBase*>(action);
+    return (ret && ret->moduleId == moduleId) ? ret : nullptr;
+}
+
+size_t UndoRedoStack::getMemoryUsed() const
+{
+    size_t ret = 0;
+    for (auto action : ::rack::appGet()->history->actions) {
+        SeqActionBase* ours = getOurAction(action, moduleId);
+        if (ours) {
+            ret += ours->getMemoryUsage();
+        }
+    }
+    return ret;
+}
+
+void UndoRedoStack::setMaxMemory(size_t max)
+{
+    maxMemory = max;
+    enforceMemoryLimit();
+}
+
+/**
+ * VCV owns the history, so the best we can do is remove our own oldest
+ * entries from it. Other modules' actions are left alone. We never remove
+ * anything at or after the current index, so redo and the most recent
+ * undo are preserved.
+ */
+void UndoRedoStack::enforceMemoryLimit()
+{
+    if (maxMemory == 0) {
+        return;
+    }
+    ::rack::history::State* history = ::rack::appGet()->history;
+    size_t used = getMemoryUsed();
+    for (int i = 0; (used > maxMemory) && (i < history->actionIndex - 1); ) {
+        SeqActionBase* ours = getOurAction(history->actions[i], moduleId);
+        if (!ours) {
+            ++i;
+            continue;
+        }
+        const size_t mem = ours->getMemoryUsage();
+        used = (mem < used) ? used - mem : 0;
+        delete ours;
+        history->actions.erase(history->actions.begin() + i);
+        history->actionIndex--;
+    }
+}
+
 #ifdef _SEQ4
 void UndoRedoStack::execute4(MidiSequencer4Ptr seq, Sequencer4Widget* widget, std::shared_ptr<Sq4Command> cmd)
 {
@@ -88,6 +152,7 @@ void UndoRedoStack::execute4(MidiSequencer4Ptr seq, Sequencer4Widget* widget, st
     auto action = new SeqAction4("unknown", cmd, moduleId, "4X4");
 
     ::rack::appGet()->history->push(action);
+    enforceMemoryLimit();
 }
 
 void UndoRedoStack::execute4(MidiSequencer4Ptr seq, std::shared_ptr<Sq4Command> cmd)
@@ -97,6 +162,7 @@ void UndoRedoStack::execute4(MidiSequencer4Ptr seq, std::shared_ptr<Sq4Command>
     auto action = new SeqAction4("unknown", cmd, moduleId, "4X4");
 
     ::rack::appGet()->history->push(action);
+    enforceMemoryLimit();
 }
 #endif
 
@@ -107,6 +173,7 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, SequencerWidget* widget, std::
     auto action = new SeqAction1("unknown", cmd, moduleId, "Seq++");
 
     ::rack::appGet()->history->push(action);
+    enforceMemoryLimit();
 }
 void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd)
 {
@@ -115,6 +182,7 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd
     auto action = new SeqAction1("unknown", cmd, moduleId, "Seq++");
 
     ::rack::appGet()->history->push(action);
+    enforceMemoryLimit();
 }
 
 #endif
@@ -130,4 +198,14 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd
 {
 
 }
+
+size_t UndoRedoStack::getMemoryUsed() const
+{
+    return 0;
+}
+
+void UndoRedoStack::setMaxMemory(size_t max)
+{
+    maxMemory = max;
+}
 #endif
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "PerfSuite.h"
 #include "SimdBlocks.h"
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 #define __STDC_FORMAT_MACROS 
 #include <inttypes.h>
 #include "TimeStatsCollector.h"
@@ -20,6 +23,7 @@ class TestBuffers;
  * Will run the function over and over in a tight loop. Return value of function
  * is saved to testBuffers. Otherwise the compiler might optimize the whole thing away.
  * Usually ends by printing out the data.
+ * PerfSuite decides which tests run, and if they get the detailed measurement.
  *
  * One of that statistics printed out is "quota used per 1 percent". Here we are arbitrarily
  * stating that a synthesizer module "should" use only one percent of the available audio processing CPU.
@@ -44,10 +48,13 @@ public:
      * Will call func in a tight loop lasting minTime seconds.
      * When done, prints out statistics.
      *
-     * returns - percent used
+     * returns - percent used, or zero if PerfSuite skipped the test.
      */
     static double run(double overhead, const char * name, std::function<T()> func, float minTime)
     {
+        if (!PerfSuite::shouldMeasure(name)) {
+            return 0;
+        }
         int64_t iterations;
         bool done = false;
         double percent = 0;
@@ -69,11 +76,42 @@ public:
                 printf("quota used per 1 percent : %f\n", percent * 100);
                 fflush(stdout);
                 done = true;
+                if (PerfSuite::isDetailed()) {
+                    measureDetailed(overhead, name, func, iterations);
+                }
             }
         }
         return percent;
     }
 
+    /**
+     * Runs each trial as many times as the first measurement did, but timed in
+     * a thousand batches, and gives the cost per sample of each batch to PerfSuite.
+     * So the percentiles are over batches, each a thousandth of the run.
+     */
+    static void measureDetailed(double overhead, const char * name, std::function<T()> func, int64_t iterations)
+    {
+        const int batches = 1000;
+        const int64_t batchSize = std::max(int64_t(1), iterations / batches);
+        const int trials = PerfSuite::getTrials();
+
+        // overhead is in percent of 44.1k, we want nanoseconds per sample
+        const double overheadNs = overhead * 1e9 / (44100 * 100);
+        std::vector<double> costs;
+        costs.reserve(trials * batches);
+        for (int trial = 0; trial < trials; ++trial) {
+            for (int batch = 0; batch < batches; ++batch) {
+                const double elapsed = measureTimeSub(func, batchSize);
+                costs.push_back(elapsed * 1e9 / batchSize - overheadNs);
+            }
+        }
+        const PerfSuite::Result r = PerfSuite::summarize(name, costs, trials, batchSize);
+        printf("ns per sample: mean %f median %f, batches of %" PRId64 ": p99 %f p99.9 %f\n",
+            r.mean, r.median, r.batchSize, r.p99, r.p999);
+        fflush(stdout);
+        PerfSuite::add(r);
+    }
+
    /**
     * Run test iterators time, return total seconds.
     */
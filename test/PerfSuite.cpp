@@ -0,0 +1,342 @@
+#include "PerfSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <regex>
+#include <sstream>
+
+namespace {
+
+struct Options
+{
+    bool filtered = false;
+    std::regex filter;
+    bool all = false;
+    bool list = false;
+    bool detailed = false;
+    int trials = 1;
+    std::string jsonFile;
+    std::string csvFile;
+    std::string baselineFile;
+    double threshold = 10;
+    int alwaysMeasure = 0;
+
+    std::vector<PerfSuite::Result> results;
+};
+
+Options& options()
+{
+    static Options o;
+    return o;
+}
+
+std::string quoteCSV(const std::string& s)
+{
+    std::string ret = "\"";
+    for (char c : s) {
+        if (c == '"') {
+            ret += '"';
+        }
+        ret += c;
+    }
+    return ret + "\"";
+}
+
+std::string quoteJSON(const std::string& s)
+{
+    std::string ret = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret + "\"";
+}
+
+/**
+ * Splits a line from writeCSV into fields.
+ */
+std::vector<std::string> splitCSV(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += c;
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+const char* const csvHeader = "name,trials,batches,batch_size,mean_ns,median_ns,batch_p99_ns,batch_p999_ns,percent";
+const char* const csvMedian = "median_ns";
+
+bool writeCSV(const std::string& fileName, const std::vector<PerfSuite::Result>& results)
+{
+    std::ofstream out(fileName);
+    if (!out) {
+        return false;
+    }
+    out << csvHeader << "\n";
+    for (auto& r : results) {
+        out << quoteCSV(r.name) << "," << r.trials << "," << r.batches << "," << r.batchSize << ","
+            << r.mean << "," << r.median << "," << r.p99 << "," << r.p999 << "," << r.percent << "\n";
+    }
+    return bool(out);
+}
+
+bool writeJSON(const std::string& fileName, const std::vector<PerfSuite::Result>& results)
+{
+    std::ofstream out(fileName);
+    if (!out) {
+        return false;
+    }
+    out << "{\n  \"units\": \"ns per sample\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": " << quoteJSON(r.name)
+            << ", \"trials\": " << r.trials
+            << ", \"batches\": " << r.batches
+            << ", \"batch_size\": " << r.batchSize
+            << ", \"mean\": " << r.mean
+            << ", \"median\": " << r.median
+            << ", \"batch_p99\": " << r.p99
+            << ", \"batch_p99.9\": " << r.p999
+            << ", \"percent\": " << r.percent << "}";
+    }
+    out << "\n  ]\n}\n";
+    return bool(out);
+}
+
+/**
+ * Returns the number of regressions, or -1 if the baseline can't be read.
+ * The median is found by name in the header, so older files still work.
+ */
+int compareToBaseline(const std::string& fileName, const std::vector<PerfSuite::Result>& results, double threshold)
+{
+    std::ifstream in(fileName);
+    if (!in) {
+        return -1;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(in, line);
+    const auto header = splitCSV(line);
+    const size_t median = std::find(header.begin(), header.end(), csvMedian) - header.begin();
+    if (median == header.size()) {
+        return -1;
+    }
+    while (std::getline(in, line)) {
+        const auto fields = splitCSV(line);
+        if (fields.size() > median) {
+            baseline[fields[0]] = std::atof(fields[median].c_str());
+        }
+    }
+
+    int regressions = 0;
+    printf("\ncompared to %s, threshold %.1f%%:\n", fileName.c_str(), threshold);
+    for (auto& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end()) {
+            printf("  %s: not in baseline\n", r.name.c_str());
+            continue;
+        }
+        const double old = it->second;
+        const double change = (old > 0) ? 100 * (r.median - old) / old : 0;
+        const bool regressed = change > threshold;
+        if (regressed) {
+            ++regressions;
+        }
+        printf("  %s: %.2f ns -> %.2f ns (%+.1f%%)%s\n", r.name.c_str(), old, r.median, change,
+            regressed ? " REGRESSION" : "");
+    }
+    return regressions;
+}
+
+bool needsValue(int i, int argc, const std::string& arg)
+{
+    if (i + 1 >= argc) {
+        printf("%s needs a value\n", arg.c_str());
+        return false;
+    }
+    return true;
+}
+
+}   // namespace
+
+bool PerfSuite::parse(int argc, char** argv)
+{
+    Options& o = options();
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--all") {
+            o.all = true;
+        } else if (arg == "--list") {
+            o.list = true;
+        } else if (arg == "--filter" || arg == "--trials" || arg == "--json" ||
+            arg == "--csv" || arg == "--baseline" || arg == "--threshold") {
+            if (!needsValue(i, argc, arg)) {
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--filter") {
+                try {
+                    o.filter = std::regex(value, std::regex::icase);
+                } catch (std::regex_error&) {
+                    printf("%s is not a valid regular expression\n", value.c_str());
+                    return false;
+                }
+                o.filtered = true;
+            } else if (arg == "--trials") {
+                o.trials = std::atoi(value.c_str());
+                o.detailed = true;
+                if (o.trials < 1) {
+                    printf("--trials must be at least 1\n");
+                    return false;
+                }
+            } else if (arg == "--json") {
+                o.jsonFile = value;
+                o.detailed = true;
+            } else if (arg == "--csv") {
+                o.csvFile = value;
+                o.detailed = true;
+            } else if (arg == "--baseline") {
+                o.baselineFile = value;
+                o.detailed = true;
+            } else {
+                char* end = nullptr;
+                o.threshold = std::strtod(value.c_str(), &end);
+                if (end == value.c_str() || *end != 0 || !(o.threshold >= 0)) {
+                    printf("--threshold must be a number, at least 0\n");
+                    return false;
+                }
+            }
+        } else {
+            printf("%s is not a valid perf argument\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PerfSuite::shouldMeasure(const char* name)
+{
+    Options& o = options();
+    if (o.alwaysMeasure) {
+        return true;
+    }
+    if (o.filtered && !std::regex_search(name, o.filter)) {
+        return false;
+    }
+    if (o.list) {
+        printf("%s\n", name);
+        fflush(stdout);
+        return false;
+    }
+    return true;
+}
+
+bool PerfSuite::isExtended()
+{
+    return options().all || options().filtered;
+}
+
+bool PerfSuite::isDetailed()
+{
+    return options().detailed;
+}
+
+int PerfSuite::getTrials()
+{
+    return options().trials;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    const size_t index = size_t(std::ceil(p * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+PerfSuite::Result PerfSuite::summarize(const char* name, std::vector<double>& costs, int trials, int64_t batchSize)
+{
+    Result r;
+    r.name = name;
+    r.trials = trials;
+    r.batches = int(costs.size());
+    r.batchSize = batchSize;
+    if (costs.empty()) {
+        return r;
+    }
+    std::sort(costs.begin(), costs.end());
+    r.mean = std::accumulate(costs.begin(), costs.end(), 0.0) / costs.size();
+    r.median = percentile(costs, .5);
+    r.p99 = percentile(costs, .99);
+    r.p999 = percentile(costs, .999);
+    r.percent = r.median * 44100 * 100 / 1e9;
+    return r;
+}
+
+void PerfSuite::add(const Result& r)
+{
+    options().results.push_back(r);
+}
+
+int PerfSuite::finish()
+{
+    Options& o = options();
+    int ret = 0;
+    if (!o.csvFile.empty() && !writeCSV(o.csvFile, o.results)) {
+        printf("could not write %s\n", o.csvFile.c_str());
+        ret = 1;
+    }
+    if (!o.jsonFile.empty() && !writeJSON(o.jsonFile, o.results)) {
+        printf("could not write %s\n", o.jsonFile.c_str());
+        ret = 1;
+    }
+    if (!o.baselineFile.empty()) {
+        const int regressions = compareToBaseline(o.baselineFile, o.results, o.threshold);
+        if (regressions < 0) {
+            printf("could not read baseline %s\n", o.baselineFile.c_str());
+            ret = 1;
+        } else if (regressions > 0) {
+            printf("%d regressions\n", regressions);
+            ret = 1;
+        }
+    }
+    fflush(stdout);
+    return ret;
+}
+
+PerfSuite::AlwaysMeasure::AlwaysMeasure()
+{
+    ++options().alwaysMeasure;
+}
+
+PerfSuite::AlwaysMeasure::~AlwaysMeasure()
+{
+    --options().alwaysMeasure;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * class PerfSuite.
+ *
+ * Lets the perf tests be picked by name, measured in more detail,
+ * saved, and compared to an earlier run.
+ *
+ * perf.exe (or test.exe --perf) takes:
+ *      --filter <regex>    only measure the tests whose name matches, anywhere in the name, ignoring case.
+ *                          This also turns on the tests that are off by default.
+ *      --all               measure every test, including the ones that are off by default.
+ *      --list              print the names of the tests, without measuring them.
+ *      --trials <n>        measure each test n times. Default is 1.
+ *      --json <file>       write the results to a JSON file.
+ *      --csv <file>        write the results to a CSV file.
+ *      --baseline <file>   compare to a CSV file from an earlier --csv.
+ *      --threshold <n>     percent slower than the baseline that counts as a regression. Default is 10.
+ *
+ * Without any of --trials, --json, --csv or --baseline the tests
+ * run the way they always have.
+ *
+ * With them, MeasureTime times each test in a thousand batches per trial, and
+ * keeps the mean, median, p99 and p99.9 of the cost per sample of each batch.
+ * A batch is a thousandth of the first measurement, usually thousands of samples,
+ * so these are percentiles of batch averages, not of single samples. The results
+ * say how many samples are in a batch, and label the tails batch_p99 and batch_p999.
+ * Timing single samples would mostly measure the timer, which reads the thread's
+ * CPU time, so time spent preempted doesn't show in any of them.
+ * The baseline comparison uses the median, which is the most repeatable.
+ */
+class PerfSuite
+{
+public:
+    PerfSuite() = delete;       // we are only static
+
+    struct Result
+    {
+        std::string name;
+        int trials = 0;
+        int batches = 0;        // number of timed batches
+        int64_t batchSize = 0;  // samples in each batch
+        double mean = 0;        // the costs are nanoseconds per sample
+        double median = 0;
+        double p99 = 0;         // over the batches, not single samples
+        double p999 = 0;
+        double percent = 0;     // percent of one core at 44.1k, from the median
+    };
+
+    /**
+     * Parses the command line options (without the program name).
+     * Returns false, after printing why, if they don't make sense.
+     */
+    static bool parse(int argc, char** argv);
+
+    /**
+     * MeasureTime calls this before running a test.
+     * Returns false if the test should be skipped.
+     */
+    static bool shouldMeasure(const char* name);
+
+    /**
+     * True if the tests that are off by default should run.
+     */
+    static bool isExtended();
+
+    /**
+     * True if MeasureTime should measure percentiles and save a Result.
+     */
+    static bool isDetailed();
+    static int getTrials();
+
+    /**
+     * Makes a result from the cost per sample of every batch.
+     * Sorts costs.
+     */
+    static Result summarize(const char* name, std::vector<double>& costs, int trials, int64_t batchSize);
+    static void add(const Result&);
+
+    /**
+     * Writes the results, compares them to the baseline.
+     * Returns the exit code for main: non zero for a regression, or an error.
+     */
+    static int finish();
+
+    /**
+     * While one of these exists every test is measured, filter or not.
+     * For the overhead measurement the other tests depend on.
+     */
+    class AlwaysMeasure
+    {
+    public:
+        AlwaysMeasure();
+        ~AlwaysMeasure();
+    };
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "TestComposite.h"
+
+// MixM uses the Module from Mix8.h, like in the other mixer tests
+#include "Mix8.h"
+#include "Mix4.h"
+#include "MixM.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**
+ * Stands in for MixerModule: one mixer composite, set up the way the module does it.
+ */
+template <class TComp>
+class TestMixerClient
+{
+public:
+    TestMixerClient()
+    {
+        comp.init();
+        auto icomp = comp.getDescription();
+        for (int i = 0; i < icomp->getNumParams(); ++i) {
+            comp.params[i].value = icomp->getParam(i).def;
+        }
+        comp._disableAntiPop();
+        // channels default to off
+        for (int i = 0; i < TComp::numChannels; ++i) {
+            comp.inputs[TComp::AUDIO0_INPUT + i].channels = 1;
+            comp.params[TComp::GAIN0_PARAM + i].value = 1;
+        }
+    }
+    TComp comp;
+};
+
+/**
+ * A row of Mix4 expanders with a MixM master on the right end.
+ * It passes the busses like the expander messages do.
+ */
+class TestMixerChain
+{
+public:
+    using Expander = TestMixerClient<Mix4<TestComposite>>;
+    using Master = TestMixerClient<MixM<TestComposite>>;
+
+    explicit TestMixerChain(int numExpanders) : hops(numExpanders)
+    {
+        for (int i = 0; i < numExpanders; ++i) {
+            expanders.push_back(std::make_shared<Expander>());
+        }
+        for (auto& hop : hops) {
+            std::fill(hop.flip, hop.flip + comBufferSizeRight, 0.f);
+            std::fill(hop.flop, hop.flop + comBufferSizeRight, 0.f);
+            hop.producer = hop.flip;
+            hop.consumer = hop.flop;
+        }
+    }
+
+    /**
+     * Like the engine with the expander messages: every module reads
+     * the busses its left neighbor wrote last sample, then they all flip.
+     */
+    void stepExpanderMessages()
+    {
+        const int n = int(expanders.size());
+        for (int i = 0; i < n; ++i) {
+            expanders[i]->comp.setExpansionInputs(i == 0 ? nullptr : hops[i - 1].consumer);
+            expanders[i]->comp.setExpansionOutputs(hops[i].producer);
+            expanders[i]->comp.step();
+        }
+        master.comp.setExpansionInputs(n == 0 ? nullptr : hops[n - 1].consumer);
+        master.comp.step();
+        for (auto& hop : hops) {
+            std::swap(hop.producer, hop.consumer);
+        }
+    }
+
+    std::vector<std::shared_ptr<Expander>> expanders;
+    Master master;
+
+private:
+    class Hop
+    {
+    public:
+        float flip[comBufferSizeRight];
+        float flop[comBufferSizeRight];
+        float* producer = nullptr;
+        float* consumer = nullptr;
+    };
+    std::vector<Hop> hops;
+};
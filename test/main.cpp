@@ -7,6 +7,8 @@
 
 #include <string>
 
+#include "PerfSuite.h"
+
 extern void testMidiPlayer2();
 extern void testMidiPlayer4();
 extern void testBiquad();
@@ -30,6 +32,7 @@ extern void testFFT();
 extern void testRingBuffer();
 extern void testManagedPool();
 extern void testColoredNoise();
+extern void testConvolver();
 extern void testFFTCrossFader();
 extern void testFinalLeaks();
 extern void testClockMult();
@@ -41,11 +44,16 @@ extern void testStochasticGrammar();
 extern void testGMR();
 extern void testLowpassFilter();
 extern void testPoly();
+extern void testChebyshevShaper();
 extern void testVCO();
+extern void testMinBLEPVCO_4();
 extern void testFilterDesign();
 extern void testVCOAlias();
 extern void testSin();
 extern void testRateConversion();
+extern void testShaperADAA();
+extern void testShaperPoly();
+extern void testPolyApprox();
 extern void testDelay();
 extern void testSpline(bool emit);
 extern void testButterLookup();
@@ -74,6 +82,7 @@ extern void testMix8();
 extern void testMix4();
 extern void testMixHelper();
 extern void testStereoMix();
+extern void testMixerChain();
 extern void testSlew4();
 extern void testCommChannels();
 extern void testLadder();
@@ -169,12 +178,20 @@ int main(int argc, char** argv) {
     bool extended = false;
     bool runShaperGen = false;
     bool cq = false;
+    int firstPerfArg = 1;       // the rest of the arguments go to PerfSuite
+#ifdef _PERF
+    runPerf = true;
+#ifndef NDEBUG
+#error asserts should be off for perf test
+#endif
+#else
     if (argc > 1) {
         std::string arg = argv[1];
         if (arg == "--ext") {
             extended = true;
         } else if (arg == "--perf") {
             runPerf = true;
+            firstPerfArg = 2;
         } else if (arg == "--shaper") {
             runShaperGen = true;
         } else if (arg == "--calQ") {
@@ -183,11 +200,6 @@ int main(int argc, char** argv) {
             printf("%s is not a valid command line argument\n", arg.c_str());
         }
     }
-#ifdef _PERF
-    runPerf = true;
-#ifndef NDEBUG
-#error asserts should be off for perf test
-#endif
 #endif
     // While this code may work in 32 bit applications, it's not tested for that.
     // Want to be sure we are testing the case we care about.
@@ -204,11 +216,14 @@ int main(int argc, char** argv) {
     }
 
     if (runPerf) {
+        if (!PerfSuite::parse(argc - firstPerfArg, argv + firstPerfArg)) {
+            return 1;
+        }
         initPerf();
         perfTest3();
         perfTest2();
         perfTest();
-        return 0;
+        return PerfSuite::finish();
     }
 
     testSimpleQuantizer();
@@ -302,6 +317,7 @@ int main(int argc, char** argv) {
     testSlew4();
     testMixHelper();
     testStereoMix();
+    testMixerChain();
     testMix4();
     testMix8();
 
@@ -312,14 +328,19 @@ int main(int argc, char** argv) {
     testClockMult();
     testDelay();
     testPoly();
+    testChebyshevShaper();
     testSinOscillator();
     testHilbert();
     testButterLookup();
     testVCO();
+    testMinBLEPVCO_4();
     // testSin();
     testFFT();
     testAnalyzer();
     testRateConversion();
+    testShaperADAA();
+    testShaperPoly();
+    testPolyApprox();
     testUtils();
     testLowpassFilter();
     testLadder();
@@ -344,6 +365,7 @@ int main(int argc, char** argv) {
     // after testing all the components, test composites.
     testTremolo();
     testColoredNoise();
+    testConvolver();
 
     testFrequencyShifter();
     testVocalAnimator();
@@ -2,6 +2,7 @@
 #include <time.h>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 #include "TestComposite.h"
 #include "AudioMath.h"
@@ -13,17 +14,23 @@
 #include "CompCurves.h"
 #include "FrequencyShifter.h"
 #include "HilbertFilterDesigner.h"
+#include "IIRDecimator.h"
+#include "IIRUpsampler.h"
+#include "PolyphaseDecimator.h"
+#include "PolyphaseUpsampler.h"
 #include "LookupTableFactory.h"
 #include "TestComposite.h"
 #include "Tremolo.h"
 #include "VocalAnimator.h"
 #include "VocalFilter.h"
 #include "LFN.h"
+#include "OnsetDetector.h"
 #include "LFNB.h"
 #include "GMR.h"
 #include "CHB.h"
 #include "FunVCOComposite.h"
-//#include "EV3.h"
+#include "EV3.h"
+#include "TestMixerChain.h"
 #include "daveguide.h"
 #include "Shaper.h"
 #include "Super.h"
@@ -134,7 +141,8 @@ static void testHilbert()
     BiquadState<T, 3> state;
     HilbertFilterDesigner<T>::design(44100, paramsSin, paramsCos);
 
-    MeasureTime<T>::run("hilbert", [&state, &paramsSin]() {
+    const char* name = (sizeof(T) == sizeof(float)) ? "hilbert float" : "hilbert double";
+    MeasureTime<T>::run(overheadInOut, name, [&state, &paramsSin]() {
 
         T d = BiquadFilter<T>::run(TestBuffers<T>::get(), state, paramsSin);
         return d;
@@ -256,6 +264,25 @@ static void testShifter()
         }, 1);
 }
 
+static void testShifterPoly()
+{
+    Shifter fs;
+
+    fs.setSampleRate(44100);
+    fs.init();
+
+    fs.inputs[Shifter::AUDIO_INPUT].channels = 16;
+    fs.outputs[Shifter::SIN_OUTPUT].channels = 1;
+    fs.outputs[Shifter::COS_OUTPUT].channels = 1;
+
+    assert(overheadInOut >= 0);
+    MeasureTime<float>::run(overheadInOut, "shifter 16 channel", [&fs]() {
+        fs.inputs[Shifter::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        fs.step();
+        return fs.outputs[Shifter::SIN_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testAnimator()
 {
     Animator an;
@@ -303,6 +330,152 @@ static void testColors()
         }, 1);
 }
 
+static void waitForColors(Colors& co, int channels = 1)
+{
+    while (co._msgCount() < channels) {
+        co.step();
+    }
+}
+
+static void testColors16()
+{
+    Colors co;
+    co.init();
+    co.params[Colors::CHANNELS_PARAM].value = 16;
+    co.outputs[Colors::AUDIO_OUTPUT].channels = 1;
+    co.params[Colors::SLOPE_PARAM].value = -1.7f;
+    waitForColors(co, 16);
+
+    MeasureTime<float>::run(overheadInOut, "colors 16 channels", [&co]() {
+        co.step();
+        return co.outputs[Colors::AUDIO_OUTPUT].getVoltage(15);
+        }, 1);
+}
+
+/**
+ * Moves the slope knob every sample.
+ * Counts what gets allocated, and how many times the server is asked for new noise.
+ */
+static void testColorsSweep()
+{
+    Colors co;
+    co.init();
+    waitForColors(co);
+
+    const int messages = co._msgCount();
+    const int buffers = FFTDataReal::_count + FFTDataCpx::_count;
+    float slope = -5;
+    MeasureTime<float>::run(overheadInOut, "colors knob sweep", [&co, &slope]() {
+        slope += .001f;
+        if (slope > 5) {
+            slope = -5;
+        }
+        co.params[Colors::SLOPE_PARAM].value = slope;
+        co.step();
+        return co.outputs[Colors::AUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+    printf("colors knob sweep: %d server requests, %d fft buffers allocated\n",
+        co._msgCount() - messages,
+        FFTDataReal::_count + FFTDataCpx::_count - buffers);
+}
+
+/**
+ * One FFT per call, so "per sec" is transforms per second.
+ */
+static void testFFT(int size, FFT::Backend backend, bool inverse)
+{
+    FFTDataReal signal(size);
+    FFTDataCpx spectrum(size);
+    for (int i = 0; i < size; ++i) {
+        signal.set(i, TestBuffers<float>::get());
+    }
+    FFT::forward(&spectrum, signal);
+
+    FFT::setBackend(backend);
+    std::string name = "fft ";
+    name += (backend == FFT::Backend::Kiss) ? "kiss " : "simd ";
+    name += inverse ? "inverse " : "forward ";
+    name += std::to_string(size);
+    MeasureTime<float>::run(0, name.c_str(), [&signal, &spectrum, inverse]() {
+        if (inverse) {
+            FFT::inverse(&signal, spectrum);
+        } else {
+            FFT::forward(&spectrum, signal);
+        }
+        return signal.get(0);
+        }, 1);
+    FFT::setBackend(FFT::Backend::Simd);
+}
+
+static void testFFTSweep()
+{
+    for (int size = 64; size <= 1024 * 64; size *= 4) {
+        for (bool inverse : {false, true}) {
+            testFFT(size, FFT::Backend::Kiss, inverse);
+            testFFT(size, FFT::Backend::Simd, inverse);
+        }
+    }
+}
+
+static void testOnsetDetector()
+{
+    OnsetDetector o;
+    MeasureTime<float>::run(overheadInOut, "onset detector", [&o]() {
+        return o.step(TestBuffers<float>::get()) ? 1.f : 0.f;
+        }, 1);
+}
+
+/**
+ * The analysis is spread over a hop, so the worst case is the most
+ * expensive position in the hop. First find that position, then time it
+ * in every hop and give those costs to PerfSuite, like MeasureTime does.
+ * The costs include the timer.
+ */
+static void testOnsetDetectorWorstCase()
+{
+    const char* name = "onset detector worst case";
+    if (!PerfSuite::shouldMeasure(name)) {
+        return;
+    }
+    OnsetDetector o;
+    float sum = 0;
+    auto timeStep = [&o, &sum]() {
+        const float x = TestBuffers<float>::get();
+        const double t0 = SqTime::seconds();
+        sum += o.step(x) ? 1.f : 0.f;
+        return (SqTime::seconds() - t0) * 1e9;
+    };
+
+    const int hops = 20000;
+    std::vector<double> positionCost(OnsetDetector::hopSize, 0);
+    for (int hop = 0; hop < hops / 10; ++hop) {
+        for (int i = 0; i < OnsetDetector::hopSize; ++i) {
+            positionCost[i] += timeStep();
+        }
+    }
+    const int worst = int(std::max_element(positionCost.begin(), positionCost.end()) - positionCost.begin());
+
+    const int trials = PerfSuite::getTrials();
+    std::vector<double> costs;
+    costs.reserve(trials * hops);
+    for (int hop = 0; hop < trials * hops; ++hop) {
+        for (int i = 0; i < OnsetDetector::hopSize; ++i) {
+            if (i == worst) {
+                costs.push_back(timeStep());
+            } else {
+                sum += o.step(TestBuffers<float>::get()) ? 1.f : 0.f;
+            }
+        }
+    }
+
+    // every sample is timed by itself, so these percentiles are of single samples
+    const PerfSuite::Result r = PerfSuite::summarize(name, costs, trials, 1);
+    printf("\nmeasure %s, position %d in the hop (%f)\n", name, worst, sum);
+    printf("ns per sample: mean %f median %f p99 %f p99.9 %f\n", r.mean, r.median, r.p99, r.p999);
+    fflush(stdout);
+    PerfSuite::add(r);
+}
+
 static void testTremolo()
 {
     Trem tr;
@@ -591,17 +764,46 @@ static void testCHBdef()
         }, 1);
 }
 
-#if 0
+static void testCHBPoly(int channels)
+{
+    CHB<TestComposite> chb;
+    chb.inputs[CHB<TestComposite>::CV_INPUT].channels = channels;
+    chb.outputs[CHB<TestComposite>::MIX_OUTPUT].channels = 1;
+    std::string name = "chb poly " + std::to_string(channels);
+    MeasureTime<float>::run(overheadOutOnly, name.c_str(), [&chb]() {
+        chb.step();
+        return chb.outputs[CHB<TestComposite>::MIX_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testEV3()
 {
     EV3<TestComposite> ev3;
+    ev3.params[EV3<TestComposite>::MIX1_PARAM].value = 1;
+    ev3.params[EV3<TestComposite>::MIX2_PARAM].value = 1;
+    ev3.params[EV3<TestComposite>::MIX3_PARAM].value = 1;
+    ev3.params[EV3<TestComposite>::WAVE1_PARAM].value = float(EV3<TestComposite>::Waves::SAW);
+    ev3.params[EV3<TestComposite>::WAVE2_PARAM].value = float(EV3<TestComposite>::Waves::SAW);
+    ev3.params[EV3<TestComposite>::WAVE3_PARAM].value = float(EV3<TestComposite>::Waves::SAW);
 
     MeasureTime<float>::run(overheadOutOnly, "ev3", [&ev3]() {
         ev3.step();
         return ev3.outputs[EV3<TestComposite>::MIX_OUTPUT].value;
         }, 1);
 }
-#endif
+
+// five Mix4 expanders and a MixM master
+static void testMixerChain()
+{
+    TestMixerChain chain(5);
+    for (auto& expander : chain.expanders) {
+        expander->comp.inputs[Mix4<TestComposite>::AUDIO0_INPUT].setVoltage(1, 0);
+    }
+    MeasureTime<float>::run(overheadOutOnly, "mixer chain 6", [&chain]() {
+        chain.stepExpanderMessages();
+        return chain.master.comp.outputs[MixM<TestComposite>::LEFT_OUTPUT].getVoltage(0);
+        }, 1);
+}
 
 static void testGMR()
 {
@@ -616,6 +818,43 @@ static void testGMR()
         }, 1);
 }
 
+/**
+ * Generating a sequence happens once every two bars, not per sample,
+ * so time a million bars of it directly.
+ */
+static void testGrammar(int grammarIndex)
+{
+    StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(grammarIndex);
+    AudioMath::RandomUniformFunc r = AudioMath::random();
+    const int numBars = 1000000;
+    const int numEvals = numBars / 2;       // grammars all start with two bars
+
+    TriggerSequencer::Event data[CompiledGrammar::maxSymbols + 1];
+    int total = 0;
+    const double t0 = SqTime::seconds();
+    for (int i = 0; i < numEvals; ++i) {
+        GTGEvaluator es(r, data);
+        es.rules = g.rules;
+        es.numRules = g.numRules;
+        ProductionRule::evaluate(es, g.firstRule);
+        es.writeEnd();
+        total += data[0].delay;
+    }
+    const double t1 = SqTime::seconds();
+
+    CompiledGrammar compiled(g.rules, g.numRules, g.firstRule);
+    GKEY keys[CompiledGrammar::maxSymbols];
+    for (int i = 0; i < numEvals; ++i) {
+        total += compiled.evaluate(r, keys, CompiledGrammar::maxSymbols);
+    }
+    const double t2 = SqTime::seconds();
+
+    printf("\ngrammar %d, %d bars (%d)\n", grammarIndex, numBars, total & 1);
+    printf("recursive: %f seconds\n", t1 - t0);
+    printf("compiled: %f seconds\n", t2 - t1);
+    fflush(stdout);
+}
+
 static void testDG()
 {
     Daveguide<TestComposite> gmr;
@@ -676,6 +915,56 @@ static void testBiquad()
         }, 1);
 }
 
+/**
+ * one sample at the base rate, up and back down.
+ */
+template <class TUp, class TDec>
+static void testUpDown(const std::string& name, int oversample)
+{
+    TUp up;
+    TDec dec;
+    up.setup(oversample);
+    dec.setup(oversample);
+
+    MeasureTime<float>::run(overheadInOut, (name + " x" + std::to_string(oversample)).c_str(), [&up, &dec]() {
+        float buffer[16];
+        up.process(buffer, TestBuffers<float>::get());
+        return dec.process(buffer);
+        }, 1);
+}
+
+template <class TDec>
+static void testDecimate4(const std::string& name, int oversample)
+{
+    TDec dec;
+    dec.setup(oversample);
+
+    MeasureTime<float>::run(overheadInOut, (name + " x" + std::to_string(oversample)).c_str(), [&dec, oversample]() {
+        float_4 buffer[16];
+        const float x = TestBuffers<float>::get();
+        for (int i = 0; i < oversample; ++i) {
+            buffer[i] = x;
+        }
+        return dec.process(buffer)[0];
+        }, 1);
+}
+
+static void testRateConversion()
+{
+    for (int oversample = 4; oversample <= 16; oversample *= 2) {
+        testUpDown<IIRUpsampler<float>, IIRDecimator<float>>("IIR up/down", oversample);
+    }
+    for (int oversample = 2; oversample <= 16; oversample *= 2) {
+        testUpDown<PolyphaseUpsampler<float>, PolyphaseDecimator<float>>("polyphase up/down", oversample);
+    }
+    for (int oversample = 4; oversample <= 16; oversample *= 2) {
+        testDecimate4<IIRDecimator<float_4>>("IIR dec simd", oversample);
+    }
+    for (int oversample = 2; oversample <= 16; oversample *= 2) {
+        testDecimate4<PolyphaseDecimator<float_4>>("polyphase dec simd", oversample);
+    }
+}
+
 //#ifndef _MSC_VER
 #if 1
  
@@ -881,6 +1170,33 @@ static void testOrgan12()
     }, 1);
 }
 
+static void testOrganWavetable(int channels)
+{
+    printf("starting organ wavetable %d\n", channels); fflush(stdout);
+    Sines<TestComposite> sines;
+
+    sines.init();
+    sines.inputs[Sines<TestComposite>::MAIN_OUTPUT].channels = 1;
+    sines.inputs[Sines<TestComposite>::VOCT_INPUT].channels = channels;
+    sines.inputs[Sines<TestComposite>::GATE_INPUT].channels = channels;
+    sines.params[Sines<TestComposite>::WAVETABLE_PARAM].value = 1;
+
+    Sines<TestComposite>::ProcessArgs args;
+    args.sampleTime = 1.f / 44100.f;
+    args.sampleRate = 44199;
+
+    // wait for the first table
+    while (!sines._usingWavetable()) {
+        sines.process(args);
+    }
+
+    std::string name = "organ wavetable " + std::to_string(channels);
+    MeasureTime<float>::run(overheadOutOnly, name.c_str(), [&sines, args]() {
+        sines.process(args);
+        return sines.outputs[Sines<TestComposite>::MAIN_OUTPUT].getVoltage(0);           
+    }, 1);
+}
+
 static void testSubMono()
 {
     Sub<TestComposite> sub;
@@ -988,6 +1304,26 @@ static void testSuper3()
         return super.outputs[Super<TestComposite>::MAIN_OUTPUT_LEFT].getVoltage(0);
         }, 1);
 }
+
+static void testSuperPolyStereo(int numChannels, int mode, const char* name)
+{
+    using Comp = Super<TestComposite>;
+    Comp super;
+
+    super.params[Comp::CLEAN_PARAM].value = float(mode);
+    super.outputs[Comp::MAIN_OUTPUT_LEFT].channels = 1;
+    super.outputs[Comp::MAIN_OUTPUT_RIGHT].channels = 1;
+    super.inputs[Comp::CV_INPUT].channels = numChannels;
+    MeasureTime<float>::run(overheadOutOnly, name, [&super, numChannels]() {
+        super.step();
+        float ret = 0;
+        for (int i = 0; i < numChannels; ++i) {
+            ret += super.outputs[Comp::MAIN_OUTPUT_LEFT].getVoltage(i) +
+                super.outputs[Comp::MAIN_OUTPUT_RIGHT].getVoltage(i);
+        }
+        return ret;
+    }, 1);
+}
 #if 0
 static void testSuper2()
 {
@@ -1034,6 +1370,23 @@ static void testShaper1c()
         }, 1);
 }
 
+static void testShaperADAA(int oversampleCode, int adaaOrder, const char* name)
+{
+    Shaper<TestComposite> gmr;
+
+    gmr.params[Shaper<TestComposite>::PARAM_SHAPE].value = (float) Shaper<TestComposite>::Shapes::FullWave;
+    gmr.params[Shaper<TestComposite>::PARAM_OVERSAMPLE].value = float(oversampleCode);
+    gmr.params[Shaper<TestComposite>::PARAM_ADAA].value = float(adaaOrder);
+    gmr.inputs[Shaper<TestComposite>::INPUT_AUDIO0].channels = 1;
+    gmr.outputs[Shaper<TestComposite>::OUTPUT_AUDIO0].channels = 1;
+
+    MeasureTime<float>::run(overheadOutOnly, name, [&gmr]() {
+        gmr.inputs[Shaper<TestComposite>::INPUT_AUDIO0].setVoltage(TestBuffers<float>::get(), 0);
+        gmr.step();
+        return gmr.outputs[Shaper<TestComposite>::OUTPUT_AUDIO0].getVoltage(0);
+        }, 1);
+}
+
 // 284
 static void testShaper2()
 {
@@ -1095,6 +1448,25 @@ static void testShaper5()
         return gmr.outputs[Shaper<TestComposite>::OUTPUT_AUDIO0].getVoltage(0);
         }, 1);
 }
+
+static void testShaperPoly(Shaper<TestComposite>::Shapes shape, int numChannels, const char* name)
+{
+    Shaper<TestComposite> gmr;
+
+    gmr.params[Shaper<TestComposite>::PARAM_SHAPE].value = (float) shape;
+    gmr.params[Shaper<TestComposite>::PARAM_OVERSAMPLE].value = 0;
+    gmr.inputs[Shaper<TestComposite>::INPUT_AUDIO0].channels = numChannels;
+    gmr.outputs[Shaper<TestComposite>::OUTPUT_AUDIO0].channels = numChannels;
+
+    MeasureTime<float>::run(overheadOutOnly, name, [&gmr, numChannels]() {
+        const float x = TestBuffers<float>::get();
+        for (int i = 0; i < numChannels; ++i) {
+            gmr.inputs[Shaper<TestComposite>::INPUT_AUDIO0].setVoltage(x, i);
+        }
+        gmr.step();
+        return gmr.outputs[Shaper<TestComposite>::OUTPUT_AUDIO0].getVoltage(0);
+        }, 1);
+}
 #if 0
 static void testAttenuverters()
 {
@@ -1216,15 +1588,24 @@ void perfTest()
     assert(overheadOutOnly > 0);
 
      testVocalFilter();
-#if 0
-    testColors();
-   
-    testAnimator();
-    testTremolo();
-  
-    testShifter();
-    testGMR();
-#endif
+     testGrammar(1);
+     testGrammar(3);
+     testOnsetDetector();
+     testOnsetDetectorWorstCase();
+    // off by default, --all or --filter turns them on
+    if (PerfSuite::isExtended()) {
+        testColors();
+        testColors16();
+        testColorsSweep();
+        testFFTSweep();
+
+        testAnimator();
+        testTremolo();
+
+        testShifter();
+        testShifterPoly();
+        testGMR();
+    }
 #ifndef _MSC_VER
     testBasic1Tri();
     testBasic1TriDyn();
@@ -1236,6 +1617,9 @@ void perfTest()
     testOrgan4();
     testOrgan4VCO();
     testOrgan12();
+    testOrganWavetable(1);
+    testOrganWavetable(4);
+    testOrganWavetable(12);
     testSuper();
     testSuperPoly();
     testWVCOPoly();
@@ -1250,12 +1634,28 @@ void perfTest()
 #endif  
 
     testBiquad();
+    testRateConversion();
+    testShaperADAA(0, 0, "shaper fw 16X mono");
+    testShaperADAA(0, 1, "shaper fw ADAA 16X mono");
+    testShaperADAA(1, 0, "shaper fw 4X mono");
+    testShaperADAA(1, 1, "shaper fw ADAA 4X mono");
+    testShaperADAA(1, 2, "shaper fw ADAA2 4X mono");
+    testShaperADAA(2, 1, "shaper fw ADAA 1X mono");
+    testShaperADAA(2, 2, "shaper fw ADAA2 1X mono");
+    testShaperPoly(Shaper<TestComposite>::Shapes::FullWave, 1, "shaper fw 16X 1 channel");
+    testShaperPoly(Shaper<TestComposite>::Shapes::FullWave, 16, "shaper fw 16X 16 channels");
+    testShaperPoly(Shaper<TestComposite>::Shapes::AsymSpline, 1, "shaper asy 16X 1 channel");
+    testShaperPoly(Shaper<TestComposite>::Shapes::AsymSpline, 16, "shaper asy 16X 16 channels");
+    testShaperPoly(Shaper<TestComposite>::Shapes::EmitterCoupled, 16, "shaper ec 16X 16 channels");
 
   
     testSuperStereo();
     testSuper2();
     testSuper2Stereo();
     testSuper3();
+    testSuperPolyStereo(1, 2, "super stereo 16X 1 channel");
+    testSuperPolyStereo(16, 0, "super stereo 1X 16 channels");
+    testSuperPolyStereo(16, 2, "super stereo 16X 16 channels");
   //  testKS();
   //  testShaper1a();
     testLFN();
@@ -1263,26 +1663,29 @@ void perfTest()
 
 
     testCHBdef();
-#if 0
-    testShaper1b();
-    testShaper1c();
-    testShaper2();
-    testShaper3();
-    testShaper4();
-    testShaper5();
-#endif
+    testCHBPoly(4);
+    testCHBPoly(16);
+    if (PerfSuite::isExtended()) {
+        testShaper1b();
+        testShaper1c();
+        testShaper2();
+        testShaper3();
+        testShaper4();
+        testShaper5();
+    }
 
-   // testEV3();
+    testEV3();
+    testMixerChain();
 
     testFunSaw(true);
-#if 0
-    testFunSaw(false);
-    testFunSin(true);
-    testFunSin(false);
-    testFunSq();
-    testFun();
-    testFunNone();
-#endif
+    if (PerfSuite::isExtended()) {
+        testFunSaw(false);
+        testFunSin(true);
+        testFunSin(false);
+        testFunSq();
+        testFun();
+        testFunNone();
+    }
 
 
 #if 0
@@ -1299,8 +1702,8 @@ void perfTest()
 
 
    // test1();
-#if 0
-    testHilbert<float>();
-    testHilbert<double>();
-#endif
+    if (PerfSuite::isExtended()) {
+        testHilbert<float>();
+        testHilbert<double>();
+    }
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "TestComposite.h"
 
+#include "CompCurves.h"
 #include "DrumTrigger.h"
 
 #include "Filt.h"
 
 #include "LookupTable.h"
+#include "LookupTable_4.h"
 #include "Mix8.h"
 #include "Mix4.h"
 #include "MixM.h"
@@ -14,9 +16,12 @@
 #include "MultiLag.h"
 #include "F2_Poly.h"
 #include "Compressor.h"
+#include "Compressor2.h"
+#include "Convolver.h"
 #endif
 
 #include "ObjectCache.h"
+#include "PolyApprox_4.h"
 #include "Slew4.h"
 #include "TestComposite.h"
 
@@ -122,6 +127,96 @@ static void testMultiLagMod()
         }, 1);
 }
 
+/**
+ * PolyApprox_4 vs. the tables and approximations it replaces.
+ * Everything processes four values per call.
+ */
+static void testPolyApproxSin()
+{
+    MeasureTime<float>::run(overheadInOut, "sin SimdBlocks::sinTwoPi (old)", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return SimdBlocks::sinTwoPi(x * float_4(float(2 * AudioMath::Pi)))[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "sin PolyApprox low", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::sin2pi<PolyApprox_4::Precision::Low>(x)[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "sin PolyApprox high", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::sin2pi<PolyApprox_4::Precision::High>(x)[0];
+    }, 1);
+}
+
+static void testPolyApproxExp2()
+{
+    std::function<float(float)> expLookup = ObjectCache<float>::getExp2Ex();
+    MeasureTime<float>::run(overheadInOut, "exp2 getExp2Ex x4 (old)", [expLookup]() {
+        const float x = TestBuffers<float>::get();
+        return expLookup(x) + expLookup(x + 1) + expLookup(x + 2) + expLookup(x + 3);
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "exp2 approxExp2_taylor5 (old)", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return rack::dsp::approxExp2_taylor5(x + 30)[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "exp2 PolyApprox low", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::exp2<PolyApprox_4::Precision::Low>(x)[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "exp2 PolyApprox high", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::exp2<PolyApprox_4::Precision::High>(x)[0];
+    }, 1);
+}
+
+static void testPolyApproxTanh()
+{
+    std::shared_ptr<LookupTableParams<float>> tanhLookup = ObjectCache<float>::getTanh5();
+    MeasureTime<float>::run(overheadInOut, "tanh LookupTable_4 (old)", [tanhLookup]() {
+        const float_4 x(TestBuffers<float>::get());
+        return LookupTable_4::lookup(*tanhLookup, x)[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "tanh PolyApprox low", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::tanh<PolyApprox_4::Precision::Low>(x)[0];
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "tanh PolyApprox medium", []() {
+        const float_4 x(TestBuffers<float>::get());
+        return PolyApprox_4::tanh<PolyApprox_4::Precision::Medium>(x)[0];
+    }, 1);
+}
+
+static void testPolyApproxDb()
+{
+    std::shared_ptr<NonUniformLookupTableParams<float>> curve = CompCurves::makeCompGainLookup([]() {
+        CompCurves::Recipe r;
+        r.ratio = 4;
+        return r;
+    }());
+    MeasureTime<float>::run(overheadInOut, "comp curve lookup x4 (old)", [curve]() {
+        const float x = TestBuffers<float>::get() + 1;
+        return CompCurves::lookup(curve, x) + CompCurves::lookup(curve, x + 1) +
+               CompCurves::lookup(curve, x + 2) + CompCurves::lookup(curve, x + 3);
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "comp curve PolyApprox", []() {
+        const float_4 x(TestBuffers<float>::get() + 1);
+        const float_4 level = SimdBlocks::max(x, float_4(1));
+        using P = PolyApprox_4::Precision;
+        return PolyApprox_4::exp2<P::Low>(float_4(-.75f) * PolyApprox_4::log2<P::Low>(level))[0];
+    }, 1);
+
+    std::shared_ptr<LookupTableParams<float>> panL = ObjectCache<float>::getMixerPanL();
+    std::shared_ptr<LookupTableParams<float>> panR = ObjectCache<float>::getMixerPanR();
+    MeasureTime<float>::run(overheadInOut, "pan lookup (old)", [panL, panR]() {
+        const float x = TestBuffers<float>::get();
+        return LookupTable<float>::lookup(*panL, x) + LookupTable<float>::lookup(*panR, x);
+    }, 1);
+    MeasureTime<float>::run(overheadInOut, "pan PolyApprox", []() {
+        const float x = std::max(-1.f, std::min(1.f, TestBuffers<float>::get()));
+        const float_4 gains = PolyApprox_4::panGains(x);
+        return gains[0] + gains[1];
+    }, 1);
+}
+
 static void testUniformLookup()
 {
     std::shared_ptr<LookupTableParams<float>> lookup = ObjectCache<float>::getSinLookup();
@@ -141,8 +236,6 @@ static void testNonUniform()
         return  NonUniformLookupTable<float>::lookup(*lookup, x);
      
     }, 1);
-    printf("Now abort");
-    abort();
 }
 
 using Slewer = Slew4<TestComposite>;
@@ -210,6 +303,27 @@ static void testFilt2()
      }, 1);
 }
 
+static void testFiltPoly(int numChannels, const char* name)
+{
+    Filter fs;
+    fs.init();
+    fs.inputs[Filter::L_AUDIO_INPUT].channels = numChannels;
+    fs.outputs[Filter::L_AUDIO_OUTPUT].channels = 1;
+    assert(overheadInOut >= 0);
+    MeasureTime<float>::run(overheadInOut, name, [&fs, numChannels]() {
+        const float x = TestBuffers<float>::get();
+        float ret = 0;
+        for (int i = 0; i < numChannels; ++i) {
+            fs.inputs[Filter::L_AUDIO_INPUT].setVoltage(x, i);
+        }
+        fs.step();
+        for (int i = 0; i < numChannels; ++i) {
+            ret += fs.outputs[Filter::L_AUDIO_OUTPUT].getVoltage(i);
+        }
+        return ret;
+        }, 1);
+}
+
 using Mixer8 = Mix8<TestComposite>;
 static void testMix8()
 {
@@ -573,6 +687,78 @@ static void testCompKnee16Hard()
         }, 1);
 }
 
+
+/**
+ * Compressor II, 16 channels, with and without lookahead.
+ */
+static void testComp2_16(float ratio, int detector, const char* name)
+{
+    using Comp = Compressor2<TestComposite>;
+    Comp comp;
+
+    comp.init();
+
+    comp.inputs[Comp::LAUDIO_INPUT].channels = 16;
+    comp.inputs[Comp::LAUDIO_INPUT].setVoltage(0, 0);
+    comp.params[Comp::RATIO_PARAM].value = ratio;
+    comp.params[Comp::NOTBYPASS_PARAM].value = 1;
+    comp.params[Comp::DETECTOR_PARAM].value = float(detector);
+    comp.params[Comp::LOOKAHEAD_PARAM].value = 2;
+
+    Comp::ProcessArgs args;
+    args.sampleTime = 1.f / 44100.f;
+    args.sampleRate = 44199;
+
+    MeasureTime<float>::run(overheadInOut, name, [&comp, args]() {
+        comp.inputs[Comp::LAUDIO_INPUT].setVoltage(TestBuffers<float>::get());
+        comp.process(args);
+        return comp.outputs[Comp::LAUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
+/**
+ * Convolver with a room sized impulse, at 48k.
+ * The composite is only what the audio thread does, so the tail server is
+ * measured separately, on this thread. The test runs much faster than real time,
+ * so the composite's server can't keep up, and drops blocks.
+ */
+static void testConvolver(int seconds, int blockParam)
+{
+    using Conv = Convolver<TestComposite>;
+    const int sampleRate = 48000;
+    std::vector<float> impulse(seconds * sampleRate);
+    for (size_t i = 0; i < impulse.size(); ++i) {
+        impulse[i] = TestBuffers<float>::get() * float(std::exp(-6.0 * i / impulse.size()));
+    }
+
+    Conv comp;
+    comp.init();
+    comp.params[Conv::BLOCK_SIZE_PARAM].value = float(blockParam);
+    comp.params[Conv::MIX_PARAM].value = 1;
+    comp.outputs[Conv::AUDIO_OUTPUT].channels = 1;
+    comp.setImpulse_UI(impulse);
+    while (!comp.isImpulseLoaded()) {
+        comp.step();
+    }
+
+    const int blockSize = comp.getBlockSize();
+    std::string name = "convolver " + std::to_string(seconds) + " s, block " + std::to_string(blockSize);
+    MeasureTime<float>::run(overheadInOut, name.c_str(), [&comp]() {
+        comp.inputs[Conv::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        comp.step();
+        return comp.outputs[Conv::AUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+    printf("%d tail blocks dropped\n", comp._underruns());
+
+    const int headSize = ConvolverServer::getHeadSize(blockSize);
+    PartitionedConvolver tail(ConvolverServer::getTailBlockSize(blockSize),
+        impulse.data() + headSize, int(impulse.size()) - headSize);
+    name += " server";
+    MeasureTime<float>::run(overheadInOut, name.c_str(), [&tail]() {
+        return tail.step(TestBuffers<float>::get());
+        }, 1);
+}
+
 #endif
 
 
@@ -594,6 +780,15 @@ void perfTest2()
     testCompKnee();
     testCompKnee16();
     testCompKnee16Hard();
+    testComp2_16(0, 0, "Comp2 16 channel limiter");
+    testComp2_16(0, 1, "Comp2 16 channel limiter, lookahead");
+    testComp2_16(3, 0, "Comp2 16 channel 4:1 soft");
+    testComp2_16(3, 1, "Comp2 16 channel 4:1 soft, lookahead");
+    testComp2_16(3, 2, "Comp2 16 channel 4:1 soft, lookahead RMS");
+    testConvolver(1, 0);
+    testConvolver(5, 0);
+    testConvolver(1, 2);
+    testConvolver(5, 2);
    
 #endif
 
@@ -601,11 +796,18 @@ void perfTest2()
     testDrumTrigger();
     testFilt();
     testFilt2();
+    testFiltPoly(1, "filt 1 channel");
+    testFiltPoly(4, "filt 4 channels");
+    testFiltPoly(16, "filt 16 channels");
     testSlew4();
     testMixStereo();
     testMix8();
     testMix4();
     testMixM();
+    testPolyApproxSin();
+    testPolyApproxExp2();
+    testPolyApproxTanh();
+    testPolyApproxDb();
    
     testUniformLookup();
     testNonUniform();
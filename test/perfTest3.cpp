@@ -3,6 +3,18 @@
 #include "MeasureTime.h"
 #include "Samp.h"
 
+#include "MidiLock.h"
+#include "MidiSelectionModel.h"
+#include "MidiSequencer.h"
+#include "MidiSong.h"
+#include "MidiVoice.h"
+#include "MidiVoiceAssigner.h"
+#include "ReplaceDataCommand.h"
+#include "TestAuditionHost.h"
+#include "TestHost2.h"
+#include "TestSettings.h"
+#include "UndoRedoStack.h"
+
 extern double overheadOutOnly;
 extern double overheadInOut;
 
@@ -129,6 +141,113 @@ static void testSamp5() {
         },
         1);
 }
+/**
+ * Makes a one track song with numNotes eighth notes, slightly off the grid,
+ * and selects all of them.
+ */
+static MidiSequencerPtr makeBigEditSequencer(int numNotes) {
+    MidiSongPtr song = MidiSong::makeTest(MidiTrack::TestContent::empty, 0);
+    MidiTrackPtr track = song->getTrack(0);
+    {
+        MidiLocker l(song->lock);
+        track->setLength(numNotes * .5f + 4);
+        for (int i = 0; i < numNotes; ++i) {
+            MidiNoteEventPtr note = std::make_shared<MidiNoteEvent>();
+            note->startTime = i * .5f + ((i % 3) * .01f);
+            note->duration = .4f;
+            note->pitchCV = (i % 24) / 12.f;
+            track->insertEvent(note);
+        }
+    }
+    MidiSequencerPtr seq = MidiSequencer::make(song, std::make_shared<TestSettings>(), std::make_shared<TestAuditionHost>());
+    seq->selection->selectAll(track);
+    return seq;
+}
+
+/**
+ * Edit commands are one shot, not per sample, so we just time
+ * one round of make command / execute / undo.
+ */
+static void testEditCommand(const char* name, std::function<ReplaceDataCommandPtr(MidiSequencerPtr)> factory) {
+    const int numNotes = 50000;
+    MidiSequencerPtr seq = makeBigEditSequencer(numNotes);
+
+    const double t0 = SqTime::seconds();
+    ReplaceDataCommandPtr cmd = factory(seq);
+    const double t1 = SqTime::seconds();
+    seq->undo->execute(seq, cmd);
+    const double t2 = SqTime::seconds();
+    seq->undo->undo(seq);
+    const double t3 = SqTime::seconds();
+
+    printf("\nmeasure edit %s on %d notes\n", name, numNotes);
+    printf("make command: %f seconds\n", t1 - t0);
+    printf("execute: %f seconds\n", t2 - t1);
+    printf("undo: %f seconds\n", t3 - t2);
+    fflush(stdout);
+}
+
+static void testEditChop() {
+    testEditCommand("chop 4", [](MidiSequencerPtr seq) {
+        return ReplaceDataCommand::makeChopNoteCommand(seq, 4, ReplaceDataCommand::Ornament::None, nullptr, 0);
+    });
+}
+
+static void testEditQuantize() {
+    testEditCommand("quantize", [](MidiSequencerPtr seq) {
+        return ReplaceDataCommand::makeChangeStartTimeCommand(seq, 0, .25f);
+    });
+}
+
+static void testEditTranspose() {
+    testEditCommand("transpose", [](MidiSequencerPtr seq) {
+        return ReplaceDataCommand::makeChangePitchCommand(seq, 1);
+    });
+}
+
+/**
+ * Dense 16 voice passage: a new note every call,
+ * each one lasting four calls, so about a quarter of the voices are busy.
+ */
+static void testVoiceAssigner(const char* name, MidiVoiceAssigner::Mode mode) {
+    static MidiVoice voices[16];
+    static MidiVoiceAssigner va(voices, 16);
+    static TestHost2 host;
+    for (int i = 0; i < 16; ++i) {
+        voices[i].setHost(&host);
+        voices[i].setIndex(i);
+        voices[i].setSampleCountForRetrigger(44);
+        voices[i].reset(false);
+    }
+    va.setMode(mode);
+
+    double time = 0;
+    unsigned int seed = 0;
+    MeasureTime<float>::run(
+        overheadOutOnly, name, [&time, &seed]() {
+            seed = seed * 1103515245 + 12345;
+            const float pitch = float((seed >> 16) % 24) / 12.f;
+            MidiVoice* vx = va.getNext(pitch);
+            if (vx) {
+                vx->playNote(pitch, time, float(time + 4));
+            }
+            time += 1;
+            for (int i = 0; i < 16; ++i) {
+                voices[i].updateToMetricTime(time);
+                voices[i].updateSampleCount(64);
+            }
+            if (time > (1 << 20)) {
+                // start over before float end times lose precision
+                time = 0;
+                for (int i = 0; i < 16; ++i) {
+                    voices[i].reset(false);
+                }
+            }
+            return vx ? vx->pitch() : 0.f;
+        },
+        1);
+}
+
 void perfTest3() {
     assert(overheadInOut > 0);
     assert(overheadOutOnly > 0);
@@ -137,4 +256,10 @@ void perfTest3() {
   //  testSamp3();
     testSamp4();
      testSamp5();
+    testEditChop();
+    testEditQuantize();
+    testEditTranspose();
+    testVoiceAssigner("note on ReUse", MidiVoiceAssigner::Mode::ReUse);
+    testVoiceAssigner("note on StealOldest", MidiVoiceAssigner::Mode::StealOldest);
+    testVoiceAssigner("note on LowPriority", MidiVoiceAssigner::Mode::LowPriority);
 }
@@ -0,0 +1,165 @@
+#include "CHB.h"
+#include "ChebyshevShaper.h"
+#include "TestComposite.h"
+#include "asserts.h"
+#include "poly.h"
+
+#include <cmath>
+#include <cstdlib>
+
+static float rand01()
+{
+    return float(std::rand()) / float(RAND_MAX);
+}
+
+/**
+ * Compares the float and float_4 shapers with Poly<double, 10>,
+ * over all of -1..1, with random gains.
+ */
+static void testMatchesPoly(float inputGain)
+{
+    Poly<double, 10> poly;
+    ChebyshevShaper<float> shaper;
+    ChebyshevShaper<float_4> shaper4;
+    for (int i = 0; i < 10; ++i) {
+        const float gain = rand01();
+        poly.setGain(i, gain);
+        shaper.setGain(i, gain);
+        shaper4.setGain(i, gain);
+    }
+    shaper.setInputGain(inputGain);
+    shaper4.setInputGain(float_4(inputGain));
+
+    double maxError = 0;
+    const int steps = 2000;
+    for (int i = 0; i <= steps; ++i) {
+        const float x = -1 + 2 * float(i) / steps;
+        const double expected = poly.run(x, inputGain);
+        const float actual = shaper.run(x);
+        const float_4 actual4 = shaper4.run(float_4(x));
+        maxError = std::max(maxError, std::abs(actual - expected));
+        for (int lane = 0; lane < 4; ++lane) {
+            assertClose(actual4[lane], actual, 1e-5);
+        }
+    }
+
+    // the output goes up to about 10 here, so this is under a ulp of that
+    assertLT(maxError, 2e-5);
+}
+
+static void testMatchesPoly()
+{
+    std::srand(123);
+    for (int i = 0; i < 10; ++i) {
+        testMatchesPoly(1);
+        testMatchesPoly(.5f);
+        testMatchesPoly(.01f);
+        testMatchesPoly(0);
+    }
+}
+
+/**
+ * Each lane has its own input gain, so its own DC.
+ */
+static void testLanesDC()
+{
+    const float_4 inputGain(1, .5f, .2f, 0);
+    ChebyshevShaper<float_4> shaper4;
+    shaper4.setGain(1, 1);
+    shaper4.setGain(3, .5f);
+    shaper4.setInputGain(inputGain);
+
+    for (int lane = 0; lane < 4; ++lane) {
+        ChebyshevShaper<float> shaper;
+        shaper.setGain(1, 1);
+        shaper.setGain(3, .5f);
+        shaper.setInputGain(inputGain[lane]);
+
+        // average over a whole cycle of the sine it expects
+        double sum = 0;
+        const int n = 1000;
+        for (int i = 0; i < n; ++i) {
+            const float x = inputGain[lane] * float(std::sin(2 * AudioMath::Pi * i / n));
+            const float y = shaper.run(x);
+            const float_4 y4 = shaper4.run(float_4(x));
+            assertClose(y4[lane], y, 1e-5);
+            sum += y;
+        }
+        assertClose(sum / n, 0, .0001);
+    }
+}
+
+/**
+ * Gains only take when they change, so changing them must be noticed.
+ */
+static void testGainChange()
+{
+    ChebyshevShaper<float> shaper;
+    shaper.setInputGain(1);
+    assertEQ(shaper.run(.5f), 0);
+
+    shaper.setGain(0, 1);
+    assertEQ(shaper.run(.5f), .5f);
+
+    // second harmonic of a full scale sine, with the DC taken out
+    shaper.setGain(0, 0);
+    shaper.setGain(1, 1);
+    assertClose(shaper.run(1), 1, .00001);
+    assertClose(shaper.run(0), -1, .00001);
+
+    // half scale sine has a different DC
+    shaper.setInputGain(.5f);
+    assertClose(shaper.run(0), -.25f, .00001);
+}
+
+using Comp = CHB<TestComposite>;
+
+static void initComp(Comp& comp, int channels)
+{
+    comp.onSampleRateChange();
+    comp.params[Comp::PARAM_H1].value = .7f;
+    comp.params[Comp::PARAM_H4].value = .5f;
+    comp.params[Comp::PARAM_H9].value = .3f;
+    comp.inputs[Comp::CV_INPUT].channels = channels;
+    comp.outputs[Comp::MIX_OUTPUT].channels = 1;
+}
+
+/**
+ * Each poly channel should sound just like a mono CHB with the same CV.
+ */
+static void testPolyMatchesMono()
+{
+    const int channels = 13;
+    Comp poly;
+    initComp(poly, channels);
+    for (int i = 0; i < channels; ++i) {
+        poly.inputs[Comp::CV_INPUT].setVoltage(i * .1f - .5f, i);
+    }
+
+    Comp mono[channels];
+    for (int i = 0; i < channels; ++i) {
+        initComp(mono[i], 1);
+        mono[i].inputs[Comp::CV_INPUT].setVoltage(i * .1f - .5f, 0);
+    }
+
+    for (int t = 0; t < 2000; ++t) {
+        poly.step();
+        assertEQ(poly.outputs[Comp::MIX_OUTPUT].channels, channels);
+        for (int i = 0; i < channels; ++i) {
+            mono[i].step();
+            const float expected = mono[i].outputs[Comp::MIX_OUTPUT].getVoltage(0);
+            assertEQ(poly.outputs[Comp::MIX_OUTPUT].getVoltage(i), expected);
+        }
+    }
+
+    // and they're all different
+    assertNE(poly.outputs[Comp::MIX_OUTPUT].getVoltage(0), poly.outputs[Comp::MIX_OUTPUT].getVoltage(1));
+}
+
+void testChebyshevShaper()
+{
+    testMatchesPoly();
+    testLanesDC();
+    testGainChange();
+    testPolyMatchesMono();
+}
@@ -2,6 +2,8 @@
 #include "Cmprsr.h"
 #include "asserts.h"
 
+#include <cmath>
+
 static void testLimiterZeroAttack(bool reduceDist) {
     const float sampleRate = 44100;
     const float threshold = 5;
@@ -188,10 +190,122 @@ static void testIndependentAttack() {
     testIndependentAttack(0);
 }
 
+/**
+ * With zero attack a lookahead limiter should never let anything
+ * over the threshold through, even on the first sample of a step.
+ */
+static void testLookaheadLimiter() {
+    const float threshold = 5;
+    const int lookahead = 64;
+
+    Cmprsr comp;
+    comp.setNumChannels(4);
+    comp.setCurve(Cmprsr::Ratios::HardLimit);
+    comp.setTimes(0, 100, 1.f / 44100.f, false);
+    comp.setThreshold(threshold);
+    comp.setLookahead(lookahead, false);
+    assertEQ(comp.getLookahead(), lookahead);
+
+    // each lane steps up at a different time, to catch every block phase
+    const int stepTime[4] = {1000, 1005, 1011, 1023};
+    const int length = 3000;
+    float_4 history[length];
+    for (int t = 0; t < length; ++t) {
+        float_4 input;
+        for (int i = 0; i < 4; ++i) {
+            input[i] = (t < stepTime[i]) ? 1.f : 10.f;
+        }
+        history[t] = input;
+        const float_4 output = comp.stepLookahead<Cmprsr::CurveType::Limit, false>(input);
+        const float_4 delayed = (t < lookahead) ? float_4(0) : history[t - lookahead];
+        simd_assertEQ(comp.getDelayedInput(), delayed);
+        for (int i = 0; i < 4; ++i) {
+            assertLE(output[i], threshold * 1.0001f);
+            if (t < stepTime[i]) {
+                // below threshold, and nothing coming, so it's just delayed
+                assertEQ(output[i], delayed[i]);
+            }
+        }
+        if (t > stepTime[3] + 2 * lookahead) {
+            simd_assertClose(output, float_4(threshold), .0001f);
+        }
+    }
+}
+
+/**
+ * In RMS mode a limiter should hold the RMS of a steady sine at the threshold.
+ */
+static void testLookaheadRMS() {
+    const float threshold = 5;
+    const int period = 64;
+
+    Cmprsr comp;
+    comp.setNumChannels(1);
+    comp.setCurve(Cmprsr::Ratios::HardLimit);
+    comp.setTimes(0, 100, 1.f / 44100.f, false);
+    comp.setThreshold(threshold);
+    comp.setLookahead(4 * period, true);
+    assert(comp.getLookaheadRMS());
+
+    double sumSquares = 0;
+    const int measure = 10 * period;
+    for (int t = 0; t < 2000 + measure; ++t) {
+        const float x = 10 * float(std::sin(2 * AudioMath::Pi * t / period));
+        const float_4 output = comp.stepLookahead<Cmprsr::CurveType::Limit, true>(float_4(x));
+        if (t >= 2000) {
+            sumSquares += output[0] * output[0];
+        }
+    }
+    assertClose(std::sqrt(sumSquares / measure), threshold, .01);
+}
+
+/**
+ * The gain is only worked out once a block, and is a straight line in between.
+ */
+static void testLookaheadRamp() {
+    Cmprsr comp;
+    comp.setNumChannels(1);
+    comp.setCurve(Cmprsr::Ratios::_4_1_soft);
+    comp.setTimes(1, 100, 1.f / 44100.f, false);
+    comp.setThreshold(1);
+    comp.setLookahead(32, false);
+
+    float lastGain = 1;
+    float lastDelta = 0;
+    for (int t = 0; t < 1000; ++t) {
+        comp.stepLookahead<Cmprsr::CurveType::Table, false>(float_4(t < 100 ? 0.f : 4.f));
+        const float gain = comp.getGain()[0];
+        const float delta = gain - lastGain;
+        if ((t % Cmprsr::lookaheadBlockSize) != 0) {
+            assertClose(delta, lastDelta, .00001);
+        }
+        lastGain = gain;
+        lastDelta = delta;
+    }
+    assertLT(lastGain, .9);
+}
+
+/**
+ * Compressor2 goes up to 5 ms of lookahead. That has to fit at 192k.
+ */
+static void testLookaheadLong() {
+    Cmprsr comp;
+    const int samples = int(.005f * 192000);
+    comp.setLookahead(samples, false);
+    assertEQ(comp.getLookahead(), samples);
+
+    comp.setLookahead(Cmprsr::maxLookahead + 100, false);
+    assertEQ(comp.getLookahead(), Cmprsr::maxLookahead);
+}
+
 void testCmprsr() {
     testCompZeroAttack(false);
     testCompZeroAttack(true);
 
     testLimiterZeroAttack();
     testIndependentAttack();
+    testLookaheadLimiter();
+    testLookaheadRMS();
+    testLookaheadRamp();
+    testLookaheadLong();
 }
\ No newline at end of file
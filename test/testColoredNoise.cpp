@@ -3,6 +3,9 @@
 #include "TestComposite.h"
 #include "asserts.h"
 
+#include <cmath>
+#include <vector>
+
 extern void testFinalLeaks();
 
 using Noise = ColoredNoise<TestComposite>;
@@ -52,38 +55,164 @@ static void test1()
 }
 
 
-// try to request a few different kinds of noise
+static void waitForBank(Noise& cn, int channels = 1)
+{
+    while (cn._msgCount() < channels) {
+        cn.step();
+    }
+}
+
+// the slope knob goes -5..5 for -8..8 dB/octave
+static float knobForSlope(float slope)
+{
+    return slope * 5.f / 8.f;
+}
+
+// Sweeping the slope doesn't allocate anything or talk to the server,
+// and takes effect on the next input service (every four samples)
 static void test2()
 {
     Noise cn;
     cn.init();
-    while (cn._msgCount() < 1) {
-        cn.step();
-    }
-    cn.params[Noise::SLOPE_PARAM].value = -6;
-    while (cn._msgCount() < 2) {
-        cn.step();
+    waitForBank(cn);
+
+    const int realCount = FFTDataReal::_count;
+    const int cpxCount = FFTDataCpx::_count;
+    const int messages = ThreadMessage::_dbgCount;
+
+    const float slopes[] = {-6, 3, 2, 2.3f, 2.5f, -1.2f, -8, 8, 0};
+    for (float slope : slopes) {
+        cn.params[Noise::SLOPE_PARAM].value = knobForSlope(slope);
+        int latency = 0;
+        while (std::abs(cn.getSlope() - slope) > .0001) {
+            cn.step();
+            ++latency;
+            assertLE(latency, 4);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            cn.step();
+            const float output = cn.outputs[Noise::AUDIO_OUTPUT].getVoltage(0);
+            assertLE(std::abs(output), 5.0001f);
+        }
     }
-    cn.params[Noise::SLOPE_PARAM].value = 3;
-    while (cn._msgCount() < 3) {
-        cn.step();
+
+    assertEQ(cn._msgCount(), 1);
+    assertEQ(FFTDataReal::_count, realCount);
+    assertEQ(FFTDataCpx::_count, cpxCount);
+    assertEQ(int(ThreadMessage::_dbgCount), messages);
+}
+
+// correlation of a[i] with b[i + lag], over length samples
+static double correlation(const std::vector<float>& a, const std::vector<float>& b, int lag, int length)
+{
+    double ab = 0, aa = 0, bb = 0;
+    for (int i = 0; i < length; ++i) {
+        ab += a[i] * b[i + lag];
+        aa += a[i] * a[i];
+        bb += b[i + lag] * b[i + lag];
     }
-    cn.params[Noise::SLOPE_PARAM].value = 2;
-    while (cn._msgCount() < 4) {
-        cn.step();
+    return ab / std::sqrt(aa * bb);
+}
+
+/**
+ * 16 channels, all different, at any slope.
+ * Not just at zero lag: if two channels were the same noise delayed,
+ * mixing them would comb filter. So look at a range of lags either way,
+ * out to a whole buffer of the first channel (the others are shorter).
+ */
+static void testPoly(float slope)
+{
+    Noise cn;
+    cn.init();
+    cn.params[Noise::CHANNELS_PARAM].value = 16;
+    cn.outputs[Noise::AUDIO_OUTPUT].channels = 1;
+    cn.params[Noise::SLOPE_PARAM].value = knobForSlope(slope);
+    waitForBank(cn, 16);
+
+    const int length = 20000;
+    const int bufferSize = 64 * 1024;
+    std::vector<int> lags = {0, 1, 2, 3, 5, 8, 13, 100, 1000};
+    for (int lag = 2048; lag <= bufferSize; lag += 2048) {
+        lags.push_back(lag);
     }
-    cn.params[Noise::SLOPE_PARAM].value = 2.3f;
-    while (cn._msgCount() < 5) {
+
+    const int samples = length + bufferSize;
+    std::vector<float> outputs[16];
+    for (int i = 0; i < samples; ++i) {
         cn.step();
+        assertEQ(cn.outputs[Noise::AUDIO_OUTPUT].channels, 16);
+        for (int ch = 0; ch < 16; ++ch) {
+            outputs[ch].push_back(cn.outputs[Noise::AUDIO_OUTPUT].getVoltage(ch));
+        }
     }
-    cn.params[Noise::SLOPE_PARAM].value = 2.5f;
-    while (cn._msgCount() < 6) {
-        cn.step();
+
+    // At steep negative slopes almost all the power is in the few dozen bins
+    // under 40 Hz, so even unrelated channels correlate up to about .45 by chance.
+    // A delayed copy would be close to 1.
+    const double maxCorrelation = slope < -4 ? .6 : .1;
+    for (int ch = 1; ch < 16; ++ch) {
+        for (int lag : lags) {
+            assertLT(std::abs(correlation(outputs[0], outputs[ch], lag, length)), maxCorrelation);
+            assertLT(std::abs(correlation(outputs[ch], outputs[0], lag, length)), maxCorrelation);
+            assertLT(std::abs(correlation(outputs[ch - 1], outputs[ch], lag, length)), maxCorrelation);
+        }
     }
-    cn.params[Noise::SLOPE_PARAM].value = -1.2f;
-    while (cn._msgCount() < 7) {
-        cn.step();
+
+    // and a channel does correlate with itself a whole buffer later
+    assertGT(correlation(outputs[0], outputs[0], bufferSize, length), .99);
+    assertGT(correlation(outputs[3], outputs[3], bufferSize / 4, length), .99);
+}
+
+/**
+ * Each channel's bank is a few MB, so when the channels go away
+ * the banks should be freed.
+ */
+static void testFreeBanks()
+{
+    const int startCount = FFTDataReal::_count;
+    {
+        Noise cn;
+        cn.init();
+        cn.params[Noise::CHANNELS_PARAM].value = 16;
+        cn.outputs[Noise::AUDIO_OUTPUT].channels = 1;
+        waitForBank(cn, 16);
+        const int slopes = NoiseBankMessage::numSlopes;
+        assertEQ(FFTDataReal::_count, startCount + 16 * slopes);
+
+        cn.params[Noise::CHANNELS_PARAM].value = 2;
+        while (FFTDataReal::_count > startCount + 2 * slopes) {
+            cn.step();
+            assertGE(cn._msgCount(), 2);
+        }
+        assertEQ(cn._msgCount(), 2);
+
+        // and back again
+        cn.params[Noise::CHANNELS_PARAM].value = 5;
+        waitForBank(cn, 5);
+        for (int i = 0; i < 100; ++i) {
+            cn.step();
+        }
+        assertEQ(FFTDataReal::_count, startCount + 5 * slopes);
+        assertNE(cn.outputs[Noise::AUDIO_OUTPUT].getVoltage(4), 0);
     }
+    assertEQ(FFTDataReal::_count, startCount);
+}
+
+// each channel follows its own slope CV
+static void testPolyCV()
+{
+    Noise cn;
+    cn.init();
+    cn.params[Noise::SLOPE_TRIM].value = 1;
+    cn.inputs[Noise::SLOPE_CV].channels = 3;
+    cn.outputs[Noise::AUDIO_OUTPUT].channels = 1;
+    cn.inputs[Noise::SLOPE_CV].setVoltage(-5, 0);
+    cn.inputs[Noise::SLOPE_CV].setVoltage(0, 1);
+    cn.inputs[Noise::SLOPE_CV].setVoltage(5, 2);
+    waitForBank(cn);
+    cn.step();
+    assertEQ(cn.outputs[Noise::AUDIO_OUTPUT].channels, 3);
+    assertEQ(cn.getSlope(), -8);
 }
 
 void testColoredNoise()
@@ -92,5 +221,10 @@ void testColoredNoise()
     test0();
     test1();
     test2();
+    testPoly(0);
+    testPoly(-8);
+    testPoly(5.5f);
+    testPolyCV();
+    testFreeBanks();
     testFinalLeaks();
 }
\ No newline at end of file
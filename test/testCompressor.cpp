@@ -262,6 +262,52 @@ static void testCompPolyOrig() {
 
 
 
+/**
+ * A lookahead limiter on 16 channels holds the peaks down, and delays the dry signal too.
+ */
+static void testComp2Lookahead() {
+    using Comp = Compressor2<TestComposite>;
+    std::shared_ptr<Comp> comp = std::make_shared<Comp>();
+    initComposite(*comp);
+
+    comp->params[Comp::RATIO_PARAM].value = float(int(Cmprsr::Ratios::HardLimit));
+    comp->params[Comp::THRESHOLD_PARAM].value = .1f;
+    comp->params[Comp::ATTACK_PARAM].value = 0;
+    comp->params[Comp::DETECTOR_PARAM].value = 1;
+    comp->params[Comp::WETDRY_PARAM].value = 0;
+    const float threshV = float(Comp::getSlowThresholdFunction()(.1));
+
+    const int channels = 16;
+    comp->inputs[Comp::LAUDIO_INPUT].channels = channels;
+    comp->outputs[Comp::LAUDIO_OUTPUT].channels = channels;
+
+    TestComposite::ProcessArgs args;
+    float maxOut = 0;
+    int firstLoud = -1;
+    for (int t = 0; t < 4000; ++t) {
+        for (int i = 0; i < channels; ++i) {
+            // each channel gets louder at a different time
+            const float x = (t < 1000 + 7 * i) ? 0 : 4 * threshV;
+            comp->inputs[Comp::LAUDIO_INPUT].setVoltage(x, i);
+        }
+        comp->process(args);
+        for (int i = 0; i < channels; ++i) {
+            maxOut = std::max(maxOut, comp->outputs[Comp::LAUDIO_OUTPUT].getVoltage(i));
+        }
+        if (firstLoud < 0 && comp->outputs[Comp::LAUDIO_OUTPUT].getVoltage(0) > 0) {
+            firstLoud = t;
+        }
+    }
+
+    // with the wet/dry at half, this is the average of the limited and the dry
+    const float expected = .5f * (threshV + 4 * threshV);
+    assertLT(maxOut, expected * 1.001f);
+    assertClose(comp->outputs[Comp::LAUDIO_OUTPUT].getVoltage(channels - 1), expected, .01);
+
+    // two milliseconds, rounded down to whole blocks
+    assertEQ(firstLoud, 1000 + 80);
+}
+
 void testCompressor()
 {
     testLimiterPolyL();
@@ -274,4 +320,5 @@ void testCompressor()
 
     // testCompPolyOrig();
     testCompPoly();
+    testComp2Lookahead();
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "Convolver.h"
+#include "PartitionedConvolver.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+extern void testFinalLeaks();
+
+static float rand11()
+{
+    return float(2 * double(std::rand()) / double(RAND_MAX) - 1);
+}
+
+/**
+ * A decaying noise, like a room.
+ */
+static std::vector<float> makeImpulse(int size)
+{
+    std::vector<float> impulse(size);
+    for (int i = 0; i < size; ++i) {
+        impulse[i] = rand11() * float(std::exp(-3.0 * i / size));
+    }
+    return impulse;
+}
+
+static std::vector<float> makeInput(int size)
+{
+    std::vector<float> input(size);
+    for (int i = 0; i < size; ++i) {
+        input[i] = rand11();
+    }
+    return input;
+}
+
+static double directConvolution(const std::vector<float>& input, const std::vector<float>& impulse, int t)
+{
+    double sum = 0;
+    for (int j = 0; j < int(impulse.size()) && j <= t; ++j) {
+        sum += double(impulse[j]) * input[t - j];
+    }
+    return sum;
+}
+
+static void testMatchesDirect(int blockSize, int impulseSize)
+{
+    const std::vector<float> impulse = makeImpulse(impulseSize);
+    const std::vector<float> input = makeInput(impulseSize + 4 * blockSize);
+    PartitionedConvolver conv(blockSize, impulse.data(), impulseSize);
+    assertEQ(conv.getBlockSize(), blockSize);
+    assertEQ(conv.getNumPartitions(), (impulseSize + blockSize - 1) / blockSize);
+
+    for (int t = 0; t < int(input.size()); ++t) {
+        const float output = conv.step(input[t]);
+        const double expected = (t < blockSize) ? 0 : directConvolution(input, impulse, t - blockSize);
+        assertClose(output, expected, .0002);
+    }
+}
+
+static void testMatchesDirect()
+{
+    testMatchesDirect(32, 1);
+    testMatchesDirect(32, 32);
+    testMatchesDirect(32, 1000);
+    testMatchesDirect(64, 300);
+    testMatchesDirect(256, 3000);
+}
+
+/**
+ * skip should be the same as processing silence.
+ */
+static void testSkip(int blocks)
+{
+    const int blockSize = 64;
+    const std::vector<float> impulse = makeImpulse(500);
+    PartitionedConvolver a(blockSize, impulse.data(), int(impulse.size()));
+    PartitionedConvolver b(blockSize, impulse.data(), int(impulse.size()));
+    std::vector<float> input = makeInput(blockSize);
+    const std::vector<float> silence(blockSize, 0.f);
+    std::vector<float> outputA(blockSize);
+    std::vector<float> outputB(blockSize);
+
+    a.process(input.data(), outputA.data());
+    b.process(input.data(), outputB.data());
+    for (int i = 0; i < blocks; ++i) {
+        a.process(silence.data(), outputA.data());
+    }
+    b.skip(blocks);
+
+    for (int i = 0; i < 3; ++i) {
+        input = makeInput(blockSize);
+        a.process(input.data(), outputA.data());
+        b.process(input.data(), outputB.data());
+        for (int j = 0; j < blockSize; ++j) {
+            assertClose(outputB[j], outputA[j], .00001);
+        }
+    }
+}
+
+static void testSkip()
+{
+    testSkip(0);
+    testSkip(1);
+    testSkip(3);
+    testSkip(8);
+    testSkip(9);
+    testSkip(100);
+}
+
+using Comp = Convolver<TestComposite>;
+
+static void waitForImpulse(Comp& comp)
+{
+    for (int i = 0; !comp.isImpulseLoaded(); ++i) {
+        assertLT(i, 10 * 1000 * 1000);
+        comp.step();
+    }
+}
+
+/**
+ * The head and the tail together should be the whole convolution,
+ * blockSize late.
+ */
+static void testCompositeMatchesDirect(int blockParam, int impulseSize)
+{
+    Comp comp;
+    comp.init();
+    comp._setWaitForTail(true);
+    comp.params[Comp::BLOCK_SIZE_PARAM].value = float(blockParam);
+    comp.params[Comp::MIX_PARAM].value = 1;
+    comp.outputs[Comp::AUDIO_OUTPUT].channels = 1;
+
+    const std::vector<float> impulse = makeImpulse(impulseSize);
+    comp.setImpulse_UI(impulse);
+    waitForImpulse(comp);
+
+    const int blockSize = Comp::blockSizeFromParam(float(blockParam));
+    assertEQ(comp.getBlockSize(), blockSize);
+
+    const std::vector<float> input = makeInput(impulseSize + 4 * ConvolverServer::getTailBlockSize(blockSize));
+    for (int t = 0; t < int(input.size()); ++t) {
+        comp.inputs[Comp::AUDIO_INPUT].setVoltage(input[t], 0);
+        comp.step();
+        const float output = comp.outputs[Comp::AUDIO_OUTPUT].getVoltage(0);
+        const double expected = (t < blockSize) ? 0 : directConvolution(input, impulse, t - blockSize);
+        assertClose(output, expected, .0005);
+    }
+    assertEQ(comp._underruns(), 0);
+}
+
+static void testCompositeMatchesDirect()
+{
+    // all head
+    testCompositeMatchesDirect(0, 500);
+    // head and tail
+    testCompositeMatchesDirect(0, 3000);
+    testCompositeMatchesDirect(2, 10000);
+}
+
+/**
+ * The dry signal is delayed as much as the wet, so it lines up.
+ */
+static void testDry()
+{
+    Comp comp;
+    comp.init();
+    comp.params[Comp::MIX_PARAM].value = 0;
+    comp.outputs[Comp::AUDIO_OUTPUT].channels = 1;
+    comp.setImpulse_UI(makeImpulse(100));
+    waitForImpulse(comp);
+
+    const int blockSize = comp.getBlockSize();
+    for (int t = 0; t < 3 * blockSize; ++t) {
+        comp.inputs[Comp::AUDIO_INPUT].setVoltage(t == 0 ? 3.f : 0.f, 0);
+        comp.step();
+        const float expected = (t == blockSize) ? 3.f : 0.f;
+        assertEQ(comp.outputs[Comp::AUDIO_OUTPUT].getVoltage(0), expected);
+    }
+}
+
+/**
+ * Half dry and half wet should be half the input plus half the convolution,
+ * all blockSize late.
+ */
+static void testHalfMixMatchesDirect(int blockParam, int impulseSize)
+{
+    Comp comp;
+    comp.init();
+    comp._setWaitForTail(true);
+    comp.params[Comp::BLOCK_SIZE_PARAM].value = float(blockParam);
+    comp.params[Comp::MIX_PARAM].value = .5f;
+    comp.outputs[Comp::AUDIO_OUTPUT].channels = 1;
+
+    const std::vector<float> impulse = makeImpulse(impulseSize);
+    comp.setImpulse_UI(impulse);
+    waitForImpulse(comp);
+
+    const int blockSize = Comp::blockSizeFromParam(float(blockParam));
+    const std::vector<float> input = makeInput(impulseSize + 4 * ConvolverServer::getTailBlockSize(blockSize));
+    for (int t = 0; t < int(input.size()); ++t) {
+        comp.inputs[Comp::AUDIO_INPUT].setVoltage(input[t], 0);
+        comp.step();
+        const float output = comp.outputs[Comp::AUDIO_OUTPUT].getVoltage(0);
+        const double expected = (t < blockSize) ? 0 : .5 * (input[t - blockSize] + directConvolution(input, impulse, t - blockSize));
+        assertClose(output, expected, .0005);
+    }
+    assertEQ(comp._underruns(), 0);
+}
+
+static void testHalfMixMatchesDirect()
+{
+    testHalfMixMatchesDirect(0, 500);
+    testHalfMixMatchesDirect(2, 10000);
+}
+
+/**
+ * Changing the block size rebuilds the convolvers, and changes the latency.
+ */
+static void testBlockSizeChange()
+{
+    Comp comp;
+    comp.init();
+    comp._setWaitForTail(true);
+    comp.params[Comp::MIX_PARAM].value = 1;
+    comp.outputs[Comp::AUDIO_OUTPUT].channels = 1;
+    comp.setImpulse_UI(std::vector<float>{1});
+    waitForImpulse(comp);
+    assertEQ(comp.getBlockSize(), 32);
+
+    comp.params[Comp::BLOCK_SIZE_PARAM].value = 3;
+    for (int i = 0; i < 10 * 1000 * 1000 && comp.getBlockSize() == 32; ++i) {
+        comp.step();
+    }
+    assertEQ(comp.getBlockSize(), 256);
+    waitForImpulse(comp);
+
+    // a click comes out 256 samples later
+    for (int t = 0; t < 1000; ++t) {
+        comp.inputs[Comp::AUDIO_INPUT].setVoltage(t == 0 ? 1.f : 0.f, 0);
+        comp.step();
+        const float expected = (t == 256) ? 1.f : 0.f;
+        assertClose(comp.outputs[Comp::AUDIO_OUTPUT].getVoltage(0), expected, .00001);
+    }
+}
+
+void testConvolver()
+{
+    testMatchesDirect();
+    testSkip();
+    testCompositeMatchesDirect();
+    testDry();
+    testHalfMixMatchesDirect();
+    testBlockSizeChange();
+    testFinalLeaks();
+}
@@ -2,10 +2,14 @@
 #include "asserts.h"
 #include <memory>
 #include <set>
+#include <vector>
 
 #include "AudioMath.h"
 #include "FFTData.h"
 #include "FFT.h"
+#include "FFTPlan.h"
+
+#include <thread>
 
 extern void testFinalLeaks();
 
@@ -305,7 +309,145 @@ static void testBlueNoise(float corner = 0)
     }
 }
 
+/**
+ * Noise made from the same phases at neighboring slopes
+ * is almost the same signal, so it can be mixed without losing level.
+ */
+static void testNoisePhases()
+{
+    const int bins = 1024 * 16;
+    std::vector<float> phases(bins);
+    for (int i = 0; i < bins; ++i) {
+        phases[i] = float(2 * AudioMath::Pi * double(std::rand()) / double(RAND_MAX));
+    }
+
+    FFTDataCpx spectrum(bins);
+    FFTDataReal noise0(bins), noise1(bins), noise2(bins);
+    FFTDataReal* noise[3] = {&noise0, &noise1, &noise2};
+    const float slopes[3] = {-3, -2, -2};
+    for (int i = 0; i < 3; ++i) {
+        ColoredNoiseSpec spec;
+        spec.slope = slopes[i];
+        FFT::makeNoiseSpectrum(&spectrum, spec, i < 2 ? phases : std::vector<float>(bins, 0.f));
+        for (int bin = 1; bin < bins / 2; ++bin) {
+            const float expected = (i < 2) ? std::arg(std::polar(1.f, phases[bin])) : 0;
+            assertClose(std::arg(spectrum.get(bin)), expected, .0001);
+        }
+        FFT::inverse(noise[i], spectrum);
+        FFT::normalize(noise[i], 5);
+    }
+
+    auto correlation = [bins](const FFTDataReal& a, const FFTDataReal& b) {
+        double ab = 0, aa = 0, bb = 0;
+        for (int i = 0; i < bins; ++i) {
+            ab += a.get(i) * b.get(i);
+            aa += a.get(i) * a.get(i);
+            bb += b.get(i) * b.get(i);
+        }
+        return ab / std::sqrt(aa * bb);
+    };
+    const double sameCorrelation = correlation(noise0, noise1);
+    const double differentCorrelation = std::abs(correlation(noise1, noise2));
+    assertGT(sameCorrelation, .9);
+    assertLT(differentCorrelation, .5);
+}
+
+static float randomFloat()
+{
+    return float(2 * double(std::rand()) / double(RAND_MAX) - 1);
+}
+
+/**
+ * The SSE FFT should give the same answers as kiss, to float precision.
+ */
+static void testSimdMatchesKiss(int size)
+{
+    FFTDataReal signal(size);
+    FFTDataCpx kissSpectrum(size);
+    FFTDataCpx simdSpectrum(size);
+    for (int i = 0; i < size; ++i) {
+        signal.set(i, randomFloat());
+    }
+
+    FFT::setBackend(FFT::Backend::Kiss);
+    FFT::forward(&kissSpectrum, signal);
+    FFT::setBackend(FFT::Backend::Simd);
+    FFT::forward(&simdSpectrum, signal);
+
+    // the bins of white noise are about 1 / sqrt(size)
+    const float binTolerance = float(1e-5 / std::sqrt(size));
+    for (int i = 0; i < size; ++i) {
+        const float error = std::abs(simdSpectrum.get(i) - kissSpectrum.get(i));
+        assertLT(error, binTolerance);
+    }
 
+    FFTDataCpx spectrum(size);
+    for (int i = 0; i <= size / 2; ++i) {
+        spectrum.set(i, cpx(randomFloat(), randomFloat()));
+    }
+    FFTDataReal kissSignal(size);
+    FFTDataReal simdSignal(size);
+    FFT::setBackend(FFT::Backend::Kiss);
+    FFT::inverse(&kissSignal, spectrum);
+    FFT::setBackend(FFT::Backend::Simd);
+    FFT::inverse(&simdSignal, spectrum);
+
+    // and the samples are about sqrt(size)
+    const float sampleTolerance = float(1e-5 * std::sqrt(size));
+    for (int i = 0; i < size; ++i) {
+        assertClose(simdSignal.get(i), kissSignal.get(i), sampleTolerance);
+    }
+
+    FFTDataReal roundTrip(size);
+    FFT::inverse(&roundTrip, simdSpectrum);
+    for (int i = 0; i < size; ++i) {
+        assertClose(roundTrip.get(i), signal.get(i), .00001);
+    }
+}
+
+static void testSimdMatchesKiss()
+{
+    assert(FFT::getBackend() == FFT::Backend::Simd);
+    for (int size = 4; size <= 1024 * 64; size *= 2) {
+        testSimdMatchesKiss(size);
+    }
+
+    // not a power of two, so it's kiss both times
+    testSimdMatchesKiss(96);
+    testSimdMatchesKiss(1000);
+}
+
+static void testPlanCache()
+{
+    assert(!FFTPlan::get(16));
+    assert(!FFTPlan::get(1000));
+
+    const std::shared_ptr<const FFTPlan> plan = FFTPlan::get(1024);
+    assert(plan);
+    assertEQ(plan->size(), 1024);
+    assert(plan == FFTPlan::get(1024));
+    assert(plan != FFTPlan::get(2048));
+
+    // every thread should get the same plans
+    const int numThreads = 4;
+    std::vector<const FFTPlan*> plans[numThreads];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        std::vector<const FFTPlan*>* myPlans = plans + t;
+        threads.push_back(std::thread([myPlans]() {
+            for (int size = FFTPlan::minSize; size <= 1024 * 64; size *= 2) {
+                myPlans->push_back(FFTPlan::get(size).get());
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int t = 1; t < numThreads; ++t) {
+        assert(plans[t] == plans[0]);
+    }
+    assert(plans[0][5] == plan.get());
+}
 
 void testFFT()
 {
@@ -324,5 +466,8 @@ void testFFT()
     testWhiteNoiseRT();
     testPolar1();
     testPolar2();
+    testNoisePhases();
+    testSimdMatchesKiss();
+    testPlanCache();
     testFinalLeaks();
 }
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include "asserts.h"
 #include "simd.h"
 
+#include <algorithm>
+#include <cmath>
+
 using Comp2_Poly = F2_Poly<TestComposite>;
 using Comp4 = F4<TestComposite>;
 
@@ -39,7 +42,9 @@ static void testF2Fc_Poly(float fcParam, float cv, float expectedFcGain)
     };
 
     auto validate = [expectedFcGain](Comp2_Poly& comp) {
-       simd_assertClosePct(comp._params1()._fcGain(), float_4(expectedFcGain), 10);
+       // expected values are for 4X
+       const float_4 fcGain4X = comp._params1()._fcGain() * float_4(comp._oversample(0) / 4.f);
+       simd_assertClosePct(fcGain4X, float_4(expectedFcGain), 10);
     };
     testArbitrary<Comp2_Poly>(setup, validate);
 } 
@@ -84,8 +89,12 @@ static void testF2R_Poly(float rParam, float rcv, float fcParam, float expectedF
     };
 
     auto validate = [expectedFcGain1,expectedFcGain2 ](Comp2_Poly& comp) {
-        simd_assertClosePct(comp._params1()._fcGain(), float_4(expectedFcGain1), 10);
-        simd_assertClosePct(comp._params2()._fcGain(), float_4(expectedFcGain2), 10);
+        // expected values are for 4X
+        const float_4 scale = float_4(comp._oversample(0) / 4.f);
+        const float_4 fcGain1 = comp._params1()._fcGain() * scale;
+        const float_4 fcGain2 = comp._params2()._fcGain() * scale;
+        simd_assertClosePct(fcGain1, float_4(expectedFcGain1), 10);
+        simd_assertClosePct(fcGain2, float_4(expectedFcGain2), 10);
     };
     testArbitrary<Comp2_Poly>(setup, validate);
 }
@@ -115,6 +124,149 @@ static void testF2R_Poly()
     testF2R_Poly(10, 0, 2.5, .00032f, .0332f);
 }
 
+static void testF2Oversample(float fcParam, float qParam, int expectedOversample)
+{
+    auto setup = [fcParam, qParam](Comp2_Poly& comp) {
+        comp.params[Comp2_Poly::FC_PARAM].value = fcParam;
+        comp.params[Comp2_Poly::Q_PARAM].value = qParam;
+        comp.inputs[Comp2_Poly::AUDIO_INPUT].channels = 4;
+    };
+
+    auto validate = [expectedOversample](Comp2_Poly& comp) {
+        assertEQ(comp._oversample(0), expectedOversample);
+    };
+    testArbitrary<Comp2_Poly>(setup, validate);
+}
+
+static void testF2Oversample()
+{
+    // 261 Hz, 523 Hz, 1046 Hz with the default Q
+    testF2Oversample(4, 2, 1);
+    testF2Oversample(5, 2, 2);
+    testF2Oversample(6, 2, 4);
+    testF2Oversample(10, 2, 4);
+
+    // low Q needs more oversampling
+    testF2Oversample(2, 0, 1);
+    testF2Oversample(3, 0, 2);
+    testF2Oversample(4, 0, 4);
+
+    // and high Q less
+    testF2Oversample(5, 8, 1);
+    testF2Oversample(6, 8, 2);
+    testF2Oversample(7, 8, 4);
+}
+
+/**
+ * Runs a sine through the filter, returns the peak output after it settles.
+ */
+static float measureF2Response(bool adaptive, float fcParam, float qParam, int mode, float freq)
+{
+    Comp2_Poly comp;
+    initComposite(comp);
+    comp._setAdaptiveOversample(adaptive);
+    comp.params[Comp2_Poly::FC_PARAM].value = fcParam;
+    comp.params[Comp2_Poly::Q_PARAM].value = qParam;
+    comp.params[Comp2_Poly::MODE_PARAM].value = float(mode);
+    comp.params[Comp2_Poly::LIMITER_PARAM].value = 0;
+    comp.inputs[Comp2_Poly::AUDIO_INPUT].channels = 1;
+    comp.outputs[Comp2_Poly::AUDIO_OUTPUT].channels = 1;
+
+    TestComposite::ProcessArgs args;
+    const int settle = 20000;
+    float peak = 0;
+    for (int i = 0; i < settle + 4000; ++i) {
+        const float input = float(std::sin(2 * AudioMath::Pi * freq * i * args.sampleTime));
+        comp.inputs[Comp2_Poly::AUDIO_INPUT].setVoltage(input, 0);
+        comp.process(args);
+        if (i > settle) {
+            peak = std::max(peak, std::abs(comp.outputs[Comp2_Poly::AUDIO_OUTPUT].getVoltage(0)));
+        }
+    }
+    return peak;
+}
+
+/**
+ * The frequency response with adaptive oversampling must
+ * be close to the response at 4X.
+ */
+static void testF2Response(float fcParam, float qParam, int mode)
+{
+    const float freqs[] = {50, 200, 500, 1000, 2000, 5000};
+    for (float freq : freqs) {
+        const float reference = measureF2Response(false, fcParam, qParam, mode, freq);
+        const float adaptive = measureF2Response(true, fcParam, qParam, mode, freq);
+        const double diffDb = std::abs(AudioMath::db(adaptive) - AudioMath::db(reference));
+        // far down in the stop band, small absolute differences are big in db
+        if (reference > .2) {
+            assertLT(diffDb, .2);
+        } else {
+            assertClose(adaptive, reference, .01);
+        }
+    }
+}
+
+static void testF2Response()
+{
+    for (int mode = 0; mode < 4; ++mode) {
+        testF2Response(3, 2, mode);
+        testF2Response(5, 2, mode);
+        testF2Response(6, 2, mode);
+        testF2Response(2, 0, mode);
+        testF2Response(3, 0, mode);
+        testF2Response(5, 6, mode);
+        testF2Response(6, 8, mode);
+    }
+}
+
+/**
+ * Sweeps Fc up and down through all the oversample rates, and checks
+ * that the output stays close to the 4X output the whole way.
+ * A click would show up as a big difference right after a switch.
+ */
+static void testF2SweepNoClicks(float qParam)
+{
+    Comp2_Poly reference;
+    Comp2_Poly adaptive;
+    Comp2_Poly* comps[] = {&reference, &adaptive};
+    for (Comp2_Poly* comp : comps) {
+        initComposite(*comp);
+        comp->params[Comp2_Poly::FC_PARAM].value = 5;
+        comp->params[Comp2_Poly::FC_TRIM_PARAM].value = 1;
+        comp->params[Comp2_Poly::Q_PARAM].value = qParam;
+        comp->params[Comp2_Poly::LIMITER_PARAM].value = 0;
+        comp->inputs[Comp2_Poly::AUDIO_INPUT].channels = 1;
+        comp->inputs[Comp2_Poly::FC_INPUT].channels = 1;
+        comp->outputs[Comp2_Poly::AUDIO_OUTPUT].channels = 1;
+    }
+    reference._setAdaptiveOversample(false);
+
+    TestComposite::ProcessArgs args;
+    bool saw1X = false;
+    bool saw4X = false;
+    float maxDiff = 0;
+    const int period = 40000;
+    for (int i = 0; i < 2 * period; ++i) {
+        // triangle sweep, Fc volts goes from 2 to 8 and back
+        const float phase = float(i % period) / period;
+        const float cv = (phase < .5f) ? (-3 + 12 * phase) : (9 - 12 * phase);
+        const float input = float(3 * std::sin(2 * AudioMath::Pi * 220 * i * args.sampleTime));
+        for (Comp2_Poly* comp : comps) {
+            comp->inputs[Comp2_Poly::FC_INPUT].setVoltage(cv, 0);
+            comp->inputs[Comp2_Poly::AUDIO_INPUT].setVoltage(input, 0);
+            comp->process(args);
+        }
+        saw1X |= (adaptive._oversample(0) == 1);
+        saw4X |= (adaptive._oversample(0) == 4);
+        const float diff = std::abs(adaptive.outputs[Comp2_Poly::AUDIO_OUTPUT].getVoltage(0) -
+                                    reference.outputs[Comp2_Poly::AUDIO_OUTPUT].getVoltage(0));
+        maxDiff = std::max(maxDiff, diff);
+    }
+    assert(saw1X);
+    assert(saw4X);
+    assertLT(maxDiff, .1);
+}
+
 static void testF4Fc()
 {
     testF2Fc<Comp4>(0, 0, .00058f);
@@ -225,6 +377,11 @@ void testFilterComposites()
    // testF4Fc();
    //void testPolyChannels(int  inputPort, int outputPort, int numChannels)
     testPolyChannelsF2();
+
+    testF2Oversample();
+    testF2Response();
+    testF2SweepNoClicks(2);
+    testF2SweepNoClicks(8);
 }
 
 #endif
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <assert.h>
+#include <cmath>
 #include <vector>
 
 #include "FrequencyShifter.h"
 #include "TestComposite.h"
 #include "ExtremeTester.h"
+#include "asserts.h"
 
 using Shifter = FrequencyShifter<TestComposite>;
 
@@ -57,9 +59,106 @@ static void testExtreme()
     ExtremeTester<Shifter>::test(va, paramLimits, true, "shifter");
 }
 
+/**
+ * Runs a sine through the shifter, and returns the amplitude of the output at
+ * frequency. Uses a single bin DFT, over a whole number of cycles.
+ */
+static float measureShift(int output, float range, float shift, float inputFreq, float freq)
+{
+    const float sampleRate = 44100;
+    Shifter fs;
+    fs.setSampleRate(sampleRate);
+    fs.init();
+    fs.freqRange = range;
+    fs.params[Shifter::PITCH_PARAM].value = shift;
+
+    double re = 0;
+    double im = 0;
+    const int settle = 4000;
+    const int n = 44100;
+    for (int i = 0; i < settle + n; ++i) {
+        const double t = double(i) / sampleRate;
+        fs.inputs[Shifter::AUDIO_INPUT].setVoltage(float(std::sin(2 * AudioMath::Pi * inputFreq * t)), 0);
+        fs.step();
+        if (i >= settle) {
+            const double out = fs.outputs[output].getVoltage(0);
+            re += out * std::cos(2 * AudioMath::Pi * freq * t);
+            im += out * std::sin(2 * AudioMath::Pi * freq * t);
+        }
+    }
+    return float(2 * std::sqrt(re * re + im * im) / n);
+}
+
+// 1000 Hz shifted by 500 Hz should come out at 1500 from one output, and 500 from the other.
+static void testSingleSideband()
+{
+    const float up1500 = measureShift(Shifter::SIN_OUTPUT, 500, 5, 1000, 1500);
+    const float up500 = measureShift(Shifter::SIN_OUTPUT, 500, 5, 1000, 500);
+    const float down1500 = measureShift(Shifter::COS_OUTPUT, 500, 5, 1000, 1500);
+    const float down500 = measureShift(Shifter::COS_OUTPUT, 500, 5, 1000, 500);
+
+    assertClose(up1500, 1, .05);
+    assertClose(down500, 1, .05);
+
+    // the other sideband should be at least 40 db down
+    assertLT(up500, .01);
+    assertLT(down1500, .01);
+}
+
+// In exp mode zero volts is 64 Hz, and it's 1V/octave
+static void testExpRange()
+{
+    assertClose(measureShift(Shifter::SIN_OUTPUT, 0, 0, 1000, 1064), 1, .05);
+    assertClose(measureShift(Shifter::SIN_OUTPUT, 0, 1, 1000, 1128), 1, .05);
+    assertClose(measureShift(Shifter::SIN_OUTPUT, 0, 4, 1000, 2024), 1, .05);
+}
+
+// each of the 16 channels should be exactly the same as a mono shifter
+static void testPolyMatchesMono()
+{
+    const int numChannels = 16;
+    Shifter poly;
+    poly.setSampleRate(44100);
+    poly.init();
+    poly.freqRange = 50;
+    poly.inputs[Shifter::AUDIO_INPUT].channels = numChannels;
+    poly.inputs[Shifter::CV_INPUT].channels = numChannels;
+    poly.outputs[Shifter::SIN_OUTPUT].channels = 1;
+    poly.outputs[Shifter::COS_OUTPUT].channels = 1;
+
+    std::vector<Shifter> monos(numChannels);
+    for (auto& mono : monos) {
+        mono.setSampleRate(44100);
+        mono.init();
+        mono.freqRange = 50;
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            poly.inputs[Shifter::AUDIO_INPUT].setVoltage(float(std::sin(i * .01 * (channel + 1))), channel);
+            poly.inputs[Shifter::CV_INPUT].setVoltage(-5 + .6f * channel, channel);
+        }
+        poly.step();
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float input = poly.inputs[Shifter::AUDIO_INPUT].getVoltage(channel);
+            const float cv = poly.inputs[Shifter::CV_INPUT].getVoltage(channel);
+            monos[channel].inputs[Shifter::AUDIO_INPUT].setVoltage(input, 0);
+            monos[channel].inputs[Shifter::CV_INPUT].setVoltage(cv, 0);
+            monos[channel].step();
+
+            assertEQ(poly.outputs[Shifter::SIN_OUTPUT].getVoltage(channel), monos[channel].outputs[Shifter::SIN_OUTPUT].getVoltage(0));
+            assertEQ(poly.outputs[Shifter::COS_OUTPUT].getVoltage(channel), monos[channel].outputs[Shifter::COS_OUTPUT].getVoltage(0));
+        }
+    }
+    assertEQ(poly.outputs[Shifter::SIN_OUTPUT].channels, numChannels);
+}
+
 void testFrequencyShifter()
 {
     test0();
     test1();
     testExtreme();
+    testSingleSideband();
+    testExpRange();
+    testPolyMatchesMono();
 }
\ No newline at end of file
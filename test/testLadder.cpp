@@ -6,6 +6,10 @@
 #include "PeakDetector.h"
 #include "TestComposite.h"
 
+#include <cmath>
+#include <memory>
+#include <vector>
+
 
 static void testLadderZero()
 {
@@ -206,6 +210,126 @@ static void testFilt2()
     }
 }
 
+/**
+ * Each lane of LadderFilter<float_4> must match a scalar LadderFilter<float>
+ * with the same settings.
+ */
+static void testLadder4MatchesScalar(LadderFilterBase::Types type, LadderFilterBase::Voicing voicing)
+{
+    LadderFilter<float_4> filter4;
+    LadderFilter<float> filters[4];
+
+    filter4.setType(type);
+    filter4.setVoicing(voicing);
+    filter4.setVolume(.6f);
+    for (int lane = 0; lane < 4; ++lane) {
+        LadderFilter<float>& f = filters[lane];
+        const float fc = .003f * (1 + lane * 5);
+        const float feedback = float(lane);
+        const float gain = .5f + lane;
+        const float edge = .25f * lane;
+        const float spread = .3f * lane;
+        const float slope = .8f * lane;
+
+        f.setType(type);
+        f.setVoicing(voicing);
+        f.setVolume(.6f);
+        f.setNormalizedFc(fc);
+        f.setFeedback(feedback);
+        f.setGain(gain);
+        f.setEdge(edge);
+        f.setFreqSpread(spread);
+        f.setSlope(slope);
+        f.setBassMakeupGain(1 + lane * .5f);
+
+        filter4.setNormalizedFc(lane, fc);
+        filter4.setFeedback(lane, feedback);
+        filter4.setGain(lane, gain);
+        filter4.setEdge(lane, edge);
+        filter4.setFreqSpread(lane, spread);
+        filter4.setSlope(lane, slope);
+        filter4.setBassMakeupGain(lane, 1 + lane * .5f);
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        float_4 input;
+        for (int lane = 0; lane < 4; ++lane) {
+            input[lane] = float(4 * std::sin(i * .01 * (lane + 1)));
+        }
+        filter4.run(input);
+        const float_4 output = filter4.getOutput();
+        for (int lane = 0; lane < 4; ++lane) {
+            filters[lane].run(input[lane]);
+            assertClose(output[lane], filters[lane].getOutput(), 1e-3);
+        }
+    }
+
+    for (int lane = 0; lane < 4; ++lane) {
+        for (int tap = 0; tap < 4; ++tap) {
+            assertEQ(filter4.getLEDValue(lane, tap), filters[lane].getLEDValue(tap));
+        }
+    }
+}
+
+static void testLadder4MatchesScalar()
+{
+    const int numVoicings = (int)LadderFilterBase::Voicing::NUM_VOICINGS;
+    for (int i = 0; i < numVoicings; ++i) {
+        testLadder4MatchesScalar(LadderFilterBase::Types::_4PLP, LadderFilterBase::Voicing(i));
+    }
+    testLadder4MatchesScalar(LadderFilterBase::Types::_2PBP, LadderFilterBase::Voicing::Classic);
+    testLadder4MatchesScalar(LadderFilterBase::Types::_3PHP, LadderFilterBase::Voicing::Clean);
+    testLadder4MatchesScalar(LadderFilterBase::Types::_PHASER, LadderFilterBase::Voicing::Fold);
+}
+
+/**
+ * Each channel of a poly Filt must match a mono Filt
+ * with the same input and fc CV. Mono runs a scalar double filter,
+ * so they are only close.
+ */
+static void testFiltPolyMatchesMono(int numChannels)
+{
+    using F = Filt<TestComposite>;
+    auto setup = [](F& f, int channels) {
+        f.init();
+        f.params[F::Q_PARAM].value = 2;
+        f.params[F::MASTER_VOLUME_PARAM].value = .5;
+        f.inputs[F::L_AUDIO_INPUT].channels = channels;
+        f.inputs[F::CV_INPUT1].channels = channels;
+        f.outputs[F::L_AUDIO_OUTPUT].channels = 1;
+    };
+
+    F poly;
+    setup(poly, numChannels);
+    std::vector<std::shared_ptr<F>> monos;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        auto mono = std::make_shared<F>();
+        setup(*mono, 1);
+        const float cv = -3 + .5f * channel;
+        poly.inputs[F::CV_INPUT1].setVoltage(cv, channel);
+        mono->inputs[F::CV_INPUT1].setVoltage(cv, 0);
+        monos.push_back(mono);
+    }
+
+    float maxOutput = 0;
+    for (int i = 0; i < 1000; ++i) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float input = float(3 * std::sin(i * .02 * (channel + 1)));
+            poly.inputs[F::L_AUDIO_INPUT].setVoltage(input, channel);
+            monos[channel]->inputs[F::L_AUDIO_INPUT].setVoltage(input, 0);
+            monos[channel]->step();
+        }
+        poly.step();
+        assertEQ(poly.outputs[F::L_AUDIO_OUTPUT].getChannels(), numChannels);
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float expected = monos[channel]->outputs[F::L_AUDIO_OUTPUT].getVoltage(0);
+            assertClose(poly.outputs[F::L_AUDIO_OUTPUT].getVoltage(channel), expected, .001);
+            maxOutput = std::max(maxOutput, std::abs(expected));
+        }
+    }
+    assertGT(maxOutput, 1);
+}
+
 static bool _testFiltStability(double fNorm, double feedback)
 {
     LadderFilter<double> f;
@@ -629,7 +753,7 @@ static void testProcVarsStereo()
     stepF(f);
 
     const Filt<TestComposite>::ProcessingVars& x = f._getProcVars();
-    assert(x.mode == LadderFilterBank<double>::Modes::stereo);
+    assert(x.mode == LadderFilterBank::Modes::stereo);
     assert(x.inputForChannel0 == nullptr);
     assert(x.inputForChannel1 != nullptr);
     assertEQ(x.leftOutputChannels, 1);
@@ -650,7 +774,7 @@ static void testProcVarsPoly()
     stepF(f);
 
     const Filt<TestComposite>::ProcessingVars& x = f._getProcVars();
-    assert(x.mode == LadderFilterBank<double>::Modes::normal);
+    assert(x.mode == LadderFilterBank::Modes::normal);
     assert(x.inputForChannel0 == nullptr);
     assert(x.inputForChannel1 == nullptr);
     assertEQ(x.leftOutputChannels, 12);
@@ -672,7 +796,7 @@ static void testProcVarsL()
     stepF(f);
 
     const Filt<TestComposite>::ProcessingVars& x = f._getProcVars();
-    assert(x.mode == LadderFilterBank<double>::Modes::leftOnly);
+    assert(x.mode == LadderFilterBank::Modes::leftOnly);
     assert(x.inputForChannel0 == nullptr);
     assert(x.inputForChannel1 == nullptr);
     assertEQ(x.leftOutputChannels, 1);
@@ -694,7 +818,7 @@ static void testProcVarsR()
     stepF(f);
 
     const Filt<TestComposite>::ProcessingVars& x = f._getProcVars();
-    assert(x.mode == LadderFilterBank<double>::Modes::rightOnly);
+    assert(x.mode == LadderFilterBank::Modes::rightOnly);
     assert(x.inputForChannel0 != nullptr);
     assert(x.inputForChannel1 == nullptr);
     assertEQ(x.leftOutputChannels, 1);
@@ -741,6 +865,10 @@ void testLadder()
     testFiltOutputLeftOnly();
     testFiltOutputRightOnly();
 
+    testLadder4MatchesScalar();
+    testFiltPolyMatchesMono(5);
+    testFiltPolyMatchesMono(16);
+
     // the following are bad tests
 #if 0
     testFiltOutputsDisconnect();
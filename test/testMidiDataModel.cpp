@@ -129,6 +129,109 @@ static void testDelete3()
     assert(no->pitchCV == 33);
 }
 
+static MidiNoteEventPtr makeNote(float time, float pitch)
+{
+    MidiNoteEventPtr ev = std::make_shared<MidiNoteEvent>();
+    ev->startTime = time;
+    ev->pitchCV = pitch;
+    ev->duration = .5f;
+    return ev;
+}
+
+// big edit, so goes through the merge path
+static void testReplaceEvents()
+{
+    auto lock = MidiLock::make();
+    MidiTrack mt(lock);
+    MidiLocker l(lock);
+
+    std::vector<MidiEventPtr> toRemove;
+    std::vector<MidiEventPtr> toAdd;
+    for (int i = 0; i < 32; ++i) {
+        auto note = makeNote(float(i), 1);
+        mt.insertEvent(note);
+        if (i % 2) {
+            // remove a copy, not the same pointer, to prove we match on value
+            toRemove.push_back(note->clone());
+            toAdd.push_back(makeNote(float(i), 2));
+        }
+    }
+    // two new notes at time 0 should come after the existing one, in order
+    toAdd.push_back(makeNote(0, 3));
+    toAdd.push_back(makeNote(0, 4));
+    mt.insertEnd(100);
+    mt.assertValid();
+    const auto orig = mt._testGetVector();
+
+    mt.replaceEvents(toRemove, toAdd);
+    mt.assertValid();
+    assertEQ(mt.size(), 32 + 1 + 2);
+
+    auto mv = mt._testGetVector();
+    assertEQ(safe_cast<MidiNoteEvent>(mv[0])->pitchCV, 1);
+    assertEQ(safe_cast<MidiNoteEvent>(mv[1])->pitchCV, 3);
+    assertEQ(safe_cast<MidiNoteEvent>(mv[2])->pitchCV, 4);
+    for (int i = 3; i < 34; ++i) {
+        auto note = safe_cast<MidiNoteEvent>(mv[i]);
+        const int time = i - 2;
+        assertEQ(note->startTime, time);
+        const float expectedPitch = (time % 2) ? 2.f : 1.f;
+        assertEQ(note->pitchCV, expectedPitch);
+    }
+
+    // and swapping the arguments puts it back
+    mt.replaceEvents(toAdd, toRemove);
+    mt.assertValid();
+    mv = mt._testGetVector();
+    assertEQ(mv.size(), orig.size());
+    for (size_t i = 0; i < mv.size(); ++i) {
+        assert(*mv[i] == *orig[i]);
+    }
+}
+
+// small edit on a bigger track, so edits in place
+static void testReplaceEventsSmall()
+{
+    auto lock = MidiLock::make();
+    MidiTrack mt(lock);
+    MidiLocker l(lock);
+
+    for (int i = 0; i < 100; ++i) {
+        mt.insertEvent(makeNote(float(i), 1));
+    }
+    mt.insertEnd(100);
+
+    std::vector<MidiEventPtr> toRemove = {makeNote(50, 1)};
+    std::vector<MidiEventPtr> toAdd = {makeNote(50, 2)};
+    mt.replaceEvents(toRemove, toAdd);
+    mt.assertValid();
+    assertEQ(mt.size(), 101);
+    assertEQ(safe_cast<MidiNoteEvent>(mt._testGetVector()[50])->pitchCV, 2);
+}
+
+// identical notes at the same time; only one should go
+static void testReplaceEventsDuplicates()
+{
+    auto lock = MidiLock::make();
+    MidiTrack mt(lock);
+    MidiLocker l(lock);
+
+    mt.insertEvent(makeNote(1, 1));
+    mt.insertEvent(makeNote(1, 1));
+    mt.insertEvent(makeNote(1, 0));
+    mt.insertEnd(4);
+
+    std::vector<MidiEventPtr> toRemove = {makeNote(1, 1)};
+    std::vector<MidiEventPtr> toAdd;
+    mt.replaceEvents(toRemove, toAdd);
+    mt.assertValid();
+    assertEQ(mt.size(), 3);
+
+    auto mv = mt._testGetVector();
+    assertEQ(safe_cast<MidiNoteEvent>(mv[0])->pitchCV, 1);
+    assertEQ(safe_cast<MidiNoteEvent>(mv[1])->pitchCV, 0);
+}
+
 static void testFind1()
 {
     auto lock = MidiLock::make();
@@ -374,6 +477,9 @@ void testMidiDataModel()
     testDelete();
     testDelete2();
     testDelete3();
+    testReplaceEvents();
+    testReplaceEventsSmall();
+    testReplaceEventsDuplicates();
     testFind1();
     testTimeRange0();
     testNoteTimeRange0();
@@ -530,6 +530,312 @@ static void testVoiceAssignBug()
     assert(p->_getIndex() != 0);
 }
 
+/**
+ * This is the original linear search version of ReUse.
+ * The new one must pick exactly the same voices.
+ */
+class ReferenceReUseAssigner
+{
+public:
+    ReferenceReUseAssigner(MidiVoice* vx, int n) : voices(vx), numVoices(n)
+    {
+    }
+    MidiVoice* getNext(float pitch)
+    {
+        for (int i = 0; i < numVoices; ++i) {
+            if ((voices[i].pitch() == pitch) &&
+                (voices[i].state() == MidiVoice::State::Idle)) {
+                if (i == nextVoice) {
+                    nextVoice = advance(nextVoice);
+                }
+                return voices + i;
+            }
+        }
+        for (int i = 0; i < numVoices; ++i) {
+            int candidateVoice = wrapAround(i + nextVoice);
+            if (voices[candidateVoice].state() == MidiVoice::State::Idle) {
+                nextVoice = advance(candidateVoice);
+                return voices + candidateVoice;
+            }
+        }
+        int i = nextVoice;
+        nextVoice = advance(nextVoice);
+        return voices + i;
+    }
+private:
+    MidiVoice* const voices;
+    const int numVoices;
+    int nextVoice = 0;
+    int wrapAround(int vxNum)
+    {
+        return (vxNum >= numVoices) ? vxNum - numVoices : vxNum;
+    }
+    int advance(int vxNum)
+    {
+        return wrapAround(vxNum + 1);
+    }
+};
+
+static void testVoiceAssignReUseMatchesReference(int numVoices)
+{
+    MidiVoice vx[16];
+    MidiVoiceAssigner va(vx, 16);
+    TestHost2 th;
+    va.setNumVoices(numVoices);
+    initVoices(vx, 16, &th);
+    ReferenceReUseAssigner ref(vx, numVoices);
+
+    // pseudo random notes, lots of overlaps and repeated pitches
+    unsigned int seed = 1234;
+    auto next = [&seed](int range) {
+        seed = seed * 1103515245 + 12345;
+        return int((seed >> 16) % range);
+    };
+
+    double time = 0;
+    for (int i = 0; i < 5000; ++i) {
+        const float pitch = float(next(12)) / 12.f;
+        MidiVoice* expected = ref.getNext(pitch);
+        MidiVoice* actual = va.getNext(pitch);
+        assertEQ(actual->_getIndex(), expected->_getIndex());
+
+        const double duration = .25 * (1 + next(8));
+        actual->playNote(pitch, time, float(time + duration));
+        time += .25 * next(3);
+        for (int j = 0; j < 16; ++j) {
+            vx[j].updateToMetricTime(time);
+            vx[j].updateSampleCount(100);       // finish any re-triggers
+        }
+    }
+}
+
+static void testVoiceAssignReUseMatchesReference()
+{
+    testVoiceAssignReUseMatchesReference(1);
+    testVoiceAssignReUseMatchesReference(3);
+    testVoiceAssignReUseMatchesReference(16);
+}
+
+static void testVoiceAssignStealOldest()
+{
+    MidiVoice vx[3];
+    MidiVoiceAssigner va(vx, 3);
+    TestHost2 th;
+    initVoices(vx, 3, &th);
+    va.setMode(MidiVoiceAssigner::Mode::StealOldest);
+
+    // three long notes, started in order 0, 1, 2
+    for (int i = 0; i < 3; ++i) {
+        MidiVoice* p = va.getNext(float(i));
+        assertEQ(p->_getIndex(), i);
+        p->playNote(float(i), 0, 10);
+    }
+
+    // all busy, so steal the oldest
+    MidiVoice* p = va.getNext(5);
+    assertEQ(p->_getIndex(), 0);
+    p->playNote(5, 1, 10);
+
+    // now 1 is the oldest
+    p = va.getNext(6);
+    assertEQ(p->_getIndex(), 1);
+}
+
+static void testVoiceAssignLRU()
+{
+    MidiVoice vx[3];
+    MidiVoiceAssigner va(vx, 3);
+    TestHost2 th;
+    initVoices(vx, 3, &th);
+    va.setMode(MidiVoiceAssigner::Mode::StealOldest);
+
+    vx[0].playNote(0, 0, 3);
+    vx[1].playNote(1, 0, 1);
+    vx[2].playNote(2, 0, 2);
+
+    // they end in the order 1, 2, 0
+    for (int i = 0; i < 3; ++i) {
+        vx[i].updateToMetricTime(1.5);
+    }
+
+    // only 1 is idle
+    MidiVoice* p = va.getNext(5);
+    assertEQ(p->_getIndex(), 1);
+
+    for (int i = 0; i < 3; ++i) {
+        vx[i].updateToMetricTime(2.5);
+    }
+    for (int i = 0; i < 3; ++i) {
+        vx[i].updateToMetricTime(5);
+    }
+    // all idle now, 1 has been idle the longest, then 2
+    p = va.getNext(5);
+    assertEQ(p->_getIndex(), 1);
+    p->playNote(5, 6, 7);
+
+    p = va.getNext(5);
+    assertEQ(p->_getIndex(), 2);
+}
+
+static void testVoiceAssignPriority(bool low)
+{
+    MidiVoice vx[2];
+    MidiVoiceAssigner va(vx, 2);
+    TestHost2 th;
+    initVoices(vx, 2, &th);
+    va.setMode(low ? MidiVoiceAssigner::Mode::LowPriority : MidiVoiceAssigner::Mode::HighPriority);
+
+    va.getNext(1)->playNote(1, 0, 10);
+    va.getNext(3)->playNote(3, 0, 10);
+
+    // new note is between the two playing, so steals the one that loses
+    MidiVoice* p = va.getNext(2);
+    assert(p);
+    const float expectedStolen = low ? 3.f : 1.f;
+    assertEQ(p->pitch(), expectedStolen);
+    p->playNote(2, 1, 10);
+
+    // new note loses to everything
+    p = va.getNext(low ? 4.f : 0.f);
+    assert(!p);
+
+    // new note wins
+    p = va.getNext(low ? 0.f : 4.f);
+    assert(p);
+    assertEQ(p->pitch(), 2.f);
+}
+
+/**
+ * With all the voices busy, the priority modes should give up the same
+ * note a search of all the voices would: the one that loses to all
+ * the others, the oldest if there is a tie.
+ */
+static void testVoiceAssignPriorityMatchesSearch(bool low)
+{
+    const int numVoices = 5;
+    MidiVoice vx[numVoices];
+    MidiVoiceAssigner va(vx, numVoices);
+    TestHost2 th;
+    initVoices(vx, numVoices, &th);
+    va.setMode(low ? MidiVoiceAssigner::Mode::LowPriority : MidiVoiceAssigner::Mode::HighPriority);
+
+    unsigned int seed = 5678;
+    auto next = [&seed](int range) {
+        seed = seed * 1103515245 + 12345;
+        return int((seed >> 16) % range);
+    };
+
+    int startOrder[numVoices] = {0};
+    int order = 0;
+    double time = 0;
+    for (int i = 0; i < 5000; ++i) {
+        // few pitches, so lots of ties
+        const float pitch = float(next(6)) / 12.f;
+
+        int expected = -1;
+        bool anyIdle = false;
+        for (int j = 0; j < numVoices; ++j) {
+            if (vx[j].state() == MidiVoice::State::Idle) {
+                anyIdle = true;
+            } else if (expected < 0) {
+                expected = j;
+            } else {
+                const float p = vx[j].pitch();
+                const float ep = vx[expected].pitch();
+                const bool loses = low ? (p > ep) : (p < ep);
+                if (loses || (p == ep && startOrder[j] < startOrder[expected])) {
+                    expected = j;
+                }
+            }
+        }
+
+        MidiVoice* actual = va.getNext(pitch);
+        if (anyIdle) {
+            assert(actual);
+            assert(actual->state() == MidiVoice::State::Idle);
+        } else {
+            const float ep = vx[expected].pitch();
+            const bool newWins = low ? (pitch < ep) : (pitch > ep);
+            if (newWins) {
+                assert(actual);
+                assertEQ(actual->_getIndex(), expected);
+            } else {
+                assert(!actual);
+            }
+        }
+
+        if (actual) {
+            startOrder[actual->_getIndex()] = order++;
+            actual->playNote(pitch, time, float(time + .25 * (1 + next(12))));
+        }
+        time += .25 * next(2);
+        for (int j = 0; j < numVoices; ++j) {
+            vx[j].updateToMetricTime(time);
+            vx[j].updateSampleCount(100);       // finish any re-triggers
+        }
+    }
+}
+
+/**
+ * A note that starts right when the last one on its voice ended is played
+ * as a re-trigger. The priority modes must rank that voice by the new note,
+ * even before the gate comes back.
+ */
+static void testVoiceAssignPriorityRetrigger(bool low)
+{
+    const int numVoices = 2;
+    MidiVoice vx[numVoices];
+    MidiVoiceAssigner va(vx, numVoices);
+    TestHost2 th;
+    initVoices(vx, numVoices, &th);
+    va.setMode(low ? MidiVoiceAssigner::Mode::LowPriority : MidiVoiceAssigner::Mode::HighPriority);
+
+    MidiVoice* first = va.getNext(1);
+    first->playNote(1, 0, 1);
+    MidiVoice* second = va.getNext(.5f);
+    assert(second != first);
+    second->playNote(.5f, 0, 2);
+
+    // first ends, and is re-triggered with a low note
+    first->updateToMetricTime(1);
+    assert(va.getNext(.2f) == first);
+    first->playNote(.2f, 1, 3);
+    assert(first->state() == MidiVoice::State::ReTriggering);
+    assertEQ(first->pitch(), .2f);
+
+    // now .2 and .5 are playing. High priority gives up the .2, low priority the .5
+    MidiVoice* const expected = low ? second : first;
+    for (int i = 0; i < 2; ++i) {
+        assert(va.getNext(.3f) == expected);
+
+        // and the same once the re-trigger is done
+        first->updateSampleCount(100);
+        assert(first->state() == MidiVoice::State::Playing);
+    }
+}
+
+static void testVoiceAssignNumVoicesChange()
+{
+    MidiVoice vx[4];
+    MidiVoiceAssigner va(vx, 4);
+    TestHost2 th;
+    initVoices(vx, 4, &th);
+    va.setMode(MidiVoiceAssigner::Mode::StealOldest);
+
+    va.setNumVoices(2);
+    va.getNext(1)->playNote(1, 0, 10);
+    va.getNext(2)->playNote(2, 0, 10);
+
+    // only two voices, so must steal
+    MidiVoice* p = va.getNext(3);
+    assertEQ(p->_getIndex(), 0);
+
+    // with more voices, should get an idle one
+    va.setNumVoices(4);
+    p = va.getNext(3);
+    assertEQ(p->_getIndex(), 2);
+}
+
 //********************* test helper functions ************************************************
 
 // song has an eight note starting at time 0
@@ -1160,6 +1466,16 @@ void testMidiPlayer2()
     testVoiceAssignRotate();
     testVoiceAssignRetrigger();
     testVoiceAssignBug();
+    testVoiceAssignReUseMatchesReference();
+    testVoiceAssignStealOldest();
+    testVoiceAssignLRU();
+    testVoiceAssignPriority(true);
+    testVoiceAssignPriority(false);
+    testVoiceAssignPriorityMatchesSearch(true);
+    testVoiceAssignPriorityMatchesSearch(false);
+    testVoiceAssignPriorityRetrigger(true);
+    testVoiceAssignPriorityRetrigger(false);
+    testVoiceAssignNumVoicesChange();
 
     playerTests<MidiPlayer2, TestHost2, MidiSong, true>(false);
     playerTests<MidiPlayer4, TestHost4, MidiSong4, false>(true);
@@ -0,0 +1,257 @@
+#include "EV3.h"
+#include "MinBLEPVCO_4.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+/**
+ * A scalar saw or square with rack's MinBlepGenerator,
+ * the same logic as MinBLEPVCO, for reference.
+ */
+class RefVCO
+{
+public:
+    RefVCO(float f, bool isSquare, float pw) : freq(f), square(isSquare), pulseWidth(pw)
+    {
+    }
+
+    float step()
+    {
+        if (square) {
+            return stepSquare();
+        }
+        phase += freq;
+        const float predicted = phase;
+        if (phase >= 1) {
+            phase -= 1;
+        }
+        if (phase != predicted) {
+            blep.insertDiscontinuity(-phase / freq, phase - predicted);
+        }
+        const float total = phase + blep.process();
+        return 5 * (-1 + 2 * total + freq * -4.6125f);
+    }
+
+private:
+    float stepSquare()
+    {
+        bool overflow = false;
+        phase += freq;
+        if (phase > 1) {
+            phase -= 1;
+            overflow = true;
+        }
+        const bool newSq = phase >= pulseWidth;
+        if (newSq != lastSq) {
+            lastSq = newSq;
+            const float crossing = overflow ? -phase / freq : -(phase - pulseWidth) / freq;
+            blep.insertDiscontinuity(crossing, newSq ? 2.f : -2.f);
+        }
+        const float x = (newSq ? 1.f : -1.f) + blep.process() + (pulseWidth * 2 - 1);
+        return 5 * x;
+    }
+
+    rack::dsp::MinBlepGenerator<16, 16, float> blep;
+    const float freq;
+    const bool square;
+    const float pulseWidth;
+    float phase = 0;
+    bool lastSq = false;
+};
+
+static void testMatchesRef(MinBLEPVCO_4::Waveform wf)
+{
+    const float_4 freq(.01f, .0123f, .05f, .31f);
+    const float_4 pw(.5f, .3f, .7f, .5f);
+    const bool isSquare = (wf == MinBLEPVCO_4::Waveform::Square);
+
+    MinBLEPVCO_4 vco;
+    for (int i = 0; i < 4; ++i) {
+        vco.setWaveform(i, wf);
+    }
+    vco.setNormalizedFreq(freq, 1.f / 44100);
+    vco.setPulseWidth(pw);
+
+    RefVCO ref0(freq[0], isSquare, pw[0]);
+    RefVCO ref1(freq[1], isSquare, pw[1]);
+    RefVCO ref2(freq[2], isSquare, pw[2]);
+    RefVCO ref3(freq[3], isSquare, pw[3]);
+
+    for (int i = 0; i < 2000; ++i) {
+        vco.step();
+        const float_4 expected(ref0.step(), ref1.step(), ref2.step(), ref3.step());
+        // not exact, since the residuals are interpolated in a different order,
+        // but a misplaced discontinuity would be off by volts
+        simd_assertClose(vco.getOutput(), expected, .01);
+    }
+}
+
+static void testMatchesRef()
+{
+    testMatchesRef(MinBLEPVCO_4::Waveform::Saw);
+    testMatchesRef(MinBLEPVCO_4::Waveform::Square);
+}
+
+// each lane should do the same thing, no matter what the other lanes are doing.
+static void testLanesIndependent()
+{
+    using Waveform = MinBLEPVCO_4::Waveform;
+    const Waveform mixed[4] = {Waveform::Tri, Waveform::Even, Waveform::Sin, Waveform::Square};
+    const float_4 freq(.01f, .0123f, .05f, .031f);
+
+    MinBLEPVCO_4 vco;
+    MinBLEPVCO_4 single[4];
+    for (int i = 0; i < 4; ++i) {
+        vco.setWaveform(i, mixed[i]);
+        for (int lane = 0; lane < 4; ++lane) {
+            single[i].setWaveform(lane, mixed[i]);
+        }
+        single[i].setNormalizedFreq(freq, 1.f / 44100);
+    }
+    vco.setNormalizedFreq(freq, 1.f / 44100);
+
+    float_4 minOut = 0;
+    float_4 maxOut = 0;
+    for (int n = 0; n < 8000; ++n) {
+        vco.step();
+        for (int i = 0; i < 4; ++i) {
+            single[i].step();
+            assertEQ(vco.getOutput()[i], single[i].getOutput()[i]);
+        }
+
+        // tri starts off center, and the leaky integrator takes a while to settle.
+        if (n < 6000) {
+            continue;
+        }
+        minOut = SimdBlocks::min(minOut, vco.getOutput());
+        maxOut = SimdBlocks::max(maxOut, vco.getOutput());
+    }
+    simd_assertGT(maxOut, float_4(3));
+    simd_assertLT(minOut, float_4(-3));
+    simd_assertLT(maxOut, float_4(8));
+    simd_assertGT(minOut, float_4(-8));
+}
+
+static void testNone()
+{
+    MinBLEPVCO_4 vco;
+    vco.setWaveform(1, MinBLEPVCO_4::Waveform::END);
+    vco.setNormalizedFreq(float_4(.01f), 1.f / 44100);
+    float maxOther = 0;
+    for (int i = 0; i < 1000; ++i) {
+        vco.step();
+        assertEQ(vco.getOutput()[1], 0);
+        maxOther = std::max(maxOther, vco.getOutput()[0]);
+    }
+    assertGT(maxOther, 4);
+}
+
+// pulse width changes the duty cycle, but the DC compensation keeps it centered
+static void testPulseWidthDC()
+{
+    MinBLEPVCO_4 vco;
+    for (int i = 0; i < 4; ++i) {
+        vco.setWaveform(i, MinBLEPVCO_4::Waveform::Square);
+    }
+    vco.setNormalizedFreq(float_4(.01f), 1.f / 44100);
+    vco.setPulseWidth(float_4(.1f, .3f, .5f, .8f));
+
+    float_4 sum = 0;
+    const int n = 10000;
+    for (int i = 0; i < n; ++i) {
+        vco.step();
+        sum += vco.getOutput();
+    }
+    const float_4 mean = sum / float_4(n);
+    simd_assertClose(mean, float_4(0), .05);
+}
+
+static void testSync(MinBLEPVCO_4::Waveform wf, bool sync)
+{
+    MinBLEPVCO_4 vco;
+    vco.setWaveform(0, MinBLEPVCO_4::Waveform::Saw);
+    vco.setWaveform(1, wf);
+    vco.setWaveform(2, wf);
+    vco.setWaveform(3, MinBLEPVCO_4::Waveform::END);
+
+    // lane 2 is never synced, for comparison
+    vco.setNormalizedFreq(float_4(.01f, .025f, .025f, .01f), 1.f / 44100);
+    float_4 syncEnabled = 0;
+    syncEnabled[1] = sync ? 1.f : 0.f;
+    vco.setSyncEnabled(syncEnabled > float_4(0));
+
+    // the sync lands half way through the slave's cycle, so keep the square's
+    // own edge away from there
+    vco.setPulseWidth(float_4(.3f));
+
+    int edges[3] = {0};
+    // ten and a half cycles of the master
+    for (int i = 0; i < 1050; ++i) {
+        vco.step();
+        const int mask = rack::simd::movemask(vco.getSyncOutMask());
+        for (int lane = 0; lane < 3; ++lane) {
+            if (mask & (1 << lane)) {
+                ++edges[lane];
+                const float crossing = vco.getSyncOutCrossing()[lane];
+                assert(crossing > -1 && crossing <= 0);
+            }
+        }
+        const float_4 out = vco.getOutput();
+        simd_assertLT(out, float_4(10));
+        simd_assertGT(out, float_4(-10));
+    }
+
+    assertEQ(edges[0], 10);
+    assertEQ(edges[2], 26);
+    if (sync && wf != MinBLEPVCO_4::Waveform::Sin) {
+        // two cycles of its own, then reset, every master cycle
+        assertEQ(edges[1], 31);
+    } else if (sync) {
+        // synced sin starts at half a cycle, and doesn't send out its resets
+        assertEQ(edges[1], 21);
+    } else {
+        assertEQ(edges[1], 26);
+    }
+}
+
+static void testSync()
+{
+    testSync(MinBLEPVCO_4::Waveform::Saw, false);
+    testSync(MinBLEPVCO_4::Waveform::Saw, true);
+    testSync(MinBLEPVCO_4::Waveform::Square, true);
+    testSync(MinBLEPVCO_4::Waveform::Even, true);
+    testSync(MinBLEPVCO_4::Waveform::Sin, true);
+}
+
+static void testEV3()
+{
+    using Comp = EV3<TestComposite>;
+    Comp ev3;
+    ev3.params[Comp::MIX1_PARAM].value = 1;
+    ev3.params[Comp::MIX2_PARAM].value = 1;
+    ev3.params[Comp::WAVE1_PARAM].value = float(Comp::Waves::SAW);
+    ev3.params[Comp::WAVE2_PARAM].value = float(Comp::Waves::SQUARE);
+    ev3.params[Comp::WAVE3_PARAM].value = float(Comp::Waves::NONE);
+    ev3.params[Comp::SYNC2_PARAM].value = 1;
+    ev3.params[Comp::OCTAVE2_PARAM].value = 1;
+
+    float maxMix = 0;
+    for (int i = 0; i < 10000; ++i) {
+        ev3.step();
+        maxMix = std::max(maxMix, ev3.outputs[Comp::MIX_OUTPUT].value);
+        assertLT(std::abs(ev3.outputs[Comp::VCO1_OUTPUT].value), 7);
+        assertLT(std::abs(ev3.outputs[Comp::VCO2_OUTPUT].value), 7);
+        assertEQ(ev3.outputs[Comp::VCO3_OUTPUT].value, 0);
+    }
+    assertGT(maxMix, 2);
+    assert(ev3.isLoweringVolume());
+}
+
+void testMinBLEPVCO_4()
+{
+    testMatchesRef();
+    testLanesIndependent();
+    testNone();
+    testPulseWidthDC();
+    testSync();
+    testEV3();
+}
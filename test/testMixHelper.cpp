@@ -5,6 +5,8 @@
 
 #include "asserts.h"
 
+#include <cmath>
+
 class MockMixComposite : public TestComposite
 {
 public:
@@ -268,6 +270,58 @@ static void testPoly2()
     assertClose(sum, expected, .001);
 }
 
+/**
+ * Two banks of strips should add up the same as a plain loop.
+ */
+static void testStrips()
+{
+    using Strips = MixStrips_4<8>;
+    Strips strips;
+    assertEQ(Strips::numBanks, 2);
+
+    float gains[Strips::NUM_GAINS][8];
+    float inputs[8];
+    for (int channel = 0; channel < 8; ++channel) {
+        inputs[channel] = channel - 3.5f;
+        for (int gain = 0; gain < Strips::NUM_GAINS; ++gain) {
+            gains[gain][channel] = (gain + 1) * .1f + channel * .01f;
+            strips.gains[gain][channel / 4][channel % 4] = gains[gain][channel];
+        }
+    }
+
+    const float_4 inputs4[2] = {float_4::load(inputs), float_4::load(inputs + 4)};
+    float_4 outputs[2];
+    float busses[8];
+    strips.mix(inputs4, outputs, busses);
+
+    for (int gain = 0; gain < Strips::numBusses; ++gain) {
+        float expected = 0;
+        for (int channel = 0; channel < 8; ++channel) {
+            expected += inputs[channel] * gains[gain][channel];
+        }
+        assertClose(busses[gain], expected, 1e-5);
+    }
+    for (int channel = 0; channel < 8; ++channel) {
+        const float expected = inputs[channel] * gains[Strips::CHANNEL][channel];
+        assertClose(outputs[channel / 4][channel % 4], expected, 1e-6);
+    }
+}
+
+static void testStripsPan()
+{
+    MixStrips_4<4> strips;
+    strips.setPan(0, float_4(-1, 0, 1, 0));
+    assertClose(strips.panLeft[0][0], 1, 1e-5);
+    assertClose(strips.panRight[0][0], 0, 1e-5);
+    assertClose(strips.panLeft[0][1], 1 / std::sqrt(2.f), 1e-5);
+    assertClose(strips.panLeft[0][2], 0, 1e-5);
+    assertClose(strips.panRight[0][2], 1, 1e-5);
+
+    // moving one lane updates it
+    strips.setPan(0, float_4(-1, 0, 1, 1));
+    assertClose(strips.panRight[0][3], 1, 1e-5);
+}
+
 void testMixHelper()
 {
     test0();
@@ -281,5 +335,8 @@ void testMixHelper()
     testPoly1();
     testPoly2();
 
+    testStrips();
+    testStripsPan();
+
    
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "TestMixerChain.h"
+#include "asserts.h"
+
+using Chain = TestMixerChain;
+using MixerM = MixM<TestComposite>;
+
+static void setInput(Chain& chain, int expander, float v)
+{
+    chain.expanders[expander]->comp.inputs[Mix4<TestComposite>::AUDIO0_INPUT].setVoltage(v, 0);
+}
+
+static float getOutput(Chain& chain)
+{
+    return chain.master.comp.outputs[MixerM::LEFT_OUTPUT].getVoltage(0);
+}
+
+/**
+ * Once things settle, the master should hear every expander.
+ */
+static void testSum()
+{
+    const int numExpanders = 3;
+    Chain chain(numExpanders);
+    Chain masterOnly(0);
+    for (int i = 0; i < numExpanders; ++i) {
+        setInput(chain, i, 1.f + i);
+    }
+    chain.master.comp.inputs[MixerM::AUDIO0_INPUT].setVoltage(-.5f, 0);
+    masterOnly.master.comp.inputs[MixerM::AUDIO0_INPUT].setVoltage(-.5f, 0);
+
+    for (int i = 0; i < 50; ++i) {
+        chain.stepExpanderMessages();
+        masterOnly.stepExpanderMessages();
+    }
+    assertGT(getOutput(chain), 1);
+    assertGT(getOutput(chain), getOutput(masterOnly) + 1);
+}
+
+/**
+ * Each module processes only itself, so the expander messages
+ * take a sample per hop.
+ */
+static void testLatency()
+{
+    const int numExpanders = 3;
+    Chain chain(numExpanders);
+    for (int i = 0; i < 20; ++i) {
+        chain.stepExpanderMessages();
+    }
+    assertEQ(getOutput(chain), 0);
+
+    setInput(chain, 0, 1);
+    for (int i = 0; i < numExpanders; ++i) {
+        chain.stepExpanderMessages();
+        assertEQ(getOutput(chain), 0);
+    }
+    chain.stepExpanderMessages();
+    assertGT(getOutput(chain), .5);
+}
+
+void testMixerChain()
+{
+    testSum();
+    testLatency();
+}
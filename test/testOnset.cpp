@@ -436,29 +436,45 @@ static void testWaveFile2()
 class TestOnsetDetector
 {
 public:
+    /**
+     * the last frame is in order, however the history wraps.
+     */
     static void test1()
     {
         OnsetDetector o;
-        assertEQ(o.curFrame, 0);
-        assertEQ(o.nextFrame(), 1);
-        assertEQ(o.prevFrame(), 2);
-        assertEQ(o.prevPrevFrame(), 1);
-
-        o.curFrame = 1;
-        assertEQ(o.nextFrame(), 2);
-        assertEQ(o.prevFrame(), 0);
-        assertEQ(o.prevPrevFrame(), 2);
-        
-        o.curFrame = 2;
-        assertEQ(o.nextFrame(), 0);
-        assertEQ(o.prevFrame(), 1);
-        assertEQ(o.prevPrevFrame(), 0);
+        const int n = OnsetDetector::frameSize;
+        for (int i = 0; i < n + 100; ++i) {
+            o.step(float(i));
+        }
+        const float* frame = o.lastFrame();
+        for (int i = 0; i < n; ++i) {
+            assertEQ(frame[i], float(i + 100));
+        }
+    }
+
+    /**
+     * the analysis is spread over analysisSteps samples, starting every hop.
+     */
+    static void test2()
+    {
+        OnsetDetector o;
+        for (int i = 1; i < OnsetDetector::hopSize; ++i) {
+            o.step(0);
+            assertEQ(o.analysisStep, OnsetDetector::analysisSteps);
+        }
+        for (int i = 0; i < OnsetDetector::analysisSteps; ++i) {
+            o.step(0);
+            assertEQ(o.analysisStep, i + 1);
+        }
+        o.step(0);
+        assertEQ(o.analysisStep, OnsetDetector::analysisSteps);
     }
 };
 
  static void testOnsetDetector()
  {
     TestOnsetDetector::test1();
+    TestOnsetDetector::test2();
  }
 
 #if 1
@@ -515,6 +531,6 @@ void testOnset()
 
     testWaveFile();
     testWaveFile2();
-    testOnsetDetector();
 #endif
+    testOnsetDetector();
 }
\ No newline at end of file
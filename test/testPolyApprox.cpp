@@ -0,0 +1,185 @@
+#include "AudioMath.h"
+#include "LookupTableFactory.h"
+#include "PolyApprox_4.h"
+#include "asserts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using Precision = PolyApprox_4::Precision;
+
+/**
+ * Sweeps x from x0 to x1, four points at a time,
+ * and returns the max error of approx vs the double precision reference.
+ */
+static double maxError(float x0, float x1,
+                       std::function<float_4(float_4)> approx,
+                       std::function<double(double)> reference,
+                       bool relative)
+{
+    const int steps = 40000;
+    const float delta = (x1 - x0) / steps;
+    double maxErr = 0;
+    for (int i = 0; i < steps; i += 4) {
+        const float_4 x(x0 + i * delta, x0 + (i + 1) * delta, x0 + (i + 2) * delta, x0 + (i + 3) * delta);
+        const float_4 y = approx(x);
+        for (int lane = 0; lane < 4; ++lane) {
+            const double expected = reference(x[lane]);
+            double err = std::abs(y[lane] - expected);
+            if (relative) {
+                err /= std::abs(expected);
+            }
+            maxErr = std::max(maxErr, err);
+        }
+    }
+    return maxErr;
+}
+
+template <Precision P>
+static void testSin(double tolerance)
+{
+    const double err = maxError(-3.3f, 3.7f, [](float_4 x) {
+        return PolyApprox_4::sin2pi<P>(x);
+    }, [](double x) {
+        return std::sin(2 * AudioMath::Pi * x);
+    }, false);
+    assertLT(err, tolerance);
+}
+
+template <Precision P>
+static void testExp2(double tolerance)
+{
+    const double err = maxError(-20, 20, [](float_4 x) {
+        return PolyApprox_4::exp2<P>(x);
+    }, [](double x) {
+        return std::pow(2.0, x);
+    }, true);
+    assertLT(err, tolerance);
+}
+
+template <Precision P>
+static void testLog2(double tolerance)
+{
+    double err = maxError(.001f, 1000, [](float_4 x) {
+        return PolyApprox_4::log2<P>(x);
+    }, [](double x) {
+        return std::log2(x);
+    }, false);
+    assertLT(err, tolerance);
+
+    // and for very small numbers, where the float result near -100
+    // only has a resolution of about 1e-5
+    err = maxError(1e-30f, 1e-20f, [](float_4 x) {
+        return PolyApprox_4::log2<P>(x);
+    }, [](double x) {
+        return std::log2(x);
+    }, false);
+    assertLT(err, std::max(tolerance, 2e-5));
+}
+
+template <Precision P>
+static void testTanh(double tolerance)
+{
+    const double err = maxError(-12, 12, [](float_4 x) {
+        return PolyApprox_4::tanh<P>(x);
+    }, [](double x) {
+        return std::tanh(x);
+    }, false);
+    assertLT(err, tolerance);
+}
+
+template <Precision P>
+static void testDb(double tolerance)
+{
+    double err = maxError(-100, 30, [](float_4 x) {
+        return PolyApprox_4::gainFromDb<P>(x);
+    }, [](double x) {
+        return AudioMath::gainFromDb(x);
+    }, true);
+    assertLT(err, tolerance);
+
+    err = maxError(.00001f, 30, [](float_4 x) {
+        return PolyApprox_4::db<P>(x);
+    }, [](double x) {
+        return AudioMath::db(x);
+    }, false);
+
+    // log2 error is scaled by 6 to get to db
+    assertLT(err, 6 * tolerance);
+}
+
+static void testExp2Exact()
+{
+    // integer powers are exact at the high tier
+    for (int i = -30; i < 30; ++i) {
+        const float_4 y = PolyApprox_4::exp2<Precision::High>(float_4(float(i)));
+        assertClosePct(y[0], std::pow(2.f, i), .00001);
+    }
+}
+
+static void testExp2Monotonic()
+{
+    // pitch CV needs this
+    float last = 0;
+    for (float x = -3; x < 3; x += .0001f) {
+        const float y = PolyApprox_4::exp2<Precision::Medium>(float_4(x))[0];
+        assertGE(y, last);
+        last = y;
+    }
+}
+
+static void testPan()
+{
+    for (float pan = -1; pan <= 1; pan += .01f) {
+        const float_4 gains = PolyApprox_4::panGains(pan);
+        assertClose(gains[0], _PanL(pan, 0), 1e-5);
+        assertClose(gains[1], _PanR(pan, 0), 1e-5);
+    }
+    assertClose(PolyApprox_4::panGains(0)[0], 1 / std::sqrt(2.f), 1e-5);
+    assertClose(PolyApprox_4::panGains(-1)[0], 1, 1e-5);
+    assertClose(PolyApprox_4::panGains(-1)[1], 0, 1e-5);
+}
+
+// four at a time should be the same as one at a time
+static void testPan4()
+{
+    for (float pan = -1; pan <= 1; pan += .01f) {
+        const float_4 pans(pan, -pan, pan * .5f, 1);
+        float_4 left, right;
+        PolyApprox_4::panGains(pans, left, right);
+        for (int i = 0; i < 4; ++i) {
+            const float_4 gains = PolyApprox_4::panGains(pans[i]);
+            assertEQ(left[i], gains[0]);
+            assertEQ(right[i], gains[1]);
+        }
+    }
+}
+
+void testPolyApprox()
+{
+    testSin<Precision::Low>(7e-5);
+    testSin<Precision::Medium>(1e-6);
+    testSin<Precision::High>(5e-7);
+
+    testExp2<Precision::Low>(8e-5);
+    testExp2<Precision::Medium>(3e-6);
+    testExp2<Precision::High>(3e-7);
+
+    testLog2<Precision::Low>(1e-5);
+    testLog2<Precision::Medium>(5e-6);
+    testLog2<Precision::High>(5e-6);
+
+    testTanh<Precision::Low>(1e-4);
+    testTanh<Precision::Medium>(3e-6);
+    testTanh<Precision::High>(5e-7);
+
+    testDb<Precision::Low>(8e-5);
+    testDb<Precision::Medium>(5e-6);
+    testDb<Precision::High>(5e-6);
+
+    testExp2Exact();
+    testExp2Monotonic();
+    testPan();
+    testPan4();
+}
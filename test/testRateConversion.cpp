@@ -1,10 +1,21 @@
 
 #include "IIRUpsampler.h"
 #include "IIRDecimator.h"
+#include "PolyphaseDecimator.h"
+#include "PolyphaseUpsampler.h"
 
+#include "Analyzer.h"
+#include "AudioMath.h"
+#include "FFT.h"
+#include "FFTData.h"
 #include "asserts.h"
 
-static void setup(IIRUpsampler& up, IIRDecimator<float>& dec)
+#include <simd/vector.hpp>
+#include <cmath>
+
+using float_4 = rack::simd::float_4;
+
+static void setup(IIRUpsampler<float>& up, IIRDecimator<float>& dec)
 {
    // float cutoff = .25 / 16;
     up.setup(16);
@@ -16,7 +27,7 @@ static void test0()
 {
     float buffer[16];
 
-    IIRUpsampler up;
+    IIRUpsampler<float> up;
     IIRDecimator<float> dec;
     setup(up, dec);
   
@@ -29,7 +40,7 @@ static void test1()
 {
     float buffer[16];
 
-    IIRUpsampler up;
+    IIRUpsampler<float> up;
     IIRDecimator<float> dec;
     setup(up, dec);
 
@@ -43,7 +54,7 @@ static void test2()
 {
     float buffer[16];
 
-    IIRUpsampler up;
+    IIRUpsampler<float> up;
     IIRDecimator<float> dec;
     setup(up, dec);
 
@@ -55,9 +66,200 @@ static void test2()
     assertClose(x, 10, .001);
 }
 
+/********** polyphase half-band versions ****************/
+
+static void testPolyphaseDC(int oversample)
+{
+    float buffer[16];
+
+    PolyphaseUpsampler<float> up;
+    PolyphaseDecimator<float> dec;
+    up.setup(oversample);
+    dec.setup(oversample);
+
+    up.process(buffer, 0);
+    assertEQ(dec.process(buffer), 0);
+
+    // the sharp filters take a while to settle
+    float x = 0;
+    for (int i = 0; i < 1000; ++i) {
+        up.process(buffer, 10);
+        x = dec.process(buffer);
+    }
+    assertClose(x, 10, .001);
+    for (int i = 0; i < oversample; ++i) {
+        assertClose(buffer[i], 10, .001);
+    }
+}
+
+static const int numFFTSamples = 4096;
+
+static double sinAt(int bin, int sample, int fftSize)
+{
+    return std::sin(AudioMath::Pi * 2 * double(bin) * double(sample) / double(fftSize));
+}
+
+/**
+ * Feeds a sine into the decimator at the high sample rate,
+ * returns the largest output bin in db. Full scale is zero db.
+ * @param bin is the frequency of the sine, in FFT bins of the output rate. May be above Nyquist.
+ */
+template <class TDec>
+static double decimatedLevelDb(int oversample, int bin)
+{
+    TDec dec;
+    dec.setup(oversample);
+    int sample = 0;
+    float buffer[16];
+    auto func = [&]() {
+        for (int i = 0; i < oversample; ++i) {
+            buffer[i] = float(sinAt(bin, sample++, numFFTSamples * oversample));
+        }
+        return dec.process(buffer);
+    };
+
+    // settle the filters
+    for (int i = 0; i < numFFTSamples; ++i) {
+        func();
+    }
+
+    FFTDataCpx spectrum(numFFTSamples);
+    Analyzer::getSpectrum(spectrum, false, func);
+    const int maxBin = Analyzer::getMax(spectrum);
+    return AudioMath::db(2 * spectrum.getAbs(maxBin));
+}
+
+/**
+ * Signals above the output Nyquist must not fold back into the audio band.
+ */
+static void testPolyphaseDecimatorAlias(int oversample)
+{
+    const int aliasBin = numFFTSamples / 4;                       // where the alias would land, fs / 4
+    const int inputBin = numFFTSamples - aliasBin;                // so input is at 3/4 fs
+    const int passBin = numFFTSamples / 8;
+
+    const double pass = decimatedLevelDb<PolyphaseDecimator<float>>(oversample, passBin);
+    const double alias = decimatedLevelDb<PolyphaseDecimator<float>>(oversample, inputBin);
+    assertClose(pass, 0, .1);
+    assertLT(alias, -85);
+
+    // IIRDecimator only does 4X and up
+    if (oversample >= 4) {
+        const double oldAlias = decimatedLevelDb<IIRDecimator<float>>(oversample, inputBin);
+        assertLT(alias, oldAlias);
+    }
+
+    // worst case, just over the stop band edge.
+    const double nearAlias = decimatedLevelDb<PolyphaseDecimator<float>>(oversample, (numFFTSamples * 56) / 100);
+    assertLT(nearAlias, -85);
+
+    // .45 of the sample rate still passes
+    const double nearPass = decimatedLevelDb<PolyphaseDecimator<float>>(oversample, (numFFTSamples * 45) / 100);
+    assertClose(nearPass, 0, .1);
+}
+
+/**
+ * The images from the upsampler must be well below the signal.
+ * Returns the ratio of the biggest image to the signal, in db.
+ */
+static double upsampledImageDb(int oversample, int bin)
+{
+    PolyphaseUpsampler<float> up;
+    up.setup(oversample);
+
+    int sample = 0;
+    int bufferIndex = oversample;
+    float buffer[16];
+    auto func = [&]() {
+        if (bufferIndex == oversample) {
+            up.process(buffer, float(sinAt(bin, sample++, numFFTSamples)));
+            bufferIndex = 0;
+        }
+        return buffer[bufferIndex++];
+    };
+    for (int i = 0; i < numFFTSamples * oversample; ++i) {
+        func();
+    }
+
+    // the high rate FFT is the same length, so the signal is at bin / oversample.
+    assert((bin % oversample) == 0);
+    FFTDataCpx spectrum(numFFTSamples);
+    Analyzer::getSpectrum(spectrum, false, func);
+    const int signalBin = bin / oversample;
+    const int maxBin = Analyzer::getMax(spectrum);
+    assertEQ(maxBin, signalBin);
+    std::set<int> signal = {signalBin, numFFTSamples - signalBin};
+    const int imageBin = Analyzer::getMaxExcluding(spectrum, signal);
+    return AudioMath::db(spectrum.getAbs(imageBin) / spectrum.getAbs(signalBin));
+}
+
+static void testPolyphaseUpsamplerImages(int oversample)
+{
+    // .3 and .44 of the base sample rate
+    const int bin1 = oversample * ((numFFTSamples * 3) / (10 * oversample));
+    const int bin2 = oversample * ((numFFTSamples * 44) / (100 * oversample));
+    assertLT(upsampledImageDb(oversample, bin1), -85);
+    assertLT(upsampledImageDb(oversample, bin2), -85);
+}
+
+/**
+ * float_4 should do exactly what four floats would.
+ */
+static void testPolyphaseSimd(int oversample)
+{
+    PolyphaseUpsampler<float> up[4];
+    PolyphaseDecimator<float> dec[4];
+    PolyphaseUpsampler<float_4> up4;
+    PolyphaseDecimator<float_4> dec4;
+    for (int i = 0; i < 4; ++i) {
+        up[i].setup(oversample);
+        dec[i].setup(oversample);
+    }
+    up4.setup(oversample);
+    dec4.setup(oversample);
+
+    for (int sample = 0; sample < 1000; ++sample) {
+        float_4 input;
+        float buffer[16];
+        float_4 buffer4[16];
+        for (int i = 0; i < 4; ++i) {
+            input[i] = float(sinAt(sample * (i + 1), 5 + i, 100));
+        }
+        up4.process(buffer4, input);
+        // shift the high rate signal a little, so the decimator sees something other than its own image
+        for (int j = 0; j < oversample; ++j) {
+            buffer4[j] *= float_4(1.f + float(j) / 16.f);
+        }
+        const float_4 out4 = dec4.process(buffer4);
+
+        for (int i = 0; i < 4; ++i) {
+            up[i].process(buffer, input[i]);
+            for (int j = 0; j < oversample; ++j) {
+                buffer[j] *= (1.f + float(j) / 16.f);
+                assertClose(buffer[j], buffer4[j][i], 1e-6);
+            }
+            const float out = dec[i].process(buffer);
+            assertClose(out, out4[i], 1e-6);
+        }
+    }
+}
+
+static void testPolyphase(int oversample)
+{
+    testPolyphaseDC(oversample);
+    testPolyphaseDecimatorAlias(oversample);
+    testPolyphaseUpsamplerImages(oversample);
+    testPolyphaseSimd(oversample);
+}
+
 void testRateConversion()
 {
     test0();
     test1();
     test2();
+    testPolyphaseDC(1);
+    testPolyphase(2);
+    testPolyphase(4);
+    testPolyphase(8);
+    testPolyphase(16);
 }
\ No newline at end of file
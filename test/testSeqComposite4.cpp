@@ -334,12 +334,86 @@ static void testSelectSectionWithCVPoly()
 }
 
 
+/**
+ * Drive the sequencer with a clock that doesn't line up with the internal
+ * processing block, and measure how far each gate lands from
+ * the clock edge that caused it.
+ * returns the worst case, in samples.
+ */
+static int measureClockJitter(int clockPeriod)
+{
+    const auto rate = SeqClock::ClockRate::Div4;
+    Sq4Ptr comp = make(rate, 4, true, -1);
+
+    const int clockHigh = 3;
+    int lastClockEdge = -1;
+    int maxJitter = 0;
+    int numGates = 0;
+    bool lastGates[4] = {false};
+
+    for (int sample = 0; sample < clockPeriod * 64; ++sample) {
+        const bool clock = (sample % clockPeriod) < clockHigh;
+        if (clock && (sample % clockPeriod) == 0) {
+            lastClockEdge = sample;
+        }
+        comp->inputs[Sq4::CLOCK_INPUT].setVoltage(clock ? 10.f : 0.f, 0);
+        comp->step();
+
+        for (int voice = 0; voice < 4; ++voice) {
+            const bool gate = comp->outputs[Sq4::GATE0_OUTPUT].getVoltage(voice) > 5;
+            if (gate && !lastGates[voice]) {
+                assert(lastClockEdge >= 0);
+                ++numGates;
+                maxJitter = std::max(maxJitter, sample - lastClockEdge);
+            }
+            lastGates[voice] = gate;
+        }
+    }
+    // sixteenth note clock, quarter notes
+    assertGE(numGates, 64 / 4 - 1);
+    return maxJitter;
+}
+
+static void testClockJitter()
+{
+    // these don't line up with the block size, so used to be late by a few samples
+    assertEQ(measureClockJitter(37), 0);
+    assertEQ(measureClockJitter(101), 0);
+    assertEQ(measureClockJitter(6), 0);
+    assertEQ(measureClockJitter(64), 0);
+}
+
 static void testLabels()
 {
     auto x = Sq4::getPolyLabels();
     assert(x.size() == 16);
     x = Sq4::getCVFunctionLabels();
     assert(x.size() == 4);
+    x = Sq4::getVoiceModeLabels();
+    assert(x.size() == int(MidiVoiceAssigner::Mode::HighPriority) + 1);
+}
+
+// each track's voice assignment param picks its assigner mode
+static void testVoiceMode()
+{
+    const SeqClock::ClockRate rate = SeqClock::ClockRate::Div64;
+    Sq4Ptr comp = make(rate, 4, true, -1);
+    for (int tk = 0; tk < 4; ++tk) {
+        assert(comp->getTrackPlayer(tk)->_getVoiceAssigner().getMode() == MidiVoiceAssigner::Mode::ReUse);
+    }
+
+    comp->params[Sq4::VOICE_MODE2_PARAM].value = float(MidiVoiceAssigner::Mode::HighPriority);
+    comp->step();
+    assert(comp->getTrackPlayer(2)->_getVoiceAssigner().getMode() == MidiVoiceAssigner::Mode::HighPriority);
+    assert(comp->getTrackPlayer(1)->_getVoiceAssigner().getMode() == MidiVoiceAssigner::Mode::ReUse);
+
+    // and it still plays
+    bool gate = false;
+    for (int i = 0; i < 64 && !gate; ++i) {
+        genOneClock(comp);
+        gate = comp->outputs[Sq4::GATE2_OUTPUT].getVoltage(0) > 5;
+    }
+    assert(gate);
 }
 
 void testSeqComposite4()
@@ -348,6 +422,8 @@ void testSeqComposite4()
     testPause();
     testPauseSwitchSectionStart();
     testLabels();
+    testVoiceMode();
     testSelectSectionWithCV();
     testSelectSectionWithCVPoly();
+    testClockJitter();
 }
\ No newline at end of file
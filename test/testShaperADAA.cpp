@@ -0,0 +1,229 @@
+#include "ADAA.h"
+#include "Analyzer.h"
+#include "AudioMath.h"
+#include "FFT.h"
+#include "FFTData.h"
+#include "Shaper.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+#include <algorithm>
+#include <cmath>
+
+using Comp = Shaper<TestComposite>;
+
+/**
+ * the anti-derivatives must really be anti-derivatives
+ */
+template <class TShape>
+static void testAntiderivative()
+{
+    const double h = 1e-4;
+    for (double x = -15; x < 15; x += .0137) {
+        const double slope = (TShape::F(x + h) - TShape::F(x - h)) / (2 * h);
+        assertClose(slope, TShape::f(x), 1e-3);
+        const double slope2 = (TShape::F2(x + h) - TShape::F2(x - h)) / (2 * h);
+        assertClose(slope2, TShape::F(x), 1e-3);
+    }
+}
+
+/**
+ * and the shapes must match the ones in Shaper
+ */
+template <class TShape>
+static void testMatchesShaper(Comp::Shapes shape)
+{
+    Comp shaper;
+    shaper.params[Comp::PARAM_SHAPE].value = float(shape);
+    shaper.params[Comp::PARAM_OVERSAMPLE].value = 2;        // 1X
+    shaper.params[Comp::PARAM_ACDC].value = 1;              // DC
+    shaper.params[Comp::PARAM_GAIN].value = 5;              // full gain, so we hit the limits
+    shaper.inputs[Comp::INPUT_AUDIO0].channels = 1;
+    shaper.outputs[Comp::OUTPUT_AUDIO0].channels = 1;
+    shaper.step();
+    const float gain = shaper._gain[0][0];
+    const float offset = shaper._offset[0][0];
+
+    for (float x = -3; x < 3; x += .01f) {
+        shaper.inputs[Comp::INPUT_AUDIO0].setVoltage(x, 0);
+        shaper.step();
+        const double expected = TShape::f((x + offset) * gain);
+        assertClose(shaper.outputs[Comp::OUTPUT_AUDIO0].getVoltage(0), expected, 1e-3);
+    }
+}
+
+template <class TShape, class TADAA>
+static void testSlowInput(double delay)
+{
+    // when the input barely changes, ADAA is the same as just running the shape,
+    // a little late. Right at the corners of the folder the average
+    // is a couple of mV off.
+    ADAAState state;
+    float buffer[1];
+    double x = -10;
+    for (int i = 0; i < 3; ++i) {
+        buffer[0] = float(x);
+        TADAA::run(buffer, 1, state);
+        x += .001;
+    }
+    for (int i = 0; i < 20000; ++i) {
+        buffer[0] = float(x);
+        TADAA::run(buffer, 1, state);
+        assertClose(buffer[0], TShape::f(float(x) - .001 * delay), 2e-3);
+        x += .001;
+    }
+
+    // and constant input must not fall apart
+    for (int i = 0; i < 10; ++i) {
+        buffer[0] = 1.5f;
+        TADAA::run(buffer, 1, state);
+    }
+    assertClose(buffer[0], TShape::f(1.5), 1e-5);
+}
+
+/**
+ * Switching between the orders, or input that keeps coming back
+ * to the same value, must not blow up. Both orders average f over
+ * the inputs, so can't go past the biggest f in between.
+ */
+template <class TShape>
+static void testSwitchOrder()
+{
+    double maxF = 0;
+    for (double x = 1; x <= 2; x += .001) {
+        maxF = std::max(maxF, std::abs(TShape::f(x)));
+    }
+
+    ADAAState state;
+    for (int i = 0; i < 10; ++i) {
+        float buffer[3] = {1, 2, 1};
+        ADAA1<TShape>::run(buffer, 3, state);
+        for (float y : buffer) {
+            assertLE(std::abs(y), maxF + 1e-3);
+        }
+        float buffer2[4] = {2, 1, 2, 1};
+        ADAA2<TShape>::run(buffer2, 4, state);
+        for (float y : buffer2) {
+            assertLE(std::abs(y), maxF + 1e-3);
+        }
+    }
+
+    float buffer[1];
+    for (int i = 0; i < 10; ++i) {
+        buffer[0] = 1.5f;
+        ADAA2<TShape>::run(buffer, 1, state);
+    }
+    assertClose(buffer[0], TShape::f(1.5), 1e-5);
+}
+
+template <class TShape>
+static void testShape(Comp::Shapes shape)
+{
+    testAntiderivative<TShape>();
+    testSlowInput<TShape, ADAA1<TShape>>(.5);
+    testSlowInput<TShape, ADAA2<TShape>>(1);
+    testSwitchOrder<TShape>();
+    testMatchesShaper<TShape>(shape);
+}
+
+/**
+ * Runs a sine through Shaper and returns the power of everything that isn't
+ * a harmonic of the input, relative to the harmonics, in db.
+ *
+ * The input is exactly periodic in the FFT frame, and the fundamental is a prime number
+ * of bins, so every harmonic lands exactly on a bin, and no alias lands on a harmonic.
+ */
+static double measureAlias(Comp::Shapes shape, int oversampleCode, int adaaOrder, float gain)
+{
+    const int numSamples = 16 * 1024;
+    const int fundamentalBin = 743;                 // about 2k
+
+    Comp shaper;
+    shaper.params[Comp::PARAM_SHAPE].value = float(shape);
+    shaper.params[Comp::PARAM_OVERSAMPLE].value = float(oversampleCode);
+    shaper.params[Comp::PARAM_ADAA].value = float(adaaOrder);
+    shaper.params[Comp::PARAM_GAIN].value = gain;
+    shaper.inputs[Comp::INPUT_AUDIO0].channels = 1;
+    shaper.outputs[Comp::OUTPUT_AUDIO0].channels = 1;
+
+    int sample = 0;
+    auto func = [&]() {
+        const double phase = AudioMath::Pi * 2 * double(fundamentalBin) * double(sample++) / double(numSamples);
+        shaper.inputs[Comp::INPUT_AUDIO0].setVoltage(float(std::sin(phase)), 0);
+        shaper.step();
+        return shaper.outputs[Comp::OUTPUT_AUDIO0].getVoltage(0);
+    };
+
+    // let everything settle
+    for (int i = 0; i < 4 * numSamples; ++i) {
+        func();
+    }
+
+    FFTDataCpx spectrum(numSamples);
+    Analyzer::getSpectrum(spectrum, false, func);
+
+    double signal = 0;
+    double alias = 0;
+    for (int i = 1; i < numSamples / 2; ++i) {
+        const double mag = spectrum.getAbs(i);
+        if ((i % fundamentalBin) == 0) {
+            signal += mag * mag;
+        } else {
+            alias += mag * mag;
+        }
+    }
+    return 10 * std::log10(alias / signal);
+}
+
+static void testAlias(Comp::Shapes shape, float gain)
+{
+    const double x16 = measureAlias(shape, 0, 0, gain);
+    const double x4 = measureAlias(shape, 1, 0, gain);
+    const double x1 = measureAlias(shape, 2, 0, gain);
+    const double adaa16 = measureAlias(shape, 0, 1, gain);
+    const double adaa4 = measureAlias(shape, 1, 1, gain);
+    const double adaa1 = measureAlias(shape, 2, 1, gain);
+    const double adaa2x4 = measureAlias(shape, 1, 2, gain);
+    const double adaa2x1 = measureAlias(shape, 2, 2, gain);
+
+    // ADAA should be a big improvement at every oversampling rate,
+    // and ADAA at 4X should be about as good as plain 16X.
+    // Second order should be better again, and at 4X much better than plain 16X.
+    // Below -100 db we would just be comparing rounding noise.
+    const double floor = -100;
+    if (x1 > floor) {
+        assertLT(adaa1, x1 - 5);
+    }
+    if (x4 > floor) {
+        assertLT(adaa4, x4 - 10);
+        assertLT(x16, x4);
+    }
+    if (x16 > floor) {
+        assertLT(adaa16, x16 - 10);
+        assertLT(adaa4, x16 + 3);
+        assertLT(adaa2x4, x16 - 10);
+    }
+    if (adaa1 > floor) {
+        assertLT(adaa2x1, adaa1 - 4);
+    }
+    if (adaa4 > floor) {
+        assertLT(adaa2x4, adaa4 - 10);
+    }
+}
+
+void testShaperADAA()
+{
+    testShape<ShaperADAAShapes::FullWave>(Comp::Shapes::FullWave);
+    testShape<ShaperADAAShapes::HalfWave>(Comp::Shapes::HalfWave);
+    testShape<ShaperADAAShapes::Clip>(Comp::Shapes::Clip);
+    testShape<ShaperADAAShapes::EmitterCoupled>(Comp::Shapes::EmitterCoupled);
+    testShape<ShaperADAAShapes::Fold>(Comp::Shapes::Fold);
+
+    for (float gain : {0.f, 3.f, 5.f}) {
+        testAlias(Comp::Shapes::FullWave, gain);
+        testAlias(Comp::Shapes::HalfWave, gain);
+        testAlias(Comp::Shapes::Clip, gain);
+        testAlias(Comp::Shapes::EmitterCoupled, gain);
+        testAlias(Comp::Shapes::Fold, gain);
+    }
+}
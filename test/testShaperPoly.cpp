@@ -0,0 +1,162 @@
+#include "AsymWaveShaper.h"
+#include "LookupTable_4.h"
+#include "ObjectCache.h"
+#include "Shaper.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using Comp = Shaper<TestComposite>;
+
+static void testLookup4()
+{
+    auto table = ObjectCache<float>::getTanh5();
+    for (float x = -7; x < 7; x += .013f) {
+        const float_4 x4(x, x + .001f, -x, x * .5f);
+        const float_4 y4 = LookupTable_4::lookup(*table, x4);
+        for (int i = 0; i < 4; ++i) {
+            const float expected = LookupTable<float>::lookup(*table, x4[i], true);
+            assertClose(y4[i], expected, 1e-6);
+        }
+    }
+}
+
+static void testAsymLookup4()
+{
+    AsymWaveShaper shaper;
+    const int index[4] = {0, 5, 11, 15};
+    for (float x = -1.5f; x < 1.5f; x += .007f) {
+        const float_4 y4 = shaper.lookup(float_4(x), index);
+        for (int i = 0; i < 4; ++i) {
+            assertClose(y4[i], shaper.lookup(x, index[i]), 1e-6);
+        }
+    }
+}
+
+/**
+ * Each channel of a 16 channel Shaper must match a mono Shaper
+ * with the same input and CV.
+ */
+static void testPolyMatchesMono(Comp::Shapes shape, int oversampleCode, int adaaOrder)
+{
+    const int numChannels = 16;
+    auto setup = [shape, oversampleCode, adaaOrder](Comp& comp, int channels) {
+        comp.params[Comp::PARAM_SHAPE].value = float(shape);
+        comp.params[Comp::PARAM_OVERSAMPLE].value = float(oversampleCode);
+        comp.params[Comp::PARAM_ADAA].value = float(adaaOrder);
+        comp.params[Comp::PARAM_GAIN_TRIM].value = 1;
+        comp.params[Comp::PARAM_OFFSET_TRIM].value = 1;
+        comp.inputs[Comp::INPUT_AUDIO0].channels = channels;
+        comp.inputs[Comp::INPUT_GAIN].channels = channels;
+        comp.inputs[Comp::INPUT_OFFSET].channels = channels;
+        comp.outputs[Comp::OUTPUT_AUDIO0].channels = channels;
+    };
+
+    Comp poly;
+    setup(poly, numChannels);
+    std::vector<std::shared_ptr<Comp>> monos;
+    for (int i = 0; i < numChannels; ++i) {
+        auto mono = std::make_shared<Comp>();
+        setup(*mono, 1);
+        monos.push_back(mono);
+    }
+
+    for (int sample = 0; sample < 1000; ++sample) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float input = float(3 * std::sin(sample * .01 * (channel + 1)));
+            const float gainCV = -5 + 10 * float(channel) / numChannels;
+            const float offsetCV = 5 - 7 * float(channel) / numChannels;
+            poly.inputs[Comp::INPUT_AUDIO0].setVoltage(input, channel);
+            poly.inputs[Comp::INPUT_GAIN].setVoltage(gainCV, channel);
+            poly.inputs[Comp::INPUT_OFFSET].setVoltage(offsetCV, channel);
+
+            Comp& mono = *monos[channel];
+            mono.inputs[Comp::INPUT_AUDIO0].setVoltage(input, 0);
+            mono.inputs[Comp::INPUT_GAIN].setVoltage(gainCV, 0);
+            mono.inputs[Comp::INPUT_OFFSET].setVoltage(offsetCV, 0);
+            mono.step();
+        }
+        poly.step();
+
+        assertEQ(poly.outputs[Comp::OUTPUT_AUDIO0].getChannels(), numChannels);
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float expected = monos[channel]->outputs[Comp::OUTPUT_AUDIO0].getVoltage(0);
+            assertClose(poly.outputs[Comp::OUTPUT_AUDIO0].getVoltage(channel), expected, 1e-4);
+        }
+    }
+}
+
+static void testPolyMatchesMono()
+{
+    const int shapeMax = (int)Comp::Shapes::Invalid;
+    for (int i = 0; i < shapeMax; ++i) {
+        testPolyMatchesMono(Comp::Shapes(i), 1, 0);
+        testPolyMatchesMono(Comp::Shapes(i), 2, 0);
+    }
+    testPolyMatchesMono(Comp::Shapes::FullWave, 0, 0);
+    testPolyMatchesMono(Comp::Shapes::Clip, 1, 1);
+    testPolyMatchesMono(Comp::Shapes::Fold, 2, 1);
+    testPolyMatchesMono(Comp::Shapes::EmitterCoupled, 2, 2);
+    testPolyMatchesMono(Comp::Shapes::HalfWave, 1, 2);
+}
+
+static void testRightFollowsLeft()
+{
+    Comp comp;
+    comp.inputs[Comp::INPUT_AUDIO0].channels = 5;
+    comp.outputs[Comp::OUTPUT_AUDIO0].channels = 1;
+    comp.outputs[Comp::OUTPUT_AUDIO1].channels = 1;
+    comp.params[Comp::PARAM_ACDC].value = 1;
+    comp.params[Comp::PARAM_SHAPE].value = float(Comp::Shapes::Clip);
+    for (int i = 0; i < 5; ++i) {
+        comp.inputs[Comp::INPUT_AUDIO0].setVoltage(float(i) - 2, i);
+    }
+    for (int i = 0; i < 100; ++i) {
+        comp.step();
+    }
+
+    assertEQ(comp.outputs[Comp::OUTPUT_AUDIO0].getChannels(), 5);
+    assertEQ(comp.outputs[Comp::OUTPUT_AUDIO1].getChannels(), 5);
+    for (int i = 0; i < 5; ++i) {
+        const float left = comp.outputs[Comp::OUTPUT_AUDIO0].getVoltage(i);
+        assertEQ(comp.outputs[Comp::OUTPUT_AUDIO1].getVoltage(i), left);
+    }
+    assertLT(comp.outputs[Comp::OUTPUT_AUDIO0].getVoltage(0), -1);
+    assertGT(comp.outputs[Comp::OUTPUT_AUDIO0].getVoltage(4), 1);
+}
+
+/**
+ * In AC mode a constant input on every channel must settle to zero.
+ */
+static void testDCBlock()
+{
+    const int numChannels = 7;
+    Comp comp;
+    comp.params[Comp::PARAM_ACDC].value = 0;
+    comp.params[Comp::PARAM_SHAPE].value = float(Comp::Shapes::HalfWave);
+    comp.inputs[Comp::INPUT_AUDIO0].channels = numChannels;
+    comp.outputs[Comp::OUTPUT_AUDIO0].channels = 1;
+    for (int i = 0; i < numChannels; ++i) {
+        comp.inputs[Comp::INPUT_AUDIO0].setVoltage(float(i) - 1.5f, i);
+    }
+
+    // a few time constants of 20 Hz
+    for (int i = 0; i < 44100; ++i) {
+        comp.step();
+    }
+    for (int i = 0; i < numChannels; ++i) {
+        assertClose(comp.outputs[Comp::OUTPUT_AUDIO0].getVoltage(i), 0, .001);
+    }
+}
+
+void testShaperPoly()
+{
+    testLookup4();
+    testAsymLookup4();
+    testPolyMatchesMono();
+    testRightFollowsLeft();
+    testDCBlock();
+}
@@ -1,5 +1,11 @@
 
+#include "Sines.h"
 #include "SinesVCO.h"
+#include "SinesWavetable.h"
+#include "TestComposite.h"
+
+#include <memory>
+#include <vector>
 
 #include "asserts.h"
 
@@ -27,8 +33,224 @@ static void testSines1()
    
 }
 
+static void testWavetableLevels()
+{
+    assertEQ(SinesWavetable::getLevel(1), 0);
+    assertEQ(SinesWavetable::getLevel(8), 0);
+    assertEQ(SinesWavetable::getLevel(15.9f), 0);
+    assertEQ(SinesWavetable::getLevel(16), 1);
+    assertEQ(SinesWavetable::getLevel(300), 5);
+    assertEQ(SinesWavetable::getLevel(1000000), SinesWavetable::numLevels - 1);
+}
+
+static void testWavetableRender()
+{
+    std::unique_ptr<SinesWavetable::Tables> tables(new SinesWavetable::Tables());
+    SinesWavetable::Recipe recipe;
+    recipe.sampleRate = 44100;
+    recipe.drawbarGains[2] = .5f;       // 8', the second harmonic
+    recipe.drawbarGains[8] = 1;         // 1', the 16th harmonic
+    recipe.percussionGains[3] = .25f;   // 4'
+    SinesWavetable::render(*tables, recipe);
+
+    // 8' peaks at 1/8 cycle. 1' is zero there.
+    assertClose(SinesWavetable::lookup(tables->drawbars[0], .125f), .5f, .0001);
+    assertClose(SinesWavetable::lookup(tables->percussion[0], 1.f / 16), .25f, .0001);
+
+    // 16 * 1024 * 2 is under .47 * 44100, but 16 * 2048 * 2 isn't.
+    assertClose(SinesWavetable::lookup(tables->drawbars[6], 1.f / 64), 1 + std::sin(AudioMath::Pi / 16) * .5f, .0001);
+    assertClose(SinesWavetable::lookup(tables->drawbars[7], 1.f / 64), std::sin(AudioMath::Pi / 16) * .5f, .0001);
+    assertClose(SinesWavetable::lookup(tables->drawbars[7], .125f), .5f, .0001);
+
+    // the extra sample at the end wraps around
+    for (int level = 0; level < SinesWavetable::numLevels; ++level) {
+        assertClose(tables->drawbars[level][SinesWavetable::tableSize], tables->drawbars[level][0], .0001);
+        assertClose(SinesWavetable::lookup(tables->drawbars[level], 1), SinesWavetable::lookup(tables->drawbars[level], 0), .0001);
+    }
+}
+
+using Organ = Sines<TestComposite>;
+
+static void setupOrgan(Organ& organ, bool wavetable)
+{
+    const float drawbars[9] = {8, 6, 8, 4, 0, 3, 5, 2, 1};
+    organ.init();
+    organ.inputs[Organ::VOCT_INPUT].channels = 1;
+    organ.outputs[Organ::MAIN_OUTPUT].channels = 1;
+    for (int i = 0; i < 9; ++i) {
+        organ.params[Organ::DRAWBAR1_PARAM + i].value = drawbars[i];
+    }
+    organ.params[Organ::PERCUSSION2_PARAM].value = 6;
+    organ.params[Organ::WAVETABLE_PARAM].value = wavetable ? 1.f : 0.f;
+}
+
+static void runUntilWavetable(Organ& organ, const Organ::ProcessArgs& args)
+{
+    while (!organ._usingWavetable()) {
+        organ.process(args);
+    }
+}
+
+/**
+ * Amplitude of one partial, using a single bin DFT with a Hann window.
+ */
+static double partialAmplitude(const std::vector<float>& x, double freq, double sampleRate)
+{
+    double re = 0;
+    double im = 0;
+    double windowSum = 0;
+    const int n = int(x.size());
+    for (int i = 0; i < n; ++i) {
+        const double w = .5 - .5 * std::cos(2 * AudioMath::Pi * i / (n - 1));
+        const double phase = 2 * AudioMath::Pi * freq * i / sampleRate;
+        re += x[i] * w * std::cos(phase);
+        im -= x[i] * w * std::sin(phase);
+        windowSum += w;
+    }
+    return 2 * std::sqrt(re * re + im * im) / windowSum;
+}
+
+static std::vector<float> captureOrgan(Organ& organ, const Organ::ProcessArgs& args)
+{
+    std::vector<float> ret;
+    for (int i = 0; i < 22050; ++i) {
+        organ.process(args);
+        ret.push_back(organ.outputs[Organ::MAIN_OUTPUT].getVoltage(0));
+    }
+    return ret;
+}
+
+// the wavetables should have the same partials as the oscillators
+static void testWavetableSpectrum()
+{
+    Organ::ProcessArgs args;
+    args.sampleRate = 44100;
+    args.sampleTime = 1.f / args.sampleRate;
+
+    Organ additive;
+    setupOrgan(additive, false);
+    Organ wavetable;
+    setupOrgan(wavetable, true);
+    runUntilWavetable(wavetable, args);
+    assert(!additive._usingWavetable());
+
+    const std::vector<float> additiveOut = captureOrgan(additive, args);
+    const std::vector<float> wavetableOut = captureOrgan(wavetable, args);
+    assert(wavetable._usingWavetable());
+
+    // the oscillators are equal tempered, the tables are harmonic.
+    const double semitonesFromC3[9] = {0, 19, 12, 24, 31, 36, 40, 43, 48};
+    const double c3 = 261.6256 / 2;
+    for (int i = 0; i < 9; ++i) {
+        const double additiveFreq = c3 * std::pow(2.0, semitonesFromC3[i] / 12);
+        const double wavetableFreq = c3 * SinesWavetable::harmonic(i);
+        const double additiveAmp = partialAmplitude(additiveOut, additiveFreq, args.sampleRate);
+        const double wavetableAmp = partialAmplitude(wavetableOut, wavetableFreq, args.sampleRate);
+        if (i == 4) {
+            // 2 2/3' drawbar is off
+            assertLT(additiveAmp, .001);
+            assertLT(wavetableAmp, .001);
+        } else {
+            assertGT(additiveAmp, .05);
+            assertClose(AudioMath::db(wavetableAmp), AudioMath::db(additiveAmp), .1);
+        }
+    }
+}
+
+// the table thread only starts when wavetable mode is first turned on
+static void testWavetableServerStart()
+{
+    Organ::ProcessArgs args;
+    args.sampleRate = 44100;
+    args.sampleTime = 1.f / args.sampleRate;
+
+    Organ organ;
+    setupOrgan(organ, false);
+    for (int i = 0; i < 1000; ++i) {
+        organ.process(args);
+    }
+    assert(!organ._hasTableServer());
+
+    // drawbar CV keeps it additive, so still no thread
+    organ.params[Organ::WAVETABLE_PARAM].value = 1;
+    organ.inputs[Organ::DRAWBAR3_INPUT].channels = 1;
+    for (int i = 0; i < 1000; ++i) {
+        organ.process(args);
+    }
+    assert(!organ._hasTableServer());
+
+    organ.inputs[Organ::DRAWBAR3_INPUT].channels = 0;
+    runUntilWavetable(organ, args);
+    assert(organ._hasTableServer());
+}
+
+// drawbar CV can't use the tables
+static void testWavetableDrawbarCV()
+{
+    Organ::ProcessArgs args;
+    args.sampleRate = 44100;
+    args.sampleTime = 1.f / args.sampleRate;
+
+    Organ organ;
+    setupOrgan(organ, true);
+    runUntilWavetable(organ, args);
+
+    organ.inputs[Organ::DRAWBAR3_INPUT].channels = 1;
+    organ.inputs[Organ::DRAWBAR3_INPUT].setVoltage(5, 0);
+    for (int i = 0; i < 32; ++i) {
+        organ.process(args);
+    }
+    assert(!organ._usingWavetable());
+
+    organ.inputs[Organ::DRAWBAR3_INPUT].channels = 0;
+    for (int i = 0; i < 32; ++i) {
+        organ.process(args);
+    }
+    assert(organ._usingWavetable());
+}
+
+// changing the drawbars renders a new table, and fades to it
+static void testWavetableChange()
+{
+    Organ::ProcessArgs args;
+    args.sampleRate = 44100;
+    args.sampleTime = 1.f / args.sampleRate;
+
+    Organ organ;
+    setupOrgan(organ, true);
+    runUntilWavetable(organ, args);
+
+    for (int i = 0; i < 9; ++i) {
+        organ.params[Organ::DRAWBAR1_PARAM + i].value = 0;
+    }
+    organ.params[Organ::PERCUSSION2_PARAM].value = 0;
+
+    float lastOutput = 0;
+    float maxOutput = 1;
+    // percussion at zero is -100 dB, not off.
+    while (maxOutput > .0001) {
+        maxOutput = 0;
+        for (int i = 0; i < 512; ++i) {
+            organ.process(args);
+            const float output = organ.outputs[Organ::MAIN_OUTPUT].getVoltage(0);
+            maxOutput = std::max(maxOutput, std::abs(output));
+
+            // nothing above 2kHz, so it can't move much in one sample.
+            assertLT(std::abs(output - lastOutput), .5);
+            lastOutput = output;
+        }
+    }
+    assert(organ._usingWavetable());
+}
+
 void testSines()
 {
     testSines0();
     testSines1();
+    testWavetableLevels();
+    testWavetableRender();
+    testWavetableSpectrum();
+    testWavetableServerStart();
+    testWavetableDrawbarCV();
+    testWavetableChange();
 }
\ No newline at end of file
@@ -205,6 +205,7 @@ static void testSplineExtremes()
     paramLimits[sp.PARAM_OFFSET_TRIM] = fp(-1.f, 1.f);
     paramLimits[sp.PARAM_OVERSAMPLE] = fp(0.f, 2.f);
     paramLimits[sp.PARAM_ACDC] = fp(0.f, 1.f);
+    paramLimits[sp.PARAM_ADAA] = fp(0.f, 2.f);
 
     ExtremeTester< Shaper<TestComposite>>::test(sp, paramLimits, true, "shaper");
 }
@@ -1,12 +1,15 @@
+#include "asserts.h"
 
 #include "GenerativeTriggerGenerator.h"
 #include "StochasticGrammar.h"
 #include "TriggerSequencer.h"
 
+#include <map>
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 #include <set>
-//#include <random>
 
 static const int numRules = fullRuleTableSize;
 
@@ -138,6 +141,10 @@ public:
        // printf("\n");
         return (int) keys.size();
     }
+    const std::vector<GKEY>& getKeys() const
+    {
+        return keys;
+    }
 private:
     std::vector<GKEY> keys;
 };
@@ -471,6 +478,114 @@ static void gtg1()
 
 
 
+/********************************************************************************************
+* CompiledGrammar
+**********************************************************************************************/
+
+// repeatable random, that can be copied and still share state
+static AudioMath::RandomUniformFunc makeRandom(int seed)
+{
+    auto generator = std::make_shared<std::default_random_engine>(seed);
+    return [generator]() {
+        std::uniform_real_distribution<float> distribution{0, 1.0};
+        return distribution(*generator);
+    };
+}
+
+// given the same random numbers, compiled grammar must make the same symbols
+static void testCompiledMatches(const ProductionRule * theRules, int theNumRules, GKEY first)
+{
+    AudioMath::RandomUniformFunc r1 = makeRandom(123);
+    AudioMath::RandomUniformFunc r2 = makeRandom(123);
+    CompiledGrammar compiled(theRules, theNumRules, first);
+
+    for (int i = 0; i < 1000; ++i) {
+        TestEvaluator es(r1);
+        es.rules = theRules;
+        es.numRules = theNumRules;
+        ProductionRule::evaluate(es, first);
+
+        GKEY keys[CompiledGrammar::maxSymbols];
+        const int numKeys = compiled.evaluate(r2, keys, CompiledGrammar::maxSymbols);
+        assertEQ(numKeys, int(es.getKeys().size()));
+        for (int j = 0; j < numKeys; ++j) {
+            assertEQ(keys[j], es.getKeys()[j]);
+        }
+    }
+}
+
+static void testCompiledMatches()
+{
+    for (int i = 0; i < StochasticGrammarDictionary::getNumGrammars(); ++i) {
+        StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(i);
+        testCompiledMatches(g.rules, g.numRules, g.firstRule);
+    }
+    testCompiledMatches(rules, numRules, init1());
+    testCompiledMatches(rules, numRules, init2());
+}
+
+// with independent random numbers, the symbol counts should come out about the same
+static void testCompiledDistribution(int grammarIndex)
+{
+    StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(grammarIndex);
+    AudioMath::RandomUniformFunc r1 = makeRandom(1);
+    AudioMath::RandomUniformFunc r2 = makeRandom(2);
+    CompiledGrammar compiled(g.rules, g.numRules, g.firstRule);
+
+    const int numBars = 20000;
+    std::map<GKEY, int> expected;
+    std::map<GKEY, int> actual;
+    int totalExpected = 0;
+    int totalActual = 0;
+    for (int i = 0; i < numBars; ++i) {
+        TestEvaluator es(r1);
+        es.rules = g.rules;
+        es.numRules = g.numRules;
+        ProductionRule::evaluate(es, g.firstRule);
+        for (GKEY key : es.getKeys()) {
+            ++expected[key];
+            ++totalExpected;
+        }
+
+        GKEY keys[CompiledGrammar::maxSymbols];
+        const int numKeys = compiled.evaluate(r2, keys, CompiledGrammar::maxSymbols);
+        for (int j = 0; j < numKeys; ++j) {
+            ++actual[keys[j]];
+            ++totalActual;
+        }
+    }
+
+    assertClose(double(totalActual) / totalExpected, 1, .02);
+    for (auto it : expected) {
+        const double expectedFraction = double(it.second) / totalExpected;
+        const double actualFraction = double(actual[it.first]) / totalActual;
+        assertClose(actualFraction, expectedFraction, .01);
+    }
+    assertEQ(expected.size(), actual.size());
+}
+
+// lookahead must not change what gets played
+static void testLookahead()
+{
+    StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(3);
+    GenerativeTriggerGenerator gtg1(makeRandom(55), g.rules, g.numRules, g.firstRule);
+    GenerativeTriggerGenerator gtg2(makeRandom(55), g.rules, g.numRules, g.firstRule);
+
+    int numTriggers = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if ((i % 7) == 0) {
+            gtg2.fillLookahead();
+        }
+        const bool b1 = gtg1.clock();
+        const bool b2 = gtg2.clock();
+        assertEQ(b1, b2);
+        if (b1) {
+            ++numTriggers;
+        }
+    }
+    assertGT(numTriggers, 100000 / PPQ);
+}
+
 void testStochasticGrammar()
 {
     test0();
@@ -495,4 +610,10 @@ void testStochasticGrammar()
     gtg0();
     gtg1();
 
+    testCompiledMatches();
+    for (int i = 0; i < StochasticGrammarDictionary::getNumGrammars(); ++i) {
+        testCompiledDistribution(i);
+    }
+    testLookahead();
+
 }
\ No newline at end of file
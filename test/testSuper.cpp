@@ -1,8 +1,13 @@
 
+#include "StateVariable4PHP.h"
+#include "StateVariable4PHP_4.h"
 #include "Super.h"
 #include "TestComposite.h"
 #include "asserts.h"
 
+#include <cmath>
+#include <vector>
+
 using Comp = Super<TestComposite>;
 
 static void test0()
@@ -94,6 +99,91 @@ static void testRun()
     testRun(0);
 }
 
+/**
+ * Each lane of the four channel filter must match the scalar one.
+ */
+static void testHPF4()
+{
+    const float cutoffs[4] = {.001f, .01f, .1f, .4f};
+    StateVariable4PHP_4 filter4;
+    StateVariable4PHP filters[4];
+    for (int i = 0; i < 4; ++i) {
+        filter4.setCutoff(i, cutoffs[i]);
+        filters[i].setCutoff(cutoffs[i]);
+    }
+
+    for (int sample = 0; sample < 1000; ++sample) {
+        const float x = (sample % 37) < 18 ? 1.f : -1.f;
+        const float_4 y4 = filter4.run(float_4(x, -x, x, .5f * x));
+        assertClose(y4[0], filters[0].run(x), 1e-4);
+        assertClose(y4[1], filters[1].run(-x), 1e-4);
+        assertClose(y4[2], filters[2].run(x), 1e-4);
+        assertClose(y4[3], filters[3].run(.5f * x), 1e-4);
+    }
+}
+
+/**
+ * Each channel of a poly Super must match a mono Super
+ * with the same pitch and detune.
+ */
+static void testPolyMatchesMono(int numChannels, bool stereo, int mode)
+{
+    auto setup = [stereo, mode](Comp& comp, int channels) {
+        comp.init();
+        comp.params[Comp::CLEAN_PARAM].value = float(mode);
+        comp.outputs[Comp::MAIN_OUTPUT_LEFT].channels = 1;
+        comp.outputs[Comp::MAIN_OUTPUT_RIGHT].channels = stereo ? 1 : 0;
+        comp.inputs[Comp::CV_INPUT].channels = channels;
+        comp.inputs[Comp::DETUNE_INPUT].channels = channels;
+        comp.inputs[Comp::MIX_INPUT].channels = channels;
+    };
+
+    Comp poly;
+    setup(poly, numChannels);
+    std::vector<CompPtr> monos;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        CompPtr mono = std::make_shared<Comp>();
+        setup(*mono, 1);
+        const float cv = -1 + float(channel) / 4;
+        const float detune = float(channel % 5) - 2;
+        const float mix = 2 - float(channel % 3);
+        poly.inputs[Comp::CV_INPUT].setVoltage(cv, channel);
+        poly.inputs[Comp::DETUNE_INPUT].setVoltage(detune, channel);
+        poly.inputs[Comp::MIX_INPUT].setVoltage(mix, channel);
+        mono->inputs[Comp::CV_INPUT].setVoltage(cv, 0);
+        mono->inputs[Comp::DETUNE_INPUT].setVoltage(detune, 0);
+        mono->inputs[Comp::MIX_INPUT].setVoltage(mix, 0);
+        monos.push_back(mono);
+    }
+
+    bool sawSignal = false;
+    for (int sample = 0; sample < 1000; ++sample) {
+        poly.step();
+        assertEQ(poly.outputs[Comp::MAIN_OUTPUT_LEFT].getChannels(), numChannels);
+        for (int channel = 0; channel < numChannels; ++channel) {
+            Comp& mono = *monos[channel];
+            mono.step();
+            const float left = mono.outputs[Comp::MAIN_OUTPUT_LEFT].getVoltage(0);
+            const float right = mono.outputs[Comp::MAIN_OUTPUT_RIGHT].getVoltage(0);
+            assertClose(poly.outputs[Comp::MAIN_OUTPUT_LEFT].getVoltage(channel), left, 1e-4);
+            if (stereo) {
+                assertClose(poly.outputs[Comp::MAIN_OUTPUT_RIGHT].getVoltage(channel), right, 1e-4);
+            }
+            sawSignal |= (std::abs(left) > .1);
+        }
+    }
+    assert(sawSignal);
+}
+
+static void testPolyMatchesMono()
+{
+    testPolyMatchesMono(16, false, 0);
+    testPolyMatchesMono(16, true, 0);
+    testPolyMatchesMono(7, false, 1);
+    testPolyMatchesMono(6, true, 1);
+    testPolyMatchesMono(5, true, 2);
+}
+
 #if 0 // just for debugging
 static void testFM()
 {
@@ -126,5 +216,7 @@ void testSuper()
     testOutput(true, 2, 3);     // clean stereo, channel4
 
     testRun();
+    testHPF4();
+    testPolyMatchesMono();
    // testFM();
 }
\ No newline at end of file
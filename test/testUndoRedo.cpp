@@ -2,7 +2,15 @@
 #include <assert.h>
 #include <assert.h>
 
+#include "asserts.h"
+#include "MidiEditor.h"
+#include "MidiSequencer.h"
+#include "MidiSong.h"
+#include "MidiTrack.h"
+#include "ReplaceDataCommand.h"
 #include "SqCommand.h"
+#include "TestAuditionHost.h"
+#include "TestSettings.h"
 #include "UndoRedoStack.h"
 
 class Cmd : public SqCommand
@@ -17,9 +25,15 @@ public:
         ++undoCount;
     }
 
+    size_t getMemoryUsage() const override
+    {
+        return memory;
+    }
+
     int id;
     int executeCount = 0;
     int undoCount = 0;
+    size_t memory = 100;
 };
 
 using Cp = std::shared_ptr<Cmd>;
@@ -77,8 +91,120 @@ static void test1()
     assert(cmd->undoCount == 1);
 }
 
+static void testMemoryUsed()
+{
+    UndoRedoStack ur;
+    assertEQ(ur.getMemoryUsed(), 0);
+
+    std::shared_ptr<Cmd> cmd(std::make_shared<Cmd>());
+    ur.execute(nullptr, cmd);
+    assertEQ(ur.getMemoryUsed(), 100);
+
+    std::shared_ptr<Cmd> cmd2(std::make_shared<Cmd>());
+    cmd2->memory = 50;
+    ur.execute(nullptr, cmd2);
+    assertEQ(ur.getMemoryUsed(), 150);
+
+    // redo records count, too
+    ur.undo(nullptr);
+    assertEQ(ur.getMemoryUsed(), 150);
+}
+
+static void testMemoryLimit()
+{
+    UndoRedoStack ur;
+    ur.setMaxMemory(250);
+    assertEQ(ur.getMaxMemory(), 250);
+
+    std::shared_ptr<Cmd> cmds[3];
+    for (int i = 0; i < 3; ++i) {
+        cmds[i] = std::make_shared<Cmd>();
+        cmds[i]->id = i;
+        ur.execute(nullptr, cmds[i]);
+    }
+
+    // oldest one should be gone
+    assertEQ(ur.getMemoryUsed(), 200);
+    ur.undo(nullptr);
+    ur.undo(nullptr);
+    assert(!ur.canUndo());
+    assertEQ(cmds[2]->undoCount, 1);
+    assertEQ(cmds[1]->undoCount, 1);
+    assertEQ(cmds[0]->undoCount, 0);
+
+    // lowering the limit trims the redo list first
+    ur.redo(nullptr);
+    ur.setMaxMemory(150);
+    assertEQ(ur.getMemoryUsed(), 100);
+    assert(ur.canUndo());
+    assert(!ur.canRedo());
+}
+
+static void testMemoryLimitKeepsLast()
+{
+    UndoRedoStack ur;
+    ur.setMaxMemory(10);
+
+    std::shared_ptr<Cmd> cmd(std::make_shared<Cmd>());
+    ur.execute(nullptr, cmd);
+    std::shared_ptr<Cmd> cmd2(std::make_shared<Cmd>());
+    ur.execute(nullptr, cmd2);
+
+    // even if it's too big, we always keep the most recent
+    assertEQ(ur.getMemoryUsed(), 100);
+    ur.undo(nullptr);
+    assertEQ(cmd2->undoCount, 1);
+    assert(!ur.canUndo());
+
+    // zero is no limit
+    ur.setMaxMemory(0);
+    ur.execute(nullptr, cmd);
+    ur.execute(nullptr, cmd2);
+    assertEQ(ur.getMemoryUsed(), 200);
+}
+
+static void testReplaceMemory()
+{
+    MidiSongPtr song = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+    MidiSequencerPtr seq = MidiSequencer::make(
+        song,
+        std::make_shared<TestSettings>(),
+        std::make_shared<TestAuditionHost>());
+    seq->editor->selectAll();
+
+    auto cmd = ReplaceDataCommand::makeChangePitchCommand(seq, 1);
+
+    // before execute, the events to remove are still in the track,
+    // so only the new ones are ours.
+    const size_t eventMem = MidiTrack::getEventMemoryUsage();
+
+    // if all 16 events were counted we would be over this
+    const size_t limit = 16 * (eventMem + sizeof(MidiEventPtr));
+    const size_t before = cmd->getMemoryUsage();
+    assertGE(before, 8 * eventMem);
+    assertLT(before, limit);
+
+    seq->undo->execute(seq, cmd);
+
+    // now the old ones are only held by the command
+    const size_t after = seq->undo->getMemoryUsed();
+    assertGE(after, 8 * eventMem);
+    assertLT(after, limit);
+
+    seq->undo->undo(seq);
+    assertGE(seq->undo->getMemoryUsed(), 8 * eventMem);
+    assertLT(seq->undo->getMemoryUsed(), limit);
+
+    // a whole song snapshot is bigger than its events
+    assertGT(song->getMemoryUsage(), 8 * eventMem);
+}
+
 void testUndoRedo()
 {
     test0();
     test1();
+    testMemoryUsed();
+    testMemoryLimit();
+    testMemoryLimitKeepsLast();
+    testReplaceMemory();
 }
\ No newline at end of file
@@ -25,7 +25,40 @@ static void testDiv0()
     assert(called);
 }
 
+static void testDivStepAndFire()
+{
+    int calls = 0;
+    int elapsed = 0;
+    Divider d;
+    auto lambda = [&]() {
+        ++calls;
+        elapsed = d.getElapsed();
+    };
+    d.setup(4, lambda);
+
+    d.step();
+    assertEQ(calls, 1);
+    d.step();
+    d.step();
+    assertEQ(calls, 1);
+
+    // fire early, should get the short count
+    d.stepAndFire();
+    assertEQ(calls, 2);
+    assertEQ(elapsed, 3);
+
+    // and then a full count from there
+    d.step();
+    d.step();
+    d.step();
+    assertEQ(calls, 2);
+    d.step();
+    assertEQ(calls, 3);
+    assertEQ(elapsed, 4);
+}
+
 void testUtils()
 {
     testDiv0();
+    testDivStepAndFire();
 }
\ No newline at end of file